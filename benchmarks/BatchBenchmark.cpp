@@ -0,0 +1,151 @@
+// Copyright 2012-2016 CNRS-UM LIRMM, CNRS-AIST JRL
+//
+// This file is part of Tasks.
+//
+// Tasks is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Tasks is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with Tasks.  If not, see <http://www.gnu.org/licenses/>.
+
+// includes
+// std
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <memory>
+#include <random>
+#include <thread>
+#include <tuple>
+
+// boost
+#include <boost/math/constants/constants.hpp>
+
+// RBDyn
+#include <RBDyn/FK.h>
+#include <RBDyn/FV.h>
+
+// Tasks
+#include "Tasks/Bounds.h"
+#include "Tasks/QPConstr.h"
+#include "Tasks/QPSolver.h"
+#include "Tasks/QPTasks.h"
+
+// Arms
+#include "arms.h"
+
+
+/// Tasks and constraints of one solver.
+struct Setup
+{
+	Setup(const std::vector<rbd::MultiBody>& mbs,
+		const rbd::MultiBodyConfig& mbcInit, tasks::qp::QPSolver& solver):
+		posTask(mbs, 0, "b3", Eigen::Vector3d(0.5, 0.5, 0.)),
+		posTaskSp(mbs, 0, &posTask, 10., 1.),
+		postureTask(mbs, 0, mbcInit.q, 1., 0.01),
+		jointConstr(mbs, 0, {lBound(), uBound()}, 0.001)
+	{
+		solver.solver("QLD");
+		jointConstr.addToSolver(solver);
+		solver.addTask(&posTaskSp);
+		solver.addTask(&postureTask);
+		solver.nrVars(mbs, {}, {});
+		solver.updateConstrSize();
+	}
+
+	static std::vector<std::vector<double>> lBound()
+	{
+		namespace cst = boost::math::constants;
+		double inf = std::numeric_limits<double>::infinity();
+		return {{}, {-cst::pi<double>()/4.}, {-inf}, {-inf}};
+	}
+
+	static std::vector<std::vector<double>> uBound()
+	{
+		namespace cst = boost::math::constants;
+		double inf = std::numeric_limits<double>::infinity();
+		return {{}, {cst::pi<double>()/4.}, {inf}, {inf}};
+	}
+
+	tasks::qp::PositionTask posTask;
+	tasks::qp::SetPointTask posTaskSp;
+	tasks::qp::PostureTask postureTask;
+	tasks::qp::JointLimitsConstr jointConstr;
+};
+
+
+int main(int argc, char** argv)
+{
+	using namespace tasks;
+
+	const int nrConfigs = argc > 1 ? std::atoi(argv[1]) : 20000;
+	const int maxThreads =
+		std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+
+	rbd::MultiBody mb;
+	rbd::MultiBodyConfig mbcInit;
+	std::tie(mb, mbcInit) = makeZXZArm();
+	std::vector<rbd::MultiBody> mbs = {mb};
+
+	// random configurations
+	std::mt19937 gen(42);
+	std::uniform_real_distribution<double> dist(-1., 1.);
+	std::vector<std::vector<rbd::MultiBodyConfig>> batch(nrConfigs, {mbcInit});
+	for(std::vector<rbd::MultiBodyConfig>& mbcs: batch)
+	{
+		for(int i = 1; i < mb.nrJoints(); ++i)
+		{
+			mbcs[0].q[i][0] = dist(gen);
+			mbcs[0].alpha[i][0] = dist(gen);
+		}
+		rbd::forwardKinematics(mb, mbcs[0]);
+		rbd::forwardVelocity(mb, mbcs[0]);
+	}
+
+	Eigen::MatrixXd results;
+	Eigen::Array<bool, Eigen::Dynamic, 1> success;
+
+	std::cout << nrConfigs << " configurations" << std::endl;
+	std::cout << std::setw(8) << "threads" << std::setw(14) << "solves/s"
+		<< std::setw(10) << "speedup" << std::endl;
+	double ref = 0.;
+	for(int nrThreads = 1; nrThreads <= maxThreads; nrThreads *= 2)
+	{
+		std::vector<std::unique_ptr<Setup>> setups;
+		qp::QPBatchSolver batchSolver(nrThreads,
+			[&](qp::QPSolver& solver)
+			{
+				setups.emplace_back(new Setup(mbs, mbcInit, solver));
+			});
+
+		auto start = std::chrono::steady_clock::now();
+		int nrSuccess = batchSolver.solve(mbs, batch, results, success);
+		std::chrono::duration<double> time = std::chrono::steady_clock::now() - start;
+
+		double throughput = nrConfigs/time.count();
+		if(nrThreads == 1)
+		{
+			ref = throughput;
+		}
+		std::cout << std::setw(8) << nrThreads << std::setw(14) << std::fixed
+			<< std::setprecision(0) << throughput << std::setw(10)
+			<< std::setprecision(2) << throughput/ref;
+		if(nrSuccess != nrConfigs)
+		{
+			std::cout << " (" << nrConfigs - nrSuccess << " failures)";
+		}
+		std::cout << std::endl;
+	}
+
+	return 0;
+}
@@ -0,0 +1,160 @@
+// Copyright 2012-2016 CNRS-UM LIRMM, CNRS-AIST JRL
+//
+// This file is part of Tasks.
+//
+// Tasks is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Tasks is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with Tasks.  If not, see <http://www.gnu.org/licenses/>.
+
+// includes
+// std
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+#include <limits>
+#include <map>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+// Tasks
+#include "Tasks/GenQPSolver.h"
+#include "Tasks/QPRecorder.h"
+
+
+/*
+	* Solve again the QPs recorded by a QPRecorder (see QPSolver::recorder)
+	* and compare the solvers timing and solution with the recorded ones.
+	*
+	* Usage: QPReplay file=<path> [solvers=<all>] [repeat=1] [qps=<record>]
+	*
+	* Each record is solved repeat times by each solver (one backend by solver
+	* kept for all the records, like in the control loop).
+	* One CSV line is written on the standard output by record and solver,
+	* max_diff being the infinity norm between the recorded and the new solution.
+	* With qps the record is only written in the QPS format on the standard output.
+	*/
+
+
+std::vector<std::string> split(const std::string& str)
+{
+	std::vector<std::string> res;
+	std::istringstream ss(str);
+	std::string item;
+	while(std::getline(ss, item, ','))
+	{
+		res.push_back(item);
+	}
+	return res;
+}
+
+
+double us(double s)
+{
+	return s*1e6;
+}
+
+
+int main(int argc, char** argv)
+{
+	using namespace tasks;
+
+	std::map<std::string, std::string> args = {
+		{"file", ""}, {"solvers", ""}, {"repeat", "1"}, {"qps", ""}};
+	for(int i = 1; i < argc; ++i)
+	{
+		std::string arg(argv[i]);
+		std::size_t eq = arg.find('=');
+		if(eq == std::string::npos || args.find(arg.substr(0, eq)) == args.end())
+		{
+			std::cerr << "unknown argument " << arg << std::endl;
+			return 1;
+		}
+		args[arg.substr(0, eq)] = arg.substr(eq + 1);
+	}
+	if(args["file"].empty())
+	{
+		std::cerr << "usage: QPReplay file=<path> [solvers=<all>] [repeat=1] "
+			"[qps=<record>]" << std::endl;
+		return 1;
+	}
+
+	qp::QPRecordReader reader;
+	qp::QPRecord rec;
+	try
+	{
+		reader.open(args["file"]);
+	}
+	catch(const std::runtime_error& e)
+	{
+		std::cerr << e.what() << std::endl;
+		return 1;
+	}
+
+	if(!args["qps"].empty())
+	{
+		int i = std::atoi(args["qps"].c_str());
+		if(i < 0 || i >= reader.nrRecords())
+		{
+			std::cerr << "no record " << i << " in " << args["file"] << std::endl;
+			return 1;
+		}
+		reader.read(i, rec);
+		qp::writeQPS(rec, "record" + std::to_string(i), std::cout);
+		return 0;
+	}
+
+	std::vector<std::string> solvers =
+		args["solvers"].empty() ? qp::qpSolverNames() : split(args["solvers"]);
+	const int repeat = std::max(1, std::atoi(args["repeat"].c_str()));
+
+	std::vector<std::unique_ptr<qp::QPReplay>> replays;
+	for(const std::string& name: solvers)
+	{
+		replays.emplace_back(new qp::QPReplay(name));
+	}
+
+	std::cout << "record,nrVars,nrLines,recorded_status,recorded_update_us,"
+		"recorded_solve_us,solver,status,update_us,solve_min_us,solve_max_us,"
+		"iterations,max_diff" << std::endl;
+
+	for(int r = 0; r < reader.nrRecords(); ++r)
+	{
+		reader.read(r, rec);
+		for(std::size_t s = 0; s < solvers.size(); ++s)
+		{
+			qp::QPReplay& replay = *replays[s];
+			double solveMin = std::numeric_limits<double>::infinity();
+			double solveMax = 0.;
+			for(int i = 0; i < repeat; ++i)
+			{
+				replay.solve(rec);
+				solveMin = std::min(solveMin, replay.solveTime());
+				solveMax = std::max(solveMax, replay.solveTime());
+			}
+
+			double maxDiff = rec.nrVars > 0 ?
+				(replay.result() - rec.result).lpNorm<Eigen::Infinity>() : 0.;
+			std::cout << r << "," << rec.nrVars << "," << rec.A.rows() << ","
+				<< static_cast<int>(rec.status) << "," << us(rec.updateTime) << ","
+				<< us(rec.solveTime) << "," << solvers[s] << ","
+				<< static_cast<int>(replay.solver().status()) << ","
+				<< us(replay.updateTime()) << "," << us(solveMin) << ","
+				<< us(solveMax) << "," << replay.solver().iterations() << ","
+				<< maxDiff << std::endl;
+		}
+	}
+
+	return 0;
+}
@@ -0,0 +1,320 @@
+// Copyright 2012-2016 CNRS-UM LIRMM, CNRS-AIST JRL
+//
+// This file is part of Tasks.
+//
+// Tasks is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Tasks is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with Tasks.  If not, see <http://www.gnu.org/licenses/>.
+
+// includes
+// std
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#ifdef __GLIBC__
+#include <malloc.h>
+#endif
+
+// RBDyn
+#include <RBDyn/EulerIntegration.h>
+#include <RBDyn/FK.h>
+#include <RBDyn/FV.h>
+
+// sch
+#include <sch/CD/CD_Pair.h>
+#include <sch/S_Object/S_Sphere.h>
+
+// Tasks
+#include "Tasks/Bounds.h"
+#include "Tasks/GenQPSolver.h"
+#include "Tasks/QPConstr.h"
+#include "Tasks/QPContactConstr.h"
+#include "Tasks/QPMotionConstr.h"
+#include "Tasks/QPSolver.h"
+#include "Tasks/QPTasks.h"
+
+// Generators
+#include "generators.h"
+
+
+/*
+	* Measure the solver build time, solve time and memory as a function of
+	* the problem size.
+	*
+	* Usage: ScaleBenchmark [key=value[,value...]]...
+	* model=chain,tree,humanoid dof=6,12,24,48 robots=1 contacts=0,2
+	* collisions=0,4 tasks=2 solvers=<all> iter=200 switch=50 cache=0
+	*
+	* Every combination of the given values is run with each solver backend.
+	* The robots state is integrated after each solve and, every switch
+	* iterations (0 to disable), the last contact is removed or added back.
+	* switch_mean_us is the nrVars and updateConstrSize cost of a switch,
+	* with cache=2 the two contact sets are swapped from the backend cache
+	* (see QPSolver::backendCacheSize).
+	* One CSV line is written on the standard output by run so two versions
+	* can be compared with diff or any CSV tool.
+	*/
+
+
+/// Solver with the tasks and constraints of a generated scene.
+struct Setup
+{
+	Setup(const gen::Scene& s, const std::string& solverName, int nrTasks,
+		int cacheSize):
+		contactConstr(),
+		plConstr(),
+		collConstr(s.mbs, 0.001)
+	{
+		using namespace tasks;
+		solver.solver(solverName);
+
+		const int nrRobots = s.envIndex();
+		for(int r = 0; r < nrRobots; ++r)
+		{
+			std::vector<std::vector<double>> lB, uB;
+			std::tie(lB, uB) = gen::torqueBounds(s.mbs[r], s.mbcs[r], 1000.);
+			motionConstrs.emplace_back(new qp::MotionConstr(s.mbs, r, {lB, uB}));
+			motionConstrs.back()->addToSolver(solver);
+
+			postureTasks.emplace_back(new qp::PostureTask(s.mbs, r, s.mbcs[r].q,
+				1., 0.01));
+			solver.addTask(postureTasks.back().get());
+		}
+
+		if(!s.contacts.empty())
+		{
+			contactConstr.addToSolver(solver);
+			plConstr.addToSolver(solver);
+		}
+
+		sva::PTransformd I = sva::PTransformd::Identity();
+		for(std::size_t i = 0; i < s.collisions.size(); ++i)
+		{
+			const gen::Collision& c = s.collisions[i];
+			hulls.emplace_back(new sch::S_Sphere(0.05));
+			sch::S_Object* robotHull = hulls.back().get();
+			hulls.emplace_back(new sch::S_Sphere(0.05));
+			sch::S_Object* envHull = hulls.back().get();
+			collConstr.addCollision(s.mbs, static_cast<int>(i),
+				c.robot, c.body, robotHull, I,
+				s.envIndex(), "b0", envHull, c.X_env_obstacle,
+				0.1, 0.02, 0.);
+		}
+		if(!s.collisions.empty())
+		{
+			collConstr.addToSolver(solver);
+		}
+
+		for(int i = 0; i < nrTasks; ++i)
+		{
+			int r = i%nrRobots;
+			const std::vector<std::string>& ee = s.endEffectors[r];
+			const std::string& body = ee[(i/nrRobots)%ee.size()];
+			int bodyIndex = s.mbs[r].bodyIndexByName(body);
+			Eigen::Vector3d target = s.mbcs[r].bodyPosW[bodyIndex].translation() +
+				Eigen::Vector3d(0.05, 0.05, 0.);
+			posTasks.emplace_back(new qp::PositionTask(s.mbs, r, body, target));
+			spTasks.emplace_back(new qp::SetPointTask(s.mbs, r, posTasks.back().get(),
+				10., 1.));
+			solver.addTask(spTasks.back().get());
+		}
+
+		solver.backendCacheSize(cacheSize);
+		solver.nrVars(s.mbs, s.contacts, {});
+		solver.updateConstrSize();
+	}
+
+	std::vector<std::unique_ptr<tasks::qp::MotionConstr>> motionConstrs;
+	std::vector<std::unique_ptr<tasks::qp::PostureTask>> postureTasks;
+	std::vector<std::unique_ptr<tasks::qp::PositionTask>> posTasks;
+	std::vector<std::unique_ptr<tasks::qp::SetPointTask>> spTasks;
+	std::vector<std::unique_ptr<sch::S_Sphere>> hulls;
+	tasks::qp::ContactAccConstr contactConstr;
+	tasks::qp::PositiveLambda plConstr;
+	tasks::qp::CollisionConstr collConstr;
+	tasks::qp::QPSolver solver;
+};
+
+
+/// @return Heap memory in use in bytes or -1 if unknown.
+long heapInUse()
+{
+#if defined(__GLIBC__) && (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 33))
+	return static_cast<long>(mallinfo2().uordblks);
+#else
+	return -1;
+#endif
+}
+
+
+std::vector<std::string> split(const std::string& str)
+{
+	std::vector<std::string> res;
+	std::istringstream ss(str);
+	std::string item;
+	while(std::getline(ss, item, ','))
+	{
+		res.push_back(item);
+	}
+	return res;
+}
+
+
+std::vector<int> splitInt(const std::string& str)
+{
+	std::vector<int> res;
+	for(const std::string& s: split(str))
+	{
+		res.push_back(std::atoi(s.c_str()));
+	}
+	return res;
+}
+
+
+double us(double s)
+{
+	return s*1e6;
+}
+
+
+void integrate(const std::vector<rbd::MultiBody>& mbs,
+	std::vector<rbd::MultiBodyConfig>& mbcs, double step)
+{
+	for(std::size_t r = 0; r < mbs.size(); ++r)
+	{
+		rbd::eulerIntegration(mbs[r], mbcs[r], step);
+		rbd::forwardKinematics(mbs[r], mbcs[r]);
+		rbd::forwardVelocity(mbs[r], mbcs[r]);
+	}
+}
+
+
+int main(int argc, char** argv)
+{
+	using namespace tasks;
+
+	std::map<std::string, std::string> args = {
+		{"model", "chain,tree,humanoid"}, {"dof", "6,12,24,48"}, {"robots", "1"},
+		{"contacts", "0,2"}, {"collisions", "0,4"}, {"tasks", "2"},
+		{"solvers", ""}, {"iter", "200"}, {"switch", "50"}, {"cache", "0"}};
+	for(int i = 1; i < argc; ++i)
+	{
+		std::string arg(argv[i]);
+		std::size_t eq = arg.find('=');
+		if(eq == std::string::npos || args.find(arg.substr(0, eq)) == args.end())
+		{
+			std::cerr << "unknown argument " << arg << std::endl;
+			return 1;
+		}
+		args[arg.substr(0, eq)] = arg.substr(eq + 1);
+	}
+
+	std::vector<std::string> solvers =
+		args["solvers"].empty() ? qp::qpSolverNames() : split(args["solvers"]);
+	const int nrIter = std::atoi(args["iter"].c_str());
+	const int switchPeriod = std::atoi(args["switch"].c_str());
+	const double timeStep = 0.001;
+
+	std::cout << "model,dof,robots,contacts,collisions,tasks,nrVars,solver,"
+		"build_us,total_mean_us,total_p50_us,total_p99_us,update_mean_us,"
+		"solve_mean_us,heap_bytes,failures,total_max_us,solve_max_us,"
+		"solver_iter,switches,switch_mean_us,cache,cache_hits" << std::endl;
+
+	for(const std::string& model: split(args["model"]))
+	for(int dof: splitInt(args["dof"]))
+	for(int robots: splitInt(args["robots"]))
+	for(int contacts: splitInt(args["contacts"]))
+	for(int collisions: splitInt(args["collisions"]))
+	for(int nrTasks: splitInt(args["tasks"]))
+	{
+		gen::SceneParams p;
+		p.model = model;
+		p.nrDof = dof;
+		p.nrRobots = robots;
+		p.nrContacts = contacts;
+		p.nrCollisions = collisions;
+		p.nrTasks = nrTasks;
+		gen::Scene scene = gen::makeScene(p);
+
+		// contact set without the last contact used when switching
+		std::vector<qp::UnilateralContact> switchedContacts(scene.contacts);
+		if(!switchedContacts.empty())
+		{
+			switchedContacts.pop_back();
+		}
+
+		for(const std::string& solverName: solvers)
+		for(int cacheSize: splitInt(args["cache"]))
+		{
+			std::vector<rbd::MultiBodyConfig> mbcs = scene.mbcs;
+
+			long heapStart = heapInUse();
+			auto start = std::chrono::steady_clock::now();
+			std::unique_ptr<Setup> setup(new Setup(scene, solverName, nrTasks, cacheSize));
+			std::chrono::duration<double> buildTime =
+				std::chrono::steady_clock::now() - start;
+
+			qp::QPSolver& solver = setup->solver;
+			int failures = solver.solve(scene.mbs, mbcs) ? 0 : 1;
+			long heap = heapStart < 0 ? -1 : heapInUse() - heapStart;
+
+			integrate(scene.mbs, mbcs, timeStep);
+
+			int nrSwitch = 0;
+			bool switched = false;
+			std::chrono::duration<double> switchTime(0.);
+			solver.profiler().window(nrIter);
+			solver.profiler().enabled(true);
+			for(int i = 0; i < nrIter; ++i)
+			{
+				if(switchPeriod > 0 && !scene.contacts.empty() &&
+					 i > 0 && i%switchPeriod == 0)
+				{
+					switched = !switched;
+					auto switchStart = std::chrono::steady_clock::now();
+					solver.nrVars(scene.mbs,
+						switched ? switchedContacts : scene.contacts, {});
+					solver.updateConstrSize();
+					switchTime += std::chrono::steady_clock::now() - switchStart;
+					++nrSwitch;
+				}
+
+				if(!solver.solve(scene.mbs, mbcs))
+				{
+					++failures;
+				}
+				integrate(scene.mbs, mbcs, timeStep);
+			}
+
+			qp::QPProfiler::Stats total = solver.profiler().stats("total");
+			qp::QPProfiler::Stats update = solver.profiler().stats("update");
+			qp::QPProfiler::Stats solve = solver.profiler().stats("solve");
+			std::cout << model << "," << dof << "," << robots << "," << contacts << ","
+				<< collisions << "," << nrTasks << "," << solver.nrVars() << ","
+				<< solverName << "," << us(buildTime.count()) << ","
+				<< us(total.mean) << "," << us(total.p50) << "," << us(total.p99) << ","
+				<< us(update.mean) << "," << us(solve.mean) << "," << heap << ","
+				<< failures << "," << us(total.max) << "," << us(solve.max) << ","
+				<< solver.solverIterations() << "," << nrSwitch << ","
+				<< (nrSwitch > 0 ? us(switchTime.count())/nrSwitch : 0.) << ","
+				<< cacheSize << "," << solver.backendCacheHits() << std::endl;
+		}
+	}
+
+	return 0;
+}
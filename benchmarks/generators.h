@@ -0,0 +1,328 @@
+// Copyright 2012-2016 CNRS-UM LIRMM, CNRS-AIST JRL
+//
+// This file is part of Tasks.
+//
+// Tasks is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Tasks is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with Tasks.  If not, see <http://www.gnu.org/licenses/>.
+
+#pragma once
+
+// includes
+// std
+#include <sstream>
+#include <string>
+#include <tuple>
+#include <vector>
+
+// sch
+#include <sch/S_Object/S_Sphere.h>
+
+// RBDyn
+#include <RBDyn/Body.h>
+#include <RBDyn/FK.h>
+#include <RBDyn/FV.h>
+#include <RBDyn/Joint.h>
+#include <RBDyn/MultiBody.h>
+#include <RBDyn/MultiBodyConfig.h>
+#include <RBDyn/MultiBodyGraph.h>
+
+// Tasks
+#include "Tasks/QPContacts.h"
+
+
+/**
+	* Synthetic robots and scenes of arbitrary size to measure how the solver
+	* scale with the problem dimensions.
+	*/
+namespace gen
+{
+
+
+/// Generated robot with the bodies usable as end effector.
+struct Robot
+{
+	rbd::MultiBody mb;
+	rbd::MultiBodyConfig mbc;
+	std::vector<std::string> endEffectors;
+};
+
+
+inline rbd::Joint::Type jointType(int i)
+{
+	static const rbd::Joint::Type types[] =
+		{rbd::Joint::RevZ, rbd::Joint::RevX, rbd::Joint::RevY};
+	return types[i%3];
+}
+
+
+inline std::string name(const std::string& prefix, int i)
+{
+	std::ostringstream ss;
+	ss << prefix << i;
+	return ss.str();
+}
+
+
+inline Robot finalize(rbd::MultiBodyGraph& mbg, const std::string& root,
+	bool isFixed, const sva::PTransformd& X_base, std::vector<std::string> ee)
+{
+	Robot r;
+	r.mb = mbg.makeMultiBody(root, isFixed, X_base);
+	r.mbc = rbd::MultiBodyConfig(r.mb);
+	r.mbc.zero(r.mb);
+	// without gravity every generated contact set is feasible
+	r.mbc.gravity = Eigen::Vector3d::Zero();
+	rbd::forwardKinematics(r.mb, r.mbc);
+	rbd::forwardVelocity(r.mb, r.mbc);
+	r.endEffectors = std::move(ee);
+	return r;
+}
+
+
+/// Add a limb of nrDof bodies named prefix1...prefixN to the parent body.
+inline std::string addLimb(rbd::MultiBodyGraph& mbg, const std::string& parent,
+	const sva::PTransformd& X_parent, const std::string& prefix, int nrDof,
+	double length)
+{
+	sva::RBInertiad rbi(1., Eigen::Vector3d::Zero(), Eigen::Matrix3d::Identity());
+	sva::PTransformd to(Eigen::Vector3d(0., length, 0.));
+
+	std::string prev = parent;
+	for(int i = 1; i <= nrDof; ++i)
+	{
+		std::string body = name(prefix, i);
+		std::string joint = name(prefix + "j", i);
+		mbg.addBody(rbd::Body(rbi, body));
+		mbg.addJoint(rbd::Joint(jointType(i - 1), true, joint));
+		mbg.linkBodies(prev, i == 1 ? X_parent : to, body,
+			sva::PTransformd::Identity(), joint);
+		prev = body;
+	}
+	return prev;
+}
+
+
+/**
+	* @return Serial chain of nrDof revolute joints (axis Z, X, Y, Z, ...)
+	* with bodies b0 (root), b1, ..., bN.
+	*/
+inline Robot makeChain(int nrDof, bool isFixed=true,
+	const sva::PTransformd& X_base=sva::PTransformd::Identity())
+{
+	rbd::MultiBodyGraph mbg;
+	sva::RBInertiad rbi(1., Eigen::Vector3d::Zero(), Eigen::Matrix3d::Identity());
+	mbg.addBody(rbd::Body(rbi, "b0"));
+	std::string ee = addLimb(mbg, "b0", sva::PTransformd::Identity(), "b",
+		nrDof, 1./nrDof);
+	return finalize(mbg, "b0", isFixed, X_base, {ee});
+}
+
+
+/**
+	* @return Tree of nrDof revolute joints where body i is the child of body
+	* (i - 1)/nrBranch, the leaves are the end effectors.
+	*/
+inline Robot makeTree(int nrDof, int nrBranch=2, bool isFixed=true,
+	const sva::PTransformd& X_base=sva::PTransformd::Identity())
+{
+	rbd::MultiBodyGraph mbg;
+	sva::RBInertiad rbi(1., Eigen::Vector3d::Zero(), Eigen::Matrix3d::Identity());
+	mbg.addBody(rbd::Body(rbi, "b0"));
+
+	std::vector<int> nrChild(nrDof + 1, 0);
+	for(int i = 1; i <= nrDof; ++i)
+	{
+		int parent = (i - 1)/nrBranch;
+		// spread the children of a body along X
+		double x = 0.1*(nrChild[parent]++ - (nrBranch - 1)/2.);
+		mbg.addBody(rbd::Body(rbi, name("b", i)));
+		mbg.addJoint(rbd::Joint(jointType(i - 1), true, name("j", i)));
+		mbg.linkBodies(name("b", parent),
+			sva::PTransformd(Eigen::Vector3d(x, 0.1, 0.)), name("b", i),
+			sva::PTransformd::Identity(), name("j", i));
+	}
+
+	std::vector<std::string> ee;
+	for(int i = 1; i <= nrDof; ++i)
+	{
+		if(nrChild[i] == 0)
+		{
+			ee.push_back(name("b", i));
+		}
+	}
+	return finalize(mbg, "b0", isFixed, X_base, ee);
+}
+
+
+/**
+	* @return Free flyer humanoid like robot, a torso with two legs, two arms
+	* and a head. Legs and arms have dofByLimb joints, the head two.
+	* End effectors are the leg (l_leg, r_leg) then the arm (l_arm, r_arm) tips.
+	*/
+inline Robot makeHumanoid(int dofByLimb,
+	const sva::PTransformd& X_base=sva::PTransformd::Identity())
+{
+	using namespace Eigen;
+	using namespace sva;
+
+	rbd::MultiBodyGraph mbg;
+	RBInertiad rbi(10., Vector3d::Zero(), Matrix3d::Identity());
+	mbg.addBody(rbd::Body(rbi, "torso"));
+
+	std::vector<std::string> ee;
+	ee.push_back(addLimb(mbg, "torso", PTransformd(Vector3d(0.1, -0.3, 0.)),
+		"l_leg", dofByLimb, -0.8/dofByLimb));
+	ee.push_back(addLimb(mbg, "torso", PTransformd(Vector3d(-0.1, -0.3, 0.)),
+		"r_leg", dofByLimb, -0.8/dofByLimb));
+	ee.push_back(addLimb(mbg, "torso", PTransformd(Vector3d(0.2, 0.3, 0.)),
+		"l_arm", dofByLimb, -0.6/dofByLimb));
+	ee.push_back(addLimb(mbg, "torso", PTransformd(Vector3d(-0.2, 0.3, 0.)),
+		"r_arm", dofByLimb, -0.6/dofByLimb));
+	addLimb(mbg, "torso", PTransformd(Vector3d(0., 0.4, 0.)), "head", 2, 0.1);
+
+	return finalize(mbg, "torso", false, X_base, ee);
+}
+
+
+/// @return Torque bounds of mbc shape, unactuated free flyer.
+inline std::tuple<std::vector<std::vector<double>>, std::vector<std::vector<double>>>
+torqueBounds(const rbd::MultiBody& mb, const rbd::MultiBodyConfig& mbc,
+	double limit)
+{
+	std::vector<std::vector<double>> lB(mbc.jointTorque), uB(mbc.jointTorque);
+	for(int i = 0; i < mb.nrJoints(); ++i)
+	{
+		double l = mb.joint(i).type() == rbd::Joint::Free ? 0. : limit;
+		for(std::size_t j = 0; j < lB[i].size(); ++j)
+		{
+			lB[i][j] = -l;
+			uB[i][j] = l;
+		}
+	}
+	return std::make_tuple(lB, uB);
+}
+
+
+/// Size of a generated Scene.
+struct SceneParams
+{
+	/// chain, tree or humanoid
+	std::string model = "chain";
+	/// robot dof (dof by limb for humanoid)
+	int nrDof = 6;
+	int nrRobots = 1;
+	/// unilateral contacts with the environment
+	int nrContacts = 0;
+	/// robot body and environment sphere collision pairs
+	int nrCollisions = 0;
+	/// position tasks on robot bodies
+	int nrTasks = 1;
+};
+
+
+/// Collision pair between a robot body and an environment sphere.
+struct Collision
+{
+	int robot;
+	std::string body;
+	sva::PTransformd X_env_obstacle;
+};
+
+
+/**
+	* Robots side by side along X plus a one body environment (last robot)
+	* with the contact and collision pairs to use.
+	* Contacts are set on the robots end effectors in their current position,
+	* collision obstacles are placed 0.3 above the robots bodies.
+	*/
+struct Scene
+{
+	std::vector<rbd::MultiBody> mbs;
+	std::vector<rbd::MultiBodyConfig> mbcs;
+	std::vector<std::vector<std::string>> endEffectors;
+	std::vector<tasks::qp::UnilateralContact> contacts;
+	std::vector<Collision> collisions;
+
+	int envIndex() const
+	{
+		return static_cast<int>(mbs.size()) - 1;
+	}
+};
+
+
+inline Robot makeRobot(const SceneParams& p, const sva::PTransformd& X_base)
+{
+	if(p.model == "tree")
+	{
+		return makeTree(p.nrDof, 2, true, X_base);
+	}
+	else if(p.model == "humanoid")
+	{
+		return makeHumanoid(p.nrDof, X_base);
+	}
+	return makeChain(p.nrDof, true, X_base);
+}
+
+
+inline Scene makeScene(const SceneParams& p)
+{
+	using namespace Eigen;
+	using namespace sva;
+
+	Scene s;
+	for(int r = 0; r < p.nrRobots; ++r)
+	{
+		Robot robot = makeRobot(p, PTransformd(Vector3d(2.*r, 0., 0.)));
+		s.mbs.push_back(robot.mb);
+		s.mbcs.push_back(robot.mbc);
+		s.endEffectors.push_back(robot.endEffectors);
+	}
+
+	rbd::MultiBodyGraph mbg;
+	mbg.addBody(rbd::Body(RBInertiad(1., Vector3d::Zero(), Matrix3d::Identity()),
+		"b0"));
+	Robot env = finalize(mbg, "b0", true, PTransformd::Identity(), {});
+	s.mbs.push_back(env.mb);
+	s.mbcs.push_back(env.mbc);
+
+	// the contact surfaces are 0.1x0.1 squares
+	std::vector<Vector3d> points = {Vector3d(0.05, 0.05, 0.),
+		Vector3d(-0.05, 0.05, 0.), Vector3d(-0.05, -0.05, 0.),
+		Vector3d(0.05, -0.05, 0.)};
+	for(int i = 0; i < p.nrContacts; ++i)
+	{
+		int r = i%p.nrRobots;
+		const std::vector<std::string>& ee = s.endEffectors[r];
+		const std::string& body = ee[(i/p.nrRobots)%ee.size()];
+		const PTransformd& X_0_b1 =
+			s.mbcs[r].bodyPosW[s.mbs[r].bodyIndexByName(body)];
+		s.contacts.emplace_back(tasks::qp::ContactId(r, s.envIndex(), body, "b0", i),
+			points, Matrix3d::Identity(), X_0_b1.inv(), 4, 0.7);
+	}
+
+	for(int i = 0; i < p.nrCollisions; ++i)
+	{
+		int r = i%p.nrRobots;
+		// skip the root body
+		int nrBodies = s.mbs[r].nrBodies() - 1;
+		int b = 1 + (i/p.nrRobots)%nrBodies;
+		const PTransformd& X_0_b = s.mbcs[r].bodyPosW[b];
+		s.collisions.push_back({r, s.mbs[r].body(b).name(),
+			PTransformd(Vector3d(X_0_b.translation() + Vector3d(0., 0., 0.3)))});
+	}
+
+	return s;
+}
+
+
+} // namespace gen
@@ -98,6 +98,16 @@ cdef extern from "<Tasks/QPContacts.h>" namespace "tasks::qp":
     vector[BilateralContact] allContacts() const
     void computeNormalAccB(const vector[MultiBody]&, const vector[MultiBodyConfig]&)
     vector[MotionVecd] normalAccB(int) const
+    int addBodyJacobian(const MultiBody&, int, const string&)
+    int bodyJacobianIndex(int, int) const
+    const MatrixXd& bodyJacobian(int) const
+    void computeBodyJacobians(const vector[MultiBody]&, const vector[MultiBodyConfig]&)
+    int addDynamics(const MultiBody&, int)
+    int dynamicsIndex(int) const
+    void computeDynamics(const vector[MultiBody]&, const vector[MultiBodyConfig]&)
+    bool cachesComputed() const
+    void computeCaches(const vector[MultiBody]&, const vector[MultiBodyConfig]&)
+    void resetCaches()
 
 cdef extern from "<Tasks/QPTasks.h>" namespace "tasks::qp":
   cdef cppclass JointStiffness:
@@ -123,7 +133,47 @@ cdef extern from "<Tasks/QPMotionConstr.h>" namespace "tasks::qp":
     double C
     double O
 
+cdef extern from "<Tasks/GenQPSolver.h>" namespace "tasks::qp":
+  cdef struct PresolveStats:
+    int nrLines
+    int nrEmptyLines
+    int nrUnboundedLines
+    int nrBoundLines
+
+  cdef enum QPStatus "tasks::qp::QPStatus":
+    QPStatusSuccess "tasks::qp::QPStatus::Success"
+    QPStatusMaxIter "tasks::qp::QPStatus::MaxIter"
+    QPStatusTimeout "tasks::qp::QPStatus::Timeout"
+    QPStatusFailure "tasks::qp::QPStatus::Failure"
+
+cdef extern from "<Tasks/QPProfiler.h>" namespace "tasks::qp":
+  cdef struct QPProfilerStats "tasks::qp::QPProfiler::Stats":
+    int count
+    double last
+    double mean
+    double p50
+    double p99
+    double max
+
+  cdef cppclass QPProfiler:
+    void enabled(bool)
+    bool enabled() const
+    void window(int)
+    int window() const
+    void reset()
+    vector[string] phases() const
+    QPProfilerStats stats(const string&) except +
+
 cdef extern from "<Tasks/QPSolver.h>" namespace "tasks::qp":
+  cdef cppclass ColBlock:
+    ColBlock(int, int, int)
+    bool isFull()
+    int col
+    int size
+    int srcCol
+
+  MatrixXd expandColBlocks(const MatrixXd&, const vector[ColBlock]&, int) except +
+
   cdef cppclass Constraint:
     void updateNrVars(const vector[MultiBody]&, SolverData)
     void update(const vector[MultiBody]&, const vector[MultiBodyConfig]&, const SolverData&)
@@ -132,18 +182,21 @@ cdef extern from "<Tasks/QPSolver.h>" namespace "tasks::qp":
     int maxEq()
     int nrEq()
     MatrixXd AEq()
+    vector[ColBlock] AEqBlocks()
     VectorXd bEq()
 
   cdef cppclass Inequality:
     int maxInEq()
     int nrInEq()
     MatrixXd AInEq()
+    vector[ColBlock] AInEqBlocks()
     VectorXd bInEq()
 
   cdef cppclass GenInequality:
     int maxGenInEq()
     int nrGenInEq()
     MatrixXd AGenInEq()
+    vector[ColBlock] AGenInEqBlocks()
     VectorXd LowerGenInEq()
     VectorXd UpperGenInEq()
 
@@ -303,9 +356,11 @@ cdef extern from "<Tasks/QPTasks.h>" namespace "tasks::qp":
     # SetPointTaskCommon
     VectorXd dimWeight() const
     void dimWeight(const VectorXd&)
+    void leastSquares(bool)
+    bool isLeastSquares() const
     void update(const vector[MultiBody]&, const vector[MultiBodyConfig]&, const SolverData&)
-    MatrixXd Q() const
-    VectorXd C() const
+    MatrixXd Q() const except +
+    VectorXd C() const except +
 
   cdef cppclass TrackingTask(Task):
     TrackingTask(const vector[MultiBody]&, int, PositionTask*, double, double, double)
@@ -341,9 +396,11 @@ cdef extern from "<Tasks/QPTasks.h>" namespace "tasks::qp":
     # SetPointTaskCommon
     VectorXd dimWeight() const
     void dimWeight(const VectorXd&)
+    void leastSquares(bool)
+    bool isLeastSquares() const
     void update(const vector[MultiBody]&, const vector[MultiBodyConfig]&, const SolverData&)
-    MatrixXd Q() const
-    VectorXd C() const
+    MatrixXd Q() const except +
+    VectorXd C() const except +
 
   cdef cppclass TrajectoryTask(Task):
     TrajectoryTask(const vector[MultiBody]&, int, PositionTask*, double, double, double)
@@ -378,9 +435,11 @@ cdef extern from "<Tasks/QPTasks.h>" namespace "tasks::qp":
     # SetPointTaskCommon
     VectorXd dimWeight() const
     void dimWeight(const VectorXd&)
+    void leastSquares(bool)
+    bool isLeastSquares() const
     void update(const vector[MultiBody]&, const vector[MultiBodyConfig]&, const SolverData&)
-    MatrixXd Q() const
-    VectorXd C() const
+    MatrixXd Q() const except +
+    VectorXd C() const except +
 
   cdef cppclass TargetObjectiveTask(Task):
     TargetObjectiveTask(const vector[MultiBody]&, int, PositionTask*, double, double, VectorXd, double)
@@ -465,9 +524,11 @@ cdef extern from "<Tasks/QPTasks.h>" namespace "tasks::qp":
     # SetPointTaskCommon
     VectorXd dimWeight() const
     void dimWeight(const VectorXd&)
+    void leastSquares(bool)
+    bool isLeastSquares() const
     void update(const vector[MultiBody]&, const vector[MultiBodyConfig]&, const SolverData&)
-    MatrixXd Q() const
-    VectorXd C() const
+    MatrixXd Q() const except +
+    VectorXd C() const except +
 
   cdef cppclass MultiCoMTask(Task):
     MultiCoMTask(const vector[MultiBody]&, vector[int], const Vector3d&, double, double)
@@ -643,7 +704,27 @@ cdef extern from "<Tasks/QPConstr.h>" namespace "tasks::qp":
     void addToSolver(const vector[MultiBody]&, QPSolver &)
     void removeFromSolver(QPSolver &)
 
+cdef extern from "<Tasks/QPRecorder.h>" namespace "tasks::qp":
+  cdef cppclass QPRecorder:
+    QPRecorder()
+    void open(const string&) except +
+    void close()
+    bool isOpen() const
+    void flush()
+    void bufferSize(size_t)
+    size_t bufferSize() const
+    void keyInterval(int)
+    int keyInterval() const
+    int nrRecords() const
+
 cdef extern from "<Tasks/QPSolver.h>" namespace "tasks::qp":
+  cdef struct QPCapacity:
+    int nrContacts
+    int nrLambda
+    int nrEqLines
+    int nrInEqLines
+    int nrGenInEqLines
+
   cdef cppclass QPSolver:
     QPSolver()
     bool solve(const vector[MultiBody]&, vector[MultiBodyConfig]&)
@@ -652,9 +733,18 @@ cdef extern from "<Tasks/QPSolver.h>" namespace "tasks::qp":
     void updateConstrSize()
     void nrVars(const vector[MultiBody]&, vector[UnilateralContact]&, vector[BilateralContact]&)
     int nrVars() const
-    void updateTasksNrVars(const vector[MultiBody]&) const
-    void updateConstrsNrVars(const vector[MultiBody]&) const
-    void updateNrVars(const vector[MultiBody]&) const
+    void capacity(const QPCapacity&)
+    const QPCapacity& capacity() const
+    bool addContact(const vector[MultiBody]&, const UnilateralContact&)
+    bool addContact(const vector[MultiBody]&, const BilateralContact&)
+    bool removeContact(const vector[MultiBody]&, const ContactId&)
+    void backendCacheSize(int)
+    int backendCacheSize() const
+    int backendCacheHits() const
+    int backendCacheMisses() const
+    void updateTasksNrVars(const vector[MultiBody]&)
+    void updateConstrsNrVars(const vector[MultiBody]&)
+    void updateNrVars(const vector[MultiBody]&)
 
     # EqualityConstraint
     void addEqualityConstraint(Equality*)
@@ -683,8 +773,32 @@ cdef extern from "<Tasks/QPSolver.h>" namespace "tasks::qp":
     int nrTasks() const
     void addTask(const vector[MultiBody]&, Task*)
     void resetTasks()
+    void taskUpdateGroup(Task*, int)
+    int taskUpdateGroup(Task*) const
+    void nrThreads(int)
+    int nrThreads() const
 
     void solver(const string&)
+    void decompose(bool)
+    bool decompose() const
+    int nrComponents() const
+    bool decomposed() const
+    void warmStart(bool)
+    bool warmStart() const
+    void resetWarmStart()
+    int solverIterations() const
+    void presolve(bool)
+    bool presolve() const
+    const PresolveStats& presolveStats() const
+    void solverMaxIter(int)
+    int solverMaxIter() const
+    double solverPrimalResidual() const
+    double solverDualResidual() const
+    void solverTimeBudget(double)
+    double solverTimeBudget() const
+    QPStatus solverStatus() const
+    bool solverFallback() const
+    void recorder(QPRecorder*)
     VectorXd result() const
     VectorXd alphaDVec() const
     VectorXd alphaDVec(int) const
@@ -694,4 +808,5 @@ cdef extern from "<Tasks/QPSolver.h>" namespace "tasks::qp":
     SolverData data() const
     c_tasks.cpu_times solveTime() const
     c_tasks.cpu_times solveAndBuildTime() const
+    QPProfiler& profiler()
 
@@ -239,8 +239,13 @@ cdef class BoundedSpeedConstr(GenInequality):
 cdef class ImageConstr(Inequality):
   cdef c_qp.ImageConstr * impl
 
+cdef class QPRecorder(object):
+  cdef c_qp.QPRecorder * impl
+
 cdef class QPSolver(object):
   cdef c_qp.QPSolver * impl
   cdef cppbool __own_impl
+  # keep the recorder alive while it is used
+  cdef object __recorder
 
 cdef QPSolver QPSolverFromPtr(c_qp.QPSolver *)
@@ -30,6 +30,12 @@ from cython.operator cimport dereference as deref
 from libcpp.string cimport string
 from libcpp.vector cimport vector
 
+# values of QPSolver.solverStatus
+QPStatusSuccess = <int>c_qp.QPStatusSuccess
+QPStatusMaxIter = <int>c_qp.QPStatusMaxIter
+QPStatusTimeout = <int>c_qp.QPStatusTimeout
+QPStatusFailure = <int>c_qp.QPStatusFailure
+
 def check_args(argList, typeList):
   if len(argList) != len(typeList):
     return False
@@ -38,6 +44,13 @@ def check_args(argList, typeList):
       return False
   return True
 
+# (col, size, srcCol) tuple of each column block, size is -1 for the full block
+cdef colBlocksFromC(const vector[c_qp.ColBlock]& blocks):
+  ret = []
+  for cb in blocks:
+    ret.append((cb.col, cb.size, cb.srcCol))
+  return ret
+
 cdef class FrictionCone(object):
   def __ctor__(self, Matrix3d frame, int nrGen, double mu, double direction = 1):
     self.impl = c_qp.FrictionCone(frame.impl, nrGen, mu, direction)
@@ -396,6 +409,28 @@ cdef class SolverData(object):
     for mv in v:
       ret.append(MotionVecdFromC(mv))
     return ret
+  def addBodyJacobian(self, MultiBody mb, int robotIndex, bodyName):
+    if isinstance(bodyName, unicode):
+      bodyName = bodyName.encode(u'ascii')
+    return self.impl.addBodyJacobian(deref(mb.impl), robotIndex, bodyName)
+  def bodyJacobianIndex(self, int robotIndex, int bodyIndex):
+    return self.impl.bodyJacobianIndex(robotIndex, bodyIndex)
+  def bodyJacobian(self, int index):
+    return MatrixXdFromC(self.impl.bodyJacobian(index))
+  def computeBodyJacobians(self, MultiBodyVector mbs, MultiBodyConfigVector mbcs):
+    self.impl.computeBodyJacobians(deref(mbs.v), deref(mbcs.v))
+  def addDynamics(self, MultiBody mb, int robotIndex):
+    return self.impl.addDynamics(deref(mb.impl), robotIndex)
+  def dynamicsIndex(self, int robotIndex):
+    return self.impl.dynamicsIndex(robotIndex)
+  def computeDynamics(self, MultiBodyVector mbs, MultiBodyConfigVector mbcs):
+    self.impl.computeDynamics(deref(mbs.v), deref(mbcs.v))
+  def cachesComputed(self):
+    return self.impl.cachesComputed()
+  def computeCaches(self, MultiBodyVector mbs, MultiBodyConfigVector mbcs):
+    self.impl.computeCaches(deref(mbs.v), deref(mbcs.v))
+  def resetCaches(self):
+    self.impl.resetCaches()
 cdef SolverData SolverDataFromC(const c_qp.SolverData& sd):
   cdef SolverData ret = SolverData()
   ret.impl = sd
@@ -517,8 +552,11 @@ cdef class Equality(Constraint):
     return self.eq_base.maxEq()
   def nrEq(self):
     return self.eq_base.nrEq()
-  def AEq(self):
-    return MatrixXdFromC(self.eq_base.AEq())
+  def AEq(self, int nrVars = -1):
+    # nrVars columns wide matrix, nrVars is needed if AEq is not dense
+    return MatrixXdFromC(c_qp.expandColBlocks(self.eq_base.AEq(), self.eq_base.AEqBlocks(), nrVars))
+  def AEqBlocks(self):
+    return colBlocksFromC(self.eq_base.AEqBlocks())
   def bEq(self):
     return VectorXdFromC(self.eq_base.bEq())
 
@@ -527,8 +565,11 @@ cdef class Inequality(Constraint):
     return self.ineq_base.maxInEq()
   def nrInEq(self):
     return self.ineq_base.nrInEq()
-  def AInEq(self):
-    return MatrixXdFromC(self.ineq_base.AInEq())
+  def AInEq(self, int nrVars = -1):
+    # nrVars columns wide matrix, nrVars is needed if AInEq is not dense
+    return MatrixXdFromC(c_qp.expandColBlocks(self.ineq_base.AInEq(), self.ineq_base.AInEqBlocks(), nrVars))
+  def AInEqBlocks(self):
+    return colBlocksFromC(self.ineq_base.AInEqBlocks())
   def bInEq(self):
     return VectorXdFromC(self.ineq_base.bInEq())
 
@@ -537,8 +578,11 @@ cdef class GenInequality(Constraint):
     return self.genineq_base.maxGenInEq()
   def nrGenInEq(self):
     return self.genineq_base.nrGenInEq()
-  def AGenInEq(self):
-    return MatrixXdFromC(self.genineq_base.AGenInEq())
+  def AGenInEq(self, int nrVars = -1):
+    # nrVars columns wide matrix, nrVars is needed if AGenInEq is not dense
+    return MatrixXdFromC(c_qp.expandColBlocks(self.genineq_base.AGenInEq(), self.genineq_base.AGenInEqBlocks(), nrVars))
+  def AGenInEqBlocks(self):
+    return colBlocksFromC(self.genineq_base.AGenInEqBlocks())
   def LowerGenInEq(self):
     return VectorXdFromC(self.genineq_base.LowerGenInEq())
   def UpperGenInEq(self):
@@ -1006,6 +1050,11 @@ cdef class SetPointTask(Task):
       return VectorXdFromC(self.impl.dimWeight())
     else:
       self.impl.dimWeight(v.impl)
+  def leastSquares(self, ls = None):
+    if ls is None:
+      return self.impl.isLeastSquares()
+    else:
+      self.impl.leastSquares(ls)
   def update(self, MultiBodyVector mbs, MultiBodyConfigVector mbcs, SolverData data):
     self.impl.update(deref(mbs.v), deref(mbcs.v), data.impl)
   def Q(self):
@@ -1119,6 +1168,11 @@ cdef class TrackingTask(Task):
       return VectorXdFromC(self.impl.dimWeight())
     else:
       self.impl.dimWeight(v.impl)
+  def leastSquares(self, ls = None):
+    if ls is None:
+      return self.impl.isLeastSquares()
+    else:
+      self.impl.leastSquares(ls)
   def update(self, MultiBodyVector mbs, MultiBodyConfigVector mbcs, SolverData data):
     self.impl.update(deref(mbs.v), deref(mbcs.v), data.impl)
   def Q(self):
@@ -1240,6 +1294,11 @@ cdef class TrajectoryTask(Task):
       return VectorXdFromC(self.impl.dimWeight())
     else:
       self.impl.dimWeight(v.impl)
+  def leastSquares(self, ls = None):
+    if ls is None:
+      return self.impl.isLeastSquares()
+    else:
+      self.impl.leastSquares(ls)
   def update(self, MultiBodyVector mbs, MultiBodyConfigVector mbcs, SolverData data):
     self.impl.update(deref(mbs.v), deref(mbcs.v), data.impl)
   def Q(self):
@@ -1496,6 +1555,11 @@ cdef class PIDTask(Task):
       return VectorXdFromC(self.impl.dimWeight())
     else:
       self.impl.dimWeight(v.impl)
+  def leastSquares(self, ls = None):
+    if ls is None:
+      return self.impl.isLeastSquares()
+    else:
+      self.impl.leastSquares(ls)
   def update(self, MultiBodyVector mbs, MultiBodyConfigVector mbcs, SolverData data):
     self.impl.update(deref(mbs.v), deref(mbcs.v), data.impl)
   def Q(self):
@@ -2134,6 +2198,32 @@ cdef class ImageConstr(Inequality):
   def removeFromSolver(self, QPSolver solver):
     self.impl.removeFromSolver(deref(solver.impl))
 
+cdef class QPRecorder(object):
+  def __dealloc__(self):
+    del self.impl
+  def __cinit__(self):
+    self.impl = new c_qp.QPRecorder()
+  def open(self, path):
+    self.impl.open(path)
+  def close(self):
+    self.impl.close()
+  def isOpen(self):
+    return self.impl.isOpen()
+  def flush(self):
+    self.impl.flush()
+  def bufferSize(self, *args):
+    if len(args) == 0:
+      return self.impl.bufferSize()
+    else:
+      self.impl.bufferSize(args[0])
+  def keyInterval(self, *args):
+    if len(args) == 0:
+      return self.impl.keyInterval()
+    else:
+      self.impl.keyInterval(args[0])
+  def nrRecords(self):
+    return self.impl.nrRecords()
+
 cdef class QPSolver(object):
   def __dealloc__(self):
     if self.__own_impl:
@@ -2157,6 +2247,29 @@ cdef class QPSolver(object):
       self.impl.nrVars(deref(mbs.v), UnilateralContactVector(uni).v, BilateralContactVector(bi).v)
     else:
       raise TypeError("Wrong arguments passed to QPSolver.nrVars")
+  def capacity(self, c = None):
+    if c is None:
+      return self.impl.capacity()
+    else:
+      self.impl.capacity(c)
+  def addContact(self, MultiBodyVector mbs, contact):
+    if isinstance(contact, UnilateralContact):
+      return self.impl.addContact(deref(mbs.v), (<UnilateralContact>contact).impl)
+    elif isinstance(contact, BilateralContact):
+      return self.impl.addContact(deref(mbs.v), (<BilateralContact>contact).impl)
+    else:
+      raise TypeError("Wrong arguments passed to QPSolver.addContact")
+  def removeContact(self, MultiBodyVector mbs, ContactId contactId):
+    return self.impl.removeContact(deref(mbs.v), contactId.impl)
+  def backendCacheSize(self, s = None):
+    if s is None:
+      return self.impl.backendCacheSize()
+    else:
+      self.impl.backendCacheSize(s)
+  def backendCacheHits(self):
+    return self.impl.backendCacheHits()
+  def backendCacheMisses(self):
+    return self.impl.backendCacheMisses()
   def updateTasksNrVars(self, MultiBodyVector mbs):
     self.impl.updateTasksNrVars(deref(mbs.v))
   def updateConstrsNrVars(self, MultiBodyVector mbs):
@@ -2219,10 +2332,69 @@ cdef class QPSolver(object):
     return self.impl.nrTasks()
   def resetTasks(self):
     self.impl.resetTasks()
+  def taskUpdateGroup(self, Task t, group = None):
+    if group is None:
+      return self.impl.taskUpdateGroup(t.base)
+    else:
+      self.impl.taskUpdateGroup(t.base, group)
+  def nrThreads(self, n = None):
+    if n is None:
+      return self.impl.nrThreads()
+    else:
+      self.impl.nrThreads(n)
   def solver(self, name):
     if isinstance(name, unicode):
       name = name.encode(u'ascii')
     self.impl.solver(name)
+  def decompose(self, d = None):
+    if d is None:
+      return self.impl.decompose()
+    else:
+      self.impl.decompose(d)
+  def nrComponents(self):
+    return self.impl.nrComponents()
+  def decomposed(self):
+    return self.impl.decomposed()
+  def warmStart(self, w = None):
+    if w is None:
+      return self.impl.warmStart()
+    else:
+      self.impl.warmStart(w)
+  def resetWarmStart(self):
+    self.impl.resetWarmStart()
+  def solverIterations(self):
+    return self.impl.solverIterations()
+  def presolve(self, p = None):
+    if p is None:
+      return self.impl.presolve()
+    else:
+      self.impl.presolve(p)
+  def presolveStats(self):
+    return self.impl.presolveStats()
+  def solverMaxIter(self, m = None):
+    if m is None:
+      return self.impl.solverMaxIter()
+    else:
+      self.impl.solverMaxIter(m)
+  def solverPrimalResidual(self):
+    return self.impl.solverPrimalResidual()
+  def solverDualResidual(self):
+    return self.impl.solverDualResidual()
+  def solverTimeBudget(self, b = None):
+    if b is None:
+      return self.impl.solverTimeBudget()
+    else:
+      self.impl.solverTimeBudget(b)
+  def solverStatus(self):
+    return <int>self.impl.solverStatus()
+  def solverFallback(self):
+    return self.impl.solverFallback()
+  def recorder(self, QPRecorder r = None):
+    self.__recorder = r
+    if r is None:
+      self.impl.recorder(NULL)
+    else:
+      self.impl.recorder(r.impl)
   def result(self):
     return VectorXdFromC(self.impl.result())
   def alphaDVec(self, robotIndex = None):
@@ -2243,6 +2415,24 @@ cdef class QPSolver(object):
     return tasks.cpu_timesFromC(self.impl.solveTime())
   def solveAndBuildTime(self):
     return tasks.cpu_timesFromC(self.impl.solveAndBuildTime())
+  def profiling(self, e = None):
+    if e is None:
+      return self.impl.profiler().enabled()
+    else:
+      self.impl.profiler().enabled(e)
+  def profilingWindow(self, w = None):
+    if w is None:
+      return self.impl.profiler().window()
+    else:
+      self.impl.profiler().window(w)
+  def profilingReset(self):
+    self.impl.profiler().reset()
+  def profilingPhases(self):
+    return self.impl.profiler().phases()
+  def profilingStats(self, name):
+    if isinstance(name, unicode):
+      name = name.encode(u'ascii')
+    return self.impl.profiler().stats(name)
 
 cdef QPSolver QPSolverFromPtr(c_qp.QPSolver * p):
     cdef QPSolver ret = QPSolver(skip_alloc = True)
@@ -0,0 +1,633 @@
+// Copyright 2012-2016 CNRS-UM LIRMM, CNRS-AIST JRL
+//
+// This file is part of Tasks.
+//
+// Tasks is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Tasks is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with Tasks.  If not, see <http://www.gnu.org/licenses/>.
+
+#pragma once
+
+// includes
+// std
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <limits>
+
+// Eigen
+#include <Eigen/Core>
+#include <Eigen/Cholesky>
+
+
+namespace tasks
+{
+
+namespace qp
+{
+
+
+/**
+	* Dense ADMM QP solver with a fixed number of iterations.
+	* Solve the following problem:
+	* \f{align}
+	* \underset{x}{\text{minimize }} & \frac{1}{2} x^T Q x + x^T c\\
+	* \text{s.t. } & L \leq \left\{ \begin{array}{c} A x \\ x \end{array} \right\} \leq U
+	* \f}
+	*
+	* The splitting is the one of OSQP (Stellato et al., 2020):
+	* each iteration solve the linear system
+	* \f$ (Q + \sigma I + A^T R A + R_x) \tilde{x} = \sigma x - c + A^T (R z - y) + R_x z_x - y_x \f$
+	* with the Cholesky factor computed by solve and project the constraints
+	* on their bounds.
+	* The equality lines (L = U) get a larger penalty than the other lines.
+	*
+	* As in OSQP the problem is first scaled: the variables and the lines of A
+	* are equilibrated by a few Ruiz iterations on
+	* \f$ \left[ \begin{array}{cc} Q & A^T \\ A & 0 \end{array} \right] \f$
+	* then the cost is normalized. The tolerance applies to the unscaled residuals.
+	* The penalty is adapted every rhoInterval iterations from the ratio of the
+	* primal and dual residuals, the linear system is then factorized again
+	* if it has changed by more than a factor 5.
+	*
+	* By default the maxIter iterations are always done so the solve time
+	* only depend on the problem size.
+	* The iterates of the previous solve can be used to warm start the next one.
+	* All the workspace is allocated by problem.
+	*/
+class ADMM
+{
+public:
+	enum Status
+	{
+		/// the residuals are under the tolerance
+		Success = 0,
+		/// the residuals are above the tolerance after maxIter iterations
+		MaxIter = 1,
+		/// the deadline has been reached before convergence
+		Timeout = 2,
+		/// Q is not positive semi-definite
+		NotPositive = 3
+	};
+
+public:
+	ADMM():
+		nrVars_(0), nrLines_(0),
+		maxIter_(defaultMaxIter),
+		deadline_(std::chrono::steady_clock::time_point::max()),
+		rho_(0.1), sigma_(1e-6), alpha_(1.6),
+		tol_(1e-3),
+		scaling_(10), rhoInterval_(25),
+		earlyStop_(false), adaptiveRho_(true),
+		llt_(), K_(), Q_(), A_(), AR_(),
+		D_(), E_(), C_(), AL_(), AU_(), XL_(), XU_(), norm_(),
+		x_(), xs_(), xt_(), zA_(), zX_(), yA_(), yX_(), rhoA_(), rhoX_(),
+		rhs_(), tmpA_(),
+		cost_(1.), rhoCur_(0.1),
+		primalRes_(0.), dualRes_(0.),
+		nrIter_(0), nrFacto_(0),
+		status_(Success),
+		initialized_(false)
+	{}
+
+	/**
+		* Allocate the workspace.
+		* @param nrVars Number of variables.
+		* @param nrLines Maximum number of lines of A.
+		*/
+	void problem(int nrVars, int nrLines)
+	{
+		nrVars_ = nrVars;
+		llt_ = Eigen::LLT<Eigen::MatrixXd>(nrVars);
+		K_.setZero(nrVars, nrVars);
+		Q_.setZero(nrVars, nrVars);
+		A_.setZero(nrLines, nrVars);
+		AR_.setZero(nrLines, nrVars);
+		D_.setOnes(nrVars);
+		E_.setOnes(nrLines);
+		C_.setZero(nrVars);
+		AL_.setZero(nrLines);
+		AU_.setZero(nrLines);
+		XL_.setZero(nrVars);
+		XU_.setZero(nrVars);
+		norm_.setZero(std::max(nrVars, nrLines));
+		x_.setZero(nrVars);
+		xs_.setZero(nrVars);
+		xt_.setZero(nrVars);
+		zA_.setZero(nrLines);
+		zX_.setZero(nrVars);
+		yA_.setZero(nrLines);
+		yX_.setZero(nrVars);
+		rhoA_.setZero(nrLines);
+		rhoX_.setZero(nrVars);
+		rhs_.setZero(nrVars);
+		tmpA_.setZero(nrLines);
+		cost_ = 1.;
+		nrLines_ = 0;
+		initialized_ = false;
+	}
+
+	/// Forget the iterates of the previous solve.
+	void reset()
+	{
+		initialized_ = false;
+	}
+
+	/// Number of iterations done by solve if not set.
+	static const int defaultMaxIter = 200;
+
+	/**
+		* Set the number of iterations done by solve,
+		* a negative value restores defaultMaxIter.
+		*/
+	void maxIter(int maxIter)
+	{
+		if(maxIter < 0)
+		{
+			maxIter_ = defaultMaxIter;
+		}
+		else
+		{
+			maxIter_ = maxIter;
+		}
+	}
+
+	int maxIter() const
+	{
+		return maxIter_;
+	}
+
+	/**
+		* Set the time after which the solve stop at the next iteration,
+		* the last iterate is then the result.
+		*/
+	void deadline(const std::chrono::steady_clock::time_point& d)
+	{
+		deadline_ = d;
+	}
+
+	/**
+		* Set the initial penalty of the inequality lines and bounds
+		* of the scaled problem.
+		*/
+	void rho(double rho)
+	{
+		rho_ = rho;
+	}
+
+	double rho() const
+	{
+		return rho_;
+	}
+
+	/// Set the relaxation parameter, in ]0, 2[.
+	void alpha(double alpha)
+	{
+		alpha_ = alpha;
+	}
+
+	double alpha() const
+	{
+		return alpha_;
+	}
+
+	/**
+		* Set the maximum primal and dual residuals
+		* under which a solve is successful.
+		*/
+	void tolerance(double tol)
+	{
+		tol_ = tol;
+	}
+
+	double tolerance() const
+	{
+		return tol_;
+	}
+
+	/// Set the number of Ruiz equilibration iterations, 0 to disable the scaling.
+	void scaling(int scaling)
+	{
+		scaling_ = scaling;
+	}
+
+	int scaling() const
+	{
+		return scaling_;
+	}
+
+	/**
+		* Enable or disable (enabled by default) the penalty adaptation,
+		* done every interval iterations.
+		*/
+	void adaptiveRho(bool a, int interval=25)
+	{
+		adaptiveRho_ = a;
+		rhoInterval_ = interval;
+	}
+
+	bool adaptiveRho() const
+	{
+		return adaptiveRho_;
+	}
+
+	/**
+		* If true the iterations stop as soon as the residuals are under
+		* the tolerance (they are then computed every 10 iterations).
+		* The solve time is then no more constant.
+		*/
+	void earlyStop(bool e)
+	{
+		earlyStop_ = e;
+	}
+
+	bool earlyStop() const
+	{
+		return earlyStop_;
+	}
+
+	/**
+		* Solve the problem.
+		* @param warm If true start from the iterates of the previous solve.
+		* @return true if the primal and dual residuals are under the tolerance.
+		*/
+	template<typename MatA, typename VecL, typename VecU>
+	bool solve(const Eigen::MatrixXd& Q, const Eigen::VectorXd& C,
+		const MatA& A, const VecL& AL, const VecU& AU,
+		const Eigen::VectorXd& XL, const Eigen::VectorXd& XU, bool warm)
+	{
+		const int m = int(A.rows());
+
+		// the lines have been changed, their iterates are no more valid
+		const bool keep = warm && initialized_ && m == nrLines_;
+		if(keep)
+		{
+			unscaleIterates();
+		}
+		nrLines_ = m;
+
+		equilibrate(Q, C, A);
+		for(int i = 0; i < m; ++i)
+		{
+			AL_(i) = E_(i)*AL(i);
+			AU_(i) = E_(i)*AU(i);
+		}
+		XL_ = XL.cwiseQuotient(D_);
+		XU_ = XU.cwiseQuotient(D_);
+
+		if(keep)
+		{
+			scaleIterates();
+		}
+		else
+		{
+			xs_.setZero();
+			zA_.head(m).setZero();
+			yA_.head(m).setZero();
+			zX_.setZero();
+			yX_.setZero();
+			rhoCur_ = rho_;
+		}
+		initialized_ = true;
+
+		nrFacto_ = 0;
+		if(!factorize())
+		{
+			nrIter_ = 0;
+			x_ = D_.cwiseProduct(xs_);
+			primalRes_ = dualRes_ = std::numeric_limits<double>::infinity();
+			status_ = NotPositive;
+			return false;
+		}
+
+		for(nrIter_ = 1; nrIter_ <= maxIter_; ++nrIter_)
+		{
+			if(std::chrono::steady_clock::now() >= deadline_)
+			{
+				--nrIter_;
+				return finish(Timeout);
+			}
+
+			// x update
+			tmpA_.head(m) = rhoA_.head(m).cwiseProduct(zA_.head(m)) - yA_.head(m);
+			rhs_ = sigma_*xs_ - C_ + rhoX_.cwiseProduct(zX_) - yX_;
+			rhs_.noalias() += A_.topRows(m).transpose()*tmpA_.head(m);
+			llt_.solveInPlace(rhs_);
+			xt_ = rhs_;
+
+			// relaxed z and y update
+			tmpA_.head(m).noalias() = A_.topRows(m)*xt_;
+			for(int i = 0; i < m; ++i)
+			{
+				project(alpha_*tmpA_(i) + (1. - alpha_)*zA_(i), AL_(i), AU_(i),
+					rhoA_(i), zA_(i), yA_(i));
+			}
+			for(int i = 0; i < nrVars_; ++i)
+			{
+				project(alpha_*xt_(i) + (1. - alpha_)*zX_(i), XL_(i), XU_(i),
+					rhoX_(i), zX_(i), yX_(i));
+			}
+			xs_ = alpha_*xt_ + (1. - alpha_)*xs_;
+
+			if(earlyStop_ && nrIter_%10 == 0 && residuals())
+			{
+				x_ = D_.cwiseProduct(xs_);
+				status_ = Success;
+				return true;
+			}
+
+			if(adaptiveRho_ && nrIter_%rhoInterval_ == 0 && nrIter_ < maxIter_ &&
+				 !updateRho())
+			{
+				x_ = D_.cwiseProduct(xs_);
+				primalRes_ = dualRes_ = std::numeric_limits<double>::infinity();
+				status_ = NotPositive;
+				return false;
+			}
+		}
+		nrIter_ = maxIter_;
+
+		return finish(MaxIter);
+	}
+
+	/// @return Solution of the last solve.
+	const Eigen::VectorXd& result() const
+	{
+		return x_;
+	}
+
+	/// @return \f$ \max(\| A x - z_A \|_{\infty}, \| x - z_x \|_{\infty}) \f$
+	double primalResidual() const
+	{
+		return primalRes_;
+	}
+
+	/// @return \f$ \| Q x + c + A^T y + y_x \|_{\infty} \f$
+	double dualResidual() const
+	{
+		return dualRes_;
+	}
+
+	/// @return Number of iterations of the last solve.
+	int iterations() const
+	{
+		return nrIter_;
+	}
+
+	/// @return Number of factorizations of the linear system in the last solve.
+	int nrFactorizations() const
+	{
+		return nrFacto_;
+	}
+
+	/// @return Penalty of the scaled problem at the end of the last solve.
+	double currentRho() const
+	{
+		return rhoCur_;
+	}
+
+	/// @return Status of the last solve.
+	Status status() const
+	{
+		return status_;
+	}
+
+private:
+	static double penalty(double rho, double L, double U)
+	{
+		const double inf = std::numeric_limits<double>::infinity();
+		if(L == -inf && U == inf)
+		{
+			// free line, OSQP value
+			return 1e-6;
+		}
+		return L == U ? 1e3*rho : rho;
+	}
+
+	static void project(double v, double L, double U, double rho,
+		double& z, double& y)
+	{
+		double zNew = std::min(std::max(v + y/rho, L), U);
+		y += rho*(v - zNew);
+		z = zNew;
+	}
+
+	/// scaling factor of a norm, norms out of [1e-4, 1e4] are not scaled (OSQP)
+	static double scale(double norm)
+	{
+		return norm < 1e-4 || norm > 1e4 ? 1. : 1./std::sqrt(norm);
+	}
+
+	/**
+		* Compute D_, E_ and cost_ and the scaled
+		* \f$ Q_s = cost D Q D \f$, \f$ c_s = cost D c \f$, \f$ A_s = E A D \f$.
+		*/
+	template<typename MatA>
+	void equilibrate(const Eigen::MatrixXd& Q, const Eigen::VectorXd& C,
+		const MatA& A)
+	{
+		const int n = nrVars_;
+		const int m = nrLines_;
+
+		Q_ = Q;
+		C_ = C;
+		A_.topRows(m) = A;
+		D_.setOnes();
+		E_.head(m).setOnes();
+		cost_ = 1.;
+
+		for(int k = 0; k < scaling_; ++k)
+		{
+			// variables
+			for(int j = 0; j < n; ++j)
+			{
+				double norm = Q_.col(j).template lpNorm<Eigen::Infinity>();
+				if(m > 0)
+				{
+					norm = std::max(norm, A_.col(j).head(m).template lpNorm<Eigen::Infinity>());
+				}
+				norm_(j) = scale(norm);
+			}
+			D_.array() *= norm_.head(n).array();
+			Q_ = norm_.head(n).asDiagonal()*Q_*norm_.head(n).asDiagonal();
+			C_.array() *= norm_.head(n).array();
+			A_.topRows(m) *= norm_.head(n).asDiagonal();
+
+			// lines
+			for(int i = 0; i < m; ++i)
+			{
+				norm_(i) = scale(A_.row(i).template lpNorm<Eigen::Infinity>());
+			}
+			E_.head(m).array() *= norm_.head(m).array();
+			A_.topRows(m) = norm_.head(m).asDiagonal()*A_.topRows(m);
+		}
+
+		if(scaling_ > 0 && n > 0)
+		{
+			double meanNorm = 0.;
+			for(int j = 0; j < n; ++j)
+			{
+				meanNorm += Q_.col(j).template lpNorm<Eigen::Infinity>();
+			}
+			meanNorm /= n;
+			const double cNorm = C_.template lpNorm<Eigen::Infinity>();
+			double norm = std::max(meanNorm, cNorm);
+			cost_ = norm < 1e-4 || norm > 1e4 ? 1. : 1./norm;
+			Q_ *= cost_;
+			C_ *= cost_;
+		}
+	}
+
+	/// unscale the iterates of the previous solve with its scaling
+	void unscaleIterates()
+	{
+		const int m = nrLines_;
+		xs_.array() *= D_.array();
+		zX_.array() *= D_.array();
+		yX_.array() /= cost_*D_.array();
+		zA_.head(m).array() /= E_.head(m).array();
+		yA_.head(m).array() *= E_.head(m).array()/cost_;
+	}
+
+	/// scale the iterates of the previous solve with the current scaling
+	void scaleIterates()
+	{
+		const int m = nrLines_;
+		xs_.array() /= D_.array();
+		zX_.array() /= D_.array();
+		yX_.array() *= cost_*D_.array();
+		zA_.head(m).array() *= E_.head(m).array();
+		yA_.head(m).array() *= cost_/E_.head(m).array();
+	}
+
+	/// K = Q + sigma I + A^T R A + R_x for the current penalty
+	bool factorize()
+	{
+		const int m = nrLines_;
+		for(int i = 0; i < m; ++i)
+		{
+			rhoA_(i) = penalty(rhoCur_, AL_(i), AU_(i));
+		}
+		for(int i = 0; i < nrVars_; ++i)
+		{
+			rhoX_(i) = penalty(rhoCur_, XL_(i), XU_(i));
+		}
+
+		AR_.topRows(m) = rhoA_.head(m).cwiseSqrt().asDiagonal()*A_.topRows(m);
+		K_ = Q_;
+		K_.noalias() += AR_.topRows(m).transpose()*AR_.topRows(m);
+		K_.diagonal().array() += sigma_ + rhoX_.array();
+		llt_.compute(K_);
+		++nrFacto_;
+		return llt_.info() == Eigen::Success;
+	}
+
+	/**
+		* Balance the scaled primal and dual residuals relatively to their terms.
+		* @return false if the factorization with the new penalty has failed.
+		*/
+	bool updateRho()
+	{
+		const double eps = 1e-10;
+		const int m = nrLines_;
+
+		tmpA_.head(m).noalias() = A_.topRows(m)*xs_;
+		double primal = (xs_ - zX_).template lpNorm<Eigen::Infinity>();
+		double primalNorm = std::max(xs_.template lpNorm<Eigen::Infinity>(),
+			zX_.template lpNorm<Eigen::Infinity>());
+		if(m > 0)
+		{
+			primal = std::max(primal,
+				(tmpA_.head(m) - zA_.head(m)).template lpNorm<Eigen::Infinity>());
+			primalNorm = std::max({primalNorm,
+				tmpA_.head(m).template lpNorm<Eigen::Infinity>(),
+				zA_.head(m).template lpNorm<Eigen::Infinity>()});
+		}
+
+		xt_.noalias() = Q_*xs_;
+		rhs_.noalias() = A_.topRows(m).transpose()*yA_.head(m);
+		double dualNorm = std::max({xt_.template lpNorm<Eigen::Infinity>(),
+			rhs_.template lpNorm<Eigen::Infinity>(),
+			yX_.template lpNorm<Eigen::Infinity>(),
+			C_.template lpNorm<Eigen::Infinity>()});
+		rhs_ += xt_ + C_ + yX_;
+		double dual = rhs_.template lpNorm<Eigen::Infinity>();
+
+		double ratio = (primal/(primalNorm + eps))/(dual/(dualNorm + eps) + eps);
+		double rho = std::min(std::max(rhoCur_*std::sqrt(ratio), 1e-6), 1e6);
+		if(rho > 5.*rhoCur_ || rho < rhoCur_/5.)
+		{
+			rhoCur_ = rho;
+			return factorize();
+		}
+		return true;
+	}
+
+	/// compute the unscaled residuals
+	bool residuals()
+	{
+		const int m = nrLines_;
+		tmpA_.head(m).noalias() = A_.topRows(m)*xs_;
+		tmpA_.head(m) -= zA_.head(m);
+		tmpA_.head(m).array() /= E_.head(m).array();
+		primalRes_ = D_.cwiseProduct(xs_ - zX_).template lpNorm<Eigen::Infinity>();
+		if(m > 0)
+		{
+			primalRes_ = std::max(primalRes_,
+				tmpA_.head(m).template lpNorm<Eigen::Infinity>());
+		}
+
+		rhs_ = C_ + yX_;
+		rhs_.noalias() += Q_*xs_;
+		rhs_.noalias() += A_.topRows(m).transpose()*yA_.head(m);
+		rhs_.array() /= cost_*D_.array();
+		dualRes_ = rhs_.template lpNorm<Eigen::Infinity>();
+
+		return primalRes_ <= tol_ && dualRes_ <= tol_;
+	}
+
+	/// set the status to failure if the residuals are above the tolerance
+	bool finish(Status failure)
+	{
+		x_ = D_.cwiseProduct(xs_);
+		bool success = residuals();
+		status_ = success ? Success : failure;
+		return success;
+	}
+
+private:
+	int nrVars_, nrLines_;
+	int maxIter_;
+	std::chrono::steady_clock::time_point deadline_;
+	double rho_, sigma_, alpha_;
+	double tol_;
+	int scaling_, rhoInterval_;
+	bool earlyStop_, adaptiveRho_;
+
+	Eigen::LLT<Eigen::MatrixXd> llt_;
+	// scaled problem, AR_ is R^{1/2} A_
+	Eigen::MatrixXd K_, Q_, A_, AR_;
+	Eigen::VectorXd D_, E_, C_, AL_, AU_, XL_, XU_, norm_;
+	// x_ is the unscaled result, the other iterates are scaled
+	Eigen::VectorXd x_, xs_, xt_, zA_, zX_, yA_, yX_, rhoA_, rhoX_;
+	Eigen::VectorXd rhs_, tmpA_;
+	double cost_, rhoCur_;
+	double primalRes_, dualRes_;
+	int nrIter_, nrFacto_;
+	Status status_;
+	bool initialized_;
+};
+
+
+} // namespace qp
+
+} // namespace tasks
@@ -0,0 +1,162 @@
+// Copyright 2012-2016 CNRS-UM LIRMM, CNRS-AIST JRL
+//
+// This file is part of Tasks.
+//
+// Tasks is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Tasks is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with Tasks.  If not, see <http://www.gnu.org/licenses/>.
+
+// associated header
+#include "ADMMQPSolver.h"
+
+// includes
+// Tasks
+#include "Tasks/QPSolver.h"
+
+
+namespace tasks
+{
+
+namespace qp
+{
+
+
+ADMMQPSolver::ADMMQPSolver():
+	admm_(),
+	dense_(DenseQP::Form::General)
+{
+	warmStart(true);
+}
+
+
+void ADMMQPSolver::updateSize(int nrVars, int nrEq, int nrInEq, int nrGenInEq)
+{
+	dense_.updateSize(nrVars, nrEq, nrInEq, nrGenInEq, reduction_);
+	admm_.problem(dense_.nrVars(), dense_.maxALines());
+}
+
+
+void ADMMQPSolver::updateMatrix(
+	const std::vector<Task*>& tasks,
+	const std::vector<Equality*>& eqConstr,
+	const std::vector<Inequality*>& inEqConstr,
+	const std::vector<GenInequality*>& genInEqConstr,
+	const std::vector<Bound*>& boundConstr)
+{
+	dense_.updateMatrix(tasks, eqConstr, inEqConstr, genInEqConstr, boundConstr,
+		false, presolveStats_);
+}
+
+
+bool ADMMQPSolver::solve()
+{
+	const int nrALines = dense_.nrALines();
+
+	admm_.deadline(deadline_);
+	bool success = admm_.solve(dense_.Q(), dense_.C(), dense_.A().topRows(nrALines),
+		dense_.AL().head(nrALines), dense_.AU().head(nrALines),
+		dense_.XL(), dense_.XU(), warmStart_);
+	switch(admm_.status())
+	{
+	case ADMM::Success:
+		status_ = QPStatus::Success;
+		break;
+	case ADMM::MaxIter:
+		status_ = QPStatus::MaxIter;
+		break;
+	case ADMM::Timeout:
+		status_ = QPStatus::Timeout;
+		break;
+	default:
+		status_ = QPStatus::Failure;
+		break;
+	}
+
+	dense_.expand(admm_.result());
+	return success;
+}
+
+
+const Eigen::VectorXd& ADMMQPSolver::result() const
+{
+	return dense_.reduced() ? dense_.XFull() : admm_.result();
+}
+
+
+bool ADMMQPSolver::feasibleIterate() const
+{
+	return (status_ == QPStatus::MaxIter || status_ == QPStatus::Timeout) &&
+		admm_.primalResidual() <= admm_.tolerance();
+}
+
+
+void ADMMQPSolver::resetWarmStart()
+{
+	GenQPSolver::resetWarmStart();
+	admm_.reset();
+}
+
+
+int ADMMQPSolver::iterations() const
+{
+	return admm_.iterations();
+}
+
+
+void ADMMQPSolver::maxIter(int maxIter)
+{
+	admm_.maxIter(maxIter);
+}
+
+
+int ADMMQPSolver::maxIter() const
+{
+	return admm_.maxIter();
+}
+
+
+double ADMMQPSolver::primalResidual() const
+{
+	return admm_.primalResidual();
+}
+
+
+double ADMMQPSolver::dualResidual() const
+{
+	return admm_.dualResidual();
+}
+
+
+std::ostream& ADMMQPSolver::errorMsg(
+	const std::vector<rbd::MultiBody>& /* mbs */,
+	const std::vector<Task*>& /* tasks */,
+	const std::vector<Equality*>& /* eqConstr */,
+	const std::vector<Inequality*>& /* inEqConstr */,
+	const std::vector<GenInequality*>& /* genInEqConstr */,
+	const std::vector<Bound*>& /* boundConstr */,
+	std::ostream& out) const
+{
+	if(admm_.status() == ADMM::NotPositive)
+	{
+		out << "ADMM: Q is not positive semi-definite" << std::endl;
+		return out;
+	}
+	out << "ADMM: residuals above the tolerance after " << admm_.iterations()
+			<< " iterations (primal " << admm_.primalResidual() << ", dual "
+			<< admm_.dualResidual() << ")" << std::endl;
+	return out;
+}
+
+
+} // namespace qp
+
+} // namespace tasks
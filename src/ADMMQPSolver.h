@@ -0,0 +1,96 @@
+// Copyright 2012-2016 CNRS-UM LIRMM, CNRS-AIST JRL
+//
+// This file is part of Tasks.
+//
+// Tasks is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Tasks is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with Tasks.  If not, see <http://www.gnu.org/licenses/>.
+
+#pragma once
+
+// includes
+// Eigen
+#include <Eigen/Core>
+
+// Tasks
+#include "Tasks/GenQPSolver.h"
+#include "ADMM.h"
+#include "GenQPUtils.h"
+
+
+namespace tasks
+{
+
+namespace qp
+{
+
+
+/**
+	* GenQPSolver interface implementation with the in-tree ADMM solver
+	* (see ADMM).
+	*
+	* Each solve do a fixed number of iterations (see GenQPSolver::maxIter)
+	* so its duration only depend on the problem size.
+	* The problem is scaled and the penalty adapted as in OSQP (see ADMM).
+	* The solve fails if the residuals are above the tolerance after
+	* the last iteration, the result is then the last iterate.
+	* The warm start is enabled by default.
+	*/
+class TASKS_DLLAPI ADMMQPSolver : public GenQPSolver
+{
+public:
+	ADMMQPSolver();
+
+	virtual void updateSize(int nrVars, int nrEq, int nrInEq, int nrGenInEq) override;
+	virtual void updateMatrix(const std::vector<Task*>& tasks,
+		const std::vector<Equality*>& eqConstr,
+		const std::vector<Inequality*>& inEqConstr,
+		const std::vector<GenInequality*>& genInEqConstr,
+		const std::vector<Bound*>& boundConstr) override;
+	virtual bool solve() override;
+	virtual const Eigen::VectorXd& result() const override;
+	virtual std::ostream& errorMsg(const std::vector<rbd::MultiBody>& mbs,
+		const std::vector<Task*>& tasks,
+		const std::vector<Equality*>& eqConstr,
+		const std::vector<Inequality*>& inEqConstr,
+		const std::vector<GenInequality*>& genInEqConstr,
+		const std::vector<Bound*>& boundConstr,
+		std::ostream& out) const override;
+
+	/// @return true if the primal residual of an interrupted solve is under the tolerance.
+	virtual bool feasibleIterate() const override;
+
+	/// The next solve start from zero iterates.
+	virtual void resetWarmStart() override;
+
+	virtual int iterations() const override;
+	/// Number of iterations of a solve, 200 by default.
+	virtual void maxIter(int maxIter) override;
+	virtual int maxIter() const override;
+	virtual double primalResidual() const override;
+	virtual double dualResidual() const override;
+
+	/// @return ADMM solver to tune its parameters.
+	ADMM& admm()
+	{
+		return admm_;
+	}
+
+private:
+	ADMM admm_;
+	DenseQP dense_;
+};
+
+
+} // namespace qp
+
+} // namespace tasks
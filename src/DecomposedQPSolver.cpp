@@ -0,0 +1,668 @@
+// Copyright 2012-2016 CNRS-UM LIRMM, CNRS-AIST JRL
+//
+// This file is part of Tasks.
+//
+// Tasks is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Tasks is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with Tasks.  If not, see <http://www.gnu.org/licenses/>.
+
+// associated header
+#include "DecomposedQPSolver.h"
+
+// includes
+// std
+#include <algorithm>
+#include <limits>
+
+// Tasks
+#include "WorkerPool.h"
+
+
+namespace tasks
+{
+
+namespace qp
+{
+
+
+
+/**
+	*													SubProblem
+	*/
+
+
+
+DecomposedQPSolver::SubProblem::SubProblem():
+	Task(1.),
+	vars(),
+	red(),
+	fullTasks(),
+	fullEqConstr(),
+	fullInEqConstr(),
+	fullGenInEqConstr(),
+	solver(),
+	tasks(),
+	eqConstr(),
+	inEqConstr(),
+	genInEqConstr(),
+	boundConstr(),
+	success(true),
+	QCache_(),
+	AEqCache_(),
+	AInEqCache_(),
+	AGenInEqCache_(),
+	Q_(),
+	C_(),
+	AEq_(),
+	AInEq_(),
+	AGenInEq_(),
+	bEq_(),
+	bInEq_(),
+	LGenInEq_(),
+	UGenInEq_(),
+	XL_(),
+	XU_(),
+	nrEq_(0),
+	nrInEq_(0),
+	nrGenInEq_(0)
+{
+	tasks = {this};
+	eqConstr = {this};
+	inEqConstr = {this};
+	genInEqConstr = {this};
+	boundConstr = {this};
+}
+
+
+void DecomposedQPSolver::SubProblem::reduction(int nrFullVars)
+{
+	red = VariableReduction();
+	red.nrFull = nrFullVars;
+	red.nrReduced = static_cast<int>(vars.size());
+	for(std::size_t i = 0; i < vars.size(); ++i)
+	{
+		if(!red.runs.empty() &&
+			 red.runs.back().full + red.runs.back().size == vars[i])
+		{
+			++red.runs.back().size;
+		}
+		else
+		{
+			red.runs.push_back({vars[i], static_cast<int>(i), 1});
+		}
+	}
+}
+
+
+void DecomposedQPSolver::SubProblem::resize(int nrEq, int nrInEq, int nrGenInEq)
+{
+	int nrVars = static_cast<int>(vars.size());
+
+	Q_.setZero(nrVars, nrVars);
+	C_.setZero(nrVars);
+	QCache_.reset(red);
+	XL_.resize(nrVars);
+	XU_.resize(nrVars);
+
+	AEq_.setZero(nrEq, nrVars);
+	bEq_.setZero(nrEq);
+	AEqCache_.reset(red);
+	AInEq_.setZero(nrInEq, nrVars);
+	bInEq_.setZero(nrInEq);
+	AInEqCache_.reset(red);
+	AGenInEq_.setZero(nrGenInEq, nrVars);
+	LGenInEq_.setZero(nrGenInEq);
+	UGenInEq_.setZero(nrGenInEq);
+	AGenInEqCache_.reset(red);
+
+	nrEq_ = nrInEq_ = nrGenInEq_ = 0;
+}
+
+
+void DecomposedQPSolver::SubProblem::fill()
+{
+	C_.setZero();
+	fillQC(fullTasks, static_cast<int>(vars.size()), QCache_, Q_, C_);
+
+	AEqCache_.start();
+	nrEq_ = fillEq(fullEqConstr, red.nrFull, 0, AEqCache_, AEq_, bEq_);
+	AInEqCache_.start();
+	nrInEq_ = fillInEq(fullInEqConstr, red.nrFull, 0, AInEqCache_, AInEq_,
+		bInEq_);
+	AGenInEqCache_.start();
+	nrGenInEq_ = fillGenInEq(fullGenInEqConstr, red.nrFull, 0, AGenInEqCache_,
+		AGenInEq_, LGenInEq_, UGenInEq_);
+}
+
+
+namespace
+{
+
+
+/// Describe the line i of the sub problem with the constraint that filled it.
+template<typename T, typename NrLines, typename Name, typename Desc>
+std::string subLineDesc(const std::vector<T*>& constrs,
+	const std::vector<rbd::MultiBody>& mbs, int i, NrLines nrLines, Name name,
+	Desc desc)
+{
+	for(T* c: constrs)
+	{
+		int nr = nrLines(c);
+		if(i < nr)
+		{
+			return name(c) + ": " + desc(c, mbs, i);
+		}
+		i -= nr;
+	}
+	return "";
+}
+
+
+} // anonymous namespace
+
+
+std::string DecomposedQPSolver::SubProblem::nameEq() const
+{
+	return "SubProblem";
+}
+
+
+std::string DecomposedQPSolver::SubProblem::descEq(
+	const std::vector<rbd::MultiBody>& mbs, int i)
+{
+	return subLineDesc(fullEqConstr, mbs, i,
+		[](Equality* c) { return c->nrEq(); },
+		[](Equality* c) { return c->nameEq(); },
+		[](Equality* c, const std::vector<rbd::MultiBody>& m, int l)
+			{ return c->descEq(m, l); });
+}
+
+
+std::string DecomposedQPSolver::SubProblem::nameInEq() const
+{
+	return "SubProblem";
+}
+
+
+std::string DecomposedQPSolver::SubProblem::descInEq(
+	const std::vector<rbd::MultiBody>& mbs, int i)
+{
+	return subLineDesc(fullInEqConstr, mbs, i,
+		[](Inequality* c) { return c->nrInEq(); },
+		[](Inequality* c) { return c->nameInEq(); },
+		[](Inequality* c, const std::vector<rbd::MultiBody>& m, int l)
+			{ return c->descInEq(m, l); });
+}
+
+
+std::string DecomposedQPSolver::SubProblem::nameGenInEq() const
+{
+	return "SubProblem";
+}
+
+
+std::string DecomposedQPSolver::SubProblem::descGenInEq(
+	const std::vector<rbd::MultiBody>& mbs, int i)
+{
+	return subLineDesc(fullGenInEqConstr, mbs, i,
+		[](GenInequality* c) { return c->nrGenInEq(); },
+		[](GenInequality* c) { return c->nameGenInEq(); },
+		[](GenInequality* c, const std::vector<rbd::MultiBody>& m, int l)
+			{ return c->descGenInEq(m, l); });
+}
+
+
+std::string DecomposedQPSolver::SubProblem::nameBound() const
+{
+	return "SubProblem";
+}
+
+
+std::string DecomposedQPSolver::SubProblem::descBound(
+	const std::vector<rbd::MultiBody>& /* mbs */, int i)
+{
+	return "full problem variable " + std::to_string(vars[i]);
+}
+
+
+
+/**
+	*													DecomposedQPSolver
+	*/
+
+
+
+DecomposedQPSolver::DecomposedQPSolver(const std::string& name,
+	std::vector<int> varComponent, int nrComponents, WorkerPool* pool):
+	name_(name),
+	varComponent_(std::move(varComponent)),
+	varLocal_(varComponent_.size()),
+	varRunEnd_(varComponent_.size()),
+	pool_(pool),
+	parallel_(false),
+	coupled_(false),
+	subs_(),
+	XLFull_(),
+	XUFull_(),
+	XFull_()
+{
+	const int nrVars = static_cast<int>(varComponent_.size());
+	for(int i = 0; i < nrComponents; ++i)
+	{
+		subs_.emplace_back(new SubProblem);
+		subs_.back()->solver.reset(createQPSolver(name));
+	}
+
+	for(int v = 0; v < nrVars; ++v)
+	{
+		std::vector<int>& vars = subs_[varComponent_[v]]->vars;
+		varLocal_[v] = static_cast<int>(vars.size());
+		vars.push_back(v);
+	}
+
+	for(int v = nrVars - 1; v >= 0; --v)
+	{
+		bool sameNext = v + 1 < nrVars && varComponent_[v + 1] == varComponent_[v];
+		varRunEnd_[v] = sameNext ? varRunEnd_[v + 1] : v + 1;
+	}
+
+	for(std::unique_ptr<SubProblem>& s: subs_)
+	{
+		s->reduction(nrVars);
+	}
+	parallel_ = reentrant();
+}
+
+
+// must declare it in cpp because of WorkerPool fwd declarition
+DecomposedQPSolver::~DecomposedQPSolver()
+{}
+
+
+void DecomposedQPSolver::updateSize(int nrVars, int nrEq, int nrInEq,
+	int nrGenInEq)
+{
+	XLFull_.resize(nrVars);
+	XUFull_.resize(nrVars);
+	XFull_.setZero(nrVars);
+
+	for(std::unique_ptr<SubProblem>& s: subs_)
+	{
+		s->resize(nrEq, nrInEq, nrGenInEq);
+		s->solver->updateSize(static_cast<int>(s->vars.size()), nrEq, nrInEq,
+			nrGenInEq);
+	}
+}
+
+
+void DecomposedQPSolver::setDependencies(int nrVars,
+	std::vector<std::tuple<int, int, double>> dependencies)
+{
+	// dependent variables are always in the same component
+	for(std::size_t i = 0; i < subs_.size(); ++i)
+	{
+		std::vector<std::tuple<int, int, double>> subDependencies;
+		for(const std::tuple<int, int, double>& d: dependencies)
+		{
+			if(varComponent_[std::get<0>(d)] == static_cast<int>(i))
+			{
+				subDependencies.emplace_back(varLocal_[std::get<0>(d)],
+					varLocal_[std::get<1>(d)], std::get<2>(d));
+			}
+		}
+		subs_[i]->solver->setDependencies(static_cast<int>(subs_[i]->vars.size()),
+			std::move(subDependencies));
+	}
+
+	GenQPSolver::setDependencies(nrVars, std::move(dependencies));
+}
+
+
+void DecomposedQPSolver::updateMatrix(
+	const std::vector<Task*>& tasks,
+	const std::vector<Equality*>& eqConstr,
+	const std::vector<Inequality*>& inEqConstr,
+	const std::vector<GenInequality*>& genInEqConstr,
+	const std::vector<Bound*>& boundConstr)
+{
+	for(std::unique_ptr<SubProblem>& s: subs_)
+	{
+		s->fullTasks.clear();
+		s->fullEqConstr.clear();
+		s->fullInEqConstr.clear();
+		s->fullGenInEqConstr.clear();
+	}
+
+	// an empty task or constraint is put in the first sub problem
+	coupled_ = false;
+	auto dispatch = [this](int comp) -> SubProblem*
+	{
+		coupled_ = coupled_ || comp == -2;
+		return coupled_ ? nullptr : subs_[std::max(comp, 0)].get();
+	};
+
+	for(Task* t: tasks)
+	{
+		if(SubProblem* s = dispatch(taskComponent(t)))
+		{
+			s->fullTasks.push_back(t);
+		}
+	}
+	for(Equality* c: eqConstr)
+	{
+		if(SubProblem* s = dispatch(blocksComponent(c->AEqBlocks())))
+		{
+			s->fullEqConstr.push_back(c);
+		}
+	}
+	for(Inequality* c: inEqConstr)
+	{
+		if(SubProblem* s = dispatch(blocksComponent(c->AInEqBlocks())))
+		{
+			s->fullInEqConstr.push_back(c);
+		}
+	}
+	for(GenInequality* c: genInEqConstr)
+	{
+		if(SubProblem* s = dispatch(blocksComponent(c->AGenInEqBlocks())))
+		{
+			s->fullGenInEqConstr.push_back(c);
+		}
+	}
+	if(coupled_)
+	{
+		return;
+	}
+
+	// bounds are variable wise and can span several components
+	XLFull_.fill(-std::numeric_limits<double>::infinity());
+	XUFull_.fill(std::numeric_limits<double>::infinity());
+	fillBound(boundConstr, XLFull_, XUFull_);
+
+	presolveStats_ = PresolveStats();
+	for(std::unique_ptr<SubProblem>& s: subs_)
+	{
+		for(std::size_t i = 0; i < s->vars.size(); ++i)
+		{
+			s->XL_(i) = XLFull_(s->vars[i]);
+			s->XU_(i) = XUFull_(s->vars[i]);
+		}
+		s->fill();
+		s->solver->updateMatrix(s->tasks, s->eqConstr, s->inEqConstr,
+			s->genInEqConstr, s->boundConstr);
+
+		const PresolveStats& subStats = s->solver->presolveStats();
+		presolveStats_.nrLines += subStats.nrLines;
+		presolveStats_.nrEmptyLines += subStats.nrEmptyLines;
+		presolveStats_.nrUnboundedLines += subStats.nrUnboundedLines;
+		presolveStats_.nrBoundLines += subStats.nrBoundLines;
+	}
+}
+
+
+bool DecomposedQPSolver::solve()
+{
+	if(coupled_)
+	{
+		status_ = QPStatus::Failure;
+		return false;
+	}
+
+	auto solveSub = [this](int i)
+	{
+		SubProblem& s = *subs_[i];
+		s.success = s.solver->solve();
+	};
+
+	if(pool_ && parallel_)
+	{
+		pool_->run(static_cast<int>(subs_.size()), solveSub);
+	}
+	else
+	{
+		for(int i = 0; i < static_cast<int>(subs_.size()); ++i)
+		{
+			solveSub(i);
+		}
+	}
+
+	bool success = true;
+	status_ = QPStatus::Success;
+	for(const std::unique_ptr<SubProblem>& s: subs_)
+	{
+		const Eigen::VectorXd& x = s->solver->result();
+		for(std::size_t i = 0; i < s->vars.size(); ++i)
+		{
+			XFull_(s->vars[i]) = x(i);
+		}
+		success = success && s->success;
+		status_ = std::max(status_, s->solver->status());
+	}
+	return success;
+}
+
+
+const Eigen::VectorXd& DecomposedQPSolver::result() const
+{
+	return XFull_;
+}
+
+
+bool DecomposedQPSolver::feasibleIterate() const
+{
+	if(coupled_)
+	{
+		return false;
+	}
+
+	for(const std::unique_ptr<SubProblem>& s: subs_)
+	{
+		if(!s->success && !s->solver->feasibleIterate())
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+
+void DecomposedQPSolver::deadline(const Clock::time_point& d)
+{
+	GenQPSolver::deadline(d);
+	for(std::unique_ptr<SubProblem>& s: subs_)
+	{
+		s->solver->deadline(d);
+	}
+}
+
+
+void DecomposedQPSolver::warmStart(bool w)
+{
+	GenQPSolver::warmStart(w);
+	for(std::unique_ptr<SubProblem>& s: subs_)
+	{
+		s->solver->warmStart(w);
+	}
+}
+
+
+void DecomposedQPSolver::resetWarmStart()
+{
+	GenQPSolver::resetWarmStart();
+	for(std::unique_ptr<SubProblem>& s: subs_)
+	{
+		s->solver->resetWarmStart();
+	}
+}
+
+
+void DecomposedQPSolver::presolve(bool p)
+{
+	GenQPSolver::presolve(p);
+	for(std::unique_ptr<SubProblem>& s: subs_)
+	{
+		s->solver->presolve(p);
+	}
+}
+
+
+int DecomposedQPSolver::iterations() const
+{
+	int iter = 0;
+	for(const std::unique_ptr<SubProblem>& s: subs_)
+	{
+		int subIter = s->solver->iterations();
+		if(subIter < 0)
+		{
+			return -1;
+		}
+		iter = std::max(iter, subIter);
+	}
+	return iter;
+}
+
+
+bool DecomposedQPSolver::reentrant() const
+{
+	for(const std::unique_ptr<SubProblem>& s: subs_)
+	{
+		if(!s->solver->reentrant())
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+
+void DecomposedQPSolver::maxIter(int maxIter)
+{
+	for(std::unique_ptr<SubProblem>& s: subs_)
+	{
+		s->solver->maxIter(maxIter);
+	}
+}
+
+
+int DecomposedQPSolver::maxIter() const
+{
+	return subs_.front()->solver->maxIter();
+}
+
+
+double DecomposedQPSolver::primalResidual() const
+{
+	double res = 0.;
+	for(const std::unique_ptr<SubProblem>& s: subs_)
+	{
+		double subRes = s->solver->primalResidual();
+		if(subRes < 0.)
+		{
+			return -1.;
+		}
+		res = std::max(res, subRes);
+	}
+	return res;
+}
+
+
+double DecomposedQPSolver::dualResidual() const
+{
+	double res = 0.;
+	for(const std::unique_ptr<SubProblem>& s: subs_)
+	{
+		double subRes = s->solver->dualResidual();
+		if(subRes < 0.)
+		{
+			return -1.;
+		}
+		res = std::max(res, subRes);
+	}
+	return res;
+}
+
+
+std::ostream& DecomposedQPSolver::errorMsg(
+	const std::vector<rbd::MultiBody>& mbs,
+	const std::vector<Task*>& /* tasks */,
+	const std::vector<Equality*>& /* eqConstr */,
+	const std::vector<Inequality*>& /* inEqConstr */,
+	const std::vector<GenInequality*>& /* genInEqConstr */,
+	const std::vector<Bound*>& /* boundConstr */,
+	std::ostream& out) const
+{
+	if(coupled_)
+	{
+		return out << "a task or a constraint couple two sub problems" << std::endl;
+	}
+
+	for(std::size_t i = 0; i < subs_.size(); ++i)
+	{
+		const SubProblem& s = *subs_[i];
+		if(!s.success)
+		{
+			out << "sub problem " << i << " failed:" << std::endl;
+			s.solver->errorMsg(mbs, s.tasks, s.eqConstr, s.inEqConstr,
+				s.genInEqConstr, s.boundConstr, out);
+		}
+	}
+	return out;
+}
+
+
+int DecomposedQPSolver::rangeComponent(int begin, int size) const
+{
+	if(size <= 0)
+	{
+		return -1;
+	}
+	return varRunEnd_[begin] >= begin + size ? varComponent_[begin] : -2;
+}
+
+
+int DecomposedQPSolver::blocksComponent(const std::vector<ColBlock>& blocks) const
+{
+	const int nrVars = static_cast<int>(varComponent_.size());
+	int comp = -1;
+	for(const ColBlock& cb: blocks)
+	{
+		int c = rangeComponent(cb.col, cb.cols(nrVars));
+		if(c == -2 || (c != -1 && comp != -1 && c != comp))
+		{
+			return -2;
+		}
+		comp = c == -1 ? comp : c;
+	}
+	return comp;
+}
+
+
+int DecomposedQPSolver::taskComponent(const Task* t) const
+{
+	std::pair<int, int> b = t->begin();
+	int rows = static_cast<int>(t->isLeastSquares() ? t->ALS().cols() :
+		t->Q().rows());
+	int cols = static_cast<int>(t->isLeastSquares() ? t->ALS().cols() :
+		t->Q().cols());
+	int c1 = rangeComponent(b.first, rows);
+	int c2 = rangeComponent(b.second, cols);
+	if(c1 == -2 || c2 == -2 || (c1 != -1 && c2 != -1 && c1 != c2))
+	{
+		return -2;
+	}
+	return std::max(c1, c2);
+}
+
+
+} // namespace qp
+
+} // namespace tasks
@@ -0,0 +1,230 @@
+// Copyright 2012-2016 CNRS-UM LIRMM, CNRS-AIST JRL
+//
+// This file is part of Tasks.
+//
+// Tasks is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Tasks is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with Tasks.  If not, see <http://www.gnu.org/licenses/>.
+
+#pragma once
+
+// includes
+// std
+#include <memory>
+#include <string>
+#include <vector>
+
+// Eigen
+#include <Eigen/Core>
+
+// Tasks
+#include "Tasks/GenQPSolver.h"
+#include "Tasks/QPSolver.h"
+#include "GenQPUtils.h"
+
+
+namespace tasks
+{
+
+namespace qp
+{
+class WorkerPool;
+
+
+/**
+	* GenQPSolver interface implementation that split the problem in
+	* independent sub problems.
+	*
+	* Each variable belong to a component (typically the robots linked by
+	* contacts with their contact forces).
+	* Each task and constraint is given to the component of its variables
+	* (see Equality::AEqBlocks) and each component is assembled and solved
+	* with its own backend, in parallel if a WorkerPool is given and
+	* the backend is reentrant.
+	* If a task or a constraint couple two components the problem is not
+	* filled (see coupled) and the components must be computed again.
+	*/
+class TASKS_DLLAPI DecomposedQPSolver : public GenQPSolver
+{
+public:
+	/**
+		* @param name Backend name (see createQPSolver).
+		* @param varComponent Component of each variable.
+		* @param nrComponents Number of components.
+		* @param pool Pool used to solve the sub problems, can be nullptr.
+		*/
+	DecomposedQPSolver(const std::string& name, std::vector<int> varComponent,
+		int nrComponents, WorkerPool* pool);
+	~DecomposedQPSolver();
+
+	void pool(WorkerPool* pool)
+	{
+		pool_ = pool;
+	}
+
+	/**
+		* @return true if a task or a constraint given to the last updateMatrix
+		* couple two components, the sub problems are then not filled.
+		*/
+	bool coupled() const
+	{
+		return coupled_;
+	}
+
+	virtual void updateSize(int nrVars, int nrEq, int nrInEq, int nrGenInEq) override;
+	virtual void setDependencies(int nrVars,
+		std::vector<std::tuple<int, int, double>> dependencies) override;
+	virtual void updateMatrix(const std::vector<Task*>& tasks,
+		const std::vector<Equality*>& eqConstr,
+		const std::vector<Inequality*>& inEqConstr,
+		const std::vector<GenInequality*>& genInEqConstr,
+		const std::vector<Bound*>& boundConstr) override;
+	/// The status is the worst status of the components.
+	virtual bool solve() override;
+	virtual const Eigen::VectorXd& result() const override;
+	/// @return true if each component is solved or has a feasible iterate.
+	virtual bool feasibleIterate() const override;
+	virtual void deadline(const Clock::time_point& d) override;
+	virtual void warmStart(bool w) override;
+	virtual void resetWarmStart() override;
+	virtual void presolve(bool p) override;
+	virtual int iterations() const override;
+	virtual bool reentrant() const override;
+	virtual void maxIter(int maxIter) override;
+	virtual int maxIter() const override;
+	/// @return Maximum residual of the components.
+	virtual double primalResidual() const override;
+	/// @return Maximum residual of the components.
+	virtual double dualResidual() const override;
+	virtual std::ostream& errorMsg(const std::vector<rbd::MultiBody>& mbs,
+		const std::vector<Task*>& tasks,
+		const std::vector<Equality*>& eqConstr,
+		const std::vector<Inequality*>& inEqConstr,
+		const std::vector<GenInequality*>& genInEqConstr,
+		const std::vector<Bound*>& boundConstr,
+		std::ostream& out) const override;
+
+private:
+	/// Problem of one component, given to its backend as a task and constraints.
+	struct SubProblem : public Task, public Equality, public Inequality,
+		public GenInequality, public Bound
+	{
+		SubProblem();
+
+		/// Build red from vars.
+		void reduction(int nrFullVars);
+		void resize(int nrEq, int nrInEq, int nrGenInEq);
+		/// Assemble the tasks and the constraints of the component.
+		void fill();
+
+		virtual std::pair<int, int> begin() const override { return {0, 0}; }
+		virtual void updateNrVars(const std::vector<rbd::MultiBody>&,
+			const SolverData&) override {}
+		virtual void update(const std::vector<rbd::MultiBody>&,
+			const std::vector<rbd::MultiBodyConfig>&, const SolverData&) override {}
+		virtual const Eigen::MatrixXd& Q() const override { return Q_; }
+		virtual const Eigen::VectorXd& C() const override { return C_; }
+
+		virtual int maxEq() const override { return int(AEq_.rows()); }
+		virtual int nrEq() const override { return nrEq_; }
+		virtual const Eigen::MatrixXd& AEq() const override { return AEq_; }
+		virtual const Eigen::VectorXd& bEq() const override { return bEq_; }
+		virtual std::string nameEq() const override;
+		virtual std::string descEq(const std::vector<rbd::MultiBody>& mbs,
+			int i) override;
+
+		virtual int maxInEq() const override { return int(AInEq_.rows()); }
+		virtual int nrInEq() const override { return nrInEq_; }
+		virtual const Eigen::MatrixXd& AInEq() const override { return AInEq_; }
+		virtual const Eigen::VectorXd& bInEq() const override { return bInEq_; }
+		virtual std::string nameInEq() const override;
+		virtual std::string descInEq(const std::vector<rbd::MultiBody>& mbs,
+			int i) override;
+
+		virtual int maxGenInEq() const override { return int(AGenInEq_.rows()); }
+		virtual int nrGenInEq() const override { return nrGenInEq_; }
+		virtual const Eigen::MatrixXd& AGenInEq() const override { return AGenInEq_; }
+		virtual const Eigen::VectorXd& LowerGenInEq() const override { return LGenInEq_; }
+		virtual const Eigen::VectorXd& UpperGenInEq() const override { return UGenInEq_; }
+		virtual std::string nameGenInEq() const override;
+		virtual std::string descGenInEq(const std::vector<rbd::MultiBody>& mbs,
+			int i) override;
+
+		virtual int beginVar() const override { return 0; }
+		virtual const Eigen::VectorXd& Lower() const override { return XL_; }
+		virtual const Eigen::VectorXd& Upper() const override { return XU_; }
+		virtual std::string nameBound() const override;
+		virtual std::string descBound(const std::vector<rbd::MultiBody>& mbs,
+			int i) override;
+
+		/// full problem index of the variables
+		std::vector<int> vars;
+		/// select the variables of the component in the full problem
+		VariableReduction red;
+
+		/// tasks and constraints of the full problem in this component
+		std::vector<Task*> fullTasks;
+		std::vector<Equality*> fullEqConstr;
+		std::vector<Inequality*> fullInEqConstr;
+		std::vector<GenInequality*> fullGenInEqConstr;
+
+		std::unique_ptr<GenQPSolver> solver;
+		/// the sub problem itself, given to solver
+		std::vector<Task*> tasks;
+		std::vector<Equality*> eqConstr;
+		std::vector<Inequality*> inEqConstr;
+		std::vector<GenInequality*> genInEqConstr;
+		std::vector<Bound*> boundConstr;
+		bool success;
+
+		QFillCache QCache_;
+		AFillCache AEqCache_, AInEqCache_, AGenInEqCache_;
+		Eigen::MatrixXd Q_;
+		Eigen::VectorXd C_;
+		Eigen::MatrixXd AEq_, AInEq_, AGenInEq_;
+		Eigen::VectorXd bEq_, bInEq_, LGenInEq_, UGenInEq_;
+		Eigen::VectorXd XL_, XU_;
+		int nrEq_, nrInEq_, nrGenInEq_;
+	};
+
+private:
+	/**
+		* @return Component of the variables [begin, begin + size),
+		* -1 if size is zero and -2 if they are in more than one component.
+		*/
+	int rangeComponent(int begin, int size) const;
+	/// @return Component of the column blocks (see rangeComponent).
+	int blocksComponent(const std::vector<ColBlock>& blocks) const;
+	/// @return Component of the task variables (see rangeComponent).
+	int taskComponent(const Task* t) const;
+
+private:
+	std::string name_;
+	std::vector<int> varComponent_;
+	/// index of each variable in its sub problem
+	std::vector<int> varLocal_;
+	/// end of the run of variables of the same component starting at each variable
+	std::vector<int> varRunEnd_;
+	WorkerPool* pool_;
+	bool parallel_;
+	bool coupled_;
+
+	std::vector<std::unique_ptr<SubProblem>> subs_;
+
+	Eigen::VectorXd XLFull_, XUFull_;
+	Eigen::VectorXd XFull_;
+};
+
+
+} // namespace qp
+
+} // namespace tasks
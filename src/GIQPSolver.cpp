@@ -0,0 +1,156 @@
+// Copyright 2012-2016 CNRS-UM LIRMM, CNRS-AIST JRL
+//
+// This file is part of Tasks.
+//
+// Tasks is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Tasks is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with Tasks.  If not, see <http://www.gnu.org/licenses/>.
+
+// associated header
+#include "GIQPSolver.h"
+
+// includes
+// Tasks
+#include "Tasks/QPSolver.h"
+
+
+namespace tasks
+{
+
+namespace qp
+{
+
+
+GIQPSolver::GIQPSolver():
+	gi_(),
+	dense_(DenseQP::Form::Standard),
+	sameQ_(false)
+{
+}
+
+
+void GIQPSolver::updateSize(int nrVars, int nrEq, int nrInEq, int nrGenInEq)
+{
+	dense_.updateSize(nrVars, nrEq, nrInEq, nrGenInEq, reduction_);
+	gi_.problem(dense_.nrVars(), dense_.maxAeqLines(), dense_.maxAineqLines());
+	// at most every inequality line and bound is active
+	activeSet_.clear();
+	activeSet_.reserve(dense_.maxAineqLines() + 2*dense_.nrVars());
+}
+
+
+void GIQPSolver::updateMatrix(
+	const std::vector<Task*>& tasks,
+	const std::vector<Equality*>& eqConstr,
+	const std::vector<Inequality*>& inEqConstr,
+	const std::vector<GenInequality*>& genInEqConstr,
+	const std::vector<Bound*>& boundConstr)
+{
+	dense_.updateMatrix(tasks, eqConstr, inEqConstr, genInEqConstr, boundConstr,
+		presolve_, presolveStats_);
+	sameQ_ = dense_.constantQ();
+}
+
+
+bool GIQPSolver::solve()
+{
+	const int nrAeqLines = dense_.nrAeqLines();
+	const int nrAineqLines = dense_.nrAineqLines();
+
+	gi_.deadline(deadline_);
+	bool success = gi_.solve(dense_.Q(), dense_.C(),
+		dense_.Aeq().topRows(nrAeqLines), dense_.beq().head(nrAeqLines),
+		dense_.Aineq().topRows(nrAineqLines), dense_.bineq().head(nrAineqLines),
+		dense_.XL(), dense_.XU(), sameQ_);
+	switch(gi_.status())
+	{
+	case GoldfarbIdnani::Success:
+		status_ = QPStatus::Success;
+		break;
+	case GoldfarbIdnani::MaxIter:
+		status_ = QPStatus::MaxIter;
+		break;
+	case GoldfarbIdnani::Timeout:
+		status_ = QPStatus::Timeout;
+		break;
+	default:
+		status_ = QPStatus::Failure;
+		break;
+	}
+
+	// active inequality lines in the Aineq, lower bounds, upper bounds order
+	activeSet_.clear();
+	for(int i = 0; i < gi_.nrActive(); ++i)
+	{
+		if(gi_.activeConstraint(i) >= 0)
+		{
+			activeSet_.push_back(gi_.activeConstraint(i));
+		}
+	}
+	if(dense_.presolved())
+	{
+		dense_.AineqMap().fromPresolved(activeSet_);
+	}
+
+	dense_.expand(gi_.result());
+	return success;
+}
+
+
+const Eigen::VectorXd& GIQPSolver::result() const
+{
+	return dense_.reduced() ? dense_.XFull() : gi_.result();
+}
+
+
+int GIQPSolver::iterations() const
+{
+	return gi_.iterations();
+}
+
+
+std::ostream& GIQPSolver::errorMsg(
+	const std::vector<rbd::MultiBody>& /* mbs */,
+	const std::vector<Task*>& /* tasks */,
+	const std::vector<Equality*>& /* eqConstr */,
+	const std::vector<Inequality*>& /* inEqConstr */,
+	const std::vector<GenInequality*>& /* genInEqConstr */,
+	const std::vector<Bound*>& /* boundConstr */,
+	std::ostream& out) const
+{
+	switch(gi_.status())
+	{
+	case GoldfarbIdnani::MaxIter:
+		out << "GI: maximum number of iterations reached" << std::endl;
+		break;
+	case GoldfarbIdnani::Timeout:
+		out << "GI: deadline reached" << std::endl;
+		break;
+	case GoldfarbIdnani::Infeasible:
+		out << "GI: the constraints are inconsistent" << std::endl;
+		break;
+	case GoldfarbIdnani::DependentEq:
+		out << "GI: the equality constraints are linearly dependent" << std::endl;
+		break;
+	case GoldfarbIdnani::NotPositive:
+		out << "GI: Q is not positive definite" << std::endl;
+		break;
+	default:
+		break;
+	}
+	return out;
+}
+
+
+} // namespace qp
+
+} // namespace tasks
@@ -0,0 +1,95 @@
+// Copyright 2012-2016 CNRS-UM LIRMM, CNRS-AIST JRL
+//
+// This file is part of Tasks.
+//
+// Tasks is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Tasks is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with Tasks.  If not, see <http://www.gnu.org/licenses/>.
+
+#pragma once
+
+// includes
+// Eigen
+#include <Eigen/Core>
+
+// Tasks
+#include "Tasks/GenQPSolver.h"
+#include "GenQPUtils.h"
+#include "GoldfarbIdnani.h"
+
+
+namespace tasks
+{
+
+namespace qp
+{
+
+
+/**
+	* GenQPSolver interface implementation with the in-tree Goldfarb-Idnani
+	* dual active set solver (see GoldfarbIdnani).
+	*
+	* The problem is assembled in the same standard form as QLDQPSolver.
+	* The Cholesky factor of Q is reused when all the tasks are constant
+	* (see Task::QRevision) and have not changed since the previous solve.
+	*/
+class TASKS_DLLAPI GIQPSolver : public GenQPSolver
+{
+public:
+	GIQPSolver();
+
+	virtual void updateSize(int nrVars, int nrEq, int nrInEq, int nrGenInEq) override;
+	virtual void updateMatrix(const std::vector<Task*>& tasks,
+		const std::vector<Equality*>& eqConstr,
+		const std::vector<Inequality*>& inEqConstr,
+		const std::vector<GenInequality*>& genInEqConstr,
+		const std::vector<Bound*>& boundConstr) override;
+	virtual bool solve() override;
+	virtual const Eigen::VectorXd& result() const override;
+	virtual std::ostream& errorMsg(const std::vector<rbd::MultiBody>& mbs,
+		const std::vector<Task*>& tasks,
+		const std::vector<Equality*>& eqConstr,
+		const std::vector<Inequality*>& inEqConstr,
+		const std::vector<GenInequality*>& genInEqConstr,
+		const std::vector<Bound*>& boundConstr,
+		std::ostream& out) const override;
+
+	/// @return Number of added or dropped constraints of the last solve.
+	virtual int iterations() const override;
+
+	/// Maximum number of added or dropped constraints, unlimited by default.
+	virtual void maxIter(int maxIter) override
+	{
+		gi_.maxIter(maxIter);
+	}
+
+	virtual int maxIter() const override
+	{
+		return gi_.maxIter();
+	}
+
+	/// @return Number of Cholesky factorizations of Q since the last updateSize.
+	int nrFactorizations() const
+	{
+		return gi_.nrFactorizations();
+	}
+
+private:
+	GoldfarbIdnani gi_;
+	DenseQP dense_;
+	bool sameQ_;
+};
+
+
+} // namespace qp
+
+} // namespace tasks
@@ -20,10 +20,14 @@
 
 // includes
 // std
+#include <algorithm>
 #include <map>
 
 // Tasks
+#include "ADMMQPSolver.h"
+#include "GIQPSolver.h"
 #include "QLDQPSolver.h"
+#include "SparseQPSolver.h"
 
 #ifdef LSSOL_SOLVER_FOUND
 	#include "LSSOLQPSolver.h"
@@ -56,7 +60,10 @@ std::map<std::string, std::function<GenQPSolver*(void)> > qpFactory = {
 #ifdef LSSOL_SOLVER_FOUND
 	{"LSSOL", allocateQP<LSSOLQPSolver>},
 #endif
-	{"QLD", allocateQP<QLDQPSolver>}
+	{"ADMM", allocateQP<ADMMQPSolver>},
+	{"GI", allocateQP<GIQPSolver>},
+	{"QLD", allocateQP<QLDQPSolver>},
+	{"SPARSE", allocateQP<SparseQPSolver>}
 };
 
 
@@ -65,6 +72,139 @@ GenQPSolver* createQPSolver(const std::string& name)
 	return qpFactory.at(name)();
 }
 
+
+std::vector<std::string> qpSolverNames()
+{
+	std::vector<std::string> names;
+	names.reserve(qpFactory.size());
+	for(const auto& p: qpFactory)
+	{
+		names.push_back(p.first);
+	}
+	return names;
+}
+
+
+GenQPSolver::GenQPSolver():
+	fullToReduced_(),
+	reducedToFull_(),
+	dependencies_(),
+	reduction_(),
+	warmStart_(false),
+	activeSet_(),
+	presolve_(false),
+	presolveStats_(),
+	deadline_(Clock::time_point::max()),
+	status_(QPStatus::Success)
+{}
+
+
+void GenQPSolver::warmStart(bool w)
+{
+	warmStart_ = w;
+}
+
+
+bool GenQPSolver::warmStart() const
+{
+	return warmStart_;
+}
+
+
+void GenQPSolver::seed(const std::vector<int>& activeSet)
+{
+	activeSet_ = activeSet;
+}
+
+
+void GenQPSolver::resetWarmStart()
+{
+	activeSet_.clear();
+}
+
+
+const std::vector<int>& GenQPSolver::activeSet() const
+{
+	return activeSet_;
+}
+
+
+QPStatus GenQPSolver::status() const
+{
+	return status_;
+}
+
+
+bool GenQPSolver::feasibleIterate() const
+{
+	return false;
+}
+
+
+void GenQPSolver::deadline(const Clock::time_point& d)
+{
+	deadline_ = d;
+}
+
+
+const GenQPSolver::Clock::time_point& GenQPSolver::deadline() const
+{
+	return deadline_;
+}
+
+
+int GenQPSolver::iterations() const
+{
+	return -1;
+}
+
+
+void GenQPSolver::maxIter(int /* maxIter */)
+{}
+
+
+int GenQPSolver::maxIter() const
+{
+	return -1;
+}
+
+
+double GenQPSolver::primalResidual() const
+{
+	return -1.;
+}
+
+
+double GenQPSolver::dualResidual() const
+{
+	return -1.;
+}
+
+
+void GenQPSolver::presolve(bool p)
+{
+	presolve_ = p;
+}
+
+
+bool GenQPSolver::presolve() const
+{
+	return presolve_;
+}
+
+
+const PresolveStats& GenQPSolver::presolveStats() const
+{
+	return presolveStats_;
+}
+
+
+const VariableReduction& GenQPSolver::reduction() const
+{
+	return reduction_;
+}
+
+
 void GenQPSolver::setDependencies(int nrVars, std::vector<std::tuple<int, int, double>> dependencies)
 {
 	dependencies_ = dependencies;
@@ -87,6 +227,34 @@ void GenQPSolver::setDependencies(int nrVars, std::vector<std::tuple<int, int, d
 		fullToReduced_[i] = static_cast<int>(i - shift);
 		reducedToFull_[i-shift] = static_cast<int>(i);
 	}
+
+	reduction_.nrFull = nrVars;
+	reduction_.nrReduced = static_cast<int>(reducedToFull_.size());
+	reduction_.runs.clear();
+	reduction_.replicas.clear();
+	for(int i = 0; i < reduction_.nrReduced; ++i)
+	{
+		int full = reducedToFull_[i];
+		if(!reduction_.runs.empty() &&
+			 reduction_.runs.back().full + reduction_.runs.back().size == full)
+		{
+			++reduction_.runs.back().size;
+		}
+		else
+		{
+			reduction_.runs.push_back({full, i, 1});
+		}
+	}
+	for(const auto& d: dependencies_)
+	{
+		reduction_.replicas.push_back({std::get<1>(d),
+			fullToReduced_[std::get<0>(d)], std::get<2>(d)});
+	}
+	std::sort(reduction_.replicas.begin(), reduction_.replicas.end(),
+		[](const VariableReduction::Replica& r1, const VariableReduction::Replica& r2)
+		{
+			return r1.full < r2.full;
+		});
 }
 
 } // namespace qp
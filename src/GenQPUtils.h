@@ -19,12 +19,16 @@
 
 // includes
 // std
+#include <algorithm>
+#include <cmath>
+#include <limits>
 #include <vector>
 
 // Eigen
 #include <Eigen/Core>
 
 // Tasks
+#include "Tasks/GenQPSolver.h"
 #include "Tasks/QPSolver.h"
 
 
@@ -40,23 +44,496 @@ static const double DIAG_CONSTANT = 1e-4;
 
 
 /**
-	* Fill the \f$ Q \f$ matrix and the \f$ c \f$ vector based on the
-	* task list.
+	* Call f(full, reduced, size) for each run of independent variables
+	* of the reduction in the full variables [begin, end).
+	*/
+template<typename F>
+inline void forEachRun(const VariableReduction& red, int begin, int end, F f)
+{
+	for(const VariableReduction::Run& r: red.runs)
+	{
+		if(r.full >= end)
+		{
+			break;
+		}
+		int lo = std::max(begin, r.full);
+		int hi = std::min(end, r.full + r.size);
+		if(lo < hi)
+		{
+			f(lo, r.reduced + lo - r.full, hi - lo);
+		}
+	}
+}
+
+
+/**
+	* Call f(replica) for each dependent variable of the reduction
+	* in the full variables [begin, end).
+	*/
+template<typename F>
+inline void forEachReplica(const VariableReduction& red, int begin, int end, F f)
+{
+	for(const VariableReduction::Replica& r: red.replicas)
+	{
+		if(r.full >= end)
+		{
+			break;
+		}
+		if(r.full >= begin)
+		{
+			f(r);
+		}
+	}
+}
+
+
+/**
+	* Add factor*v to the lines [r, r + v.size()) of the column k of
+	* the symmetric matrix Q and to the same columns of the line k.
+	* Only the upper triangular part of Q is written.
+	*/
+template<typename Vec>
+inline void addReducedCross(int k, int r, double factor, const Vec& v,
+	Eigen::MatrixXd& Q)
+{
+	const int s = static_cast<int>(v.size());
+	// above the diagonal the lines go in the column k
+	int t = std::min(std::max(k - r, 0), s);
+	if(t > 0)
+	{
+		Q.col(k).segment(r, t) += factor*v.head(t);
+	}
+	// the primary variable itself receive the term twice
+	if(t < s && r + t == k)
+	{
+		Q(k, k) += 2.*factor*v(t);
+		++t;
+	}
+	// below the diagonal they go in the line k
+	if(t < s)
+	{
+		Q.row(k).segment(r + t, s - t) += factor*v.segment(t, s - t).transpose();
+	}
+}
+
+
+/**
+	* Add \f$ w P^T Q_i P \f$ to the upper triangular part of the reduced Q.
+	* Qi is the upper triangular part of the diagonal block of a task starting
+	* at the full variable begin.
+	*/
+inline void addReducedQ(const Eigen::MatrixXd& Qi, int begin, double weight,
+	const VariableReduction& red, Eigen::MatrixXd& Q)
+{
+	const int end = begin + static_cast<int>(Qi.rows());
+
+	// independent variables, runs keep their order in the reduced variables
+	forEachRun(red, begin, end, [&](int f1, int r1, int s1)
+	{
+		Q.block(r1, r1, s1, s1).triangularView<Eigen::Upper>() +=
+			weight*Qi.block(f1 - begin, f1 - begin, s1, s1);
+		forEachRun(red, f1 + s1, end, [&](int f2, int r2, int s2)
+		{
+			Q.block(r1, r2, s1, s2) +=
+				weight*Qi.block(f1 - begin, f2 - begin, s1, s2);
+		});
+	});
+
+	forEachReplica(red, begin, end, [&](const VariableReduction::Replica& rep)
+	{
+		const int a = rep.full - begin;
+		const int k = rep.reduced;
+		const double wf = weight*rep.factor;
+
+		// dependent and independent variables
+		forEachRun(red, begin, end, [&](int f, int r, int s)
+		{
+			const int i = f - begin;
+			if(i < a)
+			{
+				addReducedCross(k, r, wf, Qi.col(a).segment(i, s), Q);
+			}
+			else
+			{
+				addReducedCross(k, r, wf, Qi.row(a).segment(i, s).transpose(), Q);
+			}
+		});
+
+		// dependent variables
+		forEachReplica(red, rep.full, end,
+			[&](const VariableReduction::Replica& rep2)
+			{
+				const double val = wf*rep2.factor*Qi(a, rep2.full - begin);
+				if(rep2.full == rep.full)
+				{
+					Q(k, k) += val;
+				}
+				else if(rep2.reduced == k)
+				{
+					Q(k, k) += 2.*val;
+				}
+				else
+				{
+					Q(std::min(k, rep2.reduced), std::max(k, rep2.reduced)) += val;
+				}
+			});
+	});
+}
+
+
+/// Add \f$ w P^T c_i \f$ to the reduced C.
+inline void addReducedC(const Eigen::VectorXd& Ci, int begin, double weight,
+	const VariableReduction& red, Eigen::VectorXd& C)
+{
+	const int end = begin + static_cast<int>(Ci.rows());
+	forEachRun(red, begin, end, [&](int f, int r, int s)
+	{
+		C.segment(r, s) += weight*Ci.segment(f - begin, s);
+	});
+	forEachReplica(red, begin, end, [&](const VariableReduction::Replica& rep)
+	{
+		C(rep.reduced) += weight*rep.factor*Ci(rep.full - begin);
+	});
+}
+
+
+/// @return Range [first, second) of the reduced variables of the full variables [begin, end).
+inline std::pair<int, int> reducedRange(const VariableReduction& red,
+	int begin, int end)
+{
+	std::pair<int, int> range(red.nrReduced, 0);
+	forEachRun(red, begin, end, [&](int /* f */, int r, int s)
+	{
+		range.first = std::min(range.first, r);
+		range.second = std::max(range.second, r + s);
+	});
+	forEachReplica(red, begin, end, [&](const VariableReduction::Replica& rep)
+	{
+		range.first = std::min(range.first, rep.reduced);
+		range.second = std::max(range.second, rep.reduced + 1);
+	});
+	return range;
+}
+
+
+/**
+	* Keep the sum of the Q matrices of the tasks that don't change at each
+	* update (see Task::QRevision).
+	*
+	* Q is only reset to this sum where it was written by addQ,
+	* addLeastSquares and the diagonal regularization since the previous fill,
+	* so the upper triangular part of Q must not be modified elsewhere.
+	*
+	* When a VariableReduction is given Q and C are assembled directly
+	* in the reduced variables.
+	*/
+class QFillCache
+{
+public:
+	QFillCache():
+		QConst_(),
+		tasks_(),
+		written_(),
+		ALS_(),
+		ALSReduced_(),
+		bLS_(),
+		reduction_(nullptr),
+		constant_(false),
+		filled_(false)
+	{}
+
+	/// Forget the cached tasks, must be called when the variables change.
+	void reset(int nrVars)
+	{
+		QConst_.setZero(nrVars, nrVars);
+		tasks_.clear();
+		written_.clear();
+		reduction_ = nullptr;
+		constant_ = false;
+		filled_ = false;
+	}
+
+	/// Same as reset but the matrices are assembled in the reduced variables.
+	void reset(const VariableReduction& red)
+	{
+		reset(red.nrReduced);
+		reduction_ = &red;
+	}
+
+	/// Add the weighted upper triangular Qi at begin to the upper part of Q.
+	void addQ(const Eigen::MatrixXd& Qi, std::pair<int, int> begin,
+		double weight, Eigen::MatrixXd& Q)
+	{
+		if(reduction_)
+		{
+			std::pair<int, int> r = reducedRange(*reduction_, begin.first,
+				begin.first + static_cast<int>(Qi.rows()));
+			if(r.first < r.second)
+			{
+				written_.push_back({r.first, r.first, r.second - r.first,
+					r.second - r.first});
+			}
+		}
+		else
+		{
+			written_.push_back({begin.first, begin.second,
+				static_cast<int>(Qi.rows()), static_cast<int>(Qi.cols())});
+		}
+		add(Qi, begin, weight, Q);
+	}
+
+	/// Add the weighted Ci at begin to C.
+	void addC(const Eigen::VectorXd& Ci, int begin, double weight,
+		Eigen::VectorXd& C) const
+	{
+		if(reduction_)
+		{
+			addReducedC(Ci, begin, weight, *reduction_, C);
+		}
+		else
+		{
+			C.segment(begin, Ci.rows()) += weight*Ci;
+		}
+	}
+
+	/**
+		* Fill the upper triangular part of Q with the sum of the Q matrices
+		* of the constant tasks.
+		* The sum is computed again only if one of them has changed,
+		* otherwise only the blocks of Q written since the previous fill
+		* are copied.
+		*/
+	void fill(const std::vector<Task*>& tasks, Eigen::MatrixXd& Q)
+	{
+		std::size_t nrConst = 0;
+		bool changed = false;
+		for(const Task* t: tasks)
+		{
+			if(isConstant(t))
+			{
+				changed = changed || nrConst >= tasks_.size() ||
+					!tasks_[nrConst].same(t);
+				++nrConst;
+			}
+		}
+
+		constant_ = !changed && nrConst == tasks_.size() && nrConst == tasks.size();
+		if(changed || nrConst != tasks_.size())
+		{
+			QConst_.setZero();
+			tasks_.clear();
+			for(const Task* t: tasks)
+			{
+				if(isConstant(t))
+				{
+					const Eigen::MatrixXd& Qi = t->Q();
+					std::pair<int, int> b = t->begin();
+					add(Qi, b, t->weight(), QConst_);
+					tasks_.push_back({t, t->QRevision(), t->weight(), b,
+						static_cast<int>(Qi.rows()), static_cast<int>(Qi.cols()),
+						Qi.data()});
+				}
+			}
+			filled_ = false;
+		}
+
+		if(filled_ && Q.rows() == QConst_.rows() && Q.cols() == QConst_.cols())
+		{
+			for(const Block& b: written_)
+			{
+				Q.block(b.row, b.col, b.rows, b.cols) =
+					QConst_.block(b.row, b.col, b.rows, b.cols);
+			}
+			Q.diagonal() = QConst_.diagonal();
+		}
+		else
+		{
+			Q = QConst_;
+			filled_ = true;
+		}
+		written_.clear();
+	}
+
+	/**
+		* @return true if the Q filled by the last fill is the same as the previous one:
+		* all the tasks are constant and none of them has changed.
+		*/
+	bool constant() const
+	{
+		return constant_;
+	}
+
+	/**
+		* Add the least squares tasks to the upper triangular part of Q and to C.
+		* Their weighted matrices are stacked to compute
+		* \f$ A_{LS}^T A_{LS} \f$ with one rank update.
+		*/
+	void addLeastSquares(const std::vector<Task*>& tasks, Eigen::MatrixXd& Q,
+		Eigen::VectorXd& C)
+	{
+		int nrRows = 0;
+		int begin = static_cast<int>(Q.cols());
+		int end = 0;
+		for(const Task* t: tasks)
+		{
+			if(t->isLeastSquares())
+			{
+				nrRows += static_cast<int>(t->ALS().rows());
+				begin = std::min(begin, t->begin().second);
+				end = std::max(end, t->begin().second + static_cast<int>(t->ALS().cols()));
+			}
+		}
+
+		if(nrRows == 0)
+		{
+			return;
+		}
+
+		// only the columns used by the least squares tasks are stacked
+		ALS_.setZero(nrRows, end - begin);
+		bLS_.resize(nrRows);
+		int row = 0;
+		for(const Task* t: tasks)
+		{
+			if(t->isLeastSquares())
+			{
+				const Eigen::MatrixXd& Ai = t->ALS();
+				double sqrtWeight = std::sqrt(t->weight());
+				ALS_.block(row, t->begin().second - begin, Ai.rows(), Ai.cols()) =
+					sqrtWeight*Ai;
+				bLS_.segment(row, Ai.rows()) = sqrtWeight*t->bLS();
+				row += static_cast<int>(Ai.rows());
+			}
+		}
+
+		if(reduction_)
+		{
+			reduceLeastSquares(nrRows, begin, end, Q, C);
+			return;
+		}
+
+		written_.push_back({begin, begin, end - begin, end - begin});
+		Q.block(begin, begin, end - begin, end - begin).
+			selfadjointView<Eigen::Upper>().rankUpdate(ALS_.transpose());
+		C.segment(begin, end - begin).noalias() -= ALS_.transpose()*bLS_;
+	}
+
+private:
+	static bool isConstant(const Task* t)
+	{
+		return t->QRevision() != -1 && !t->isLeastSquares();
+	}
+
+	void add(const Eigen::MatrixXd& Qi, std::pair<int, int> begin,
+		double weight, Eigen::MatrixXd& Q) const
+	{
+		if(reduction_)
+		{
+			addReducedQ(Qi, begin.first, weight, *reduction_, Q);
+		}
+		else
+		{
+			Q.block(begin.first, begin.second, Qi.rows(), Qi.cols()).
+				triangularView<Eigen::Upper>() += weight*Qi;
+		}
+	}
+
+	/// Same as the end of addLeastSquares with the ALS_ columns reduced first.
+	void reduceLeastSquares(int nrRows, int begin, int end, Eigen::MatrixXd& Q,
+		Eigen::VectorXd& C)
+	{
+		const VariableReduction& red = *reduction_;
+		std::pair<int, int> range = reducedRange(red, begin, end);
+		int rBegin = range.first;
+		int rEnd = range.second;
+		written_.push_back({rBegin, rBegin, rEnd - rBegin, rEnd - rBegin});
+
+		ALSReduced_.setZero(nrRows, rEnd - rBegin);
+		forEachRun(red, begin, end, [&](int f, int r, int s)
+		{
+			ALSReduced_.middleCols(r - rBegin, s) = ALS_.middleCols(f - begin, s);
+		});
+		forEachReplica(red, begin, end, [&](const VariableReduction::Replica& rep)
+		{
+			ALSReduced_.col(rep.reduced - rBegin) +=
+				rep.factor*ALS_.col(rep.full - begin);
+		});
+
+		Q.block(rBegin, rBegin, rEnd - rBegin, rEnd - rBegin).
+			selfadjointView<Eigen::Upper>().rankUpdate(ALSReduced_.transpose());
+		C.segment(rBegin, rEnd - rBegin).noalias() -= ALSReduced_.transpose()*bLS_;
+	}
+
+private:
+	/**
+		* The Q storage is compared in addition to the task address so a task
+		* destroyed and replaced at the same address is seen as a new task.
+		*/
+	struct TaskRecord
+	{
+		bool same(const Task* t) const
+		{
+			return task == t && revision == t->QRevision() &&
+				!t->isLeastSquares() && weight == t->weight() && begin == t->begin() &&
+				rows == t->Q().rows() && cols == t->Q().cols() &&
+				data == t->Q().data();
+		}
+
+		const Task* task;
+		int revision;
+		double weight;
+		std::pair<int, int> begin;
+		int rows, cols;
+		const double* data;
+	};
+
+	/// Block of Q written since the last fill.
+	struct Block
+	{
+		int row, col, rows, cols;
+	};
+
+private:
+	Eigen::MatrixXd QConst_;
+	std::vector<TaskRecord> tasks_;
+	std::vector<Block> written_;
+	Eigen::MatrixXd ALS_, ALSReduced_;
+	Eigen::VectorXd bLS_;
+	const VariableReduction* reduction_;
+	bool constant_;
+	// true if Q has been filled from QConst_
+	bool filled_;
+};
+
+
+/**
+	* Fill the upper triangular part of the \f$ Q \f$ matrix and
+	* the \f$ c \f$ vector based on the task list.
+	* The constant tasks Q matrix are taken from cache and C must be zero.
+	* nrVars is the number of variables of Q (reduced ones if the cache
+	* has a VariableReduction).
 	*/
 inline void fillQC(const std::vector<Task*>& tasks, int nrVars,
-	Eigen::MatrixXd& Q, Eigen::VectorXd& C)
+	QFillCache& cache, Eigen::MatrixXd& Q, Eigen::VectorXd& C)
 {
+	cache.fill(tasks, Q);
+	cache.addLeastSquares(tasks, Q, C);
 	for(std::size_t i = 0; i < tasks.size(); ++i)
 	{
+		if(tasks[i]->isLeastSquares())
+		{
+			continue;
+		}
+
 		const Eigen::MatrixXd& Qi = tasks[i]->Q();
 		const Eigen::VectorXd& Ci = tasks[i]->C();
 		std::pair<int, int> b = tasks[i]->begin();
 
-		int r = static_cast<int>(Qi.rows());
-		int c = static_cast<int>(Qi.cols());
-
-		Q.block(b.first, b.second, r, c) += tasks[i]->weight()*Qi;
-		C.segment(b.first, r) += tasks[i]->weight()*Ci;
+		if(tasks[i]->QRevision() == -1)
+		{
+			cache.addQ(Qi, b, tasks[i]->weight(), Q);
+		}
+		cache.addC(Ci, b.first, tasks[i]->weight(), C);
 	}
 
 	// try to transform Q_ to a positive matrix
@@ -76,44 +553,228 @@ inline void fillQC(const std::vector<Task*>& tasks, int nrVars,
 }
 
 /**
-	* Reduce \f$ Q \f$ matrix and the \f$ c \f$ vector based on the dependencies list
+	* Call f(col, srcCol, size) for each column block,
+	* the full block (see ColBlock::full) hold the nrVars columns.
 	*/
-inline void reduceQC(const Eigen::MatrixXd & QFull, const Eigen::VectorXd & CFull,
-										 Eigen::MatrixXd & Q, Eigen::VectorXd & C,
-										 const std::vector<int> & fullToReduced,
-										 const std::vector<int> & reducedToFull,
-										 const std::vector<std::tuple<int, int, double>> & dependencies)
+template<typename F>
+inline void forEachColBlock(const std::vector<ColBlock>& blocks, int nrVars, F f)
 {
-	/* Start by moving the non-reduced variables to their new location */
-	for(size_t i = 0; i < reducedToFull.size(); ++i)
+	for(const ColBlock& cb: blocks)
+	{
+		f(cb.col, cb.srcCol, cb.cols(nrVars));
+	}
+}
+
+
+/**
+	* Copy nrConstr lines of Ai from srcLine multiplied by sign in A at line.
+	* Only the described column blocks are copied and the other columns
+	* of the lines are left untouched (they must be zero).
+	*/
+inline void fillA(const Eigen::MatrixXd& Ai, const std::vector<ColBlock>& blocks,
+	int srcLine, int nrConstr, int nrVars, int line, double sign, Eigen::MatrixXd& A)
+{
+	forEachColBlock(blocks, nrVars, [&](int col, int srcCol, int size)
 	{
-		for(size_t j = i; j < reducedToFull.size(); ++j)
+		A.block(line, col, nrConstr, size) =
+			sign*Ai.block(srcLine, srcCol, nrConstr, size);
+	});
+}
+
+
+/**
+	* Same as fillA but A columns are the reduced variables,
+	* the columns of the dependent variables are added to their primary one.
+	* The lines of A outside the reduced columns of the blocks are left untouched.
+	*/
+inline void fillReducedA(const Eigen::MatrixXd& Ai,
+	const std::vector<ColBlock>& blocks, int srcLine, int nrConstr, int line,
+	double sign,
+	const VariableReduction& red, Eigen::MatrixXd& A)
+{
+	// the primary columns are only written by the runs if they are
+	// in the blocks, they are cleared first otherwise
+	forEachColBlock(blocks, red.nrFull, [&](int col, int /* srcCol */, int size)
+	{
+		forEachReplica(red, col, col + size, [&](const VariableReduction::Replica& rep)
 		{
-			Q(i,j) = QFull(reducedToFull[i], reducedToFull[j]);
+			A.block(line, rep.reduced, nrConstr, 1).setZero();
+		});
+	});
+	forEachColBlock(blocks, red.nrFull, [&](int col, int srcCol, int size)
+	{
+		forEachRun(red, col, col + size, [&](int f, int r, int s)
+		{
+			A.block(line, r, nrConstr, s) =
+				sign*Ai.block(srcLine, srcCol + f - col, nrConstr, s);
+		});
+	});
+	forEachColBlock(blocks, red.nrFull, [&](int col, int srcCol, int size)
+	{
+		forEachReplica(red, col, col + size, [&](const VariableReduction::Replica& rep)
+		{
+			A.block(line, rep.reduced, nrConstr, 1) +=
+				(sign*rep.factor)*Ai.block(srcLine, srcCol + rep.full - col, nrConstr, 1);
+		});
+	});
+}
+
+
+/**
+	* Keep track of the constraint lines filled in a matrix at the previous
+	* solve to only copy again the constraint matrices that have changed
+	* (see Equality::AEqRevision).
+	*
+	* When a VariableReduction is given the lines are filled directly
+	* in the reduced variables (see fillReducedA).
+	*/
+class AFillCache
+{
+public:
+	AFillCache():
+		constrs_(),
+		nrRecords_(0),
+		index_(0),
+		reduction_(nullptr)
+	{}
+
+	/// Forget the filled lines, must be called when A is set to zero.
+	void reset()
+	{
+		nrRecords_ = 0;
+		index_ = 0;
+		reduction_ = nullptr;
+	}
+
+	/// Same as reset but the lines are filled in the reduced variables.
+	void reset(const VariableReduction& red)
+	{
+		reset();
+		reduction_ = &red;
+	}
+
+	/// Must be called before filling A.
+	void start()
+	{
+		index_ = 0;
+	}
+
+	/**
+		* Same as fillA but the copy is skipped when the constraint filled
+		* the same lines of A at the previous solve and its revision has not changed.
+		* The lines are set to zero before the copy if they were filled
+		* by another constraint or with other blocks.
+		*/
+	void fill(const void* constr, int revision, const Eigen::MatrixXd& Ai,
+		const std::vector<ColBlock>& blocks, int nrConstr, int nrVars, int line,
+		double sign, Eigen::MatrixXd& A)
+	{
+		fill(constr, revision, Ai, blocks, 0, nrConstr, nrVars, line, sign, A);
+	}
+
+	/// Same as above but nrConstr lines are copied from the srcLine line of Ai.
+	void fill(const void* constr, int revision, const Eigen::MatrixXd& Ai,
+		const std::vector<ColBlock>& blocks, int srcLine, int nrConstr, int nrVars,
+		int line, double sign, Eigen::MatrixXd& A)
+	{
+		if(index_ < nrRecords_ &&
+			 constrs_[index_].same(constr, blocks, srcLine, nrConstr, line, sign))
+		{
+			ConstrRecord& cr = constrs_[index_++];
+			if(revision == -1 || revision != cr.revision)
+			{
+				fill(Ai, blocks, srcLine, nrConstr, nrVars, line, sign, A);
+				cr.revision = revision;
+			}
+			return;
 		}
-		C(i) = CFull(reducedToFull[i]);
+
+		// the next records are no more valid since lines could have been moved,
+		// they are kept to reuse their blocks storage
+		if(index_ == constrs_.size())
+		{
+			constrs_.emplace_back();
+		}
+		ConstrRecord& cr = constrs_[index_++];
+		nrRecords_ = index_;
+		cr.constr = constr;
+		cr.revision = revision;
+		cr.srcLine = srcLine;
+		cr.nrConstr = nrConstr;
+		cr.line = line;
+		cr.sign = sign;
+		cr.blocks.assign(blocks.begin(), blocks.end());
+
+		if(!isDenseColBlocks(blocks))
+		{
+			A.block(line, 0, nrConstr, A.cols()).setZero();
+		}
+		fill(Ai, blocks, srcLine, nrConstr, nrVars, line, sign, A);
 	}
-	/* Apply the reduction */
-	for(const auto & d : dependencies)
+
+private:
+	void fill(const Eigen::MatrixXd& Ai, const std::vector<ColBlock>& blocks,
+		int srcLine, int nrConstr, int nrVars, int line, double sign,
+		Eigen::MatrixXd& A) const
 	{
-		const int & primaryFullI = std::get<0>(d);
-		const int & primaryReducedI = fullToReduced[primaryFullI];
-		const int & replicaFullI = std::get<1>(d);
-		const double & alpha = std::get<2>(d);
-		/* Apply reduction to C */
-		C(primaryReducedI) += alpha*CFull(replicaFullI);
-		/* Add cross-terms to Q */
-		for(size_t i = 0; i < reducedToFull.size(); ++i)
+		if(reduction_)
+		{
+			fillReducedA(Ai, blocks, srcLine, nrConstr, line, sign, *reduction_, A);
+		}
+		else
 		{
-			Q(i, primaryReducedI) += alpha*QFull(reducedToFull[i], replicaFullI);
+			fillA(Ai, blocks, srcLine, nrConstr, nrVars, line, sign, A);
 		}
-		/* Add diagonal element to Q */
-		Q(primaryReducedI, primaryReducedI) += alpha*alpha*QFull(replicaFullI, replicaFullI);
 	}
-	/* Update the lower triangular part of Q */
-	Q = Q.selfadjointView<Eigen::Upper>();
+
+private:
+	struct ConstrRecord
+	{
+		bool same(const void* c, const std::vector<ColBlock>& b, int srcL, int nrC,
+			int l, double s) const
+		{
+			return constr == c && srcLine == srcL && nrConstr == nrC && line == l &&
+				sign == s && blocks.size() == b.size() &&
+				std::equal(blocks.begin(), blocks.end(), b.begin(),
+					[](const ColBlock& cb1, const ColBlock& cb2)
+					{
+						return cb1.col == cb2.col && cb1.size == cb2.size &&
+							cb1.srcCol == cb2.srcCol;
+					});
+		}
+
+		const void* constr;
+		int revision;
+		int srcLine, nrConstr, line;
+		double sign;
+		std::vector<ColBlock> blocks;
+	};
+
+private:
+	std::vector<ConstrRecord> constrs_;
+	/// number of valid records in constrs_
+	std::size_t nrRecords_;
+	std::size_t index_;
+	const VariableReduction* reduction_;
+};
+
+
+/**
+	* Compute the product of the line of a constraint matrix by
+	* the full variables vector.
+	*/
+inline double rowDot(const Eigen::MatrixXd& Ai,
+	const std::vector<ColBlock>& blocks, int line, const Eigen::VectorXd& x)
+{
+	double res = 0.;
+	forEachColBlock(blocks, int(x.size()), [&](int col, int srcCol, int size)
+	{
+		res += Ai.row(line).segment(srcCol, size).dot(x.segment(col, size));
+	});
+	return res;
 }
 
+
 // general qp form
 
 
@@ -122,7 +783,8 @@ inline void reduceQC(const Eigen::MatrixXd & QFull, const Eigen::VectorXd & CFul
 	* based on the equality constaint list.
 	*/
 inline int fillEq(const std::vector<Equality*>& eq, int nrVars,
-	int nrALines, Eigen::MatrixXd& A, Eigen::VectorXd& AL, Eigen::VectorXd& AU)
+	int nrALines, AFillCache& cache, Eigen::MatrixXd& A, Eigen::VectorXd& AL,
+	Eigen::VectorXd& AU)
 {
 	for(std::size_t i = 0; i < eq.size(); ++i)
 	{
@@ -130,10 +792,11 @@ inline int fillEq(const std::vector<Equality*>& eq, int nrVars,
 		// than the number of constraint
 		int nrConstr = eq[i]->nrEq();
 		const Eigen::MatrixXd& Ai = eq[i]->AEq();
+		const std::vector<ColBlock>& blocks = eq[i]->AEqBlocks();
 		const Eigen::VectorXd& bi = eq[i]->bEq();
 
-		A.block(nrALines, 0, nrConstr, nrVars) =
-			Ai.block(0, 0, nrConstr, nrVars);
+		cache.fill(eq[i], eq[i]->AEqRevision(), Ai, blocks, nrConstr, nrVars,
+			nrALines, 1., A);
 		AL.segment(nrALines, nrConstr) = bi.head(nrConstr);
 		AU.segment(nrALines, nrConstr) = bi.head(nrConstr);
 
@@ -149,7 +812,8 @@ inline int fillEq(const std::vector<Equality*>& eq, int nrVars,
 	* based on the inequality constaint list.
 	*/
 inline int fillInEq(const std::vector<Inequality*>& inEq, int nrVars,
-	int nrALines, Eigen::MatrixXd& A, Eigen::VectorXd& AL, Eigen::VectorXd& AU)
+	int nrALines, AFillCache& cache, Eigen::MatrixXd& A, Eigen::VectorXd& AL,
+	Eigen::VectorXd& AU)
 {
 	for(std::size_t i = 0; i < inEq.size(); ++i)
 	{
@@ -157,10 +821,11 @@ inline int fillInEq(const std::vector<Inequality*>& inEq, int nrVars,
 		// than the number of constraint
 		int nrConstr = inEq[i]->nrInEq();
 		const Eigen::MatrixXd& Ai = inEq[i]->AInEq();
+		const std::vector<ColBlock>& blocks = inEq[i]->AInEqBlocks();
 		const Eigen::VectorXd& bi = inEq[i]->bInEq();
 
-		A.block(nrALines, 0, nrConstr, nrVars) =
-			Ai.block(0, 0, nrConstr, nrVars);
+		cache.fill(inEq[i], inEq[i]->AInEqRevision(), Ai, blocks, nrConstr, nrVars,
+			nrALines, 1., A);
 		AL.segment(nrALines, nrConstr).fill(-std::numeric_limits<double>::infinity());
 		AU.segment(nrALines, nrConstr) = bi.head(nrConstr);
 
@@ -176,7 +841,8 @@ inline int fillInEq(const std::vector<Inequality*>& inEq, int nrVars,
 	* based on the general inequality constaint list.
 	*/
 inline int fillGenInEq(const std::vector<GenInequality*>& genInEq, int nrVars,
-	int nrALines, Eigen::MatrixXd& A, Eigen::VectorXd& AL, Eigen::VectorXd& AU)
+	int nrALines, AFillCache& cache, Eigen::MatrixXd& A, Eigen::VectorXd& AL,
+	Eigen::VectorXd& AU)
 {
 	for(std::size_t i = 0; i < genInEq.size(); ++i)
 	{
@@ -184,11 +850,12 @@ inline int fillGenInEq(const std::vector<GenInequality*>& genInEq, int nrVars,
 		// than the number of constraint
 		int nrConstr = genInEq[i]->nrGenInEq();
 		const Eigen::MatrixXd& Ai = genInEq[i]->AGenInEq();
+		const std::vector<ColBlock>& blocks = genInEq[i]->AGenInEqBlocks();
 		const Eigen::VectorXd& ALi = genInEq[i]->LowerGenInEq();
 		const Eigen::VectorXd& AUi = genInEq[i]->UpperGenInEq();
 
-		A.block(nrALines, 0, nrConstr, nrVars) =
-			Ai.block(0, 0, nrConstr, nrVars);
+		cache.fill(genInEq[i], genInEq[i]->AGenInEqRevision(), Ai, blocks, nrConstr,
+			nrVars, nrALines, 1., A);
 		AL.segment(nrALines, nrConstr) = ALi.head(nrConstr);
 		AU.segment(nrALines, nrConstr) = AUi.head(nrConstr);
 
@@ -207,7 +874,7 @@ inline int fillGenInEq(const std::vector<GenInequality*>& genInEq, int nrVars,
 	* based on the equality constaint list.
 	*/
 inline int fillEq(const std::vector<Equality*>& eq, int nrVars,
-	int nrALines, Eigen::MatrixXd& A, Eigen::VectorXd& b)
+	int nrALines, AFillCache& cache, Eigen::MatrixXd& A, Eigen::VectorXd& b)
 {
 	for(std::size_t i = 0; i < eq.size(); ++i)
 	{
@@ -215,10 +882,11 @@ inline int fillEq(const std::vector<Equality*>& eq, int nrVars,
 		// than the number of constraint
 		int nrConstr = eq[i]->nrEq();
 		const Eigen::MatrixXd& Ai = eq[i]->AEq();
+		const std::vector<ColBlock>& blocks = eq[i]->AEqBlocks();
 		const Eigen::VectorXd& bi = eq[i]->bEq();
 
-		A.block(nrALines, 0, nrConstr, nrVars) =
-			Ai.block(0, 0, nrConstr, nrVars);
+		cache.fill(eq[i], eq[i]->AEqRevision(), Ai, blocks, nrConstr, nrVars,
+			nrALines, 1., A);
 		b.segment(nrALines, nrConstr) = bi.head(nrConstr);
 
 		nrALines += nrConstr;
@@ -233,7 +901,7 @@ inline int fillEq(const std::vector<Equality*>& eq, int nrVars,
 	* based on the inequality constaint list.
 	*/
 inline int fillInEq(const std::vector<Inequality*>& inEq, int nrVars,
-	int nrALines, Eigen::MatrixXd& A, Eigen::VectorXd& b)
+	int nrALines, AFillCache& cache, Eigen::MatrixXd& A, Eigen::VectorXd& b)
 {
 	for(std::size_t i = 0; i < inEq.size(); ++i)
 	{
@@ -241,10 +909,11 @@ inline int fillInEq(const std::vector<Inequality*>& inEq, int nrVars,
 		// than the number of constraint
 		int nrConstr = inEq[i]->nrInEq();
 		const Eigen::MatrixXd& Ai = inEq[i]->AInEq();
+		const std::vector<ColBlock>& blocks = inEq[i]->AInEqBlocks();
 		const Eigen::VectorXd& bi = inEq[i]->bInEq();
 
-		A.block(nrALines, 0, nrConstr, nrVars) =
-			Ai.block(0, 0, nrConstr, nrVars);
+		cache.fill(inEq[i], inEq[i]->AInEqRevision(), Ai, blocks, nrConstr, nrVars,
+			nrALines, 1., A);
 		b.segment(nrALines, nrConstr) = bi.head(nrConstr);
 
 		nrALines += nrConstr;
@@ -254,36 +923,290 @@ inline int fillInEq(const std::vector<Inequality*>& inEq, int nrVars,
 }
 
 
+/// Kind of the lines of a general inequality constraint (see genInEqKind).
+enum class GenInEqKind
+{
+	None, ///< both bounds are infinite, even if they are equal
+	Equal, ///< lower == upper
+	Lower, ///< only the lower bound is finite
+	Upper, ///< only the upper bound is finite
+	Both ///< both bounds are finite
+};
+
+
+/// Classify a general inequality line by its bounds.
+inline GenInEqKind genInEqKind(double L, double U)
+{
+	const double inf = std::numeric_limits<double>::infinity();
+	// L == U == inf must not become an equality line
+	if(std::abs(L) == inf && std::abs(U) == inf)
+	{
+		return GenInEqKind::None;
+	}
+	if(L == U)
+	{
+		return GenInEqKind::Equal;
+	}
+	if(L == -inf)
+	{
+		return GenInEqKind::Upper;
+	}
+	return U == inf ? GenInEqKind::Lower : GenInEqKind::Both;
+}
+
+
 /**
-	* Fill the \f$ A \f$ matrix and the \f$ b \f$ vectors
+	* Fill the \f$ A_{eq} \f$ and \f$ A_{ineq} \f$ matrices and
+	* the \f$ b_{eq} \f$ and \f$ b_{ineq} \f$ vectors
 	* based on the general inequality constaint list.
+	* Lines with equal bounds are added to the equality lines, lines with one
+	* infinite bound give one inequality line and lines with two infinite
+	* bounds are dropped.
+	* Consecutive lines of the same kind are copied together.
+	* Aeq must have nrGenInEq more lines and Aineq 2*nrGenInEq more lines.
 	*/
-inline int fillGenInEq(const std::vector<GenInequality*>& genInEq, int nrVars,
-	int nrALines, Eigen::MatrixXd& A, Eigen::VectorXd& b)
+inline void fillGenInEq(const std::vector<GenInequality*>& genInEq, int nrVars,
+	int& nrAeqLines, AFillCache& eqCache, Eigen::MatrixXd& Aeq,
+	Eigen::VectorXd& beq,
+	int& nrAineqLines, AFillCache& ineqCache, Eigen::MatrixXd& Aineq,
+	Eigen::VectorXd& bineq)
 {
 	for(std::size_t i = 0; i < genInEq.size(); ++i)
 	{
 		// ineq constraint can return a matrix with more line
 		// than the number of constraint
 		int nrConstr = genInEq[i]->nrGenInEq();
+		int revision = genInEq[i]->AGenInEqRevision();
 		const Eigen::MatrixXd& Ai = genInEq[i]->AGenInEq();
+		const std::vector<ColBlock>& blocks = genInEq[i]->AGenInEqBlocks();
 		const Eigen::VectorXd& ALi = genInEq[i]->LowerGenInEq();
 		const Eigen::VectorXd& AUi = genInEq[i]->UpperGenInEq();
 
-		A.block(nrALines, 0, nrConstr, nrVars) =
-			-Ai.block(0, 0, nrConstr, nrVars);
-		b.segment(nrALines, nrConstr) = -ALi.head(nrConstr);
+		int begin = 0;
+		while(begin < nrConstr)
+		{
+			GenInEqKind kind = genInEqKind(ALi(begin), AUi(begin));
+			int end = begin + 1;
+			while(end < nrConstr && genInEqKind(ALi(end), AUi(end)) == kind)
+			{
+				++end;
+			}
+			int size = end - begin;
 
-		nrALines += nrConstr;
+			if(kind == GenInEqKind::Equal)
+			{
+				eqCache.fill(genInEq[i], revision, Ai, blocks, begin, size, nrVars,
+					nrAeqLines, 1., Aeq);
+				beq.segment(nrAeqLines, size) = AUi.segment(begin, size);
+				nrAeqLines += size;
+			}
+			if(kind == GenInEqKind::Lower || kind == GenInEqKind::Both)
+			{
+				ineqCache.fill(genInEq[i], revision, Ai, blocks, begin, size, nrVars,
+					nrAineqLines, -1., Aineq);
+				bineq.segment(nrAineqLines, size) = -ALi.segment(begin, size);
+				nrAineqLines += size;
+			}
+			if(kind == GenInEqKind::Upper || kind == GenInEqKind::Both)
+			{
+				ineqCache.fill(genInEq[i], revision, Ai, blocks, begin, size, nrVars,
+					nrAineqLines, 1., Aineq);
+				bineq.segment(nrAineqLines, size) = AUi.segment(begin, size);
+				nrAineqLines += size;
+			}
 
-		A.block(nrALines, 0, nrConstr, nrVars) =
-			Ai.block(0, 0, nrConstr, nrVars);
-		b.segment(nrALines, nrConstr) = AUi.head(nrConstr);
+			begin = end;
+		}
+	}
+}
 
-		nrALines += nrConstr;
+
+/**
+	* Where the inequality lines have gone in the presolve (see presolveLines).
+	* Active sets are kept in the line order before the presolve,
+	* the Aineq lines then the lower bounds then the upper bounds,
+	* so they stay valid when the presolve removes a different number of lines.
+	*/
+class PresolveMap
+{
+public:
+	/// Line removed by the presolve.
+	static const int removed = -1;
+
+	PresolveMap():
+		nrLines_(0),
+		nrPLines_(0),
+		nrVars_(0),
+		index_(),
+		origin_()
+	{}
+
+	/// Reserve the map of maxLines lines, must be called before presolveLines.
+	void resize(int maxLines)
+	{
+		index_.resize(maxLines);
+		origin_.resize(maxLines);
 	}
 
-	return nrALines;
+	/// Start the map of nrLines lines on nrVars variables.
+	void start(int nrLines, int nrVars)
+	{
+		nrLines_ = nrLines;
+		nrPLines_ = 0;
+		nrVars_ = nrVars;
+	}
+
+	/// The line i is the next presolved line.
+	void keep(int i)
+	{
+		index_[i] = nrPLines_;
+		origin_[nrPLines_++] = i;
+	}
+
+	/// The line i is removed.
+	void remove(int i)
+	{
+		index_[i] = removed;
+	}
+
+	/// The line i is now the lower (upper is false) or upper bound of col.
+	void moveToBound(int i, int col, bool upper)
+	{
+		index_[i] = -2 - (upper ? nrVars_ + col : col);
+	}
+
+	/// Convert activeSet from the lines before the presolve to the presolved lines.
+	void toPresolved(std::vector<int>& activeSet) const
+	{
+		std::size_t nrActive = 0;
+		for(int a: activeSet)
+		{
+			int pa = -1;
+			if(a < nrLines_)
+			{
+				int idx = index_[a];
+				pa = idx >= 0 ? idx : idx == removed ? -1 : nrPLines_ - 2 - idx;
+			}
+			else
+			{
+				pa = a - nrLines_ + nrPLines_;
+			}
+			if(pa >= 0 && std::find(activeSet.begin(), activeSet.begin() + nrActive, pa) ==
+				 activeSet.begin() + nrActive)
+			{
+				activeSet[nrActive++] = pa;
+			}
+		}
+		activeSet.resize(nrActive);
+	}
+
+	/// Convert activeSet from the presolved lines to the lines before the presolve.
+	void fromPresolved(std::vector<int>& activeSet) const
+	{
+		for(int& a: activeSet)
+		{
+			a = a < nrPLines_ ? origin_[a] : a - nrPLines_ + nrLines_;
+		}
+	}
+
+private:
+	int nrLines_, nrPLines_, nrVars_;
+	/// presolved line of each line, removed or -2 - bound line
+	std::vector<int> index_;
+	/// line of each presolved line
+	std::vector<int> origin_;
+};
+
+
+/**
+	* Presolve the nrLines first lines of A x = b (equality is true)
+	* or A x <= b and copy the remaining lines in AP and bP.
+	* The empty lines and the lines with an infinite b are removed and the lines
+	* with only one non zero are moved to XL and XU.
+	* Lines that make the problem infeasible are kept to let the solver report it.
+	* @param map If not null, record where each line has gone (see PresolveMap).
+	* @return Number of lines in AP.
+	*/
+inline int presolveLines(const Eigen::MatrixXd& A, const Eigen::VectorXd& b,
+	int nrLines, bool equality, Eigen::MatrixXd& AP, Eigen::VectorXd& bP,
+	Eigen::VectorXd& XL, Eigen::VectorXd& XU, PresolveStats& stats,
+	PresolveMap* map=nullptr)
+{
+	const double inf = std::numeric_limits<double>::infinity();
+	const int nrVars = int(A.cols());
+	int nrPLines = 0;
+	stats.nrLines += nrLines;
+	if(map)
+	{
+		map->start(nrLines, nrVars);
+	}
+	for(int i = 0; i < nrLines; ++i)
+	{
+		int nrNonZero = 0;
+		int col = -1;
+		for(int j = 0; j < nrVars && nrNonZero < 2; ++j)
+		{
+			if(A(i, j) != 0.)
+			{
+				++nrNonZero;
+				col = j;
+			}
+		}
+
+		if(nrNonZero == 0 && (equality ? b(i) == 0. : b(i) >= 0.))
+		{
+			++stats.nrEmptyLines;
+			if(map)
+			{
+				map->remove(i);
+			}
+			continue;
+		}
+		if(!equality && b(i) == inf)
+		{
+			++stats.nrUnboundedLines;
+			if(map)
+			{
+				map->remove(i);
+			}
+			continue;
+		}
+		if(nrNonZero == 1 && std::isfinite(b(i)))
+		{
+			double val = b(i)/A(i, col);
+			double lower = XL(col);
+			double upper = XU(col);
+			if(equality || A(i, col) > 0.)
+			{
+				upper = std::min(upper, val);
+			}
+			if(equality || A(i, col) < 0.)
+			{
+				lower = std::max(lower, val);
+			}
+			if(lower <= upper)
+			{
+				XL(col) = lower;
+				XU(col) = upper;
+				++stats.nrBoundLines;
+				if(map)
+				{
+					map->moveToBound(i, col, equality || A(i, col) > 0.);
+				}
+				continue;
+			}
+		}
+
+		AP.row(nrPLines) = A.row(i);
+		bP(nrPLines) = b(i);
+		++nrPLines;
+		if(map)
+		{
+			map->keep(i);
+		}
+	}
+
+	return nrPLines;
 }
 
 
@@ -305,29 +1228,6 @@ inline void fillBound(const std::vector<Bound*>& bounds,
 	}
 }
 
-/**
-	* Reduce \f$ A \f$ matrix based on the dependencies list
-	*/
-inline void reduceA(const Eigen::MatrixXd & AFull,
-										Eigen::MatrixXd & A,
-										const std::vector<int> & fullToReduced,
-										const std::vector<int> & reducedToFull,
-										const std::vector<std::tuple<int, int, double>> & dependencies)
-{
-	for(size_t i = 0; i <reducedToFull.size(); ++i)
-	{
-		A.col(i) = AFull.col(reducedToFull[i]);
-	}
-	for(const auto & d : dependencies)
-	{
-		const int & primaryFullI = std::get<0>(d);
-		const int & primaryReducedI = fullToReduced[primaryFullI];
-		const int & replicaFullI = std::get<1>(d);
-		const double & alpha = std::get<2>(d);
-		A.col(primaryReducedI) += alpha*AFull.col(replicaFullI);
-	}
-}
-
 /**
 	* Reduce bounds vector based on the dependencies list
 	*/
@@ -388,6 +1288,321 @@ inline void expandResult(const Eigen::VectorXd & result,
 	}
 }
 
+/**
+	* Same as reduceBound with the reduction operator (see VariableReduction),
+	* XLFull and XUFull are the bounds of the full variables.
+	*/
+inline void reduceBound(const Eigen::VectorXd& XLFull,
+	const Eigen::VectorXd& XUFull, const VariableReduction& red,
+	Eigen::VectorXd& XL, Eigen::VectorXd& XU)
+{
+	for(const VariableReduction::Run& r: red.runs)
+	{
+		XL.segment(r.reduced, r.size) = XLFull.segment(r.full, r.size);
+		XU.segment(r.reduced, r.size) = XUFull.segment(r.full, r.size);
+	}
+	for(const VariableReduction::Replica& r: red.replicas)
+	{
+		if(r.factor != 0.)
+		{
+			// if the factor is negative, the upper/lower bounds should be inverted
+			double l = (r.factor < 0. ? XUFull(r.full) : XLFull(r.full))/r.factor;
+			double u = (r.factor < 0. ? XLFull(r.full) : XUFull(r.full))/r.factor;
+			XL(r.reduced) = std::max(XL(r.reduced), l);
+			XU(r.reduced) = std::min(XU(r.reduced), u);
+		}
+	}
+}
+
+
+/// Same as expandResult with the reduction operator (see VariableReduction).
+inline void expandResult(const Eigen::VectorXd& result,
+	const VariableReduction& red, Eigen::VectorXd& resultFull)
+{
+	for(const VariableReduction::Run& r: red.runs)
+	{
+		resultFull.segment(r.full, r.size) = result.segment(r.reduced, r.size);
+	}
+	for(const VariableReduction::Replica& r: red.replicas)
+	{
+		resultFull(r.full) = r.factor*result(r.reduced);
+	}
+}
+
+
+/**
+	* Dense problem assembled from the tasks and constraints,
+	* shared by the dense backends.
+	*
+	* The constraint lines are assembled in one of two forms:
+	* - Standard: \f$ A_{eq} x = b_{eq} \f$ and \f$ A_{ineq} x \leq b_{ineq} \f$
+	*   (see fillGenInEq), this form can be presolved (see presolveLines).
+	* - General: \f$ L \leq A x \leq U \f$.
+	*
+	* When the variables have dependencies the problem is directly assembled in
+	* the reduced variables (see VariableReduction) and expand give back
+	* the full variables.
+	* Q is symmetric, C is the linear term and XL, XU are the variable bounds.
+	*/
+class DenseQP
+{
+public:
+	/// Layout of the constraint lines.
+	enum class Form
+	{
+		Standard,
+		General
+	};
+
+	explicit DenseQP(Form form):
+		form_(form),
+		reduction_(nullptr),
+		Q_(), C_(), QCache_(),
+		Aeq_(), Aineq_(), beq_(), bineq_(), AeqCache_(), AineqCache_(),
+		AeqPre_(), AineqPre_(), beqPre_(), bineqPre_(), AineqMap_(),
+		A_(), AL_(), AU_(), ACache_(),
+		XLFull_(), XUFull_(), XL_(), XU_(), XFull_(),
+		nrAeqLines_(0), nrAineqLines_(0), nrALines_(0),
+		presolved_(false)
+	{}
+
+	/**
+		* Allocate the problem.
+		* @param reduction Reduction operator of the dependencies, must stay valid
+		* until the next updateSize.
+		*/
+	void updateSize(int nrVars, int nrEq, int nrInEq, int nrGenInEq,
+		const VariableReduction& reduction)
+	{
+		reduction_ = reduction.replicas.empty() ? nullptr : &reduction;
+		const int n = reduction_ ? reduction.nrReduced : nrVars;
+
+		XLFull_.resize(nrVars);
+		XUFull_.resize(nrVars);
+		XL_.resize(reduction_ ? n : 0);
+		XU_.resize(reduction_ ? n : 0);
+		XFull_.resize(reduction_ ? nrVars : 0);
+
+		Q_.resize(n, n);
+		C_.resize(n);
+		if(reduction_)
+		{
+			QCache_.reset(reduction);
+		}
+		else
+		{
+			QCache_.reset(nrVars);
+		}
+
+		if(form_ == Form::Standard)
+		{
+			// general inequality lines can become equality lines
+			// or one or two inequality lines
+			const int maxAeqLines = nrEq + nrGenInEq;
+			const int maxAineqLines = nrInEq + nrGenInEq*2;
+			Aeq_.setZero(maxAeqLines, n);
+			Aineq_.setZero(maxAineqLines, n);
+			beq_.resize(maxAeqLines);
+			bineq_.resize(maxAineqLines);
+			AineqMap_.resize(maxAineqLines);
+			resetCache(AeqCache_);
+			resetCache(AineqCache_);
+		}
+		else
+		{
+			const int maxALines = nrEq + nrInEq + nrGenInEq;
+			A_.setZero(maxALines, n);
+			AL_.resize(maxALines);
+			AU_.resize(maxALines);
+			resetCache(ACache_);
+		}
+		presolved_ = false;
+	}
+
+	/**
+		* Fill the problem. A and Q are only patched
+		* where the tasks and constraints have changed.
+		* @param presolve Presolve the standard form lines (see presolveLines).
+		* @param stats Statistics of the presolve.
+		*/
+	void updateMatrix(const std::vector<Task*>& tasks,
+		const std::vector<Equality*>& eqConstr,
+		const std::vector<Inequality*>& inEqConstr,
+		const std::vector<GenInequality*>& genInEqConstr,
+		const std::vector<Bound*>& boundConstr,
+		bool presolve, PresolveStats& stats)
+	{
+		const int nrVars = int(XLFull_.rows());
+
+		XLFull_.fill(-std::numeric_limits<double>::infinity());
+		XUFull_.fill(std::numeric_limits<double>::infinity());
+		C_.setZero();
+
+		if(form_ == Form::Standard)
+		{
+			beq_.setZero();
+			bineq_.setZero();
+
+			AeqCache_.start();
+			nrAeqLines_ = 0;
+			nrAeqLines_ = fillEq(eqConstr, nrVars, nrAeqLines_, AeqCache_, Aeq_, beq_);
+			AineqCache_.start();
+			nrAineqLines_ = 0;
+			nrAineqLines_ = fillInEq(inEqConstr, nrVars, nrAineqLines_, AineqCache_,
+				Aineq_, bineq_);
+			fillGenInEq(genInEqConstr, nrVars, nrAeqLines_, AeqCache_, Aeq_, beq_,
+				nrAineqLines_, AineqCache_, Aineq_, bineq_);
+		}
+		else
+		{
+			AL_.setZero();
+			AU_.setZero();
+
+			ACache_.start();
+			nrALines_ = 0;
+			nrALines_ = fillEq(eqConstr, nrVars, nrALines_, ACache_, A_, AL_, AU_);
+			nrALines_ = fillInEq(inEqConstr, nrVars, nrALines_, ACache_, A_, AL_, AU_);
+			nrALines_ = fillGenInEq(genInEqConstr, nrVars, nrALines_, ACache_, A_,
+				AL_, AU_);
+		}
+
+		fillBound(boundConstr, XLFull_, XUFull_);
+		fillQC(tasks, int(Q_.rows()), QCache_, Q_, C_);
+		if(reduction_)
+		{
+			reduceBound(XLFull_, XUFull_, *reduction_, XL_, XU_);
+		}
+
+		stats = PresolveStats();
+		presolved_ = presolve && form_ == Form::Standard;
+		if(presolved_)
+		{
+			// Aeq and Aineq are kept as filled for the next updateMatrix,
+			// the presolved lines are copied in AeqPre_ and AineqPre_
+			Eigen::VectorXd& XL = reduction_ ? XL_ : XLFull_;
+			Eigen::VectorXd& XU = reduction_ ? XU_ : XUFull_;
+			AeqPre_.resize(Aeq_.rows(), Aeq_.cols());
+			AineqPre_.resize(Aineq_.rows(), Aineq_.cols());
+			beqPre_.resize(beq_.rows());
+			bineqPre_.resize(bineq_.rows());
+			nrAeqLines_ = presolveLines(Aeq_, beq_, nrAeqLines_, true, AeqPre_, beqPre_,
+				XL, XU, stats);
+			nrAineqLines_ = presolveLines(Aineq_, bineq_, nrAineqLines_, false,
+				AineqPre_, bineqPre_, XL, XU, stats, &AineqMap_);
+		}
+
+		// only the upper part of Q is filled
+		Q_.triangularView<Eigen::StrictlyLower>() = Q_.transpose();
+	}
+
+	/**
+		* Compute the full variables of the result x of the problem.
+		* @return x if the variables are not reduced.
+		*/
+	const Eigen::VectorXd& expand(const Eigen::VectorXd& x)
+	{
+		if(!reduction_)
+		{
+			return x;
+		}
+		expandResult(x, *reduction_, XFull_);
+		return XFull_;
+	}
+
+	/// @return true if the problem is assembled in the reduced variables.
+	bool reduced() const
+	{
+		return reduction_ != nullptr;
+	}
+
+	/// @return Number of variables of the problem.
+	int nrVars() const
+	{
+		return int(Q_.rows());
+	}
+
+	/// @return true if Q has not changed since the previous updateMatrix.
+	bool constantQ() const
+	{
+		return QCache_.constant();
+	}
+
+	const Eigen::MatrixXd& Q() const { return Q_; }
+	const Eigen::VectorXd& C() const { return C_; }
+	const Eigen::VectorXd& XL() const { return reduction_ ? XL_ : XLFull_; }
+	const Eigen::VectorXd& XU() const { return reduction_ ? XU_ : XUFull_; }
+	/// @return Full variables of the last expand.
+	const Eigen::VectorXd& XFull() const { return XFull_; }
+
+	/// @return Maximum number of lines of Aeq.
+	int maxAeqLines() const { return int(Aeq_.rows()); }
+	/// @return Maximum number of lines of Aineq.
+	int maxAineqLines() const { return int(Aineq_.rows()); }
+	/// @return Aeq (presolved if presolved()), only nrAeqLines() are used.
+	const Eigen::MatrixXd& Aeq() const { return presolved_ ? AeqPre_ : Aeq_; }
+	const Eigen::VectorXd& beq() const { return presolved_ ? beqPre_ : beq_; }
+	/// @return Aineq (presolved if presolved()), only nrAineqLines() are used.
+	const Eigen::MatrixXd& Aineq() const { return presolved_ ? AineqPre_ : Aineq_; }
+	const Eigen::VectorXd& bineq() const { return presolved_ ? bineqPre_ : bineq_; }
+	int nrAeqLines() const { return nrAeqLines_; }
+	int nrAineqLines() const { return nrAineqLines_; }
+	/// @return true if the last updateMatrix has presolved the lines.
+	bool presolved() const { return presolved_; }
+	/// @return Where the Aineq lines have gone in the last presolve.
+	const PresolveMap& AineqMap() const { return AineqMap_; }
+
+	/// @return Maximum number of lines of A.
+	int maxALines() const { return int(A_.rows()); }
+	/// @return A, only nrALines() are used.
+	const Eigen::MatrixXd& A() const { return A_; }
+	const Eigen::VectorXd& AL() const { return AL_; }
+	const Eigen::VectorXd& AU() const { return AU_; }
+	int nrALines() const { return nrALines_; }
+
+private:
+	void resetCache(AFillCache& cache)
+	{
+		if(reduction_)
+		{
+			cache.reset(*reduction_);
+		}
+		else
+		{
+			cache.reset();
+		}
+	}
+
+private:
+	Form form_;
+	const VariableReduction* reduction_;
+
+	Eigen::MatrixXd Q_;
+	Eigen::VectorXd C_;
+	QFillCache QCache_;
+
+	// standard form
+	Eigen::MatrixXd Aeq_, Aineq_;
+	Eigen::VectorXd beq_, bineq_;
+	AFillCache AeqCache_, AineqCache_;
+	// presolved lines (see GenQPSolver::presolve)
+	Eigen::MatrixXd AeqPre_, AineqPre_;
+	Eigen::VectorXd beqPre_, bineqPre_;
+	PresolveMap AineqMap_;
+
+	// general form
+	Eigen::MatrixXd A_;
+	Eigen::VectorXd AL_, AU_;
+	AFillCache ACache_;
+
+	Eigen::VectorXd XLFull_, XUFull_;
+	Eigen::VectorXd XL_, XU_;
+	Eigen::VectorXd XFull_;
+
+	int nrAeqLines_, nrAineqLines_, nrALines_;
+	bool presolved_;
+};
+
+
 // print of a constraint at a given line
 template<typename T>
 std::ostream& printConstr(const Eigen::VectorXd& result, T* constr, int line,
@@ -397,7 +1612,7 @@ template<>
 inline std::ostream& printConstr(const Eigen::VectorXd& result, Equality* constr,
 	int line, std::ostream& out)
 {
-	out << constr->AEq().row(line)*result <<" = " <<
+	out << rowDot(constr->AEq(), constr->AEqBlocks(), line, result) <<" = " <<
 				 constr->bEq()(line);
 	return out;
 }
@@ -406,7 +1621,7 @@ template<>
 inline std::ostream& printConstr(const Eigen::VectorXd& result, Inequality* constr,
 	int line, std::ostream& out)
 {
-	out << constr->AInEq().row(line)*result <<" <= " <<
+	out << rowDot(constr->AInEq(), constr->AInEqBlocks(), line, result) <<" <= " <<
 				 constr->bInEq()(line);
 	return out;
 }
@@ -416,7 +1631,7 @@ inline std::ostream& printConstr(const Eigen::VectorXd& result, GenInequality* c
 	int line, std::ostream& out)
 {
 	out << constr->LowerGenInEq()(line) << " <= " <<
-				 constr->AGenInEq().row(line)*result <<" <= " <<
+				 rowDot(constr->AGenInEq(), constr->AGenInEqBlocks(), line, result) <<" <= " <<
 				 constr->UpperGenInEq()(line);
 	return out;
 }
@@ -0,0 +1,627 @@
+// Copyright 2012-2016 CNRS-UM LIRMM, CNRS-AIST JRL
+//
+// This file is part of Tasks.
+//
+// Tasks is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Tasks is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with Tasks.  If not, see <http://www.gnu.org/licenses/>.
+
+#pragma once
+
+// includes
+// std
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <limits>
+
+// Eigen
+#include <Eigen/Core>
+#include <Eigen/Cholesky>
+
+
+namespace tasks
+{
+
+namespace qp
+{
+
+
+/**
+	* Dense dual active set QP solver (Goldfarb and Idnani, 1983).
+	* Solve the following problem:
+	* \f{align}
+	* \underset{x}{\text{minimize }} & \frac{1}{2} x^T Q x + x^T c\\
+	* \text{s.t. } & A_{eq} x = b_{eq} \\
+	* & A_{ineq} x \leq b_{ineq} \\
+	* & XL \leq x \leq XU
+	* \f}
+	* Q must be positive definite.
+	*
+	* The solver start from the unconstrained minimum and add the most violated
+	* constraint at each iteration while keeping the dual feasibility.
+	* The working set is kept in the factorization \f$ J = L^{-T} Q_w \f$,
+	* \f$ R \f$ where \f$ Q = L L^T \f$ and \f$ Q_w R \f$ is the QR factorization
+	* of \f$ L^{-1} N \f$, N being the active constraints normals.
+	* The Cholesky factor of Q and \f$ L^{-T} \f$ can be kept from
+	* the previous solve when Q has not changed.
+	* All the workspace is allocated by problem.
+	*/
+class GoldfarbIdnani
+{
+public:
+	enum Status
+	{
+		Success = 0,
+		/// the iteration limit has been reached
+		MaxIter = 1,
+		/// the constraints are inconsistent
+		Infeasible = 2,
+		/// the equality constraints are linearly dependent
+		DependentEq = 3,
+		/// Q is not positive definite
+		NotPositive = 4,
+		/// the deadline has been reached
+		Timeout = 5
+	};
+
+public:
+	GoldfarbIdnani():
+		nrVars_(0),
+		maxIter_(std::numeric_limits<int>::max()),
+		deadline_(std::chrono::steady_clock::time_point::max()),
+		llt_(), J0_(), J_(), R_(),
+		x_(), u_(), mult_(), s_(), z_(), r_(), d_(), np_(),
+		xOld_(), uOld_(),
+		A_(), AOld_(), iai_(), iaexcl_(),
+		condEst_(0.), RNorm_(1.),
+		iq_(0), nrIter_(0), nrFacto_(0), status_(Success),
+		factorized_(false)
+	{}
+
+	/**
+		* Allocate the workspace.
+		* @param nrVars Number of variables.
+		* @param nrEq Maximum number of equality lines.
+		* @param nrIneq Maximum number of inequality lines.
+		*/
+	void problem(int nrVars, int nrEq, int nrIneq)
+	{
+		nrVars_ = nrVars;
+		const int nrConstr = nrIneq + 2*nrVars;
+		const int nrW = nrEq + nrConstr;
+
+		llt_ = Eigen::LLT<Eigen::MatrixXd>(nrVars);
+		J0_.setZero(nrVars, nrVars);
+		J_.setZero(nrVars, nrVars);
+		R_.setZero(nrVars, nrVars);
+		x_.setZero(nrVars);
+		u_.setZero(nrW + 1);
+		mult_.setZero(nrW);
+		s_.setZero(nrConstr);
+		z_.setZero(nrVars);
+		r_.setZero(nrW + 1);
+		d_.setZero(nrVars);
+		np_.setZero(nrVars);
+		xOld_.setZero(nrVars);
+		uOld_.setZero(nrW + 1);
+		A_.setZero(nrW + 1);
+		AOld_.setZero(nrW + 1);
+		iai_.setZero(nrConstr);
+		iaexcl_.setZero(nrConstr);
+		nrFacto_ = 0;
+		factorized_ = false;
+	}
+
+	/**
+		* Set the maximum number of iterations (added or dropped constraints),
+		* a negative value restores the default unlimited number.
+		*/
+	void maxIter(int maxIter)
+	{
+		maxIter_ = maxIter < 0 ? std::numeric_limits<int>::max() : maxIter;
+	}
+
+	int maxIter() const
+	{
+		return maxIter_;
+	}
+
+	/// Set the time after which the solve stop at the next iteration.
+	void deadline(const std::chrono::steady_clock::time_point& d)
+	{
+		deadline_ = d;
+	}
+
+	/**
+		* Solve the problem.
+		* Only the nrEq first lines of Aeq and the nrIneq first lines
+		* of Aineq are used.
+		* @param sameQ If true the factorization of the previous solve is reused,
+		* Q is then unused.
+		* @return true if the problem has been solved.
+		*/
+	template<typename MatEq, typename VecEq, typename MatIneq, typename VecIneq>
+	bool solve(const Eigen::MatrixXd& Q, const Eigen::VectorXd& C,
+		const MatEq& Aeq, const VecEq& beq,
+		const MatIneq& Aineq, const VecIneq& bineq,
+		const Eigen::VectorXd& XL, const Eigen::VectorXd& XU, bool sameQ = false)
+	{
+		const double inf = std::numeric_limits<double>::infinity();
+		const double eps = std::numeric_limits<double>::epsilon();
+		const int n = nrVars_;
+		const int me = int(Aeq.rows());
+		const int mi = int(Aineq.rows());
+		// inequality k is n_k^T x >= b_k with the Aineq lines first
+		// then the lower and upper bounds
+		const int m = mi + 2*n;
+
+		nrIter_ = 0;
+		iq_ = 0;
+		RNorm_ = 1.;
+
+		if(!sameQ || !factorized_)
+		{
+			llt_.compute(Q);
+			++nrFacto_;
+			if(llt_.info() != Eigen::Success)
+			{
+				factorized_ = false;
+				status_ = NotPositive;
+				return false;
+			}
+			// J0 = L^{-T}
+			J0_.setIdentity();
+			llt_.matrixU().solveInPlace(J0_);
+			condEst_ = Q.trace()*J0_.trace();
+			factorized_ = true;
+		}
+		J_ = J0_;
+
+		// unconstrained minimum
+		x_ = C;
+		llt_.solveInPlace(x_);
+		x_ = -x_;
+
+		// equality constraints
+		for(int i = 0; i < me; ++i)
+		{
+			np_ = Aeq.row(i).transpose();
+			computeStep(np_);
+			double t2 = 0.;
+			double zn = z_.dot(np_);
+			if(z_.dot(z_) > eps)
+			{
+				t2 = (beq(i) - np_.dot(x_))/zn;
+			}
+			x_ += t2*z_;
+			u_(iq_) = t2;
+			u_.head(iq_) -= t2*r_.head(iq_);
+			A_(iq_) = -i - 1;
+			if(!addConstraint())
+			{
+				status_ = DependentEq;
+				return false;
+			}
+		}
+
+		for(int i = 0; i < m; ++i)
+		{
+			iai_(i) = i;
+		}
+
+		while(true)
+		{
+			// step 1: choose a violated constraint
+			for(int i = me; i < iq_; ++i)
+			{
+				iai_(A_(i)) = -1;
+			}
+
+			double psi = 0.;
+			slacks(Aineq, bineq, XL, XU);
+			for(int i = 0; i < m; ++i)
+			{
+				iaexcl_(i) = 1;
+				psi += std::min(0., s_(i));
+			}
+			if(std::abs(psi) <= m*eps*condEst_*100.)
+			{
+				return finish(me, mi, Success);
+			}
+
+			uOld_.head(iq_) = u_.head(iq_);
+			AOld_.head(iq_) = A_.head(iq_);
+			xOld_ = x_;
+
+			bool stepTwo = true;
+			while(stepTwo)
+			{
+				stepTwo = false;
+
+				// step 2: determine the most violated constraint
+				int ip = -1;
+				double ss = 0.;
+				for(int i = 0; i < m; ++i)
+				{
+					if(s_(i) < ss && iai_(i) != -1 && iaexcl_(i))
+					{
+						ss = s_(i);
+						ip = i;
+					}
+				}
+				if(ip == -1)
+				{
+					return finish(me, mi, Success);
+				}
+
+				normal(Aineq, ip);
+				u_(iq_) = 0.;
+				A_(iq_) = ip;
+
+				while(true)
+				{
+					if(++nrIter_ > maxIter_)
+					{
+						return finish(me, mi, MaxIter);
+					}
+					if(std::chrono::steady_clock::now() >= deadline_)
+					{
+						return finish(me, mi, Timeout);
+					}
+
+					// step 2a: step direction
+					computeStep(np_);
+
+					// step 2b: partial step length t1 (dual feasibility)
+					// and full step length t2 (primal feasibility)
+					int l = -1;
+					double t1 = inf;
+					for(int k = me; k < iq_; ++k)
+					{
+						if(r_(k) > 0. && u_(k)/r_(k) < t1)
+						{
+							t1 = u_(k)/r_(k);
+							l = A_(k);
+						}
+					}
+					double t2 = inf;
+					if(z_.dot(z_) > eps)
+					{
+						t2 = -s_(ip)/z_.dot(np_);
+					}
+					double t = std::min(t1, t2);
+
+					// step 2c: take the step
+					if(t >= inf)
+					{
+						return finish(me, mi, Infeasible);
+					}
+
+					if(t2 >= inf)
+					{
+						// step in dual space only
+						u_.head(iq_) -= t*r_.head(iq_);
+						u_(iq_) += t;
+						iai_(l) = l;
+						deleteConstraint(me, l);
+						continue;
+					}
+
+					x_ += t*z_;
+					u_.head(iq_) -= t*r_.head(iq_);
+					u_(iq_) += t;
+
+					if(t == t2)
+					{
+						// full step
+						if(!addConstraint())
+						{
+							// linearly dependent, exclude ip and restore the previous state
+							iaexcl_(ip) = 0;
+							deleteConstraint(me, ip);
+							for(int i = 0; i < m; ++i)
+							{
+								iai_(i) = i;
+							}
+							for(int i = me; i < iq_; ++i)
+							{
+								A_(i) = AOld_(i);
+								iai_(A_(i)) = -1;
+								u_(i) = uOld_(i);
+							}
+							x_ = xOld_;
+							stepTwo = true;
+						}
+						else
+						{
+							iai_(ip) = -1;
+						}
+						break;
+					}
+
+					// partial step, drop constraint l
+					iai_(l) = l;
+					deleteConstraint(me, l);
+					s_(ip) = slack(Aineq, bineq, XL, XU, ip);
+				}
+			}
+		}
+	}
+
+	/// @return Status of the last solve.
+	Status status() const
+	{
+		return status_;
+	}
+
+	/// @return Solution of the last solve.
+	const Eigen::VectorXd& result() const
+	{
+		return x_;
+	}
+
+	/**
+		* @return Lagrange multipliers of the last solve, ordered as
+		* the equality lines, the inequality lines, the lower bounds
+		* then the upper bounds.
+		*/
+	const Eigen::VectorXd& multipliers() const
+	{
+		return mult_;
+	}
+
+	/// @return Number of active inequality constraints (see activeConstraint).
+	int nrActive() const
+	{
+		return iq_;
+	}
+
+	/**
+		* @return Index of the i-th active constraint, equality lines are negative
+		* (-line - 1) and inequality ones follow the multipliers order
+		* without the equality lines.
+		*/
+	int activeConstraint(int i) const
+	{
+		return A_(i);
+	}
+
+	/// @return Number of added or dropped constraints in the last solve.
+	int iterations() const
+	{
+		return nrIter_;
+	}
+
+	/// @return Number of Cholesky factorizations of Q since the last problem call.
+	int nrFactorizations() const
+	{
+		return nrFacto_;
+	}
+
+private:
+	template<typename MatIneq>
+	void normal(const MatIneq& Aineq, int k)
+	{
+		const int mi = int(Aineq.rows());
+		if(k < mi)
+		{
+			np_ = -Aineq.row(k).transpose();
+		}
+		else if(k < mi + nrVars_)
+		{
+			np_.setZero();
+			np_(k - mi) = 1.;
+		}
+		else
+		{
+			np_.setZero();
+			np_(k - mi - nrVars_) = -1.;
+		}
+	}
+
+	template<typename MatIneq, typename VecIneq>
+	double slack(const MatIneq& Aineq, const VecIneq& bineq,
+		const Eigen::VectorXd& XL, const Eigen::VectorXd& XU, int k) const
+	{
+		const int mi = int(Aineq.rows());
+		if(k < mi)
+		{
+			return bineq(k) - Aineq.row(k).dot(x_);
+		}
+		else if(k < mi + nrVars_)
+		{
+			return x_(k - mi) - XL(k - mi);
+		}
+		return XU(k - mi - nrVars_) - x_(k - mi - nrVars_);
+	}
+
+	template<typename MatIneq, typename VecIneq>
+	void slacks(const MatIneq& Aineq, const VecIneq& bineq,
+		const Eigen::VectorXd& XL, const Eigen::VectorXd& XU)
+	{
+		const int mi = int(Aineq.rows());
+		s_.head(mi) = bineq;
+		s_.head(mi).noalias() -= Aineq*x_;
+		s_.segment(mi, nrVars_) = x_ - XL;
+		s_.segment(mi + nrVars_, nrVars_) = XU - x_;
+	}
+
+	/// d = J^T np, z = J_2 d_2 and r = R^{-1} d_1
+	void computeStep(const Eigen::VectorXd& np)
+	{
+		const int n = nrVars_;
+		d_.noalias() = J_.transpose()*np;
+		z_.noalias() = J_.rightCols(n - iq_)*d_.tail(n - iq_);
+		r_.head(iq_) = d_.head(iq_);
+		R_.topLeftCorner(iq_, iq_).triangularView<Eigen::Upper>().
+			solveInPlace(r_.head(iq_));
+	}
+
+	bool addConstraint()
+	{
+		const int n = nrVars_;
+		// Givens rotations to zero the d_ elements below iq_
+		for(int j = n - 1; j >= iq_ + 1; --j)
+		{
+			double cc = d_(j - 1);
+			double ss = d_(j);
+			double h = std::hypot(cc, ss);
+			if(h == 0.)
+			{
+				continue;
+			}
+			d_(j) = 0.;
+			ss /= h;
+			cc /= h;
+			if(cc < 0.)
+			{
+				cc = -cc;
+				ss = -ss;
+				d_(j - 1) = -h;
+			}
+			else
+			{
+				d_(j - 1) = h;
+			}
+			double xny = ss/(1. + cc);
+			for(int k = 0; k < n; ++k)
+			{
+				double t1 = J_(k, j - 1);
+				double t2 = J_(k, j);
+				J_(k, j - 1) = t1*cc + t2*ss;
+				J_(k, j) = xny*(t1 + J_(k, j - 1)) - t2;
+			}
+		}
+
+		++iq_;
+		R_.col(iq_ - 1).head(iq_) = d_.head(iq_);
+
+		if(std::abs(d_(iq_ - 1)) <= std::numeric_limits<double>::epsilon()*RNorm_)
+		{
+			return false;
+		}
+		RNorm_ = std::max(RNorm_, std::abs(d_(iq_ - 1)));
+		return true;
+	}
+
+	void deleteConstraint(int me, int l)
+	{
+		const int n = nrVars_;
+		int qq = -1;
+		for(int i = me; i < iq_; ++i)
+		{
+			if(A_(i) == l)
+			{
+				qq = i;
+				break;
+			}
+		}
+
+		for(int i = qq; i < iq_ - 1; ++i)
+		{
+			A_(i) = A_(i + 1);
+			u_(i) = u_(i + 1);
+			R_.col(i) = R_.col(i + 1);
+		}
+		A_(iq_ - 1) = A_(iq_);
+		u_(iq_ - 1) = u_(iq_);
+		A_(iq_) = 0;
+		u_(iq_) = 0.;
+		R_.col(iq_ - 1).head(iq_).setZero();
+		--iq_;
+
+		if(iq_ == 0)
+		{
+			return;
+		}
+
+		// Givens rotations to restore the triangular R
+		for(int j = qq; j < iq_; ++j)
+		{
+			double cc = R_(j, j);
+			double ss = R_(j + 1, j);
+			double h = std::hypot(cc, ss);
+			if(h == 0.)
+			{
+				continue;
+			}
+			cc /= h;
+			ss /= h;
+			R_(j + 1, j) = 0.;
+			if(cc < 0.)
+			{
+				R_(j, j) = -h;
+				cc = -cc;
+				ss = -ss;
+			}
+			else
+			{
+				R_(j, j) = h;
+			}
+			double xny = ss/(1. + cc);
+			for(int k = j + 1; k < iq_; ++k)
+			{
+				double t1 = R_(j, k);
+				double t2 = R_(j + 1, k);
+				R_(j, k) = t1*cc + t2*ss;
+				R_(j + 1, k) = xny*(t1 + R_(j, k)) - t2;
+			}
+			for(int k = 0; k < n; ++k)
+			{
+				double t1 = J_(k, j);
+				double t2 = J_(k, j + 1);
+				J_(k, j) = t1*cc + t2*ss;
+				J_(k, j + 1) = xny*(J_(k, j) + t1) - t2;
+			}
+		}
+	}
+
+	bool finish(int me, int mi, Status status)
+	{
+		status_ = status;
+		mult_.head(me + mi + 2*nrVars_).setZero();
+		for(int i = 0; i < iq_; ++i)
+		{
+			int k = A_(i);
+			if(k < 0)
+			{
+				mult_(-k - 1) = u_(i);
+			}
+			else
+			{
+				mult_(me + k) = u_(i);
+			}
+		}
+		return status == Success;
+	}
+
+private:
+	int nrVars_;
+	int maxIter_;
+	std::chrono::steady_clock::time_point deadline_;
+
+	Eigen::LLT<Eigen::MatrixXd> llt_;
+	Eigen::MatrixXd J0_, J_, R_;
+	Eigen::VectorXd x_, u_, mult_, s_, z_, r_, d_, np_;
+	Eigen::VectorXd xOld_, uOld_;
+	Eigen::VectorXi A_, AOld_, iai_, iaexcl_;
+	double condEst_, RNorm_;
+	int iq_, nrIter_, nrFacto_;
+	Status status_;
+	bool factorized_;
+};
+
+
+} // namespace qp
+
+} // namespace tasks
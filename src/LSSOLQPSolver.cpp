@@ -20,7 +20,6 @@
 
 // includes
 // Tasks
-#include "GenQPUtils.h"
 #include "Tasks/QPSolver.h"
 
 
@@ -33,51 +32,24 @@ namespace qp
 
 LSSOLQPSolver::LSSOLQPSolver():
 	lssol_(),
-	A_(),AL_(),AU_(),
-	AFull_(),
-	XL_(),XU_(),
-	XLFull_(),XUFull_(),
-	Q_(),C_(),
-	QFull_(),CFull_(),
-	XFull_(),
-	nrALines_(0)
+	dense_(DenseQP::Form::General)
 {
-	lssol_.warm(true);
+	warmStart(true);
 	lssol_.feasibilityTol(1e-6);
 }
 
 
-void LSSOLQPSolver::updateSize(int nrVars, int nrEq, int nrInEq, int nrGenInEq)
+void LSSOLQPSolver::warmStart(bool w)
 {
-	int maxALines = nrEq + nrInEq + nrGenInEq;
-	AFull_.resize(maxALines, nrVars);
-	AL_.resize(maxALines);
-	AU_.resize(maxALines);
-
-	XLFull_.resize(nrVars);
-	XUFull_.resize(nrVars);
-
-	QFull_.resize(nrVars, nrVars);
-	CFull_.resize(nrVars);
-
-	if(dependencies_.size())
-	{
-		int nrReducedVars = nrVars - static_cast<int>(dependencies_.size());
-
-		A_.resize(maxALines, nrReducedVars);
-		Q_.resize(nrReducedVars, nrReducedVars);
-		C_.resize(nrReducedVars);
+	GenQPSolver::warmStart(w);
+	lssol_.warm(w);
+}
 
-		XL_.resize(nrReducedVars);
-		XU_.resize(nrReducedVars);
-		XFull_.resize(nrVars);
 
-		lssol_.problem(nrReducedVars, maxALines);
-	}
-	else
-	{
-		lssol_.problem(nrVars, maxALines);
-	}
+void LSSOLQPSolver::updateSize(int nrVars, int nrEq, int nrInEq, int nrGenInEq)
+{
+	dense_.updateSize(nrVars, nrEq, nrInEq, nrGenInEq, reduction_);
+	lssol_.problem(dense_.nrVars(), dense_.maxALines());
 }
 
 
@@ -88,60 +60,33 @@ void LSSOLQPSolver::updateMatrix(
 	const std::vector<GenInequality*>& genInEqConstr,
 	const std::vector<Bound*>& boundConstr)
 {
-	AFull_.setZero();
-	AL_.setZero();
-	AU_.setZero();
-	XLFull_.fill(-std::numeric_limits<double>::infinity());
-	XUFull_.fill(std::numeric_limits<double>::infinity());
-	QFull_.setZero();
-	CFull_.setZero();
-
-	const int nrVars = int(QFull_.rows());
-
-	nrALines_ = 0;
-	nrALines_ = fillEq(eqConstr, nrVars, nrALines_, AFull_, AL_, AU_);
-	nrALines_ = fillInEq(inEqConstr, nrVars, nrALines_, AFull_, AL_, AU_);
-	nrALines_ = fillGenInEq(genInEqConstr, nrVars, nrALines_, AFull_, AL_, AU_);
-
-	fillBound(boundConstr, XLFull_, XUFull_);
-	fillQC(tasks, nrVars, QFull_, CFull_);
-
-	if(dependencies_.size())
-	{
-		reduceA(AFull_, A_, fullToReduced_, reducedToFull_, dependencies_);
-		reduceBound(XLFull_, XL_, XUFull_, XU_, fullToReduced_, reducedToFull_, dependencies_);
-		reduceQC(QFull_, CFull_, Q_, C_, fullToReduced_, reducedToFull_, dependencies_);
-	}
+	dense_.updateMatrix(tasks, eqConstr, inEqConstr, genInEqConstr, boundConstr,
+		false, presolveStats_);
 }
 
 
 bool LSSOLQPSolver::solve()
 {
-	bool success = false;
-	if(dependencies_.size())
-	{
-		success = lssol_.solve(Q_, C_,
-			A_.block(0, 0, nrALines_, int(A_.cols())), int(A_.rows()),
-			AL_.segment(0, nrALines_), AU_.segment(0, nrALines_), XL_, XU_);
-		expandResult(lssol_.result(), XFull_,
-									reducedToFull_,
-									dependencies_);
-	}
-	else
-	{
-		success = lssol_.solve(QFull_, CFull_,
-			AFull_.block(0, 0, nrALines_, int(AFull_.cols())), int(AFull_.rows()),
-			AL_.segment(0, nrALines_), AU_.segment(0, nrALines_), XLFull_, XUFull_);
-	}
+	const int nrALines = dense_.nrALines();
+	const Eigen::MatrixXd& A = dense_.A();
+
+	bool success = lssol_.solve(dense_.Q(), dense_.C(),
+		A.block(0, 0, nrALines, int(A.cols())), int(A.rows()),
+		dense_.AL().segment(0, nrALines), dense_.AU().segment(0, nrALines),
+		dense_.XL(), dense_.XU());
+	dense_.expand(lssol_.result());
+	// inform 4: iteration limit reached
+	status_ = success ? QPStatus::Success :
+		lssol_.fail() == 4 ? QPStatus::MaxIter : QPStatus::Failure;
 	return success;
 }
 
 
 const Eigen::VectorXd& LSSOLQPSolver::result() const
 {
-	if(dependencies_.size())
+	if(dense_.reduced())
 	{
-		return XFull_;
+		return dense_.XFull();
 	}
 	else
 	{
@@ -159,7 +104,7 @@ std::ostream& LSSOLQPSolver::errorMsg(
 	const std::vector<Bound*>& boundConstr,
 	std::ostream& out) const
 {
-	const int nrVars = int(Q_.rows());
+	const int nrVars = dense_.nrVars();
 
 	out << "lssol output (" << lssol_.fail() << "): ";
 	out << std::endl;
@@ -180,7 +125,8 @@ std::ostream& LSSOLQPSolver::errorMsg(
 					int line = i - start;
 					out << b->nameBound() << " violated at line: " << line << std::endl;
 					out << b->descBound(mbs, line) << std::endl;
-					out << XL_(i) << " <= " << lssol_.result()(i) << " <= " << XU_(i) << std::endl;
+					out << dense_.XL()(i) << " <= " << lssol_.result()(i) << " <= " <<
+						dense_.XU()(i) << std::endl;
 					break;
 				}
 			}
@@ -188,7 +134,7 @@ std::ostream& LSSOLQPSolver::errorMsg(
 	}
 
 	// check inequality constraint
-	for(int i = 0; i < nrALines_; ++i)
+	for(int i = 0; i < dense_.nrALines(); ++i)
 	{
 		int iInIstate = i + nrVars;
 		if(istate(iInIstate) < 0)
@@ -23,6 +23,7 @@
 
 // Tasks
 #include "Tasks/GenQPSolver.h"
+#include "GenQPUtils.h"
 
 
 namespace tasks
@@ -48,6 +49,14 @@ public:
 		const std::vector<Bound*>& boundConstr) override;
 	virtual bool solve() override;
 	virtual const Eigen::VectorXd& result() const override;
+	/// LSSOL warm start is enabled by default.
+	virtual void warmStart(bool w) override;
+	using GenQPSolver::warmStart;
+	/// LSSOL use global fortran data.
+	virtual bool reentrant() const override
+	{
+		return false;
+	}
 	virtual std::ostream& errorMsg(const std::vector<rbd::MultiBody>& mbs,
 		const std::vector<Task*>& tasks,
 		const std::vector<Equality*>& eqConstr,
@@ -58,27 +67,7 @@ public:
 
 private:
 	Eigen::LSSOL lssol_;
-
-	Eigen::MatrixXd A_;
-	Eigen::VectorXd AL_, AU_;
-
-	Eigen::MatrixXd AFull_;
-
-	Eigen::VectorXd XL_;
-	Eigen::VectorXd XU_;
-
-	Eigen::VectorXd XLFull_;
-	Eigen::VectorXd XUFull_;
-
-	Eigen::MatrixXd Q_;
-	Eigen::VectorXd C_;
-
-	Eigen::MatrixXd QFull_;
-	Eigen::VectorXd CFull_;
-
-	Eigen::VectorXd XFull_;
-
-	int nrALines_;
+	DenseQP dense_;
 };
 
 } // namespace qp
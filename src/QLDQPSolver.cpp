@@ -19,6 +19,11 @@
 #include "QLDQPSolver.h"
 
 // includes
+// std
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
 // Tasks
 #include "GenQPUtils.h"
 #include "Tasks/QPSolver.h"
@@ -33,57 +38,38 @@ namespace qp
 
 QLDQPSolver::QLDQPSolver():
 	qld_(),
-	Aeq_(),Aineq_(),
-	beq_(), bineq_(),
-	AeqFull_(),AineqFull_(),
-	XL_(),XU_(),
-	XLFull_(),XUFull_(),
-	Q_(),C_(),
-	QFull_(),CFull_(),
-	nrAeqLines_(0), nrAineqLines_(0)
+	dense_(DenseQP::Form::Standard),
+	llt_(),
+	E_(), V_(), S_(),
+	r_(), w_(), x0_(), y_(), lambda_(), XWarm_(),
+	maxWarmIter_(10), nrIter_(-1),
+	QFactorized_(false),
+	warmSolved_(false)
 {
 }
 
 
 void QLDQPSolver::updateSize(int nrVars, int nrEq, int nrInEq, int nrGenInEq)
 {
-	int maxAeqLines = nrEq;
-	int maxAineqLines = nrInEq + nrGenInEq*2;
-
-	AeqFull_.resize(maxAeqLines, nrVars);
-	AineqFull_.resize(maxAineqLines, nrVars);
-
-	beq_.resize(maxAeqLines);
-	bineq_.resize(maxAineqLines);
-
-	XLFull_.resize(nrVars);
-	XUFull_.resize(nrVars);
-
-	QFull_.resize(nrVars, nrVars);
-	CFull_.resize(nrVars);
-
-	if(dependencies_.size())
-	{
-		int reducedNrVars = nrVars - static_cast<int>(dependencies_.size());
-
-		Aeq_.resize(maxAeqLines, reducedNrVars);
-		Aineq_.resize(maxAineqLines, reducedNrVars);
-
-		XL_.resize(reducedNrVars);
-		XU_.resize(reducedNrVars);
-
-		Q_.resize(reducedNrVars, reducedNrVars);
-		C_.resize(reducedNrVars);
-
-		XFull_.resize(nrVars);
-
-		qld_.problem(reducedNrVars, maxAeqLines, maxAineqLines);
-	}
-	else
-	{
-		qld_.problem(nrVars, maxAeqLines, maxAineqLines);
-	}
-
+	dense_.updateSize(nrVars, nrEq, nrInEq, nrGenInEq, reduction_);
+	qld_.problem(dense_.nrVars(), dense_.maxAeqLines(), dense_.maxAineqLines());
+
+	int n = dense_.nrVars();
+	E_.resize(n, n);
+	V_.resize(n, n);
+	S_.resize(n, n);
+	r_.resize(n);
+	w_.resize(n);
+	x0_.resize(n);
+	y_.resize(n);
+	lambda_.resize(n);
+	XWarm_.resize(n);
+	QFactorized_ = false;
+
+	// active set lines are no more valid,
+	// at most every inequality line and bound is active
+	activeSet_.clear();
+	activeSet_.reserve(dense_.maxAineqLines() + 2*n);
 }
 
 
@@ -94,70 +80,57 @@ void QLDQPSolver::updateMatrix(
 	const std::vector<GenInequality*>& genInEqConstr,
 	const std::vector<Bound*>& boundConstr)
 {
-	AeqFull_.setZero();
-	AineqFull_.setZero();
-	beq_.setZero();
-	bineq_.setZero();
-	XLFull_.fill(-std::numeric_limits<double>::infinity());
-	XUFull_.fill(std::numeric_limits<double>::infinity());
-	QFull_.setZero();
-	CFull_.setZero();
-
-	const int nrVars = int(QFull_.rows());
-
-	nrAeqLines_ = 0;
-	nrAeqLines_ = fillEq(eqConstr, nrVars, nrAeqLines_, AeqFull_, beq_);
-	nrAineqLines_ = 0;
-	nrAineqLines_ = fillInEq(inEqConstr, nrVars, nrAineqLines_, AineqFull_, bineq_);
-	nrAineqLines_ = fillGenInEq(genInEqConstr, nrVars, nrAineqLines_, AineqFull_, bineq_);
-
-	fillBound(boundConstr, XLFull_, XUFull_);
-	fillQC(tasks, nrVars, QFull_, CFull_);
-	if(dependencies_.size())
-	{
-		Aeq_.setZero();
-		Aineq_.setZero();
-		XL_.fill(-std::numeric_limits<double>::infinity());
-		XU_.fill(std::numeric_limits<double>::infinity());
-		Q_.setZero();
-		C_.setZero();
-		reduceA(AeqFull_, Aeq_, fullToReduced_, reducedToFull_, dependencies_);
-		reduceA(AineqFull_, Aineq_, fullToReduced_, reducedToFull_, dependencies_);
-		reduceBound(XLFull_, XL_, XUFull_, XU_, fullToReduced_, reducedToFull_, dependencies_);
-		reduceQC(QFull_, CFull_, Q_, C_, fullToReduced_, reducedToFull_, dependencies_);
-	}
+	dense_.updateMatrix(tasks, eqConstr, inEqConstr, genInEqConstr, boundConstr,
+		presolve_, presolveStats_);
+	QFactorized_ = QFactorized_ && dense_.constantQ();
 }
 
 
 bool QLDQPSolver::solve()
 {
 	bool success = false;
-	if(dependencies_.size())
+	const Eigen::MatrixXd& Q = dense_.Q();
+	const int nrAeqLines = dense_.nrAeqLines();
+	const int nrAineqLines = dense_.nrAineqLines();
+
+	// the active set is kept in the line order before the presolve
+	if(warmStart_ && dense_.presolved())
 	{
-		success = qld_.solve(Q_, C_,
-			Aeq_.block(0, 0, nrAeqLines_, int(Aeq_.cols())), beq_.segment(0, nrAeqLines_),
-			Aineq_.block(0, 0, nrAineqLines_, int(Aineq_.cols())), bineq_.segment(0, nrAineqLines_),
-			XL_, XU_, false, 1e-6);
-		expandResult(qld_.result(), XFull_,
-								 reducedToFull_,
-								 dependencies_);
+		dense_.AineqMap().toPresolved(activeSet_);
+	}
+	warmSolved_ = warmStart_ && solveWarm();
+	if(warmSolved_)
+	{
+		success = true;
 	}
 	else
 	{
-		success = qld_.solve(QFull_, CFull_,
-			AeqFull_.block(0, 0, nrAeqLines_, int(AeqFull_.cols())), beq_.segment(0, nrAeqLines_),
-			AineqFull_.block(0, 0, nrAineqLines_, int(AineqFull_.cols())), bineq_.segment(0, nrAineqLines_),
-			XLFull_, XUFull_, false, 1e-6);
+		success = qld_.solve(Q, dense_.C(),
+			dense_.Aeq().topRows(nrAeqLines), dense_.beq().head(nrAeqLines),
+			dense_.Aineq().topRows(nrAineqLines), dense_.bineq().head(nrAineqLines),
+			dense_.XL(), dense_.XU(), false, 1e-6);
+		qldActiveSet(int(Q.rows()));
+	}
+	if(dense_.presolved())
+	{
+		dense_.AineqMap().fromPresolved(activeSet_);
 	}
+	status_ = success ? QPStatus::Success : QPStatus::Failure;
+
+	dense_.expand(warmSolved_ ? XWarm_ : qld_.result());
 	return success;
 }
 
 
 const Eigen::VectorXd& QLDQPSolver::result() const
 {
-	if(dependencies_.size())
+	if(dense_.reduced())
 	{
-		return XFull_;
+		return dense_.XFull();
+	}
+	else if(warmSolved_)
+	{
+		return XWarm_;
 	}
 	else
 	{
@@ -166,6 +139,213 @@ const Eigen::VectorXd& QLDQPSolver::result() const
 }
 
 
+int QLDQPSolver::iterations() const
+{
+	return nrIter_;
+}
+
+
+bool QLDQPSolver::solveWarm()
+{
+	using namespace Eigen;
+	const double inf = std::numeric_limits<double>::infinity();
+	const MatrixXd& Q = dense_.Q();
+	const VectorXd& C = dense_.C();
+	const MatrixXd& Aeq = dense_.Aeq();
+	const VectorXd& beq = dense_.beq();
+	const MatrixXd& Aineq = dense_.Aineq();
+	const VectorXd& bineq = dense_.bineq();
+	const VectorXd& XL = dense_.XL();
+	const VectorXd& XU = dense_.XU();
+	const int nrVars = int(Q.rows());
+	const int nrAeqLines = dense_.nrAeqLines();
+	const int nrAineqLines = dense_.nrAineqLines();
+
+	// inequality lines are Aineq lines, lower bounds and upper bounds
+	// line i is a_i^T x <= b_i
+	auto lineValue = [&](int i, const VectorXd& x)
+	{
+		if(i < nrAineqLines)
+		{
+			return Aineq.row(i).dot(x) - bineq(i);
+		}
+		else if(i < nrAineqLines + nrVars)
+		{
+			return XL(i - nrAineqLines) - x(i - nrAineqLines);
+		}
+		return x(i - nrAineqLines - nrVars) - XU(i - nrAineqLines - nrVars);
+	};
+	auto lineBound = [&](int i)
+	{
+		if(i < nrAineqLines)
+		{
+			return bineq(i);
+		}
+		else if(i < nrAineqLines + nrVars)
+		{
+			return -XL(i - nrAineqLines);
+		}
+		return XU(i - nrAineqLines - nrVars);
+	};
+
+	// remove the lines that don't exist anymore
+	const int nrLines = nrAineqLines + 2*nrVars;
+	activeSet_.erase(std::remove_if(activeSet_.begin(), activeSet_.end(),
+		[&](int i) { return i >= nrLines || std::abs(lineBound(i)) == inf; }),
+		activeSet_.end());
+
+	// unconstrained minimum x0 = -Q^{-1} C
+	if(!QFactorized_)
+	{
+		llt_.compute(Q);
+		if(llt_.info() != Success)
+		{
+			return false;
+		}
+		QFactorized_ = true;
+	}
+	x0_ = llt_.solve(C);
+	x0_ *= -1.;
+
+	for(nrIter_ = 1; nrIter_ <= maxWarmIter_; ++nrIter_)
+	{
+		// working set E x = r
+		// with more lines than variables the working set is degenerate
+		int nrW = nrAeqLines + int(activeSet_.size());
+		if(nrW > nrVars)
+		{
+			return false;
+		}
+		E_.topRows(nrAeqLines) = Aeq.topRows(nrAeqLines);
+		r_.head(nrAeqLines) = beq.head(nrAeqLines);
+		for(std::size_t w = 0; w < activeSet_.size(); ++w)
+		{
+			int i = activeSet_[w];
+			int line = nrAeqLines + int(w);
+			if(i < nrAineqLines)
+			{
+				E_.row(line) = Aineq.row(i);
+			}
+			else if(i < nrAineqLines + nrVars)
+			{
+				E_.row(line).setZero();
+				E_(line, i - nrAineqLines) = -1.;
+			}
+			else
+			{
+				E_.row(line).setZero();
+				E_(line, i - nrAineqLines - nrVars) = 1.;
+			}
+			r_(line) = lineBound(i);
+		}
+
+		// x = x0 - Q^{-1} E^T lambda
+		// E Q^{-1} E^T lambda = E x0 - r
+		XWarm_ = x0_;
+		if(nrW > 0)
+		{
+			auto E = E_.topRows(nrW);
+			auto V = V_.leftCols(nrW);
+			auto S = S_.topLeftCorner(nrW, nrW);
+			auto r = r_.head(nrW);
+			auto w = w_.head(nrW);
+			auto lambda = lambda_.head(nrW);
+
+			V = E.transpose();
+			llt_.matrixL().solveInPlace(V);
+			S.noalias() = V.transpose()*V;
+			// factorized in place, a decomposition object would reallocate
+			// its storage each time the working set size change
+			LLT<Ref<MatrixXd>> lltS(S);
+			if(lltS.info() != Success)
+			{
+				return false;
+			}
+			w.noalias() = E*x0_;
+			w -= r;
+			lambda = lltS.solve(w);
+			y_.noalias() = V*lambda;
+			llt_.matrixU().solveInPlace(y_);
+			XWarm_ -= y_;
+
+			// singular working set
+			w.noalias() = E*XWarm_;
+			w -= r;
+			if(w.lpNorm<Infinity>() > 1e-8*(1. + r.lpNorm<Infinity>()))
+			{
+				return false;
+			}
+		}
+
+		// remove the most negative multiplier
+		int minW = -1;
+		double minLambda = -1e-10;
+		for(std::size_t w = 0; w < activeSet_.size(); ++w)
+		{
+			if(lambda_(nrAeqLines + int(w)) < minLambda)
+			{
+				minLambda = lambda_(nrAeqLines + int(w));
+				minW = int(w);
+			}
+		}
+		if(minW != -1)
+		{
+			activeSet_.erase(activeSet_.begin() + minW);
+			continue;
+		}
+
+		// add the most violated line
+		int maxI = -1;
+		double maxViol = 0.;
+		for(int i = 0; i < nrLines; ++i)
+		{
+			double viol = lineValue(i, XWarm_)/(1. + std::abs(lineBound(i)));
+			if(viol > 1e-8 && viol > maxViol &&
+				 std::find(activeSet_.begin(), activeSet_.end(), i) == activeSet_.end())
+			{
+				maxViol = viol;
+				maxI = i;
+			}
+		}
+		if(maxI != -1)
+		{
+			activeSet_.push_back(maxI);
+			continue;
+		}
+
+		return true;
+	}
+
+	return false;
+}
+
+
+void QLDQPSolver::qldActiveSet(int nrVars)
+{
+	activeSet_.clear();
+	const Eigen::VectorXd& mult = qld_.multipliers();
+	const int nrAeqLines = dense_.nrAeqLines();
+	const int nrAineqLines = dense_.nrAineqLines();
+	const int nrLines = nrAeqLines + nrAineqLines;
+	for(int i = 0; i < nrAineqLines; ++i)
+	{
+		if(mult(nrAeqLines + i) > 0.)
+		{
+			activeSet_.push_back(i);
+		}
+	}
+	for(int i = 0; i < 2*nrVars; ++i)
+	{
+		if(mult(nrLines + i) > 0.)
+		{
+			activeSet_.push_back(nrAineqLines + i);
+		}
+	}
+	// QLD don't give its number of iterations
+	nrIter_ = -1;
+}
+
+
 std::ostream& QLDQPSolver::errorMsg(
 	const std::vector<rbd::MultiBody>& /* mbs */,
 	const std::vector<Task*>& /* tasks */,
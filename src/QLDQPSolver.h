@@ -18,11 +18,15 @@
 #pragma once
 
 // includes
+// Eigen
+#include <Eigen/Cholesky>
+
 // eigen-qld
 #include <eigen-qld/QLD.h>
 
 // Tasks
 #include "Tasks/GenQPSolver.h"
+#include "GenQPUtils.h"
 
 
 namespace tasks
@@ -34,6 +38,18 @@ namespace qp
 
 /**
 	* GenQPSolver interface implementation with the QLD QP solver.
+	*
+	* When the warm start is enabled the previous active set is used to solve
+	* the equality constrained problem with a range space method and the
+	* active set is updated until the KKT conditions are met.
+	* If it fails after a few iterations QLD is called.
+	* The Cholesky factor of Q is kept while Q don't change.
+	*
+	* iterations() is the number of working sets solved by the warm start,
+	* -1 when QLD is called since it doesn't report its iterations.
+	*
+	* The presolve is applied on the QLD standard form lines, the active set
+	* is remapped to the presolved lines for the warm start (see PresolveMap).
 	*/
 class TASKS_DLLAPI QLDQPSolver : public GenQPSolver
 {
@@ -56,30 +72,26 @@ public:
 		const std::vector<Bound*>& boundConstr,
 		std::ostream& out) const override;
 
-private:
-	Eigen::QLD qld_;
-
-	Eigen::MatrixXd Aeq_, Aineq_;
-	Eigen::VectorXd beq_, bineq_;
-
-	Eigen::MatrixXd AeqFull_, AineqFull_;
+	virtual int iterations() const override;
 
-	Eigen::VectorXd XL_;
-	Eigen::VectorXd XU_;
-
-	Eigen::VectorXd XLFull_;
-	Eigen::VectorXd XUFull_;
-
-	Eigen::MatrixXd Q_;
-	Eigen::VectorXd C_;
+private:
+	/// Solve the problem of dense_ from the active set of the previous solve.
+	bool solveWarm();
+	void qldActiveSet(int nrVars);
 
-	Eigen::MatrixXd QFull_;
-	Eigen::VectorXd CFull_;
+private:
+	Eigen::QLD qld_;
 
-	Eigen::VectorXd XFull_;
+	DenseQP dense_;
 
-	int nrAeqLines_;
-	int nrAineqLines_;
+	// warm start workspace, sized for nrVars working lines
+	Eigen::LLT<Eigen::MatrixXd> llt_;
+	Eigen::MatrixXd E_, V_, S_;
+	Eigen::VectorXd r_, w_, x0_, y_, lambda_, XWarm_;
+	int maxWarmIter_, nrIter_;
+	// true if llt_ is the factor of the current Q
+	bool QFactorized_;
+	bool warmSolved_;
 };
 
 
@@ -20,6 +20,7 @@
 
 // includes
 // std
+#include <algorithm>
 #include <cmath>
 
 // RBDyn
@@ -327,6 +328,7 @@ CollisionConstr::BodyCollData::BodyCollData(const rbd::MultiBody& mb,
 	X_op_o(X),
 	rIndex(rI),
 	bIndex(mb.bodyIndexByName(bName)),
+	jacIndex(-1),
 	bodyName(bName)
 {}
 
@@ -352,11 +354,14 @@ CollisionConstr::CollisionConstr(const std::vector<rbd::MultiBody>& mbs, double
 	dataVec_(),
 	step_(step),
 	nrActivated_(0),
-	totalAlphaD_(-1),
+	totalAlphaD_(0),
 	AInEq_(),
 	bInEq_(),
+	robotBlocks_(),
+	AInEqBlocks_(),
 	fullJac_(),
-	distJac_()
+	distJac_(),
+	nrVars_(0)
 {
 	int maxDof = std::max_element(mbs.begin(), mbs.end(), compareDof)->nrDof();
 	fullJac_.resize(1, maxDof);
@@ -420,16 +425,57 @@ void CollisionConstr::reset()
 
 void CollisionConstr::updateNrCollisions()
 {
-	AInEq_.setZero(dataVec_.size(), nrVars_);
+	AInEq_.setZero(dataVec_.size(), totalAlphaD_);
 	bInEq_.setZero(dataVec_.size());
+
+	// only keep the alphaD block of robots involved in a collision
+	AInEqBlocks_.clear();
+	for(std::size_t r = 0; r < robotBlocks_.size(); ++r)
+	{
+		bool involved = std::any_of(dataVec_.begin(), dataVec_.end(),
+			[r](const CollData& d)
+			{
+				return std::any_of(d.bodies.begin(), d.bodies.end(),
+					[r](const BodyCollData& bcd)
+					{
+						return bcd.rIndex == int(r);
+					});
+			});
+		if(involved && robotBlocks_[r].size > 0)
+		{
+			AInEqBlocks_.push_back(robotBlocks_[r]);
+		}
+	}
 }
 
 
-void CollisionConstr::updateNrVars(const std::vector<rbd::MultiBody>& /* mb */,
+void CollisionConstr::registerCache(const std::vector<rbd::MultiBody>& mbs,
+	SolverData& data)
+{
+	for(CollData& d: dataVec_)
+	{
+		for(BodyCollData& bcd: d.bodies)
+		{
+			bcd.jacIndex = data.addBodyJacobian(mbs[bcd.rIndex], bcd.rIndex,
+				bcd.bodyName);
+		}
+	}
+}
+
+
+void CollisionConstr::updateNrVars(const std::vector<rbd::MultiBody>& mbs,
 	const SolverData& data)
 {
 	totalAlphaD_ = data.totalAlphaD();
 	nrVars_ = data.nrVars();
+
+	robotBlocks_.clear();
+	for(int r = 0; r < int(mbs.size()); ++r)
+	{
+		robotBlocks_.emplace_back(data.alphaDBegin(r), data.alphaD(r),
+			data.alphaDBegin(r));
+	}
+
 	updateNrCollisions();
 }
 
@@ -498,15 +544,30 @@ void CollisionConstr::update(const std::vector<rbd::MultiBody>& mbs,
 				const rbd::MultiBodyConfig& mbc = mbcs[bcd.rIndex];
 
 				// Compute body1
-				const MatrixXd& jac = bcd.jac.jacobian(mb, mbc);
+				int dof = bcd.jac.dof();
+				if(data.bodyJacobianComputed(bcd.jacIndex, bcd.rIndex, bcd.bIndex))
+				{
+					// nearest point with the world orientation,
+					// like rbd::Jacobian::jacobian
+					const sva::PTransformd& X_0_b = mbc.bodyPosW[bcd.bIndex];
+					sva::PTransformd X_0_p(
+						(sva::PTransformd(nearestPoint[i])*X_0_b).translation());
+					Eigen::Matrix<double, 1, 6> nX = (nf*step_*sign).transpose()*
+						(X_0_p*X_0_b.inv()).matrix().bottomRows<3>();
+					distJac_.block(0, 0, 1, dof).noalias() =
+						nX*data.bodyJacobian(bcd.jacIndex);
+				}
+				else
+				{
+					const MatrixXd& jac = bcd.jac.jacobian(mb, mbc);
+					distJac_.block(0, 0, 1, dof).noalias() =
+						(nf*step_*sign).transpose()*jac.block(3, 0, 3, dof);
+				}
 				Eigen::Vector3d pSpeed = bcd.jac.velocity(mb, mbc).linear();
 				Eigen::Vector3d pNormalAcc = bcd.jac.normalAcceleration(
 					mb, mbc, data.normalAccB(bcd.rIndex)).linear();
 
-				distJac_.block(0, 0, 1, bcd.jac.dof()).noalias() =
-					(nf*step_*sign).transpose()*jac.block(3, 0, 3, bcd.jac.dof());
-
-				bcd.jac.fullJacobian(mb, distJac_.block(0, 0, 1, bcd.jac.dof()), fullJac_);
+				bcd.jac.fullJacobian(mb, distJac_.block(0, 0, 1, dof), fullJac_);
 
 				double jqdn = pSpeed.dot(nf);
 				double jqdnd = pSpeed.dot(dnf*step_);
@@ -592,6 +653,12 @@ const Eigen::MatrixXd& CollisionConstr::AInEq() const
 }
 
 
+const std::vector<ColBlock>& CollisionConstr::AInEqBlocks() const
+{
+	return AInEqBlocks_;
+}
+
+
 const Eigen::VectorXd& CollisionConstr::bInEq() const
 {
 	return bInEq_;
@@ -883,7 +950,9 @@ GripperTorqueConstr::GripperData::GripperData(const ContactId& cId, double tl,
 GripperTorqueConstr::GripperTorqueConstr():
 	dataVec_(),
 	AInEq_(),
-	bInEq_()
+	bInEq_(),
+	AInEqBlocks_(),
+	AInEqRevision_(-1)
 {}
 
 
@@ -922,11 +991,38 @@ void GripperTorqueConstr::updateNrVars(const std::vector<rbd::MultiBody>& /* mbs
 	const SolverData& data)
 {
 	using namespace Eigen;
-	AInEq_.setZero(dataVec_.size(), data.nrVars());
+	int nrUni = int(data.unilateralContacts().size());
+
+	// AInEq_ only store the lambda of the gripper contacts
+	AInEqBlocks_.clear();
+	int nrCols = 0;
+	for(const GripperData& gd: dataVec_)
+	{
+		for(std::size_t bi = 0; bi < data.bilateralContacts().size(); ++bi)
+		{
+			if(data.bilateralContacts()[bi].contactId == gd.contactId)
+			{
+				int cIndex = int(bi) + nrUni;
+				int lambdaBegin = data.lambdaBegin(cIndex);
+				auto it = std::find_if(AInEqBlocks_.begin(), AInEqBlocks_.end(),
+					[lambdaBegin](const ColBlock& cb)
+					{
+						return cb.col == lambdaBegin;
+					});
+				if(it == AInEqBlocks_.end())
+				{
+					AInEqBlocks_.emplace_back(lambdaBegin, data.lambda(cIndex), nrCols);
+					nrCols += data.lambda(cIndex);
+				}
+				break;
+			}
+		}
+	}
+
+	AInEq_.setZero(dataVec_.size(), nrCols);
 	bInEq_.setZero(dataVec_.size());
 
 	int line = 0;
-	int nrUni = int(data.unilateralContacts().size());
 	for(const GripperData& gd: dataVec_)
 	{
 		for(std::size_t bi = 0; bi < data.bilateralContacts().size(); ++bi)
@@ -935,7 +1031,12 @@ void GripperTorqueConstr::updateNrVars(const std::vector<rbd::MultiBody>& /* mbs
 
 			if(bc.contactId == gd.contactId)
 			{
-				int col = data.lambdaBegin(int(bi) + nrUni);
+				int lambdaBegin = data.lambdaBegin(int(bi) + nrUni);
+				int col = std::find_if(AInEqBlocks_.begin(), AInEqBlocks_.end(),
+					[lambdaBegin](const ColBlock& cb)
+					{
+						return cb.col == lambdaBegin;
+					})->srcCol;
 				// Torque applied on the gripper motor
 				// Sum_i^nrF  T_i·( p_i^T_o x f_i)
 				for(std::size_t i = 0; i < bc.r1Cones.size(); ++i)
@@ -957,6 +1058,7 @@ void GripperTorqueConstr::updateNrVars(const std::vector<rbd::MultiBody>& /* mbs
 			// if the bodyId is not found the AInEq_ and BInEq_ line stay at zero
 		}
 	}
+	AInEqRevision_ = newRevision();
 }
 
 
@@ -996,6 +1098,18 @@ const Eigen::MatrixXd& GripperTorqueConstr::AInEq() const
 }
 
 
+const std::vector<ColBlock>& GripperTorqueConstr::AInEqBlocks() const
+{
+	return AInEqBlocks_;
+}
+
+
+int GripperTorqueConstr::AInEqRevision() const
+{
+	return AInEqRevision_;
+}
+
+
 const Eigen::VectorXd& GripperTorqueConstr::bInEq() const
 {
 	return bInEq_;
@@ -1011,10 +1125,12 @@ BoundedSpeedConstr::BoundedSpeedConstr(const std::vector<rbd::MultiBody>& mbs,
 	int robotIndex, double timeStep):
 	robotIndex_(robotIndex),
 	cont_(),
+	jacMat_(6, mbs[robotIndex_].nrDof()),
 	fullJac_(6, mbs[robotIndex_].nrDof()),
 	A_(),
 	lower_(),
 	upper_(),
+	AGenInEqBlocks_(),
 	nrVars_(0),
 	timeStep_(timeStep)
 {}
@@ -1075,11 +1191,22 @@ void BoundedSpeedConstr::updateBoundedSpeeds()
 }
 
 
+void BoundedSpeedConstr::registerCache(const std::vector<rbd::MultiBody>& mbs,
+	SolverData& data)
+{
+	for(BoundedSpeedData& c: cont_)
+	{
+		c.jacIndex = data.addBodyJacobian(mbs[robotIndex_], robotIndex_, c.bodyName);
+	}
+}
+
+
 void BoundedSpeedConstr::updateNrVars(const std::vector<rbd::MultiBody>& /* mbs */,
 	const SolverData& data)
 {
 	alphaDBegin_ = data.alphaDBegin(robotIndex_);
 	nrVars_ = data.nrVars();
+	AGenInEqBlocks_.assign(1, {alphaDBegin_, int(fullJac_.cols()), 0});
 	updateNrEq();
 }
 
@@ -1103,9 +1230,21 @@ void BoundedSpeedConstr::update(const std::vector<rbd::MultiBody>& mbs,
 		int rows = int(cont_[i].dof.rows());
 
 		// AEq
-		const MatrixXd& jac = cont_[i].jac.bodyJacobian(mb, mbc);
-		cont_[i].jac.fullJacobian(mb, jac, fullJac_);
-		A_.block(index, alphaDBegin_, rows, mb.nrDof()).noalias() =
+		const BoundedSpeedData& bsd = cont_[i];
+		if(data.bodyJacobianComputed(bsd.jacIndex, robotIndex_, bsd.body))
+		{
+			// translate the shared body Jacobian to the body point
+			int dof = bsd.jac.dof();
+			jacMat_.block(0, 0, 6, dof).noalias() =
+				bsd.bodyPoint.matrix()*data.bodyJacobian(bsd.jacIndex);
+			bsd.jac.fullJacobian(mb, jacMat_.block(0, 0, 6, dof), fullJac_);
+		}
+		else
+		{
+			const MatrixXd& jac = cont_[i].jac.bodyJacobian(mb, mbc);
+			cont_[i].jac.fullJacobian(mb, jac, fullJac_);
+		}
+		A_.block(index, 0, rows, mb.nrDof()).noalias() =
 			cont_[i].dof*fullJac_;
 
 		// BEq
@@ -1158,6 +1297,12 @@ const Eigen::MatrixXd& BoundedSpeedConstr::AGenInEq() const
 }
 
 
+const std::vector<ColBlock>& BoundedSpeedConstr::AGenInEqBlocks() const
+{
+	return AGenInEqBlocks_;
+}
+
+
 const Eigen::VectorXd& BoundedSpeedConstr::LowerGenInEq() const
 {
 	return lower_;
@@ -1178,7 +1323,7 @@ void BoundedSpeedConstr::updateNrEq()
 		nrEq += int(c.dof.rows());
 	}
 
-	A_.setZero(nrEq, nrVars_);
+	A_.setZero(nrEq, fullJac_.cols());
 	lower_.setZero(nrEq);
 	upper_.setZero(nrEq);
 }
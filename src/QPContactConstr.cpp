@@ -20,6 +20,7 @@
 
 // includes
 // std
+#include <algorithm>
 #include <set>
 
 // RBDyn
@@ -36,22 +37,10 @@ namespace qp
 {
 
 /**
-	*															ContactCommon
+	*															ContactConstrCommon
 	*/
 
 
-bool ContactConstrCommon::ContactCommon::operator==(const ContactCommon& cc) const
-{
-	return cId == cc.cId;
-}
-
-
-bool ContactConstrCommon::ContactCommon::operator<(const ContactCommon& cc) const
-{
-	return cId < cc.cId;
-}
-
-
 bool ContactConstrCommon::addVirtualContact(const ContactId& cId)
 {
 	return virtualContacts_.insert(cId).second;
@@ -89,26 +78,30 @@ void ContactConstrCommon::resetDofContacts()
 }
 
 
-std::set<ContactConstrCommon::ContactCommon>
-ContactConstrCommon::contactCommonInContact(
-	const std::vector<rbd::MultiBody>& mbs, const SolverData& data)
+void ContactConstrCommon::contactsInContact(const SolverData& data)
 {
-	std::set<ContactCommon> ret;
-	auto isValid = [&mbs, this](const ContactId& contactId)
-	{
-		// if is virtualContacts we don't add it
-		return (virtualContacts_.find(contactId) == virtualContacts_.end());
-	};
-
+	contacts_.clear();
 	for(const BilateralContact& c: data.allContacts())
 	{
-		if(isValid(c.contactId))
+		// if is virtualContacts we don't add it
+		if(virtualContacts_.find(c.contactId) == virtualContacts_.end())
 		{
-			ret.insert({c.contactId, c.X_b1_cf, c.X_b1_b2});
+			contacts_.push_back(&c);
 		}
 	}
 
-	return std::move(ret);
+	// the first contact of an id is kept, contacts_ follow allContacts order
+	std::sort(contacts_.begin(), contacts_.end(),
+		[](const BilateralContact* c1, const BilateralContact* c2)
+		{
+			return c1->contactId < c2->contactId ||
+				(c1->contactId == c2->contactId && c1 < c2);
+		});
+	contacts_.erase(std::unique(contacts_.begin(), contacts_.end(),
+		[](const BilateralContact* c1, const BilateralContact* c2)
+		{
+			return c1->contactId == c2->contactId;
+		}), contacts_.end());
 }
 
 
@@ -119,10 +112,12 @@ ContactConstrCommon::contactCommonInContact(
 
 ContactConstr::ContactConstr():
 	cont_(),
+	nrCont_(0),
 	fullJac_(),
 	dofJac_(),
 	A_(),
 	b_(),
+	AEqBlocks_(),
 	nrEq_(0),
 	totalAlphaD_(0)
 {}
@@ -146,48 +141,122 @@ void ContactConstr::updateDofContacts()
 }
 
 
+void ContactConstr::registerCache(const std::vector<rbd::MultiBody>& mbs,
+	SolverData& data)
+{
+	contactsInContact(data);
+	for(const BilateralContact* c: contacts_)
+	{
+		const ContactId& cId = c->contactId;
+		if(mbs[cId.r1Index].nrDof() > 0)
+		{
+			data.addBodyJacobian(mbs[cId.r1Index], cId.r1Index, cId.r1BodyName);
+		}
+		if(mbs[cId.r2Index].nrDof() > 0)
+		{
+			data.addBodyJacobian(mbs[cId.r2Index], cId.r2Index, cId.r2BodyName);
+		}
+	}
+}
+
+
 void ContactConstr::updateNrVars(const std::vector<rbd::MultiBody>& mbs,
 	const SolverData& data)
 {
-	cont_.clear();
 	totalAlphaD_ = data.totalAlphaD();
 
 	int maxDof = std::max_element(mbs.begin(), mbs.end(), compareDof)->nrDof();
 	fullJac_.resize(6, maxDof);
 	dofJac_.resize(6, maxDof);
 
-	std::set<ContactCommon> contactCSet = contactCommonInContact(mbs, data);
-	for(const ContactCommon& cC: contactCSet)
+	contactsInContact(data);
+	nrCont_ = 0;
+	for(const BilateralContact* c: contacts_)
 	{
-		Eigen::MatrixXd dof(Eigen::MatrixXd::Identity(6, 6));
-		auto it = dofContacts_.find(cC.cId);
+		const ContactId& cId = c->contactId;
+		const rbd::MultiBody& mb1 = mbs[cId.r1Index];
+		const rbd::MultiBody& mb2 = mbs[cId.r2Index];
+		int b1Index = mb1.bodyIndexByName(cId.r1BodyName);
+		int b2Index = mb2.bodyIndexByName(cId.r2BodyName);
+		sva::PTransformd X_b2_cf = c->X_b1_cf*c->X_b1_b2.inv();
+		std::size_t nrSides = (mb1.nrDof() > 0 ? 1 : 0) + (mb2.nrDof() > 0 ? 1 : 0);
+
+		// same contact on the same bodies, its Jacobians are reused
+		bool cached = activateCached(cont_, std::size_t(nrCont_),
+			[&cId, b1Index, b2Index, nrSides](const ContactData& cd)
+			{
+				return cd.contactId == cId && cd.b1Index == b1Index &&
+					cd.b2Index == b2Index && cd.contacts.size() == nrSides;
+			});
+		if(!cached)
+		{
+			std::vector<ContactSideData> contacts;
+			auto addContact = [&mbs, &data, &contacts](int rIndex,
+				const std::string& bName,
+				double sign, const sva::PTransformd& point)
+			{
+				if(mbs[rIndex].nrDof() > 0)
+				{
+					contacts.emplace_back(rIndex, data.alphaDBegin(rIndex), sign,
+								rbd::Jacobian(mbs[rIndex], bName), point);
+				}
+			};
+			addContact(cId.r1Index, cId.r1BodyName, 1., c->X_b1_cf);
+			addContact(cId.r2Index, cId.r2BodyName, -1., X_b2_cf);
+
+			cont_.emplace_back(std::move(contacts), Eigen::MatrixXd::Identity(6, 6),
+				b1Index, b2Index, c->X_b1_b2, c->X_b1_cf, cId);
+			std::rotate(cont_.begin() + nrCont_, cont_.end() - 1, cont_.end());
+		}
+
+		// only the variables position, the contact frame
+		// and the dof can have changed
+		ContactData& cd = cont_[nrCont_];
+		auto it = dofContacts_.find(cId);
 		if(it != dofContacts_.end())
 		{
-			dof = it->second;
+			cd.dof = it->second;
 		}
-		std::vector<ContactSideData> contacts;
-		auto addContact = [&mbs, &data, &contacts](int rIndex,
-			const std::string& bName,
-			double sign, const sva::PTransformd& point)
+		else
 		{
-			if(mbs[rIndex].nrDof() > 0)
+			cd.dof.setIdentity(6, 6);
+		}
+		cd.X_b1_b2 = c->X_b1_b2;
+		cd.X_b1_cf = c->X_b1_cf;
+		for(ContactSideData& csd: cd.contacts)
+		{
+			csd.alphaDBegin = data.alphaDBegin(csd.robotIndex);
+			// -1 if registerCache has not been called
+			csd.jacIndex = data.bodyJacobianIndex(csd.robotIndex, csd.bodyIndex);
+			csd.X_b_p = csd.sign > 0. ? c->X_b1_cf : X_b2_cf;
+		}
+		++nrCont_;
+	}
+	trimCached(cont_, std::size_t(nrCont_), std::size_t(data.contactCapacity()));
+	updateNrEq();
+
+	// only robots in contact have non zero columns
+	AEqBlocks_.clear();
+	for(int i = 0; i < nrCont_; ++i)
+	{
+		for(const ContactSideData& csd: cont_[i].contacts)
+		{
+			auto it = std::find_if(AEqBlocks_.begin(), AEqBlocks_.end(),
+				[&csd](const ColBlock& cb)
+				{
+					return cb.col == csd.alphaDBegin;
+				});
+			if(it == AEqBlocks_.end())
 			{
-				contacts.emplace_back(rIndex, data.alphaDBegin(rIndex), sign,
-							rbd::Jacobian(mbs[rIndex], bName), point);
+				int alphaD = data.alphaD(csd.robotIndex);
+				AEqBlocks_.emplace_back(csd.alphaDBegin, alphaD, csd.alphaDBegin);
 			}
-		};
-		addContact(cC.cId.r1Index, cC.cId.r1BodyName, 1., cC.X_b1_cf);
-		addContact(cC.cId.r2Index, cC.cId.r2BodyName, -1., cC.X_b1_cf*cC.X_b1_b2.inv());
-
-		int b1Index = mbs[cC.cId.r1Index].bodyIndexByName(cC.cId.r1BodyName);
-		int b2Index = mbs[cC.cId.r2Index].bodyIndexByName(cC.cId.r2BodyName);
-		cont_.emplace_back(std::move(contacts), dof, b1Index, b2Index, cC.X_b1_b2,
-			cC.X_b1_cf, cC.cId);
+		}
 	}
-	updateNrEq();
 
-	A_.setZero(cont_.size()*6, data.nrVars());
-	b_.setZero(cont_.size()*6);
+	// sized for the contact capacity to not be resized by a contact change
+	A_.setZero(data.contactCapacity()*6, totalAlphaD_);
+	b_.setZero(data.contactCapacity()*6);
 }
 
 
@@ -223,6 +292,12 @@ const Eigen::MatrixXd& ContactConstr::AEq() const
 }
 
 
+const std::vector<ColBlock>& ContactConstr::AEqBlocks() const
+{
+	return AEqBlocks_;
+}
+
+
 const Eigen::VectorXd& ContactConstr::bEq() const
 {
 	return b_;
@@ -232,10 +307,36 @@ const Eigen::VectorXd& ContactConstr::bEq() const
 void ContactConstr::updateNrEq()
 {
 	nrEq_ = 0;
-	for(const ContactData& c: cont_)
+	for(int i = 0; i < nrCont_; ++i)
+	{
+		nrEq_ += int(cont_[i].dof.rows());
+	}
+}
+
+
+void ContactConstr::addSideJacobian(int line, const ContactData& cd,
+	ContactSideData& csd, const rbd::MultiBody& mb,
+	const rbd::MultiBodyConfig& mbc, const SolverData& data)
+{
+	int rows = int(cd.dof.rows());
+	int dof = csd.jac.dof();
+	if(data.bodyJacobianComputed(csd.jacIndex, csd.robotIndex, csd.bodyIndex))
+	{
+		// J = X_b_p*J_b, the product with S is done first on the 6x6 transform
+		Eigen::Matrix<double, Eigen::Dynamic, 6, 0, 6, 6> dofX =
+			csd.sign*cd.dof*csd.X_b_p.matrix();
+		dofJac_.block(0, 0, rows, dof).noalias() =
+			dofX*data.bodyJacobian(csd.jacIndex);
+	}
+	else
 	{
-		nrEq_ += int(c.dof.rows());
+		sva::PTransformd X_0_p = csd.X_b_p*mbc.bodyPosW[csd.bodyIndex];
+		dofJac_.block(0, 0, rows, dof).noalias() =
+			csd.sign*cd.dof*csd.jac.jacobian(mb, mbc, X_0_p);
 	}
+	csd.jac.fullJacobian(mb, dofJac_.block(0, 0, rows, dof), fullJac_);
+	A_.block(line, csd.alphaDBegin, rows, mb.nrDof()).noalias() +=
+		fullJac_.block(0, 0, rows, mb.nrDof());
 }
 
 
@@ -260,7 +361,7 @@ void ContactAccConstr::update(const std::vector<rbd::MultiBody>& mbs,
 	// J_i*alphaD + JD_i*alpha = 0
 
 	int index = 0;
-	for(std::size_t i = 0; i < cont_.size(); ++i)
+	for(int i = 0; i < nrCont_; ++i)
 	{
 		ContactData& cd = cont_[i];
 		int rows = int(cd.dof.rows());
@@ -272,14 +373,7 @@ void ContactAccConstr::update(const std::vector<rbd::MultiBody>& mbs,
 			const rbd::MultiBodyConfig& mbc = mbcs[csd.robotIndex];
 
 			// AEq = J_i
-			sva::PTransformd X_0_p = csd.X_b_p*mbc.bodyPosW[csd.bodyIndex];
-			const MatrixXd& jacMat = csd.jac.jacobian(mb, mbc, X_0_p);
-			dofJac_.block(0, 0, rows, csd.jac.dof()).noalias() =
-				csd.sign*cd.dof*jacMat;
-			csd.jac.fullJacobian(mb, dofJac_.block(0, 0, rows, csd.jac.dof()),
-				fullJac_);
-			A_.block(index, csd.alphaDBegin, rows, mb.nrDof()).noalias() +=
-					fullJac_.block(0, 0, rows, mb.nrDof());
+			addSideJacobian(index, cd, csd, mb, mbc, data);
 
 			// BEq = -JD_i*alpha
 			Vector6d normalAcc = csd.jac.normalAcceleration(
@@ -320,7 +414,7 @@ void ContactSpeedConstr::update(const std::vector<rbd::MultiBody>& mbs,
 	// J_i*alphaD + JD_i*alpha = 0
 
 	int index = 0;
-	for(std::size_t i = 0; i < cont_.size(); ++i)
+	for(int i = 0; i < nrCont_; ++i)
 	{
 		ContactData& cd = cont_[i];
 		int rows = int(cd.dof.rows());
@@ -332,14 +426,7 @@ void ContactSpeedConstr::update(const std::vector<rbd::MultiBody>& mbs,
 			const rbd::MultiBodyConfig& mbc = mbcs[csd.robotIndex];
 
 			// AEq = J_i
-			sva::PTransformd X_0_p = csd.X_b_p*mbc.bodyPosW[csd.bodyIndex];
-			const MatrixXd& jacMat = csd.jac.jacobian(mb, mbc, X_0_p);
-			dofJac_.block(0, 0, rows, csd.jac.dof()).noalias() =
-				csd.sign*cd.dof*jacMat;
-			csd.jac.fullJacobian(mb, dofJac_.block(0, 0, rows, csd.jac.dof()),
-				fullJac_);
-			A_.block(index, csd.alphaDBegin, rows, mb.nrDof()).noalias() +=
-					fullJac_.block(0, 0, rows, mb.nrDof());
+			addSideJacobian(index, cd, csd, mb, mbc, data);
 
 			// BEq = -JD_i*alpha
 			Vector6d normalAcc = csd.jac.normalAcceleration(
@@ -383,7 +470,7 @@ void ContactPosConstr::update(const std::vector<rbd::MultiBody>& mbs,
 	// J_i*alphaD + JD_i*alpha = 0
 
 	int index = 0;
-	for(std::size_t i = 0; i < cont_.size(); ++i)
+	for(int i = 0; i < nrCont_; ++i)
 	{
 		ContactData& cd = cont_[i];
 		int rows = int(cd.dof.rows());
@@ -395,14 +482,7 @@ void ContactPosConstr::update(const std::vector<rbd::MultiBody>& mbs,
 			const rbd::MultiBodyConfig& mbc = mbcs[csd.robotIndex];
 
 			// AEq = J_i
-			sva::PTransformd X_0_p = csd.X_b_p*mbc.bodyPosW[csd.bodyIndex];
-			const MatrixXd& jacMat = csd.jac.jacobian(mb, mbc, X_0_p);
-			dofJac_.block(0, 0, rows, csd.jac.dof()).noalias() =
-				csd.sign*cd.dof*jacMat;
-			csd.jac.fullJacobian(mb, dofJac_.block(0, 0, rows, csd.jac.dof()),
-				fullJac_);
-			A_.block(index, csd.alphaDBegin, rows, mb.nrDof()).noalias() +=
-					fullJac_.block(0, 0, rows, mb.nrDof());
+			addSideJacobian(index, cd, csd, mb, mbc, data);
 
 			// BEq = -JD_i*alpha
 			Vector6d normalAcc = csd.jac.normalAcceleration(
@@ -423,7 +503,7 @@ void ContactPosConstr::update(const std::vector<rbd::MultiBody>& mbs,
 		Eigen::Vector6d error;
 		error.head<3>() = sva::rotationVelocity(X_b1cf_b2cf.rotation(), 1e-7);
 		error.tail<3>() = X_b1cf_b2cf.translation();
-		b_.segment(index, rows) += cd.dof*(error/timeStep_);
+		b_.segment(index, rows).noalias() += cd.dof*(error/timeStep_);
 
 		index += rows;
 	}
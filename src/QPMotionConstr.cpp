@@ -19,6 +19,9 @@
 #include "Tasks/QPMotionConstr.h"
 
 // includes
+// std
+#include <algorithm>
+
 // Eigen
 #include <unsupported/Eigen/Polynomials>
 
@@ -45,7 +48,8 @@ PositiveLambda::PositiveLambda():
 	lambdaBegin_(-1),
 	XL_(),
 	XU_(),
-	cont_()
+	cont_(),
+	nrCont_(0)
 { }
 
 
@@ -54,16 +58,23 @@ void PositiveLambda::updateNrVars(const std::vector<rbd::MultiBody>& /* mbs */,
 {
 	lambdaBegin_ = data.lambdaBegin();
 
-	XL_.setConstant(data.totalLambda(), 0.);
-	XU_.setConstant(data.totalLambda(), std::numeric_limits<double>::infinity());
+	// the unused lambda up to the capacity are also bounded
+	int nrLambda = data.nrVars() - data.lambdaBegin();
+	XL_.setConstant(nrLambda, 0.);
+	XU_.setConstant(nrLambda, std::numeric_limits<double>::infinity());
 
-	cont_.clear();
+	// the elements are assigned to reuse their memory
 	const std::vector<BilateralContact>& allC = data.allContacts();
+	nrCont_ = int(allC.size());
+	if(cont_.size() < allC.size())
+	{
+		cont_.resize(allC.size());
+	}
 	for(std::size_t i = 0; i < allC.size(); ++i)
 	{
-		cont_.push_back({allC[i].contactId,
-				data.lambdaBegin(int(i)),
-				allC[i].nrLambda()});
+		cont_[i].cId = allC[i].contactId;
+		cont_[i].lambdaBegin = data.lambdaBegin(int(i));
+		cont_[i].nrLambda = allC[i].nrLambda();
 	}
 }
 
@@ -85,8 +96,9 @@ std::string PositiveLambda::descBound(const std::vector<rbd::MultiBody>& /* mbs
 {
 	std::ostringstream oss;
 
-	for(const ContactData& cd: cont_)
+	for(int i = 0; i < nrCont_; ++i)
 	{
+		const ContactData& cd = cont_[i];
 		int begin = cd.lambdaBegin - lambdaBegin_;
 		int end = begin + cd.nrLambda;
 		if(line >= begin && line < end)
@@ -124,17 +136,29 @@ const Eigen::VectorXd& PositiveLambda::Upper() const
 	*/
 
 
-MotionConstrCommon::ContactData::ContactData(const rbd::MultiBody& mb,
-	const std::string& bName, int lB,
-	std::vector<Eigen::Vector3d> pts,
+MotionConstrCommon::ContactData::ContactData(int bIndex,
+	const ContactId& cId, int lB,
+	const std::vector<Eigen::Vector3d>& pts,
 	const std::vector<FrictionCone>& cones):
-	bodyIndex(),
-	lambdaBegin(lB),
-	jac(mb, bName),
-	points(std::move(pts)),
-	minusGenerators(cones.size())
+	contactId(cId),
+	bodyIndex(bIndex),
+	jacIndex(-1),
+	lambdaBegin(),
+	fallbackJac(),
+	points(),
+	minusGenerators()
 {
-	bodyIndex = jac.jointsPath().back();
+	update(lB, pts, cones);
+}
+
+
+void MotionConstrCommon::ContactData::update(int lB,
+	const std::vector<Eigen::Vector3d>& pts,
+	const std::vector<FrictionCone>& cones)
+{
+	lambdaBegin = lB;
+	points = pts;
+	minusGenerators.resize(cones.size());
 	for(std::size_t i = 0; i < cones.size(); ++i)
 	{
 		minusGenerators[i].resize(3, cones[i].generators.size());
@@ -153,14 +177,18 @@ MotionConstrCommon::MotionConstrCommon(const std::vector<rbd::MultiBody>& mbs,
 	nrDof_(mbs[robotIndex_].nrDof()),
 	lambdaBegin_(-1),
 	fd_(mbs[robotIndex_]),
+	fdIndex_(-1),
+	cacheFd_(),
 	fullJacLambda_(),
 	jacTrans_(6, nrDof_),
 	jacLambda_(),
 	cont_(),
+	nrCont_(0),
 	curTorque_(nrDof_),
 	A_(),
 	AL_(nrDof_),
-	AU_(nrDof_)
+	AU_(nrDof_),
+	AGenInEqBlocks_()
 {
 	assert(std::size_t(robotIndex_) < mbs.size() && robotIndex_ >= 0);
 }
@@ -168,8 +196,9 @@ MotionConstrCommon::MotionConstrCommon(const std::vector<rbd::MultiBody>& mbs,
 
 void MotionConstrCommon::computeTorque(const Eigen::VectorXd& alphaD, const Eigen::VectorXd& lambda)
 {
-	curTorque_ = fd_.H()*alphaD.segment(alphaDBegin_, nrDof_);
-	curTorque_ += fd_.C();
+	const rbd::ForwardDynamics& fd = currentFd();
+	curTorque_ = fd.H()*alphaD.segment(alphaDBegin_, nrDof_);
+	curTorque_ += fd.C();
 	curTorque_ += A_.block(0, lambdaBegin_, nrDof_, A_.cols() - lambdaBegin_)*lambda;
 }
 
@@ -198,6 +227,26 @@ void MotionConstrCommon::torque(const std::vector<rbd::MultiBody>& mbs,
 }
 
 
+void MotionConstrCommon::registerCache(const std::vector<rbd::MultiBody>& mbs,
+	SolverData& data)
+{
+	const rbd::MultiBody& mb = mbs[robotIndex_];
+
+	data.addDynamics(mb, robotIndex_);
+	for(const BilateralContact& c: data.allContacts())
+	{
+		if(robotIndex_ == c.contactId.r1Index)
+		{
+			data.addBodyJacobian(mb, robotIndex_, c.contactId.r1BodyName);
+		}
+		if(robotIndex_ == c.contactId.r2Index)
+		{
+			data.addBodyJacobian(mb, robotIndex_, c.contactId.r2BodyName);
+		}
+	}
+}
+
+
 void MotionConstrCommon::updateNrVars(const std::vector<rbd::MultiBody>& mbs,
 	const SolverData& data)
 {
@@ -205,54 +254,136 @@ void MotionConstrCommon::updateNrVars(const std::vector<rbd::MultiBody>& mbs,
 
 	alphaDBegin_ = data.alphaDBegin(robotIndex_);
 	lambdaBegin_ = data.lambdaBegin();
+	fdIndex_ = data.dynamicsIndex(robotIndex_);
+
+	nrCont_ = 0;
+	auto addContact = [&mb, &data, this](const ContactId& cId,
+		const std::string& bName,
+		int lambdaBegin, const std::vector<Eigen::Vector3d>& points,
+		const std::vector<FrictionCone>& cones)
+	{
+		int bIndex = mb.bodyIndexByName(bName);
+		bool cached = activateCached(cont_, std::size_t(nrCont_),
+			[&cId, bIndex](const ContactData& cd)
+			{
+				return cd.bodyIndex == bIndex && cd.contactId == cId;
+			});
+		if(cached)
+		{
+			cont_[nrCont_].update(lambdaBegin, points, cones);
+		}
+		else
+		{
+			cont_.emplace_back(bIndex, cId, lambdaBegin, points, cones);
+			std::rotate(cont_.begin() + nrCont_, cont_.end() - 1, cont_.end());
+		}
+		// -1 if registerCache has not been called
+		cont_[nrCont_].jacIndex = data.bodyJacobianIndex(robotIndex_, bIndex);
+		++nrCont_;
+	};
 
-	cont_.clear();
+	AGenInEqBlocks_.assign(1, {alphaDBegin_, nrDof_, alphaDBegin_});
 	const auto& cCont = data.allContacts();
 	for(std::size_t i = 0; i < cCont.size(); ++i)
 	{
 		const BilateralContact& c = cCont[i];
 		if(robotIndex_ == c.contactId.r1Index)
 		{
-			cont_.emplace_back(mb, c.contactId.r1BodyName, data.lambdaBegin(int(i)),
+			addContact(c.contactId, c.contactId.r1BodyName, data.lambdaBegin(int(i)),
 				c.r1Points, c.r1Cones);
 		}
 		// we don't use else to manage self contact on the robot
 		if(robotIndex_ == c.contactId.r2Index)
 		{
-			cont_.emplace_back(mb, c.contactId.r2BodyName, data.lambdaBegin(int(i)),
+			addContact(c.contactId, c.contactId.r2BodyName, data.lambdaBegin(int(i)),
 				c.r2Points, c.r2Cones);
 		}
+
+		if(robotIndex_ == c.contactId.r1Index || robotIndex_ == c.contactId.r2Index)
+		{
+			int lambdaBegin = data.lambdaBegin(int(i));
+			AGenInEqBlocks_.emplace_back(lambdaBegin, data.lambda(int(i)), lambdaBegin);
+		}
 	}
+	// a self contact has two sides
+	trimCached(cont_, std::size_t(nrCont_),
+		std::size_t(2*data.contactCapacity()));
 
 	/// @todo don't use nrDof and totalLamdba but max dof of a jacobian
 	/// and max lambda of a contact.
 	A_.setZero(nrDof_, data.nrVars());
-	jacLambda_.resize(data.totalLambda(), nrDof_);
-	fullJacLambda_.resize(data.totalLambda(), nrDof_);
+	// the lambda capacity is used to not resize them at each contact change
+	jacLambda_.resize(data.nrVars() - data.lambdaBegin(), nrDof_);
+	fullJacLambda_.resize(data.nrVars() - data.lambdaBegin(), nrDof_);
 }
 
 
 void MotionConstrCommon::computeMatrix(const std::vector<rbd::MultiBody>& mbs,
 	const std::vector<rbd::MultiBodyConfig>& mbcs)
+{
+	computeMatrix(mbs, mbcs, nullptr);
+}
+
+
+void MotionConstrCommon::computeMatrix(const std::vector<rbd::MultiBody>& mbs,
+	const std::vector<rbd::MultiBodyConfig>& mbcs, const SolverData& data)
+{
+	computeMatrix(mbs, mbcs, &data);
+}
+
+
+void MotionConstrCommon::computeMatrix(const std::vector<rbd::MultiBody>& mbs,
+	const std::vector<rbd::MultiBodyConfig>& mbcs, const SolverData* data)
 {
 	using namespace Eigen;
 
 	const rbd::MultiBody& mb = mbs[robotIndex_];
 	const rbd::MultiBodyConfig& mbc = mbcs[robotIndex_];
 
-	fd_.computeH(mb, mbc);
-	fd_.computeC(mb, mbc);
+	// H and C are shared by all the constraints of the robot when they have
+	// been computed by QPSolver for this cycle
+	if(data && data->dynamicsComputed(fdIndex_, robotIndex_))
+	{
+		if(cacheFd_.get() != &data->forwardDynamics(fdIndex_))
+		{
+			cacheFd_ = data->sharedForwardDynamics(fdIndex_);
+		}
+	}
+	else
+	{
+		cacheFd_.reset();
+		fd_.computeH(mb, mbc);
+		fd_.computeC(mb, mbc);
+	}
+	const rbd::ForwardDynamics& fd = currentFd();
 
 	// tauMin -C <= H*alphaD - J^t G lambda <= tauMax - C
 
 	// fill inertia matrix part
-	A_.block(0, alphaDBegin_, nrDof_, nrDof_) = fd_.H();
+	A_.block(0, alphaDBegin_, nrDof_, nrDof_) = fd.H();
 
-	for(std::size_t i = 0; i < cont_.size(); ++i)
+	for(int i = 0; i < nrCont_; ++i)
 	{
-		const MatrixXd& jac = cont_[i].jac.bodyJacobian(mb, mbc);
-
 		ContactData& cd = cont_[i];
+		// the body Jacobian is shared by all the users of the body
+		const rbd::Jacobian* jac = nullptr;
+		const MatrixXd* bodyJac = nullptr;
+		if(data && data->bodyJacobianComputed(cd.jacIndex, robotIndex_, cd.bodyIndex))
+		{
+			jac = &data->jacobian(cd.jacIndex);
+			bodyJac = &data->bodyJacobian(cd.jacIndex);
+		}
+		else
+		{
+			if(cd.fallbackJac.jointsPath().empty())
+			{
+				cd.fallbackJac = rbd::Jacobian(mb, mb.body(cd.bodyIndex).name());
+			}
+			jac = &cd.fallbackJac;
+			bodyJac = &cd.fallbackJac.bodyJacobian(mb, mbc);
+		}
+		const int dof = jac->dof();
+
 		int lambdaOffset = 0;
 		for(std::size_t j = 0; j < cd.points.size(); ++j)
 		{
@@ -261,12 +392,13 @@ void MotionConstrCommon::computeMatrix(const std::vector<rbd::MultiBody>& mbs,
 			// then we compute the jacobian against lambda J_l = J^T C
 			// to apply fullJacobian on it we must have robot dof on the column so
 			// J_l^T = (J^T C)^T = C^T J
-			cd.jac.translateBodyJacobian(jac, mbc, cd.points[j], jacTrans_);
-			jacLambda_.block(0, 0, nrLambda, cd.jac.dof()).noalias() =
-				(cd.minusGenerators[j].transpose()*jacTrans_.block(3, 0, 3, cd.jac.dof()));
+			jacTrans_.block(3, 0, 3, dof).noalias() =
+				sva::PTransformd(cd.points[j]).matrix().bottomRows<3>()*(*bodyJac);
+			jacLambda_.block(0, 0, nrLambda, dof).noalias() =
+				(cd.minusGenerators[j].transpose()*jacTrans_.block(3, 0, 3, dof));
 
-			cd.jac.fullJacobian(mb,
-				jacLambda_.block(0, 0, nrLambda, cd.jac.dof()),
+			jac->fullJacobian(mb,
+				jacLambda_.block(0, 0, nrLambda, dof),
 				fullJacLambda_);
 
 			A_.block(0, cd.lambdaBegin + lambdaOffset,
@@ -277,8 +409,8 @@ void MotionConstrCommon::computeMatrix(const std::vector<rbd::MultiBody>& mbs,
 	}
 
 	// BEq = -C
-	AL_ = -fd_.C();
-	AU_ = -fd_.C();
+	AL_ = -fd.C();
+	AU_ = -fd.C();
 }
 
 
@@ -294,6 +426,12 @@ const Eigen::MatrixXd& MotionConstrCommon::AGenInEq() const
 }
 
 
+const std::vector<ColBlock>& MotionConstrCommon::AGenInEqBlocks() const
+{
+	return AGenInEqBlocks_;
+}
+
+
 const Eigen::VectorXd& MotionConstrCommon::LowerGenInEq() const
 {
 	return AL_;
@@ -338,9 +476,9 @@ MotionConstr::MotionConstr(const std::vector<rbd::MultiBody>& mbs,
 
 void MotionConstr::update(const std::vector<rbd::MultiBody>& mbs,
 	const std::vector<rbd::MultiBodyConfig>& mbcs,
-	const SolverData& /* data */)
+	const SolverData& data)
 {
-	computeMatrix(mbs, mbcs);
+	computeMatrix(mbs, mbcs, data);
 
 	AL_.head(torqueL_.rows()) += torqueL_;
 	AU_.head(torqueU_.rows()) += torqueU_;
@@ -351,9 +489,14 @@ Eigen::MatrixXd MotionConstr::contactMatrix() const
 	return A_.block(0, nrDof_, A_.rows(), A_.cols() - nrDof_);
 }
 
-const rbd::ForwardDynamics MotionConstr::fd() const
+void MotionConstr::contactMatrix(Eigen::MatrixXd& res) const
+{
+	res = A_.block(0, nrDof_, A_.rows(), A_.cols() - nrDof_);
+}
+
+const rbd::ForwardDynamics& MotionConstr::fd() const
 {
-	return fd_;
+	return currentFd();
 }
 
 /**
@@ -379,11 +522,11 @@ MotionSpringConstr::MotionSpringConstr(
 
 void MotionSpringConstr::update(const std::vector<rbd::MultiBody>& mbs,
 	const std::vector<rbd::MultiBodyConfig>& mbcs,
-	const SolverData& /* data */)
+	const SolverData& data)
 {
 	const rbd::MultiBodyConfig& mbc = mbcs[robotIndex_];
 
-	computeMatrix(mbs, mbcs);
+	computeMatrix(mbs, mbcs, data);
 
 	for(const SpringJointData& sj: springs_)
 	{
@@ -425,12 +568,12 @@ MotionPolyConstr::MotionPolyConstr(const std::vector<rbd::MultiBody>& mbs,
 
 void MotionPolyConstr::update(const std::vector<rbd::MultiBody>& mbs,
 	const std::vector<rbd::MultiBodyConfig>& mbcs,
-	const SolverData& /* data */)
+	const SolverData& data)
 {
 	const rbd::MultiBody& mb = mbs[robotIndex_];
 	const rbd::MultiBodyConfig& mbc = mbcs[robotIndex_];
 
-	computeMatrix(mbs, mbcs);
+	computeMatrix(mbs, mbcs, data);
 
 	for(std::size_t i = 0; i < jointIndex_.size(); ++i)
 	{
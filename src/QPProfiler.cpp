@@ -0,0 +1,142 @@
+// Copyright 2012-2016 CNRS-UM LIRMM, CNRS-AIST JRL
+//
+// This file is part of Tasks.
+//
+// Tasks is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Tasks is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with Tasks.  If not, see <http://www.gnu.org/licenses/>.
+
+// associated header
+#include "Tasks/QPProfiler.h"
+
+// includes
+// std
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+#include <stdexcept>
+
+
+namespace tasks
+{
+
+namespace qp
+{
+
+
+QPProfiler::QPProfiler(int window):
+	phases_(),
+	index_(),
+	window_(std::max(window, 1)),
+	enabled_(false)
+{
+}
+
+
+void QPProfiler::window(int w)
+{
+	window_ = std::max(w, 1);
+	for(Phase& p: phases_)
+	{
+		p.samples.assign(window_, 0.);
+	}
+	reset();
+}
+
+
+void QPProfiler::reset()
+{
+	for(Phase& p: phases_)
+	{
+		p.next = 0;
+		p.count = 0;
+	}
+}
+
+
+int QPProfiler::phase(const std::string& name)
+{
+	auto it = index_.find(name);
+	if(it != index_.end())
+	{
+		return it->second;
+	}
+
+	int index = static_cast<int>(phases_.size());
+	phases_.push_back({name, std::vector<double>(window_, 0.), 0, 0});
+	index_[name] = index;
+	return index;
+}
+
+
+std::vector<std::string> QPProfiler::phases() const
+{
+	std::vector<std::string> names;
+	names.reserve(phases_.size());
+	for(const Phase& p: phases_)
+	{
+		names.push_back(p.name);
+	}
+	return names;
+}
+
+
+void QPProfiler::record(int phase, double duration)
+{
+	Phase& p = phases_[phase];
+	p.samples[p.next] = duration;
+	p.next = (p.next + 1) % window_;
+	p.count = std::min(p.count + 1, window_);
+}
+
+
+QPProfiler::Stats QPProfiler::stats(int phase) const
+{
+	const Phase& p = phases_[phase];
+	Stats s = {p.count, 0., 0., 0., 0., 0.};
+	if(p.count == 0)
+	{
+		return s;
+	}
+
+	s.last = p.samples[(p.next + window_ - 1) % window_];
+
+	// samples are only in [0, count) until the buffer is full
+	std::vector<double> sorted(p.samples.begin(), p.samples.begin() + p.count);
+	std::sort(sorted.begin(), sorted.end());
+	auto rank = [&sorted](double q)
+	{
+		int r = static_cast<int>(std::ceil(q*double(sorted.size()))) - 1;
+		return sorted[std::max(r, 0)];
+	};
+	s.mean = std::accumulate(sorted.begin(), sorted.end(), 0.)/double(p.count);
+	s.p50 = rank(0.5);
+	s.p99 = rank(0.99);
+	s.max = sorted.back();
+	return s;
+}
+
+
+QPProfiler::Stats QPProfiler::stats(const std::string& name) const
+{
+	auto it = index_.find(name);
+	if(it == index_.end())
+	{
+		throw std::domain_error("QPProfiler: unknown phase " + name);
+	}
+	return stats(it->second);
+}
+
+
+} // namespace qp
+
+} // namespace tasks
@@ -0,0 +1,922 @@
+// Copyright 2012-2016 CNRS-UM LIRMM, CNRS-AIST JRL
+//
+// This file is part of Tasks.
+//
+// Tasks is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Tasks is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with Tasks.  If not, see <http://www.gnu.org/licenses/>.
+
+// associated header
+#include "Tasks/QPRecorder.h"
+
+// includes
+// std
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <iomanip>
+#include <limits>
+#include <stdexcept>
+
+// Tasks
+#include "GenQPUtils.h"
+#include "Tasks/QPSolver.h"
+
+
+namespace tasks
+{
+
+namespace qp
+{
+
+
+namespace
+{
+
+struct RecordHeader
+{
+	std::int64_t size;
+	std::int32_t nrVars, nrLines, nrDependencies, status, iterations, key;
+	double updateTime, solveTime;
+};
+
+struct RecordDependency
+{
+	std::int32_t primary, replica;
+	double factor;
+};
+
+const std::size_t fileHeaderSize = 16;
+
+static_assert(sizeof(RecordHeader) == 48, "RecordHeader must be packed");
+static_assert(sizeof(RecordDependency) == 16, "RecordDependency must be packed");
+
+
+/// @return Number of float64 of the arrays of a record but the result.
+std::size_t nrArrayDoubles(std::size_t nrVars, std::size_t nrLines)
+{
+	return (nrVars*(nrVars + 1))/2 + 3*nrVars + nrLines*nrVars + 2*nrLines;
+}
+
+
+template<typename T>
+void appendRaw(std::vector<char>& buffer, const T* data, std::size_t nr)
+{
+	const char* ptr = reinterpret_cast<const char*>(data);
+	buffer.insert(buffer.end(), ptr, ptr + sizeof(T)*nr);
+}
+
+
+template<typename T>
+void writeRaw(std::ofstream& file, const T* data, std::size_t nr)
+{
+	file.write(reinterpret_cast<const char*>(data), sizeof(T)*nr);
+}
+
+
+template<typename T>
+const char* readRaw(const char* ptr, T* data, std::size_t nr)
+{
+	std::memcpy(data, ptr, sizeof(T)*nr);
+	return ptr + sizeof(T)*nr;
+}
+
+
+/**
+	* Decode an array written by QPRecorder::writeArray.
+	* @param set Called with the index and the value of each stored entry.
+	*/
+template<typename Set>
+const char* readArray(const char* ptr, std::int64_t size, Set set)
+{
+	std::int64_t count;
+	ptr = readRaw(ptr, &count, 1);
+	if(count < 0)
+	{
+		const double* values = reinterpret_cast<const double*>(ptr);
+		for(std::int64_t i = 0; i < size; ++i)
+		{
+			set(i, values[i]);
+		}
+		return ptr + sizeof(double)*size;
+	}
+
+	const std::int32_t* indices = reinterpret_cast<const std::int32_t*>(ptr);
+	ptr += sizeof(std::int32_t)*(count + count%2);
+	const double* values = reinterpret_cast<const double*>(ptr);
+	for(std::int64_t i = 0; i < count; ++i)
+	{
+		set(indices[i], values[i]);
+	}
+	return ptr + sizeof(double)*count;
+}
+
+} // anonymous namespace
+
+
+
+/**
+	*													QPRecord
+	*/
+
+
+
+QPRecord::QPRecord():
+	nrVars(0),
+	dependencies(),
+	Q(), C(),
+	A(), AL(), AU(),
+	XL(), XU(),
+	result(),
+	status(QPStatus::Success),
+	iterations(-1),
+	updateTime(0.),
+	solveTime(0.),
+	index(-1)
+{}
+
+
+
+/**
+	*													QPRecorder
+	*/
+
+
+
+const char QPRecorder::magic[8] = {'T', 'A', 'S', 'K', 'S', 'Q', 'P', '\0'};
+const std::int32_t QPRecorder::version = 2;
+
+
+QPRecorder::QPRecorder():
+	file_(),
+	nrRecords_(0),
+	buffer_(),
+	bufferSize_(1 << 20),
+	keyInterval_(100),
+	nrSinceKey_(0),
+	Q_(), C_(),
+	A_(), AL_(), AU_(),
+	XL_(), XU_(),
+	QCache_(new QFillCache),
+	ACache_(new AFillCache),
+	QPacked_(),
+	ALines_(),
+	prev_(),
+	indices_()
+{}
+
+
+// must declare it in cpp because of the fill caches fwd declaration
+QPRecorder::~QPRecorder()
+{
+	close();
+}
+
+
+void QPRecorder::open(const std::string& path)
+{
+	close();
+	file_.open(path, std::ios::binary | std::ios::trunc);
+	if(!file_)
+	{
+		throw std::runtime_error("QPRecorder: can't create " + path);
+	}
+
+	std::int32_t head[2] = {version, 0};
+	writeRaw(file_, magic, 8);
+	writeRaw(file_, head, 2);
+	nrRecords_ = 0;
+	buffer_.clear();
+	buffer_.reserve(bufferSize_);
+
+	// the problem is rebuilt from scratch in the new file
+	Q_.resize(0, 0);
+	A_.resize(0, 0);
+}
+
+
+void QPRecorder::close()
+{
+	if(file_.is_open())
+	{
+		flush();
+		file_.close();
+	}
+}
+
+
+bool QPRecorder::isOpen() const
+{
+	return file_.is_open();
+}
+
+
+void QPRecorder::flush()
+{
+	if(file_.is_open())
+	{
+		writeRaw(file_, buffer_.data(), buffer_.size());
+		file_.flush();
+		buffer_.clear();
+	}
+}
+
+
+void QPRecorder::bufferSize(std::size_t size)
+{
+	bufferSize_ = size;
+	buffer_.reserve(size);
+}
+
+
+std::size_t QPRecorder::bufferSize() const
+{
+	return bufferSize_;
+}
+
+
+void QPRecorder::keyInterval(int interval)
+{
+	keyInterval_ = interval;
+}
+
+
+int QPRecorder::keyInterval() const
+{
+	return keyInterval_;
+}
+
+
+void QPRecorder::record(int nrVars,
+	const std::vector<std::tuple<int, int, double>>& dependencies,
+	const std::vector<Task*>& tasks,
+	const std::vector<Equality*>& eqConstr,
+	const std::vector<Inequality*>& inEqConstr,
+	const std::vector<GenInequality*>& genInEqConstr,
+	const std::vector<Bound*>& boundConstr,
+	const Eigen::VectorXd& result, QPStatus status, int iterations,
+	double updateTime, double solveTime)
+{
+	if(!file_.is_open())
+	{
+		return;
+	}
+
+	int nrLines = 0;
+	for(const Equality* c: eqConstr)
+	{
+		nrLines += c->nrEq();
+	}
+	for(const Inequality* c: inEqConstr)
+	{
+		nrLines += c->nrInEq();
+	}
+	for(const GenInequality* c: genInEqConstr)
+	{
+		nrLines += c->nrGenInEq();
+	}
+
+	// same assembly than the general form backends on the full variables
+	bool key = nrSinceKey_ >= keyInterval_ || nrRecords_ == 0;
+	if(Q_.rows() != nrVars)
+	{
+		Q_.resize(nrVars, nrVars);
+		C_.resize(nrVars);
+		XL_.resize(nrVars);
+		XU_.resize(nrVars);
+		QCache_->reset(nrVars);
+		QPacked_.resize((nrVars*(nrVars + 1))/2);
+		A_.resize(0, 0);
+		key = true;
+	}
+	if(A_.rows() != nrLines)
+	{
+		A_.setZero(nrLines, nrVars);
+		AL_.resize(nrLines);
+		AU_.resize(nrLines);
+		ACache_->reset();
+		key = true;
+	}
+
+	C_.setZero();
+	XL_.fill(-std::numeric_limits<double>::infinity());
+	XU_.fill(std::numeric_limits<double>::infinity());
+
+	ACache_->start();
+	int line = 0;
+	line = fillEq(eqConstr, nrVars, line, *ACache_, A_, AL_, AU_);
+	line = fillInEq(inEqConstr, nrVars, line, *ACache_, A_, AL_, AU_);
+	line = fillGenInEq(genInEqConstr, nrVars, line, *ACache_, A_, AL_, AU_);
+	fillBound(boundConstr, XL_, XU_);
+	fillQC(tasks, nrVars, *QCache_, Q_, C_);
+
+	std::size_t k = 0;
+	for(int i = 0; i < nrVars; ++i)
+	{
+		for(int j = i; j < nrVars; ++j)
+		{
+			QPacked_[k++] = Q_(i, j);
+		}
+	}
+	ALines_ = A_;
+
+	// a key record is stored relatively to zero arrays
+	if(key)
+	{
+		prev_.assign(nrArrayDoubles(nrVars, nrLines), 0.);
+		nrSinceKey_ = 0;
+	}
+	++nrSinceKey_;
+
+	const std::size_t begin = buffer_.size();
+	RecordHeader head;
+	head.size = 0;
+	head.nrVars = nrVars;
+	head.nrLines = nrLines;
+	head.nrDependencies = static_cast<std::int32_t>(dependencies.size());
+	head.status = static_cast<std::int32_t>(status);
+	head.iterations = iterations;
+	head.key = key ? 1 : 0;
+	head.updateTime = updateTime;
+	head.solveTime = solveTime;
+	appendRaw(buffer_, &head, 1);
+
+	for(const std::tuple<int, int, double>& d: dependencies)
+	{
+		RecordDependency rd = {std::get<0>(d), std::get<1>(d), std::get<2>(d)};
+		appendRaw(buffer_, &rd, 1);
+	}
+
+	double* prev = prev_.data();
+	writeArray(QPacked_.data(), prev, QPacked_.size());
+	prev += QPacked_.size();
+	writeArray(C_.data(), prev, nrVars);
+	prev += nrVars;
+	writeArray(ALines_.data(), prev, ALines_.size());
+	prev += ALines_.size();
+	writeArray(AL_.data(), prev, nrLines);
+	prev += nrLines;
+	writeArray(AU_.data(), prev, nrLines);
+	prev += nrLines;
+	writeArray(XL_.data(), prev, nrVars);
+	prev += nrVars;
+	writeArray(XU_.data(), prev, nrVars);
+	appendRaw(buffer_, result.data(), nrVars);
+
+	head.size = static_cast<std::int64_t>(buffer_.size() - begin);
+	std::memcpy(buffer_.data() + begin, &head.size, sizeof(head.size));
+	if(buffer_.size() >= bufferSize_)
+	{
+		flush();
+	}
+
+	++nrRecords_;
+}
+
+
+void QPRecorder::writeArray(const double* cur, double* prev, std::size_t size)
+{
+	indices_.clear();
+	for(std::size_t i = 0; i < size; ++i)
+	{
+		if(!(cur[i] == prev[i]))
+		{
+			indices_.push_back(static_cast<std::int32_t>(i));
+			prev[i] = cur[i];
+		}
+	}
+
+	// an index and a value cost 12 bytes, an entry 8
+	std::int64_t count = static_cast<std::int64_t>(indices_.size());
+	if(3*indices_.size() >= 2*size)
+	{
+		count = -1;
+		appendRaw(buffer_, &count, 1);
+		appendRaw(buffer_, cur, size);
+		return;
+	}
+
+	appendRaw(buffer_, &count, 1);
+	if(indices_.size()%2 != 0)
+	{
+		indices_.push_back(0);
+	}
+	appendRaw(buffer_, indices_.data(), indices_.size());
+	for(std::int64_t i = 0; i < count; ++i)
+	{
+		appendRaw(buffer_, cur + indices_[i], 1);
+	}
+}
+
+
+int QPRecorder::nrRecords() const
+{
+	return nrRecords_;
+}
+
+
+
+/**
+	*													QPRecordReader
+	*/
+
+
+
+QPRecordReader::QPRecordReader():
+	data_(),
+	offsets_(),
+	keys_()
+{}
+
+
+void QPRecordReader::open(const std::string& path)
+{
+	std::ifstream file(path, std::ios::binary | std::ios::ate);
+	if(!file)
+	{
+		throw std::runtime_error("QPRecordReader: can't open " + path);
+	}
+	data_.resize(static_cast<std::size_t>(file.tellg()));
+	file.seekg(0);
+	file.read(data_.data(), static_cast<std::streamsize>(data_.size()));
+
+	std::int32_t head[2] = {0, 0};
+	if(data_.size() < fileHeaderSize ||
+		 std::memcmp(data_.data(), QPRecorder::magic, 8) != 0)
+	{
+		throw std::runtime_error("QPRecordReader: " + path + " is not a record file");
+	}
+	readRaw(data_.data() + 8, head, 2);
+	if(head[0] != QPRecorder::version)
+	{
+		throw std::runtime_error("QPRecordReader: unsupported version of " + path);
+	}
+
+	// a truncated last record (interrupted recording) is ignored
+	offsets_.clear();
+	keys_.clear();
+	std::size_t offset = fileHeaderSize;
+	while(offset + sizeof(RecordHeader) <= data_.size())
+	{
+		RecordHeader rh;
+		readRaw(data_.data() + offset, &rh, 1);
+		if(rh.size < static_cast<std::int64_t>(sizeof(RecordHeader)) ||
+			 offset + static_cast<std::size_t>(rh.size) > data_.size() ||
+			 (keys_.empty() && rh.key == 0))
+		{
+			break;
+		}
+		keys_.push_back(rh.key != 0 ? int(offsets_.size()) : keys_.back());
+		offsets_.push_back(offset);
+		offset += static_cast<std::size_t>(rh.size);
+	}
+}
+
+
+int QPRecordReader::nrRecords() const
+{
+	return static_cast<int>(offsets_.size());
+}
+
+
+void QPRecordReader::read(int i, QPRecord& rec) const
+{
+	const int key = keys_.at(i);
+	const int start = key != i && rec.index == i - 1 ? i : key;
+	for(int r = start; r <= i; ++r)
+	{
+		decode(r, rec);
+	}
+}
+
+
+void QPRecordReader::decode(int i, QPRecord& rec) const
+{
+	const char* ptr = data_.data() + offsets_[i];
+	RecordHeader head;
+	ptr = readRaw(ptr, &head, 1);
+
+	const int n = head.nrVars;
+	const int m = head.nrLines;
+	rec.nrVars = n;
+	rec.status = static_cast<QPStatus>(head.status);
+	rec.iterations = head.iterations;
+	rec.updateTime = head.updateTime;
+	rec.solveTime = head.solveTime;
+	rec.index = i;
+
+	rec.dependencies.resize(head.nrDependencies);
+	for(std::tuple<int, int, double>& d: rec.dependencies)
+	{
+		RecordDependency rd;
+		ptr = readRaw(ptr, &rd, 1);
+		d = std::make_tuple(rd.primary, rd.replica, rd.factor);
+	}
+
+	// the arrays of a key record replace zero arrays
+	if(head.key != 0)
+	{
+		rec.Q.setZero(n, n);
+		rec.C.setZero(n);
+		rec.A.setZero(m, n);
+		rec.AL.setZero(m);
+		rec.AU.setZero(m);
+		rec.XL.setZero(n);
+		rec.XU.setZero(n);
+	}
+
+	// packed upper triangle index to (row, col), the indices are increasing
+	int row = 0, rowStart = 0;
+	ptr = readArray(ptr, (n*(n + 1))/2, [&](std::int64_t k, double v)
+		{
+			while(k >= rowStart + n - row)
+			{
+				rowStart += n - row;
+				++row;
+			}
+			const int col = row + int(k - rowStart);
+			rec.Q(row, col) = v;
+			rec.Q(col, row) = v;
+		});
+	ptr = readArray(ptr, n, [&rec](std::int64_t k, double v) { rec.C(k) = v; });
+	ptr = readArray(ptr, std::int64_t(m)*n, [&rec, n](std::int64_t k, double v)
+		{
+			rec.A(k/n, k%n) = v;
+		});
+	ptr = readArray(ptr, m, [&rec](std::int64_t k, double v) { rec.AL(k) = v; });
+	ptr = readArray(ptr, m, [&rec](std::int64_t k, double v) { rec.AU(k) = v; });
+	ptr = readArray(ptr, n, [&rec](std::int64_t k, double v) { rec.XL(k) = v; });
+	ptr = readArray(ptr, n, [&rec](std::int64_t k, double v) { rec.XU(k) = v; });
+	rec.result.resize(n);
+	readRaw(ptr, rec.result.data(), n);
+}
+
+
+
+/**
+	*													QPReplay
+	*/
+
+
+
+/// Recorded QP given to the backend as a task and constraints.
+struct QPReplay::Problem : public Task, public Equality, public Inequality,
+	public GenInequality, public Bound
+{
+	Problem():
+		Task(1.),
+		dependencies(),
+		tasks({this}),
+		eqConstr({this}),
+		inEqConstr({this}),
+		genInEqConstr({this}),
+		boundConstr({this}),
+		nrVars(-1),
+		Q_(), C_(),
+		AEq_(), AInEq_(), AGenInEq_(),
+		bEq_(), bInEq_(), LGenInEq_(), UGenInEq_(),
+		XL_(), XU_()
+	{}
+
+	/// split the record lines, @return true if the sizes have changed
+	bool set(const QPRecord& rec)
+	{
+		const double inf = std::numeric_limits<double>::infinity();
+		const int n = rec.nrVars;
+		const int m = static_cast<int>(rec.A.rows());
+		int nrEq = 0, nrInEq = 0, nrGenInEq = 0;
+		for(int i = 0; i < m; ++i)
+		{
+			if(rec.AL(i) == rec.AU(i))
+			{
+				++nrEq;
+			}
+			else if(rec.AL(i) == -inf)
+			{
+				++nrInEq;
+			}
+			else
+			{
+				++nrGenInEq;
+			}
+		}
+
+		bool resized = n != nrVars || nrEq != AEq_.rows() ||
+			nrInEq != AInEq_.rows() || nrGenInEq != AGenInEq_.rows() ||
+			rec.dependencies != dependencies;
+		nrVars = n;
+		dependencies = rec.dependencies;
+
+		Q_ = rec.Q;
+		C_ = rec.C;
+		XL_ = rec.XL;
+		XU_ = rec.XU;
+		AEq_.resize(nrEq, n);
+		bEq_.resize(nrEq);
+		AInEq_.resize(nrInEq, n);
+		bInEq_.resize(nrInEq);
+		AGenInEq_.resize(nrGenInEq, n);
+		LGenInEq_.resize(nrGenInEq);
+		UGenInEq_.resize(nrGenInEq);
+
+		int eq = 0, inEq = 0, genInEq = 0;
+		for(int i = 0; i < m; ++i)
+		{
+			if(rec.AL(i) == rec.AU(i))
+			{
+				AEq_.row(eq) = rec.A.row(i);
+				bEq_(eq++) = rec.AU(i);
+			}
+			else if(rec.AL(i) == -inf)
+			{
+				AInEq_.row(inEq) = rec.A.row(i);
+				bInEq_(inEq++) = rec.AU(i);
+			}
+			else
+			{
+				AGenInEq_.row(genInEq) = rec.A.row(i);
+				LGenInEq_(genInEq) = rec.AL(i);
+				UGenInEq_(genInEq++) = rec.AU(i);
+			}
+		}
+		return resized;
+	}
+
+	virtual std::pair<int, int> begin() const override { return {0, 0}; }
+	virtual void updateNrVars(const std::vector<rbd::MultiBody>&,
+		const SolverData&) override {}
+	virtual void update(const std::vector<rbd::MultiBody>&,
+		const std::vector<rbd::MultiBodyConfig>&, const SolverData&) override {}
+	virtual const Eigen::MatrixXd& Q() const override { return Q_; }
+	virtual const Eigen::VectorXd& C() const override { return C_; }
+
+	virtual int maxEq() const override { return int(AEq_.rows()); }
+	virtual int nrEq() const override { return int(AEq_.rows()); }
+	virtual const Eigen::MatrixXd& AEq() const override { return AEq_; }
+	virtual const Eigen::VectorXd& bEq() const override { return bEq_; }
+	virtual std::string nameEq() const override { return "QPReplay"; }
+	virtual std::string descEq(const std::vector<rbd::MultiBody>&,
+		int i) override { return "equality line " + std::to_string(i); }
+
+	virtual int maxInEq() const override { return int(AInEq_.rows()); }
+	virtual int nrInEq() const override { return int(AInEq_.rows()); }
+	virtual const Eigen::MatrixXd& AInEq() const override { return AInEq_; }
+	virtual const Eigen::VectorXd& bInEq() const override { return bInEq_; }
+	virtual std::string nameInEq() const override { return "QPReplay"; }
+	virtual std::string descInEq(const std::vector<rbd::MultiBody>&,
+		int i) override { return "inequality line " + std::to_string(i); }
+
+	virtual int maxGenInEq() const override { return int(AGenInEq_.rows()); }
+	virtual int nrGenInEq() const override { return int(AGenInEq_.rows()); }
+	virtual const Eigen::MatrixXd& AGenInEq() const override { return AGenInEq_; }
+	virtual const Eigen::VectorXd& LowerGenInEq() const override { return LGenInEq_; }
+	virtual const Eigen::VectorXd& UpperGenInEq() const override { return UGenInEq_; }
+	virtual std::string nameGenInEq() const override { return "QPReplay"; }
+	virtual std::string descGenInEq(const std::vector<rbd::MultiBody>&,
+		int i) override { return "general inequality line " + std::to_string(i); }
+
+	virtual int beginVar() const override { return 0; }
+	virtual const Eigen::VectorXd& Lower() const override { return XL_; }
+	virtual const Eigen::VectorXd& Upper() const override { return XU_; }
+	virtual std::string nameBound() const override { return "QPReplay"; }
+	virtual std::string descBound(const std::vector<rbd::MultiBody>&,
+		int i) override { return "variable " + std::to_string(i); }
+
+	std::vector<std::tuple<int, int, double>> dependencies;
+	std::vector<Task*> tasks;
+	std::vector<Equality*> eqConstr;
+	std::vector<Inequality*> inEqConstr;
+	std::vector<GenInequality*> genInEqConstr;
+	std::vector<Bound*> boundConstr;
+	int nrVars;
+
+	Eigen::MatrixXd Q_;
+	Eigen::VectorXd C_;
+	Eigen::MatrixXd AEq_, AInEq_, AGenInEq_;
+	Eigen::VectorXd bEq_, bInEq_, LGenInEq_, UGenInEq_;
+	Eigen::VectorXd XL_, XU_;
+};
+
+
+QPReplay::QPReplay(const std::string& solverName):
+	solver_(createQPSolver(solverName)),
+	problem_(new Problem),
+	updateTime_(0.),
+	solveTime_(0.)
+{}
+
+
+// must declare it in cpp because of Problem fwd declaration
+QPReplay::~QPReplay()
+{}
+
+
+bool QPReplay::solve(const QPRecord& rec)
+{
+	typedef std::chrono::steady_clock Clock;
+	Problem& p = *problem_;
+
+	if(p.set(rec))
+	{
+		solver_->setDependencies(p.nrVars, p.dependencies);
+		solver_->updateSize(p.nrVars, p.maxEq(), p.maxInEq(), p.maxGenInEq());
+	}
+
+	Clock::time_point start = Clock::now();
+	solver_->updateMatrix(p.tasks, p.eqConstr, p.inEqConstr, p.genInEqConstr,
+		p.boundConstr);
+	Clock::time_point solveStart = Clock::now();
+	bool success = solver_->solve();
+	Clock::time_point end = Clock::now();
+
+	updateTime_ = std::chrono::duration<double>(solveStart - start).count();
+	solveTime_ = std::chrono::duration<double>(end - solveStart).count();
+	return success;
+}
+
+
+const Eigen::VectorXd& QPReplay::result() const
+{
+	return solver_->result();
+}
+
+
+double QPReplay::updateTime() const
+{
+	return updateTime_;
+}
+
+
+double QPReplay::solveTime() const
+{
+	return solveTime_;
+}
+
+
+GenQPSolver& QPReplay::solver()
+{
+	return *solver_;
+}
+
+
+
+/**
+	*													writeQPS
+	*/
+
+
+
+std::ostream& writeQPS(const QPRecord& rec, const std::string& name,
+	std::ostream& out)
+{
+	const double inf = std::numeric_limits<double>::infinity();
+	const int n = rec.nrVars;
+	const int m = static_cast<int>(rec.A.rows());
+	const int nrDeps = static_cast<int>(rec.dependencies.size());
+
+	auto var = [](int j) { return "x" + std::to_string(j); };
+	auto row = [](int i) { return "c" + std::to_string(i); };
+	auto dep = [](int k) { return "d" + std::to_string(k); };
+
+	// E: L = U, L: only U, G: only L or both (with a range), N: free line
+	std::vector<char> type(m, 'N');
+	for(int i = 0; i < m; ++i)
+	{
+		if(rec.AL(i) == rec.AU(i))
+		{
+			type[i] = 'E';
+		}
+		else if(rec.AL(i) == -inf && rec.AU(i) != inf)
+		{
+			type[i] = 'L';
+		}
+		else if(rec.AL(i) != -inf)
+		{
+			type[i] = 'G';
+		}
+	}
+
+	out << std::setprecision(17);
+	out << "NAME " << name << "\n";
+	out << "ROWS\n";
+	out << " N obj\n";
+	for(int i = 0; i < m; ++i)
+	{
+		if(type[i] != 'N')
+		{
+			out << " " << type[i] << " " << row(i) << "\n";
+		}
+	}
+	for(int k = 0; k < nrDeps; ++k)
+	{
+		out << " E " << dep(k) << "\n";
+	}
+
+	out << "COLUMNS\n";
+	for(int j = 0; j < n; ++j)
+	{
+		if(rec.C(j) != 0.)
+		{
+			out << " " << var(j) << " obj " << rec.C(j) << "\n";
+		}
+		for(int i = 0; i < m; ++i)
+		{
+			if(type[i] != 'N' && rec.A(i, j) != 0.)
+			{
+				out << " " << var(j) << " " << row(i) << " " << rec.A(i, j) << "\n";
+			}
+		}
+		// replica - factor*primary = 0
+		for(int k = 0; k < nrDeps; ++k)
+		{
+			const std::tuple<int, int, double>& d = rec.dependencies[k];
+			if(std::get<1>(d) == j)
+			{
+				out << " " << var(j) << " " << dep(k) << " 1\n";
+			}
+			if(std::get<0>(d) == j)
+			{
+				out << " " << var(j) << " " << dep(k) << " " << -std::get<2>(d) << "\n";
+			}
+		}
+	}
+
+	out << "RHS\n";
+	for(int i = 0; i < m; ++i)
+	{
+		double rhs = type[i] == 'L' ? rec.AU(i) : rec.AL(i);
+		if(type[i] != 'N' && rhs != 0.)
+		{
+			out << " rhs " << row(i) << " " << rhs << "\n";
+		}
+	}
+
+	out << "RANGES\n";
+	for(int i = 0; i < m; ++i)
+	{
+		if(type[i] == 'G' && rec.AU(i) != inf)
+		{
+			out << " rng " << row(i) << " " << rec.AU(i) - rec.AL(i) << "\n";
+		}
+	}
+
+	// the default MPS bounds are [0, inf]
+	out << "BOUNDS\n";
+	for(int j = 0; j < n; ++j)
+	{
+		const double l = rec.XL(j);
+		const double u = rec.XU(j);
+		if(l == u)
+		{
+			out << " FX bnd " << var(j) << " " << l << "\n";
+			continue;
+		}
+		if(l == -inf && u == inf)
+		{
+			out << " FR bnd " << var(j) << "\n";
+			continue;
+		}
+		if(l == -inf)
+		{
+			out << " MI bnd " << var(j) << "\n";
+		}
+		else
+		{
+			out << " LO bnd " << var(j) << " " << l << "\n";
+		}
+		if(u != inf)
+		{
+			out << " UP bnd " << var(j) << " " << u << "\n";
+		}
+	}
+
+	// lower triangle of Q
+	out << "QUADOBJ\n";
+	for(int j = 0; j < n; ++j)
+	{
+		for(int i = j; i < n; ++i)
+		{
+			if(rec.Q(i, j) != 0.)
+			{
+				out << " " << var(j) << " " << var(i) << " " << rec.Q(i, j) << "\n";
+			}
+		}
+	}
+	out << "ENDATA" << std::endl;
+
+	return out;
+}
+
+
+} // namespace qp
+
+} // namespace tasks
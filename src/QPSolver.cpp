@@ -21,10 +21,18 @@
 // includes
 // std
 #include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <functional>
 #include <iostream>
 #include <limits>
 #include <numeric>
 #include <cmath>
+#include <stdexcept>
+#include <typeinfo>
+
+// boost
+#include <boost/core/demangle.hpp>
 
 // RBDyn
 #include <RBDyn/MultiBody.h>
@@ -32,6 +40,9 @@
 
 // Tasks
 #include "Tasks/GenQPSolver.h"
+#include "Tasks/QPRecorder.h"
+#include "DecomposedQPSolver.h"
+#include "WorkerPool.h"
 
 
 namespace tasks
@@ -58,12 +69,52 @@ QPSolver::QPSolver():
 	maxEqLines_(0),
 	maxInEqLines_(0),
 	maxGenInEqLines_(0),
-	solver_(createQPSolver(GenQPSolver::default_qp_solver))
+	capacity_(),
+	solver_(createQPSolver(defaultSolver())),
+	solverName_(defaultSolver()),
+	solverMaxIter_(-1),
+	recorder_(nullptr),
+	solverTimeBudget_(std::numeric_limits<double>::infinity()),
+	solverStatus_(QPStatus::Success),
+	solverFallback_(false),
+	lastResult_(),
+	fallbackResult_(),
+	dependencies_(),
+	newDependencies_(),
+	decompose_(false),
+	varComponents_(),
+	nrComponents_(1),
+	componentsDirty_(false),
+	decomposedSolver_(nullptr),
+	componentParent_(),
+	varRobot_(),
+	rootComponent_(),
+	newVarComponents_(),
+	layoutKey_(),
+	layouts_(),
+	backendCacheSize_(0),
+	backendCacheHits_(0),
+	backendCacheMisses_(0),
+	backendSwapped_(false),
+	pool_(),
+	taskGroups_(),
+	jobs_(),
+	jobTasks_(),
+	jobsDirty_(true),
+	profiler_(),
+	normalAccBPhase_(profiler_.phase("computeNormalAccB")),
+	updatePhase_(profiler_.phase("update")),
+	updateMatrixPhase_(profiler_.phase("updateMatrix")),
+	solvePhase_(profiler_.phase("solve")),
+	totalPhase_(profiler_.phase("total")),
+	constrPhases_(),
+	taskPhases_(),
+	phasesDirty_(true)
 {
 }
 
 
-// must declare it in cpp because of GenQPSolver fwd declarition
+// must declare it in cpp because of GenQPSolver and WorkerPool fwd declarition
 QPSolver::~QPSolver()
 {}
 
@@ -73,7 +124,9 @@ bool QPSolver::solve(const std::vector<rbd::MultiBody>& mbs,
 {
 	bool success = solveNoMbcUpdate(mbs, mbcs);
 
-	postUpdate(mbs, mbcs, success);
+	// an interrupted solve give the last feasible iterate or the fallback
+	postUpdate(mbs, mbcs, success || solverStatus_ == QPStatus::MaxIter ||
+		solverStatus_ == QPStatus::Timeout);
 
 	return success;
 }
@@ -82,14 +135,63 @@ bool QPSolver::solve(const std::vector<rbd::MultiBody>& mbs,
 bool QPSolver::solveNoMbcUpdate(const std::vector<rbd::MultiBody>& mbs,
 	const std::vector<rbd::MultiBodyConfig>& mbcs)
 {
+	const bool profile = profiler_.enabled();
+	const bool budget = std::isfinite(solverTimeBudget_);
+	const bool record = recorder_ != nullptr;
+	QPProfiler::Clock::time_point start;
+	if(profile || budget || record)
+	{
+		start = QPProfiler::Clock::now();
+	}
+	if(budget)
+	{
+		solver_->deadline(start +
+			std::chrono::duration_cast<GenQPSolver::Clock::duration>(
+				std::chrono::duration<double>(solverTimeBudget_)));
+	}
+
 	solverAndBuildTimer_.start();
 	preUpdate(mbs, mbcs);
 
-	solverTimer_.start();
-	bool success = solver_->solve();
-	solverTimer_.stop();
+	QPProfiler::Clock::time_point solveStart, solveEnd;
+	if(profile || record)
+	{
+		solveStart = QPProfiler::Clock::now();
+	}
+	bool success = false;
+	if(!budget || GenQPSolver::Clock::now() < solver_->deadline())
+	{
+		solverTimer_.start();
+		success = solver_->solve();
+		solverTimer_.stop();
+		solverStatus_ = solver_->status();
+	}
+	else
+	{
+		solverStatus_ = QPStatus::Timeout;
+	}
+	if(profile || record)
+	{
+		solveEnd = QPProfiler::Clock::now();
+	}
+	if(profile)
+	{
+		profiler_.record(solvePhase_, std::chrono::duration<double>(
+			solveEnd - solveStart).count());
+	}
+
+	solverFallback_ = false;
+	if(success || (solverStatus_ != QPStatus::Failure && solver_->feasibleIterate()))
+	{
+		lastResult_ = solver_->result();
+	}
+	else
+	{
+		computeFallback();
+	}
 
-	if(!success)
+	// budget overruns are expected in real time loops
+	if(solverStatus_ == QPStatus::Failure)
 	{
 		solver_->errorMsg(mbs,
 											tasks_, eqConstr_, inEqConstr_,
@@ -97,6 +199,19 @@ bool QPSolver::solveNoMbcUpdate(const std::vector<rbd::MultiBody>& mbs,
 											std::cerr) << std::endl;
 	}
 	solverAndBuildTimer_.stop();
+	if(profile)
+	{
+		profiler_.record(totalPhase_, start);
+	}
+
+	if(record)
+	{
+		recorder_->record(data_.nrVars_, dependencies_, tasks_, eqConstr_,
+			inEqConstr_, genInEqConstr_, boundConstr_, result(), solverStatus_,
+			solver_->iterations(),
+			std::chrono::duration<double>(solveStart - start).count(),
+			std::chrono::duration<double>(solveEnd - solveStart).count());
+	}
 
 	return success;
 }
@@ -105,7 +220,7 @@ bool QPSolver::solveNoMbcUpdate(const std::vector<rbd::MultiBody>& mbs,
 void QPSolver::updateMbc(rbd::MultiBodyConfig& mbc, int rI) const
 {
 	rbd::vectorToParam(
-		solver_->result().segment(data_.alphaDBegin_[rI], data_.alphaD_[rI]),
+		result().segment(data_.alphaDBegin_[rI], data_.alphaD_[rI]),
 		mbc.alphaD);
 }
 
@@ -119,14 +234,67 @@ int accumMaxLines(int acc, T* constr)
 
 void QPSolver::updateConstrSize()
 {
-	maxEqLines_ = std::accumulate(eqConstr_.begin(), eqConstr_.end(), 0,
+	int eqLines = std::max(capacity_.nrEqLines,
+		std::accumulate(eqConstr_.begin(), eqConstr_.end(), 0,
+			accumMaxLines<Equality>));
+	int inEqLines = std::max(capacity_.nrInEqLines,
+		std::accumulate(inEqConstr_.begin(), inEqConstr_.end(), 0,
+			accumMaxLines<Inequality>));
+	int genInEqLines = std::max(capacity_.nrGenInEqLines,
+		std::accumulate(genInEqConstr_.begin(), genInEqConstr_.end(), 0,
+			accumMaxLines<GenInequality>));
+
+	// a backend swapped in from the cache keep its size while the lines fit,
+	// resizing it would drop its workspace and warm start
+	bool fit = backendSwapped_ && eqLines <= maxEqLines_ &&
+		inEqLines <= maxInEqLines_ && genInEqLines <= maxGenInEqLines_;
+	backendSwapped_ = false;
+	if(fit)
+	{
+		return;
+	}
+
+	maxEqLines_ = eqLines;
+	maxInEqLines_ = inEqLines;
+	maxGenInEqLines_ = genInEqLines;
+	solver_->updateSize(data_.nrVars_, maxEqLines_, maxInEqLines_, maxGenInEqLines_);
+}
+
+
+void QPSolver::growConstrSize()
+{
+	int eqLines = std::accumulate(eqConstr_.begin(), eqConstr_.end(), 0,
 		accumMaxLines<Equality>);
-	maxInEqLines_ = std::accumulate(inEqConstr_.begin(), inEqConstr_.end(), 0,
+	int inEqLines = std::accumulate(inEqConstr_.begin(), inEqConstr_.end(), 0,
 		accumMaxLines<Inequality>);
-	maxGenInEqLines_ = std::accumulate(genInEqConstr_.begin(), genInEqConstr_.end(),
-		0, accumMaxLines<GenInequality>);
+	int genInEqLines = std::accumulate(genInEqConstr_.begin(),
+		genInEqConstr_.end(), 0, accumMaxLines<GenInequality>);
 
-	solver_->updateSize(data_.nrVars_, maxEqLines_, maxInEqLines_, maxGenInEqLines_);
+	// the solver keep its size while the lines fit
+	if(eqLines > maxEqLines_ || inEqLines > maxInEqLines_ ||
+		 genInEqLines > maxGenInEqLines_)
+	{
+		maxEqLines_ = std::max({maxEqLines_, eqLines, capacity_.nrEqLines});
+		maxInEqLines_ = std::max({maxInEqLines_, inEqLines, capacity_.nrInEqLines});
+		maxGenInEqLines_ = std::max({maxGenInEqLines_, genInEqLines,
+			capacity_.nrGenInEqLines});
+		solver_->updateSize(data_.nrVars_, maxEqLines_, maxInEqLines_,
+			maxGenInEqLines_);
+		backendSwapped_ = false;
+	}
+}
+
+
+/// Copy an unilateral contact in bc like BilateralContact(c) but reuse its memory.
+static void assignContact(BilateralContact& bc, const UnilateralContact& c)
+{
+	bc.contactId = c.contactId;
+	bc.r1Points = c.r1Points;
+	bc.r2Points = c.r2Points;
+	bc.r1Cones.assign(c.r1Points.size(), c.r1Cone);
+	bc.r2Cones.assign(c.r1Points.size(), c.r2Cone);
+	bc.X_b1_b2 = c.X_b1_b2;
+	bc.X_b1_cf = c.X_b1_cf;
 }
 
 
@@ -134,7 +302,31 @@ void QPSolver::nrVars(const std::vector<rbd::MultiBody>& mbs,
 	std::vector<UnilateralContact> uni,
 	std::vector<BilateralContact> bi)
 {
-	std::vector<std::tuple<int, int, double>> dependencies;
+	const int oldNrVars = data_.nrVars_;
+	newDependencies_.clear();
+
+	// the kinematics and dynamics caches are kept while the robots don't change
+	bool sameRobots = data_.alphaD_.size() == mbs.size();
+	for(std::size_t r = 0; sameRobots && r < mbs.size(); ++r)
+	{
+		sameRobots = data_.alphaD_[r] == mbs[r].nrDof() &&
+			int(data_.normalAccB_[r].size()) == mbs[r].nrBodies();
+	}
+	if(!sameRobots)
+	{
+		data_.bodyJac_.clear();
+		data_.dynamics_.clear();
+	}
+	// registered again by the tasks and constraints
+	for(SolverData::BodyJacobian& bj: data_.bodyJac_)
+	{
+		bj.used = false;
+	}
+	for(SolverData::RobotDynamics& rd: data_.dynamics_)
+	{
+		rd.used = false;
+	}
+
 	data_.alphaD_.resize(mbs.size());
 	data_.alphaDBegin_.resize(mbs.size());
 
@@ -142,10 +334,35 @@ void QPSolver::nrVars(const std::vector<rbd::MultiBody>& mbs,
 	data_.biCont_ = std::move(bi);
 
 	int nrContacts = data_.nrContacts();
+	data_.contactCapacity_ = std::max(nrContacts, capacity_.nrContacts);
 
+	// the contact vectors are only reallocated above the capacity
+	data_.lambda_.reserve(capacity_.nrContacts);
+	data_.lambdaBegin_.reserve(capacity_.nrContacts);
+	data_.allCont_.reserve(capacity_.nrContacts);
+	data_.spareCont_.reserve(capacity_.nrContacts);
 	data_.lambda_.resize(nrContacts);
 	data_.lambdaBegin_.resize(nrContacts);
 
+	// the removed contacts are kept to be assigned again without allocation
+	while(int(data_.allCont_.size()) > nrContacts)
+	{
+		data_.spareCont_.push_back(std::move(data_.allCont_.back()));
+		data_.allCont_.pop_back();
+	}
+	while(int(data_.allCont_.size()) < nrContacts)
+	{
+		if(data_.spareCont_.empty())
+		{
+			data_.allCont_.emplace_back();
+		}
+		else
+		{
+			data_.allCont_.push_back(std::move(data_.spareCont_.back()));
+			data_.spareCont_.pop_back();
+		}
+	}
+
 	data_.mobileRobotIndex_.clear();
 	data_.normalAccB_.resize(mbs.size());
 
@@ -165,7 +382,7 @@ void QPSolver::nrVars(const std::vector<rbd::MultiBody>& mbs,
 			{
 				if(j.isMimic())
 				{
-					dependencies.emplace_back(data_.alphaDBegin_[r] + mb.jointPosInDof(mb.jointIndexByName(j.mimicName())),
+					newDependencies_.emplace_back(data_.alphaDBegin_[r] + mb.jointPosInDof(mb.jointIndexByName(j.mimicName())),
 																		data_.alphaDBegin_[r] + mb.jointPosInDof(mb.jointIndexByName(j.name())),
 																		j.mimicMultiplier());
 				}
@@ -176,7 +393,6 @@ void QPSolver::nrVars(const std::vector<rbd::MultiBody>& mbs,
 
 	int cumLambda = cumAlphaD;
 	int cIndex = 0;
-	data_.allCont_.clear();
 	// counting unilateral contact
 	for(const UnilateralContact& c: data_.uniCont_)
 	{
@@ -188,9 +404,9 @@ void QPSolver::nrVars(const std::vector<rbd::MultiBody>& mbs,
 		}
 		data_.lambda_[cIndex] = lambda;
 		cumLambda += lambda;
-		++cIndex;
 
-		data_.allCont_.emplace_back(c);
+		assignContact(data_.allCont_[cIndex], c);
+		++cIndex;
 	}
 	data_.nrUniLambda_ = cumLambda - cumAlphaD;
 
@@ -205,27 +421,47 @@ void QPSolver::nrVars(const std::vector<rbd::MultiBody>& mbs,
 		}
 		data_.lambda_[cIndex] = lambda;
 		cumLambda += lambda;
-		++cIndex;
 
-		data_.allCont_.emplace_back(c);
+		data_.allCont_[cIndex] = c;
+		++cIndex;
 	}
 	data_.nrBiLambda_ = cumLambda - data_.nrUniLambda_ - cumAlphaD;
 
 	data_.totalLambda_ = data_.nrUniLambda_ + data_.nrBiLambda_;
-	data_.nrVars_ = data_.totalAlphaD_ + data_.totalLambda_;
+	// unused lambda variables up to the capacity keep the number of variables
+	data_.nrVars_ = data_.totalAlphaD_ +
+		std::max(data_.totalLambda_, capacity_.nrLambda);
 
-	for(Task* t: tasks_)
+	updateNrVars(mbs);
+
+	bool sameVars = data_.nrVars_ == oldNrVars &&
+		newDependencies_ == dependencies_;
+	dependencies_.swap(newDependencies_);
+	componentsDirty_ = false;
+	if(backendCacheSize_ > 0 && swapLayout())
 	{
-		t->updateNrVars(mbs, data_);
+		return;
 	}
-
-	for(Constraint* c: constr_)
+	// the backend is resized below for a layout that is not cached
+	if(backendCacheSize_ == 0)
 	{
-		c->updateNrVars(mbs, data_);
+		layoutKey_ = LayoutKey();
 	}
 
-	solver_->setDependencies(data_.nrVars_, dependencies);
-	solver_->updateSize(data_.nrVars_, maxEqLines_, maxInEqLines_, maxGenInEqLines_);
+	if(updateComponents() && decompose_)
+	{
+		bool warm = solver_->warmStart();
+		resetSolver();
+		solver_->warmStart(warm);
+	}
+	else if(!sameVars)
+	{
+		solver_->setDependencies(data_.nrVars_, dependencies_);
+		solver_->updateSize(data_.nrVars_, maxEqLines_, maxInEqLines_, maxGenInEqLines_);
+		backendSwapped_ = false;
+	}
+	// else the contact change is handled by the solver caches
+	// and the new lines by growConstrSize
 }
 
 
@@ -235,25 +471,140 @@ int QPSolver::nrVars() const
 }
 
 
-void QPSolver::updateTasksNrVars(const std::vector<rbd::MultiBody>& mbs) const
+void QPSolver::capacity(const QPCapacity& c)
+{
+	capacity_ = c;
+}
+
+
+const QPCapacity& QPSolver::capacity() const
+{
+	return capacity_;
+}
+
+
+template<typename T>
+static typename std::vector<T>::iterator findContact(std::vector<T>& contacts,
+	const ContactId& contactId)
+{
+	return std::find_if(contacts.begin(), contacts.end(),
+		[&contactId](const T& c)
+		{
+			return c.contactId == contactId;
+		});
+}
+
+
+bool QPSolver::addContact(const std::vector<rbd::MultiBody>& mbs,
+	const UnilateralContact& contact)
+{
+	if(findContact(data_.uniCont_, contact.contactId) != data_.uniCont_.end() ||
+		 findContact(data_.biCont_, contact.contactId) != data_.biCont_.end())
+	{
+		return false;
+	}
+
+	// the current lists are moved to not be copied
+	std::vector<UnilateralContact> uni(std::move(data_.uniCont_));
+	uni.push_back(contact);
+	nrVars(mbs, std::move(uni), std::move(data_.biCont_));
+	return true;
+}
+
+
+bool QPSolver::addContact(const std::vector<rbd::MultiBody>& mbs,
+	const BilateralContact& contact)
+{
+	if(findContact(data_.uniCont_, contact.contactId) != data_.uniCont_.end() ||
+		 findContact(data_.biCont_, contact.contactId) != data_.biCont_.end())
+	{
+		return false;
+	}
+
+	std::vector<BilateralContact> bi(std::move(data_.biCont_));
+	bi.push_back(contact);
+	nrVars(mbs, std::move(data_.uniCont_), std::move(bi));
+	return true;
+}
+
+
+bool QPSolver::removeContact(const std::vector<rbd::MultiBody>& mbs,
+	const ContactId& contactId)
+{
+	auto uniIt = findContact(data_.uniCont_, contactId);
+	if(uniIt != data_.uniCont_.end())
+	{
+		data_.uniCont_.erase(uniIt);
+	}
+	else
+	{
+		auto biIt = findContact(data_.biCont_, contactId);
+		if(biIt == data_.biCont_.end())
+		{
+			return false;
+		}
+		data_.biCont_.erase(biIt);
+	}
+
+	nrVars(mbs, std::move(data_.uniCont_), std::move(data_.biCont_));
+	return true;
+}
+
+
+void QPSolver::backendCacheSize(int size)
+{
+	backendCacheSize_ = std::max(size, 0);
+	while(int(layouts_.size()) > backendCacheSize_)
+	{
+		layouts_.pop_back();
+	}
+	// nrVars don't keep the key of the current backend without cache
+	if(backendCacheSize_ == 0)
+	{
+		layoutKey_ = LayoutKey();
+	}
+}
+
+
+int QPSolver::backendCacheSize() const
+{
+	return backendCacheSize_;
+}
+
+
+int QPSolver::backendCacheHits() const
+{
+	return backendCacheHits_;
+}
+
+
+int QPSolver::backendCacheMisses() const
+{
+	return backendCacheMisses_;
+}
+
+
+void QPSolver::updateTasksNrVars(const std::vector<rbd::MultiBody>& mbs)
 {
 	for(Task* t: tasks_)
 	{
+		t->registerCache(mbs, data_);
 		t->updateNrVars(mbs, data_);
 	}
 }
 
 
-void QPSolver::updateConstrsNrVars(const std::vector<rbd::MultiBody>& mbs) const
+void QPSolver::updateConstrsNrVars(const std::vector<rbd::MultiBody>& mbs)
 {
 	for(Constraint* c: constr_)
 	{
+		c->registerCache(mbs, data_);
 		c->updateNrVars(mbs, data_);
 	}
 }
 
 
-void QPSolver::updateNrVars(const std::vector<rbd::MultiBody>& mbs) const
+void QPSolver::updateNrVars(const std::vector<rbd::MultiBody>& mbs)
 {
 	updateTasksNrVars(mbs);
 	updateConstrsNrVars(mbs);
@@ -263,12 +614,14 @@ void QPSolver::updateNrVars(const std::vector<rbd::MultiBody>& mbs) const
 void QPSolver::addEqualityConstraint(Equality* co)
 {
 	eqConstr_.push_back(co);
+	componentsDirty_ = true;
 }
 
 
 void QPSolver::removeEqualityConstraint(Equality* co)
 {
 	eqConstr_.erase(std::find(eqConstr_.begin(), eqConstr_.end(), co));
+	componentsDirty_ = true;
 }
 
 
@@ -281,12 +634,14 @@ int QPSolver::nrEqualityConstraints() const
 void QPSolver::addInequalityConstraint(Inequality* co)
 {
 	inEqConstr_.push_back(co);
+	componentsDirty_ = true;
 }
 
 
 void QPSolver::removeInequalityConstraint(Inequality* co)
 {
 	inEqConstr_.erase(std::find(inEqConstr_.begin(), inEqConstr_.end(), co));
+	componentsDirty_ = true;
 }
 
 
@@ -299,12 +654,14 @@ int QPSolver::nrInequalityConstraints() const
 void QPSolver::addGenInequalityConstraint(GenInequality* co)
 {
 	genInEqConstr_.push_back(co);
+	componentsDirty_ = true;
 }
 
 
 void QPSolver::removeGenInequalityConstraint(GenInequality* co)
 {
 	genInEqConstr_.erase(std::find(genInEqConstr_.begin(), genInEqConstr_.end(), co));
+	componentsDirty_ = true;
 }
 
 
@@ -337,6 +694,8 @@ void QPSolver::addConstraint(Constraint* co)
 	if(std::find(constr_.begin(), constr_.end(), co) == constr_.end())
 	{
 		constr_.push_back(co);
+		jobsDirty_ = true;
+		phasesDirty_ = true;
 	}
 }
 
@@ -347,9 +706,12 @@ void QPSolver::addConstraint(const std::vector<rbd::MultiBody>& mbs,
 	if(std::find(constr_.begin(), constr_.end(), co) == constr_.end())
 	{
 		constr_.push_back(co);
+		jobsDirty_ = true;
+		phasesDirty_ = true;
 		// check if nrVars has been call at least one
 		if(data_.nrVars_ > 0)
 		{
+			co->registerCache(mbs, data_);
 			co->updateNrVars(mbs, data_);
 		}
 	}
@@ -362,6 +724,8 @@ void QPSolver::removeConstraint(Constraint* co)
 	if(it != constr_.end())
 	{
 		constr_.erase(it);
+		jobsDirty_ = true;
+		phasesDirty_ = true;
 	}
 }
 
@@ -376,6 +740,9 @@ void QPSolver::addTask(Task* task)
 	if(std::find(tasks_.begin(), tasks_.end(), task) == tasks_.end())
 	{
 		tasks_.push_back(task);
+		jobsDirty_ = true;
+		phasesDirty_ = true;
+		componentsDirty_ = true;
 	}
 }
 
@@ -385,9 +752,13 @@ void QPSolver::addTask(const std::vector<rbd::MultiBody>& mbs, Task* task)
 	if(std::find(tasks_.begin(), tasks_.end(), task) == tasks_.end())
 	{
 		tasks_.push_back(task);
+		jobsDirty_ = true;
+		phasesDirty_ = true;
+		componentsDirty_ = true;
 		// check if nrVars has been call at least one
 		if(data_.nrVars_ > 0)
 		{
+			task->registerCache(mbs, data_);
 			task->updateNrVars(mbs, data_);
 		}
 	}
@@ -400,6 +771,10 @@ void QPSolver::removeTask(Task* task)
 	if(it != tasks_.end())
 	{
 		tasks_.erase(it);
+		taskGroups_.erase(task);
+		jobsDirty_ = true;
+		phasesDirty_ = true;
+		componentsDirty_ = true;
 	}
 }
 
@@ -410,131 +785,1052 @@ int QPSolver::nrTasks() const
 }
 
 
+void QPSolver::nrThreads(int nrThreads)
+{
+	if(nrThreads == this->nrThreads())
+	{
+		return;
+	}
+
+	if(nrThreads > 1)
+	{
+		pool_.reset(new WorkerPool(nrThreads));
+	}
+	else
+	{
+		pool_.reset();
+	}
+
+	if(decomposedSolver_)
+	{
+		decomposedSolver_->pool(pool_.get());
+	}
+	for(Layout& l: layouts_)
+	{
+		if(l.decomposedSolver)
+		{
+			l.decomposedSolver->pool(pool_.get());
+		}
+	}
+}
+
+
+int QPSolver::nrThreads() const
+{
+	return pool_ ? pool_->nrThreads() : 1;
+}
+
+
+void QPSolver::taskUpdateGroup(Task* task, int group)
+{
+	if(group < 0)
+	{
+		taskGroups_.erase(task);
+	}
+	else
+	{
+		taskGroups_[task] = group;
+	}
+	jobsDirty_ = true;
+}
+
+
+int QPSolver::taskUpdateGroup(Task* task) const
+{
+	auto it = taskGroups_.find(task);
+	return it != taskGroups_.end() ? it->second : -1;
+}
+
+
 void QPSolver::solver(const std::string& name)
 {
-	solver_ = std::unique_ptr<GenQPSolver>(createQPSolver(name));
-	solver_->updateSize(data_.nrVars_, maxEqLines_, maxInEqLines_, maxGenInEqLines_);
+	solverName_ = name;
+	layouts_.clear();
+	resetSolver();
 }
 
 
-void QPSolver::resetTasks()
+const std::string& QPSolver::solver() const
 {
-	tasks_.clear();
+	return solverName_;
 }
 
 
-const SolverData& QPSolver::data() const
+const GenQPSolver& QPSolver::solverBackend() const
 {
-	return data_;
+	return *solver_;
 }
 
 
-SolverData& QPSolver::data()
+static std::string& defaultSolverName()
 {
-	return data_;
+	static std::string name(GenQPSolver::default_qp_solver);
+	return name;
 }
 
 
-const Eigen::VectorXd& QPSolver::result() const
+void QPSolver::defaultSolver(const std::string& name)
 {
-	return solver_->result();
+	defaultSolverName() = name;
 }
 
 
-Eigen::VectorXd QPSolver::alphaDVec() const
+const std::string& QPSolver::defaultSolver()
 {
-	return solver_->result().head(data_.totalAlphaD_);
+	return defaultSolverName();
 }
 
 
-Eigen::VectorXd QPSolver::alphaDVec(int rIndex) const
+void QPSolver::decompose(bool d)
 {
-	return solver_->result().segment(data_.alphaDBegin_[rIndex],
-		data_.alphaD_[rIndex]);
+	if(d != decompose_)
+	{
+		decompose_ = d;
+		layouts_.clear();
+		bool warm = solver_->warmStart();
+		resetSolver();
+		solver_->warmStart(warm);
+	}
 }
 
 
-Eigen::VectorXd QPSolver::lambdaVec() const
+bool QPSolver::decompose() const
 {
-	return solver_->result().segment(data_.lambdaBegin(), data_.totalLambda_);
+	return decompose_;
 }
 
 
-Eigen::VectorXd QPSolver::lambdaVec(int cIndex) const
+int QPSolver::nrComponents() const
 {
-	return solver_->result().segment(data_.lambdaBegin_[cIndex],
-		data_.lambda_[cIndex]);
+	return nrComponents_;
 }
 
 
-int QPSolver::contactLambdaPosition(const ContactId& cId) const
+bool QPSolver::decomposed() const
 {
-	int pos = 0;
+	return decomposedSolver_ != nullptr;
+}
 
-	for(const BilateralContact& bc: data_.allContacts())
+
+bool QPSolver::updateComponents()
+{
+	const int nrRobots = static_cast<int>(data_.alphaD_.size());
+
+	// union-find of the robots, the work vectors are members to not allocate
+	std::vector<int>& parent = componentParent_;
+	parent.resize(nrRobots);
+	std::iota(parent.begin(), parent.end(), 0);
+	auto root = [&parent](int r)
 	{
-		if(bc.contactId == cId)
+		while(parent[r] != r)
 		{
-			return pos;
+			parent[r] = parent[parent[r]];
+			r = parent[r];
 		}
+		return r;
+	};
 
-		for(std::size_t i = 0; i < bc.r1Points.size(); ++i)
+	std::vector<int>& varRobot = varRobot_;
+	varRobot.assign(data_.nrVars_, -1);
+	for(int r = 0; r < nrRobots; ++r)
+	{
+		std::fill_n(varRobot.begin() + data_.alphaDBegin_[r], data_.alphaD_[r], r);
+	}
+
+	// contacts link two robots if both can move
+	// contact forces are given to the robot that can move
+	for(std::size_t c = 0; c < data_.allCont_.size(); ++c)
+	{
+		const ContactId& id = data_.allCont_[c].contactId;
+		bool r1Mobile = data_.alphaD_[id.r1Index] > 0;
+		bool r2Mobile = data_.alphaD_[id.r2Index] > 0;
+		if(r1Mobile && r2Mobile)
 		{
-			pos += bc.nrLambda(int(i));
+			parent[root(id.r1Index)] = root(id.r2Index);
 		}
+
+		int r = r1Mobile ? id.r1Index : (r2Mobile ? id.r2Index : -1);
+		std::fill_n(varRobot.begin() + data_.lambdaBegin_[c], data_.lambda_[c], r);
 	}
 
-	return -1;
+	// link the robots of the variables [begin, begin + size) to first
+	int first = -1;
+	auto link = [&](int begin, int size)
+	{
+		for(int v = begin; v < std::min(begin + size, data_.nrVars_); ++v)
+		{
+			if(varRobot[v] != -1)
+			{
+				if(first == -1)
+				{
+					first = varRobot[v];
+				}
+				parent[root(varRobot[v])] = root(first);
+			}
+		}
+	};
+	auto linkBlocks = [&](const std::vector<ColBlock>& blocks)
+	{
+		first = -1;
+		for(const ColBlock& cb: blocks)
+		{
+			link(cb.col, cb.cols(data_.nrVars_));
+		}
+	};
+
+	// tasks link all the robots of their variables
+	for(const Task* t: tasks_)
+	{
+		std::pair<int, int> b = t->begin();
+		int nrRows = static_cast<int>(t->isLeastSquares() ? t->ALS().cols() :
+			t->Q().rows());
+		int nrCols = static_cast<int>(t->isLeastSquares() ? t->ALS().cols() :
+			t->Q().cols());
+		first = -1;
+		link(b.first, nrRows);
+		link(b.second, nrCols);
+	}
+
+	// constraints link all the robots of their column blocks,
+	// a dense constraint link all the robots
+	for(const Equality* c: eqConstr_)
+	{
+		linkBlocks(c->AEqBlocks());
+	}
+	for(const Inequality* c: inEqConstr_)
+	{
+		linkBlocks(c->AInEqBlocks());
+	}
+	for(const GenInequality* c: genInEqConstr_)
+	{
+		linkBlocks(c->AGenInEqBlocks());
+	}
+
+	std::vector<int>& rootComponent = rootComponent_;
+	rootComponent.assign(nrRobots, -1);
+	int nrComponents = 0;
+	for(int r = 0; r < nrRobots; ++r)
+	{
+		if(data_.alphaD_[r] > 0 && rootComponent[root(r)] == -1)
+		{
+			rootComponent[root(r)] = nrComponents++;
+		}
+	}
+
+	// variables without mobile robot are put in the first component
+	std::vector<int>& varComponents = newVarComponents_;
+	varComponents.assign(data_.nrVars_, 0);
+	for(int v = 0; v < data_.nrVars_; ++v)
+	{
+		if(varRobot[v] != -1)
+		{
+			varComponents[v] = rootComponent[root(varRobot[v])];
+		}
+	}
+	nrComponents = std::max(nrComponents, 1);
+
+	bool changed = nrComponents != nrComponents_ ||
+		varComponents != varComponents_;
+	nrComponents_ = nrComponents;
+	varComponents_.swap(varComponents);
+	return changed;
 }
 
 
-boost::timer::cpu_times QPSolver::solveTime() const
+void QPSolver::resetComponents()
 {
-	return solverTimer_.elapsed();
+	componentsDirty_ = false;
+	if(updateComponents() && decompose_)
+	{
+		bool warm = solver_->warmStart();
+		GenQPSolver::Clock::time_point deadline = solver_->deadline();
+		resetSolver();
+		solver_->warmStart(warm);
+		solver_->deadline(deadline);
+	}
 }
 
 
-boost::timer::cpu_times QPSolver::solveAndBuildTime() const
+bool QPSolver::LayoutKey::operator==(const LayoutKey& k) const
 {
-	return solverAndBuildTimer_.elapsed();
+	return nrVars == k.nrVars && contacts == k.contacts && alphaD == k.alphaD &&
+		lambda == k.lambda && dependencies == k.dependencies;
 }
 
 
-void QPSolver::preUpdate(const std::vector<rbd::MultiBody>& mbs,
-												const std::vector<rbd::MultiBodyConfig>& mbcs)
+bool QPSolver::swapLayout()
 {
-	data_.computeNormalAccB(mbs, mbcs);
-	for(std::size_t i = 0; i < constr_.size(); ++i)
+	LayoutKey key;
+	key.nrVars = data_.nrVars_;
+	key.contacts.reserve(data_.allCont_.size());
+	for(const BilateralContact& c: data_.allCont_)
 	{
-		constr_[i]->update(mbs, mbcs, data_);
+		key.contacts.push_back(c.contactId);
 	}
+	key.alphaD = data_.alphaD_;
+	key.lambda = data_.lambda_;
+	key.dependencies = dependencies_;
 
-	for(std::size_t i = 0; i < tasks_.size(); ++i)
+	if(key == layoutKey_)
 	{
-		tasks_[i]->update(mbs, mbcs, data_);
+		return false;
 	}
 
-	solver_->updateMatrix(tasks_, eqConstr_, inEqConstr_, genInEqConstr_,
-		boundConstr_);
-}
-
+	bool warm = solver_->warmStart();
+	bool pre = solver_->presolve();
+	// a cached backend keeps the deadline of its last solve,
+	// solverTimeBudget only resets the current one
+	GenQPSolver::Clock::time_point deadline = solver_->deadline();
 
-void QPSolver::postUpdate(const std::vector<rbd::MultiBody>& /* mbs */,
-	std::vector<rbd::MultiBodyConfig>& mbcs, bool success)
-{
-	if(success)
+	// keep the current layout, the first one has never been sized
+	// and a replaced backend has no key
+	if(!layoutKey_.alphaD.empty())
 	{
-		for(std::size_t r = 0; r < mbcs.size(); ++r)
-		{
-			updateMbc(mbcs[r], int(r));
-		}
+		layouts_.emplace_front();
+		Layout& l = layouts_.front();
+		l.key = std::move(layoutKey_);
+		l.solver = std::move(solver_);
+		l.decomposedSolver = decomposedSolver_;
+		l.varComponents = varComponents_;
+		l.nrComponents = nrComponents_;
+		l.maxEqLines = maxEqLines_;
+		l.maxInEqLines = maxInEqLines_;
+		l.maxGenInEqLines = maxGenInEqLines_;
+	}
 
-		// don't write contact force to the structure since contact force are used
+	auto it = std::find_if(layouts_.begin(), layouts_.end(),
+		[&key](const Layout& l)
+		{
+			return l.solver && l.key == key;
+		});
+	if(it != layouts_.end())
+	{
+		solver_ = std::move(it->solver);
+		decomposedSolver_ = it->decomposedSolver;
+		varComponents_ = std::move(it->varComponents);
+		nrComponents_ = it->nrComponents;
+		maxEqLines_ = it->maxEqLines;
+		maxInEqLines_ = it->maxInEqLines;
+		maxGenInEqLines_ = it->maxGenInEqLines;
+		layouts_.erase(it);
+		++backendCacheHits_;
+		backendSwapped_ = true;
+		// tasks or constraints could have been added since the layout was cached
+		componentsDirty_ = true;
+
+		// the settings could have changed since the layout was cached
+		solver_->presolve(pre);
+		solver_->maxIter(solverMaxIter_);
+	}
+	else
+	{
+		++backendCacheMisses_;
+		updateComponents();
+		resetSolver(pre);
+	}
+	solver_->warmStart(warm);
+	solver_->deadline(deadline);
+	layoutKey_ = std::move(key);
+
+	while(int(layouts_.size()) > backendCacheSize_)
+	{
+		layouts_.pop_back();
+	}
+	return true;
+}
+
+
+void QPSolver::resetSolver()
+{
+	resetSolver(solver_->presolve());
+}
+
+
+void QPSolver::resetSolver(bool pre)
+{
+	// the new backend is not the one of the current layout key
+	layoutKey_ = LayoutKey();
+	backendSwapped_ = false;
+	if(decompose_ && nrComponents_ > 1)
+	{
+		decomposedSolver_ = new DecomposedQPSolver(solverName_, varComponents_,
+			nrComponents_, pool_.get());
+		solver_.reset(decomposedSolver_);
+	}
+	else
+	{
+		decomposedSolver_ = nullptr;
+		solver_.reset(createQPSolver(solverName_));
+	}
+	solver_->presolve(pre);
+	solver_->maxIter(solverMaxIter_);
+	solver_->setDependencies(data_.nrVars_, dependencies_);
+	solver_->updateSize(data_.nrVars_, maxEqLines_, maxInEqLines_, maxGenInEqLines_);
+}
+
+
+void QPSolver::warmStart(bool w)
+{
+	solver_->warmStart(w);
+}
+
+
+bool QPSolver::warmStart() const
+{
+	return solver_->warmStart();
+}
+
+
+void QPSolver::resetWarmStart()
+{
+	solver_->resetWarmStart();
+}
+
+
+int QPSolver::solverIterations() const
+{
+	return solver_->iterations();
+}
+
+
+bool QPSolver::solverReentrant() const
+{
+	return solver_->reentrant();
+}
+
+
+void QPSolver::presolve(bool p)
+{
+	solver_->presolve(p);
+}
+
+
+bool QPSolver::presolve() const
+{
+	return solver_->presolve();
+}
+
+
+const PresolveStats& QPSolver::presolveStats() const
+{
+	return solver_->presolveStats();
+}
+
+
+void QPSolver::solverMaxIter(int maxIter)
+{
+	// a negative value is forwarded to restore the backend default
+	solverMaxIter_ = maxIter;
+	solver_->maxIter(maxIter);
+}
+
+
+int QPSolver::solverMaxIter() const
+{
+	return solver_->maxIter();
+}
+
+
+double QPSolver::solverPrimalResidual() const
+{
+	return solver_->primalResidual();
+}
+
+
+double QPSolver::solverDualResidual() const
+{
+	return solver_->dualResidual();
+}
+
+
+void QPSolver::solverTimeBudget(double budget)
+{
+	solverTimeBudget_ = budget;
+	if(!std::isfinite(budget))
+	{
+		solver_->deadline(GenQPSolver::Clock::time_point::max());
+	}
+}
+
+
+double QPSolver::solverTimeBudget() const
+{
+	return solverTimeBudget_;
+}
+
+
+void QPSolver::recorder(QPRecorder* r)
+{
+	recorder_ = r;
+}
+
+
+QPRecorder* QPSolver::recorder() const
+{
+	return recorder_;
+}
+
+
+QPStatus QPSolver::solverStatus() const
+{
+	return solverStatus_;
+}
+
+
+bool QPSolver::solverFallback() const
+{
+	return solverFallback_;
+}
+
+
+void QPSolver::computeFallback()
+{
+	if(lastResult_.size() != data_.nrVars_)
+	{
+		lastResult_.setZero(data_.nrVars_);
+	}
+
+	fallbackResult_ = lastResult_;
+	for(const Bound* b: boundConstr_)
+	{
+		const Eigen::VectorXd& XL = b->Lower();
+		const Eigen::VectorXd& XU = b->Upper();
+		auto x = fallbackResult_.segment(b->beginVar(), XL.size());
+		x = x.cwiseMax(XL).cwiseMin(XU);
+	}
+	solverFallback_ = true;
+}
+
+
+void QPSolver::resetTasks()
+{
+	tasks_.clear();
+	taskGroups_.clear();
+	jobsDirty_ = true;
+	phasesDirty_ = true;
+}
+
+
+const SolverData& QPSolver::data() const
+{
+	return data_;
+}
+
+
+SolverData& QPSolver::data()
+{
+	return data_;
+}
+
+
+const Eigen::VectorXd& QPSolver::result() const
+{
+	return solverFallback_ ? fallbackResult_ : solver_->result();
+}
+
+
+Eigen::VectorXd QPSolver::alphaDVec() const
+{
+	return result().head(data_.totalAlphaD_);
+}
+
+
+Eigen::VectorXd QPSolver::alphaDVec(int rIndex) const
+{
+	return result().segment(data_.alphaDBegin_[rIndex],
+		data_.alphaD_[rIndex]);
+}
+
+
+Eigen::VectorXd QPSolver::lambdaVec() const
+{
+	return result().segment(data_.lambdaBegin(), data_.totalLambda_);
+}
+
+
+Eigen::VectorXd QPSolver::lambdaVec(int cIndex) const
+{
+	return result().segment(data_.lambdaBegin_[cIndex],
+		data_.lambda_[cIndex]);
+}
+
+
+void QPSolver::alphaDVec(Eigen::VectorXd& res) const
+{
+	res = result().head(data_.totalAlphaD_);
+}
+
+
+void QPSolver::alphaDVec(int rIndex, Eigen::VectorXd& res) const
+{
+	res = result().segment(data_.alphaDBegin_[rIndex],
+		data_.alphaD_[rIndex]);
+}
+
+
+void QPSolver::lambdaVec(Eigen::VectorXd& res) const
+{
+	res = result().segment(data_.lambdaBegin(), data_.totalLambda_);
+}
+
+
+void QPSolver::lambdaVec(int cIndex, Eigen::VectorXd& res) const
+{
+	res = result().segment(data_.lambdaBegin_[cIndex],
+		data_.lambda_[cIndex]);
+}
+
+
+int QPSolver::contactLambdaPosition(const ContactId& cId) const
+{
+	int pos = 0;
+
+	for(const BilateralContact& bc: data_.allContacts())
+	{
+		if(bc.contactId == cId)
+		{
+			return pos;
+		}
+
+		for(std::size_t i = 0; i < bc.r1Points.size(); ++i)
+		{
+			pos += bc.nrLambda(int(i));
+		}
+	}
+
+	return -1;
+}
+
+
+boost::timer::cpu_times QPSolver::solveTime() const
+{
+	return solverTimer_.elapsed();
+}
+
+
+boost::timer::cpu_times QPSolver::solveAndBuildTime() const
+{
+	return solverAndBuildTimer_.elapsed();
+}
+
+
+QPProfiler& QPSolver::profiler()
+{
+	return profiler_;
+}
+
+
+const QPProfiler& QPSolver::profiler() const
+{
+	return profiler_;
+}
+
+
+void QPSolver::preUpdate(const std::vector<rbd::MultiBody>& mbs,
+												const std::vector<rbd::MultiBodyConfig>& mbcs)
+{
+	const bool profile = profiler_.enabled();
+	if(profile && phasesDirty_)
+	{
+		updatePhases();
+	}
+	QPProfiler::Clock::time_point start;
+	if(profile)
+	{
+		start = QPProfiler::Clock::now();
+	}
+
+	data_.computeNormalAccB(mbs, mbcs);
+	data_.computeCaches(mbs, mbcs);
+	if(profile)
+	{
+		QPProfiler::Clock::time_point now = QPProfiler::Clock::now();
+		profiler_.record(normalAccBPhase_, std::chrono::duration<double>(
+			now - start).count());
+		start = now;
+	}
+
+	if(pool_)
+	{
+		if(jobsDirty_)
+		{
+			updateJobs();
+		}
+		// std::ref keep the std::function small enough to not allocate
+		auto job = [this, &mbs, &mbcs, profile](int j) { runJob(j, mbs, mbcs, profile); };
+		pool_->run(static_cast<int>(jobs_.size()), std::ref(job));
+	}
+	else if(profile)
+	{
+		// each phase is only written by one thread
+		for(std::size_t i = 0; i < constr_.size(); ++i)
+		{
+			QPProfiler::Clock::time_point s = QPProfiler::Clock::now();
+			constr_[i]->update(mbs, mbcs, data_);
+			profiler_.record(constrPhases_[i], s);
+		}
+
+		for(std::size_t i = 0; i < tasks_.size(); ++i)
+		{
+			QPProfiler::Clock::time_point s = QPProfiler::Clock::now();
+			tasks_[i]->update(mbs, mbcs, data_);
+			profiler_.record(taskPhases_[i], s);
+		}
+	}
+	else
+	{
+		for(std::size_t i = 0; i < constr_.size(); ++i)
+		{
+			constr_[i]->update(mbs, mbcs, data_);
+		}
+
+		for(std::size_t i = 0; i < tasks_.size(); ++i)
+		{
+			tasks_[i]->update(mbs, mbcs, data_);
+		}
+	}
+
+	// the constraints and tasks updated outside this cycle don't read the caches
+	data_.resetCaches();
+
+	if(profile)
+	{
+		QPProfiler::Clock::time_point now = QPProfiler::Clock::now();
+		profiler_.record(updatePhase_, std::chrono::duration<double>(
+			now - start).count());
+		start = now;
+	}
+
+	if(componentsDirty_)
+	{
+		resetComponents();
+	}
+	growConstrSize();
+	solver_->updateMatrix(tasks_, eqConstr_, inEqConstr_, genInEqConstr_,
+		boundConstr_);
+	// a constraint has changed its column blocks and couple two components
+	if(decomposedSolver_ && decomposedSolver_->coupled())
+	{
+		resetComponents();
+		solver_->updateMatrix(tasks_, eqConstr_, inEqConstr_, genInEqConstr_,
+			boundConstr_);
+	}
+
+	if(profile)
+	{
+		profiler_.record(updateMatrixPhase_, start);
+	}
+}
+
+
+void QPSolver::updateJobs()
+{
+	jobs_.clear();
+	jobTasks_.clear();
+	for(std::size_t i = 0; i < constr_.size(); ++i)
+	{
+		jobs_.push_back({static_cast<int>(i), 0, 0});
+	}
+
+	// tasks of the same group are put next to each other in jobTasks_
+	std::map<int, std::vector<int>> groups;
+	for(std::size_t i = 0; i < tasks_.size(); ++i)
+	{
+		auto it = taskGroups_.find(tasks_[i]);
+		if(it == taskGroups_.end())
+		{
+			int begin = static_cast<int>(jobTasks_.size());
+			jobTasks_.push_back(static_cast<int>(i));
+			jobs_.push_back({-1, begin, begin + 1});
+		}
+		else
+		{
+			groups[it->second].push_back(static_cast<int>(i));
+		}
+	}
+
+	for(const auto& g: groups)
+	{
+		int begin = static_cast<int>(jobTasks_.size());
+		jobTasks_.insert(jobTasks_.end(), g.second.begin(), g.second.end());
+		jobs_.push_back({-1, begin, static_cast<int>(jobTasks_.size())});
+	}
+
+	jobsDirty_ = false;
+}
+
+
+void QPSolver::updatePhases()
+{
+	// phases are named by their position in the solver and their type
+	auto name = [](const char* kind, std::size_t i, const std::type_info& type)
+	{
+		std::string typeName = boost::core::demangle(type.name());
+		const std::string ns = "tasks::qp::";
+		if(typeName.compare(0, ns.size(), ns) == 0)
+		{
+			typeName.erase(0, ns.size());
+		}
+		return std::string(kind) + "[" + std::to_string(i) + "] " + typeName;
+	};
+
+	constrPhases_.resize(constr_.size());
+	for(std::size_t i = 0; i < constr_.size(); ++i)
+	{
+		constrPhases_[i] = profiler_.phase(name("constraint", i, typeid(*constr_[i])));
+	}
+
+	taskPhases_.resize(tasks_.size());
+	for(std::size_t i = 0; i < tasks_.size(); ++i)
+	{
+		taskPhases_[i] = profiler_.phase(name("task", i, typeid(*tasks_[i])));
+	}
+
+	phasesDirty_ = false;
+}
+
+
+void QPSolver::runJob(int job, const std::vector<rbd::MultiBody>& mbs,
+	const std::vector<rbd::MultiBodyConfig>& mbcs, bool profile)
+{
+	// each phase is only written by the thread running its job
+	const UpdateJob& j = jobs_[job];
+	if(j.constr != -1)
+	{
+		QPProfiler::Clock::time_point start;
+		if(profile)
+		{
+			start = QPProfiler::Clock::now();
+		}
+		constr_[j.constr]->update(mbs, mbcs, data_);
+		if(profile)
+		{
+			profiler_.record(constrPhases_[j.constr], start);
+		}
+	}
+	for(int i = j.begin; i < j.end; ++i)
+	{
+		QPProfiler::Clock::time_point start;
+		if(profile)
+		{
+			start = QPProfiler::Clock::now();
+		}
+		tasks_[jobTasks_[i]]->update(mbs, mbcs, data_);
+		if(profile)
+		{
+			profiler_.record(taskPhases_[jobTasks_[i]], start);
+		}
+	}
+}
+
+
+void QPSolver::postUpdate(const std::vector<rbd::MultiBody>& /* mbs */,
+	std::vector<rbd::MultiBodyConfig>& mbcs, bool success)
+{
+	if(success)
+	{
+		for(std::size_t r = 0; r < mbcs.size(); ++r)
+		{
+			updateMbc(mbcs[r], int(r));
+		}
+
+		// don't write contact force to the structure since contact force are used
 		// to compute C vector.
 	}
 }
 
 
+
+/**
+	*													QPBatchSolver
+	*/
+
+
+
+QPBatchSolver::QPBatchSolver(int nrThreads, const Builder& build):
+	solvers_(),
+	pool_()
+{
+	if(nrThreads < 1)
+	{
+		throw std::domain_error("QPBatchSolver need at least one thread");
+	}
+
+	for(int t = 0; t < nrThreads; ++t)
+	{
+		solvers_.emplace_back(new QPSolver);
+		build(*solvers_.back());
+		if(!solvers_.front()->solverReentrant())
+		{
+			break;
+		}
+		if(solvers_.back()->nrVars() != solvers_.front()->nrVars())
+		{
+			throw std::domain_error("QPBatchSolver solvers must have the same nrVars");
+		}
+	}
+
+	pool_.reset(new WorkerPool(static_cast<int>(solvers_.size())));
+}
+
+
+// must declare it in cpp because of WorkerPool fwd declarition
+QPBatchSolver::~QPBatchSolver()
+{}
+
+
+int QPBatchSolver::nrSolvers() const
+{
+	return static_cast<int>(solvers_.size());
+}
+
+
+QPSolver& QPBatchSolver::solver(int i)
+{
+	return *solvers_[i];
+}
+
+
+int QPBatchSolver::solve(const std::vector<rbd::MultiBody>& mbs,
+	const std::vector<std::vector<rbd::MultiBodyConfig>>& mbcsBatch,
+	Eigen::MatrixXd& results, Eigen::Array<bool, Eigen::Dynamic, 1>& success)
+{
+	const int nrConfigs = static_cast<int>(mbcsBatch.size());
+	results.resize(solvers_.front()->nrVars(), nrConfigs);
+	success.resize(nrConfigs);
+
+	// the backend could have been changed since the construction
+	int nrThreads = static_cast<int>(solvers_.size());
+	for(const std::unique_ptr<QPSolver>& s: solvers_)
+	{
+		if(!s->solverReentrant())
+		{
+			nrThreads = 1;
+		}
+	}
+
+	// one job by solver, each one take the next configuration to solve
+	std::atomic<int> next(0);
+	auto job = [&](int j)
+	{
+		QPSolver& solver = *solvers_[j];
+		int i = 0;
+		while((i = next.fetch_add(1, std::memory_order_relaxed)) < nrConfigs)
+		{
+			success(i) = solver.solveNoMbcUpdate(mbs, mbcsBatch[i]);
+			results.col(i) = solver.result();
+		}
+	};
+	pool_->run(nrThreads, std::ref(job));
+
+	return static_cast<int>(success.count());
+}
+
+
+
+/**
+	*													Equality, Inequality, GenInequality
+	*/
+
+
+
+namespace
+{
+
+// full block alone, used by constraint with a dense matrix
+const std::vector<ColBlock> denseColBlocks(1, ColBlock::full());
+
+std::atomic<int> lastRevision(-1);
+
+}
+
+
+int newRevision()
+{
+	return ++lastRevision;
+}
+
+
+bool isDenseColBlocks(const std::vector<ColBlock>& blocks)
+{
+	return blocks.size() == 1 && blocks[0].isFull();
+}
+
+
+Eigen::MatrixXd expandColBlocks(const Eigen::MatrixXd& A,
+	const std::vector<ColBlock>& blocks, int nrVars)
+{
+	if(nrVars < 0)
+	{
+		if(!isDenseColBlocks(blocks))
+		{
+			throw std::domain_error("The number of variables is needed to expand "
+				"a matrix with column blocks");
+		}
+		nrVars = int(A.cols());
+	}
+
+	Eigen::MatrixXd res(Eigen::MatrixXd::Zero(A.rows(), nrVars));
+	for(const ColBlock& cb: blocks)
+	{
+		int size = cb.cols(nrVars);
+		if(cb.col + size > nrVars || cb.srcCol + size > A.cols())
+		{
+			throw std::domain_error("Column block out of the matrix");
+		}
+		res.block(0, cb.col, A.rows(), size) = A.block(0, cb.srcCol, A.rows(), size);
+	}
+	return res;
+}
+
+
+const std::vector<ColBlock>& Equality::AEqBlocks() const
+{
+	return denseColBlocks;
+}
+
+
+const std::vector<ColBlock>& Inequality::AInEqBlocks() const
+{
+	return denseColBlocks;
+}
+
+
+const std::vector<ColBlock>& GenInequality::AGenInEqBlocks() const
+{
+	return denseColBlocks;
+}
+
+
+
+/**
+	*													Task
+	*/
+
+
+
+namespace
+{
+
+// empty least squares objective, used by task with a quadratic form
+const Eigen::MatrixXd emptyALS;
+const Eigen::VectorXd emptybLS;
+
+}
+
+
+const Eigen::MatrixXd& Task::ALS() const
+{
+	return emptyALS;
+}
+
+
+const Eigen::VectorXd& Task::bLS() const
+{
+	return emptybLS;
+}
+
+
 } // namespace qp
 
 } // namespace tasks
@@ -39,11 +39,16 @@ SolverData::SolverData():
 	nrUniLambda_(0),
 	nrBiLambda_(0),
 	nrVars_(0),
+	contactCapacity_(0),
 	uniCont_(),
 	biCont_(),
 	allCont_(),
+	spareCont_(),
 	mobileRobotIndex_(),
-	normalAccB_()
+	normalAccB_(),
+	bodyJac_(),
+	dynamics_(),
+	cachesComputed_(false)
 {}
 
 
@@ -74,6 +79,109 @@ void SolverData::computeNormalAccB(const std::vector<rbd::MultiBody>& mbs,
 	}
 }
 
+
+int SolverData::addBodyJacobian(const rbd::MultiBody& mb, int robotIndex,
+	const std::string& bodyName)
+{
+	int bodyIndex = mb.bodyIndexByName(bodyName);
+	for(std::size_t i = 0; i < bodyJac_.size(); ++i)
+	{
+		if(bodyJac_[i].robotIndex == robotIndex &&
+			 bodyJac_[i].bodyIndex == bodyIndex)
+		{
+			bodyJac_[i].used = true;
+			return int(i);
+		}
+	}
+
+	rbd::Jacobian jac(mb, bodyName);
+	Eigen::MatrixXd mat(Eigen::MatrixXd::Zero(6, jac.dof()));
+	bodyJac_.push_back({robotIndex, bodyIndex, std::move(jac), std::move(mat), true});
+	return int(bodyJac_.size()) - 1;
+}
+
+
+int SolverData::bodyJacobianIndex(int robotIndex, int bodyIndex) const
+{
+	for(std::size_t i = 0; i < bodyJac_.size(); ++i)
+	{
+		const BodyJacobian& bj = bodyJac_[i];
+		if(bj.used && bj.robotIndex == robotIndex && bj.bodyIndex == bodyIndex)
+		{
+			return int(i);
+		}
+	}
+	return -1;
+}
+
+
+void SolverData::computeBodyJacobians(const std::vector<rbd::MultiBody>& mbs,
+	const std::vector<rbd::MultiBodyConfig>& mbcs)
+{
+	for(BodyJacobian& bj: bodyJac_)
+	{
+		if(!bj.used)
+		{
+			continue;
+		}
+		bj.mat = bj.jac.bodyJacobian(mbs[bj.robotIndex], mbcs[bj.robotIndex]);
+	}
+}
+
+
+int SolverData::addDynamics(const rbd::MultiBody& mb, int robotIndex)
+{
+	for(std::size_t i = 0; i < dynamics_.size(); ++i)
+	{
+		if(dynamics_[i].robotIndex == robotIndex)
+		{
+			dynamics_[i].used = true;
+			return int(i);
+		}
+	}
+
+	dynamics_.push_back({robotIndex, std::make_shared<rbd::ForwardDynamics>(mb),
+		true});
+	return int(dynamics_.size()) - 1;
+}
+
+
+int SolverData::dynamicsIndex(int robotIndex) const
+{
+	for(std::size_t i = 0; i < dynamics_.size(); ++i)
+	{
+		if(dynamics_[i].used && dynamics_[i].robotIndex == robotIndex)
+		{
+			return int(i);
+		}
+	}
+	return -1;
+}
+
+
+void SolverData::computeDynamics(const std::vector<rbd::MultiBody>& mbs,
+	const std::vector<rbd::MultiBodyConfig>& mbcs)
+{
+	for(RobotDynamics& rd: dynamics_)
+	{
+		if(!rd.used)
+		{
+			continue;
+		}
+		rd.fd->computeH(mbs[rd.robotIndex], mbcs[rd.robotIndex]);
+		rd.fd->computeC(mbs[rd.robotIndex], mbcs[rd.robotIndex]);
+	}
+}
+
+
+void SolverData::computeCaches(const std::vector<rbd::MultiBody>& mbs,
+	const std::vector<rbd::MultiBodyConfig>& mbcs)
+{
+	computeBodyJacobians(mbs, mbcs);
+	computeDynamics(mbs, mbcs);
+	cachesComputed_ = true;
+}
+
 } // namespace qp
 
 } // namespace tasks
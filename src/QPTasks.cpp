@@ -23,6 +23,7 @@
 #include <cmath>
 #include <iterator>
 #include <set>
+#include <stdexcept>
 
 // Eigen
 #include <Eigen/Geometry>
@@ -53,8 +54,11 @@ SetPointTaskCommon::SetPointTaskCommon(const std::vector<rbd::MultiBody>& mbs,
 	dimWeight_(Eigen::VectorXd::Ones(hlTask->dim())),
 	robotIndex_(rI),
 	alphaDBegin_(0),
-	Q_(mbs[rI].nrDof(), mbs[rI].nrDof()),
+	Q_(Eigen::MatrixXd::Zero(mbs[rI].nrDof(), mbs[rI].nrDof())),
 	C_(mbs[rI].nrDof()),
+	leastSquares_(false),
+	ALS_(hlTask->dim(), mbs[rI].nrDof()),
+	bLS_(hlTask->dim()),
 	preQ_(hlTask->dim(), mbs[rI].nrDof()),
 	preC_(hlTask->dim())
 {}
@@ -70,8 +74,11 @@ SetPointTaskCommon::SetPointTaskCommon(const std::vector<rbd::MultiBody>& mbs,
 	dimWeight_(dimWeight),
 	robotIndex_(rI),
 	alphaDBegin_(0),
-	Q_(mbs[rI].nrDof(), mbs[rI].nrDof()),
+	Q_(Eigen::MatrixXd::Zero(mbs[rI].nrDof(), mbs[rI].nrDof())),
 	C_(mbs[rI].nrDof()),
+	leastSquares_(false),
+	ALS_(hlTask->dim(), mbs[rI].nrDof()),
+	bLS_(hlTask->dim()),
 	preQ_(hlTask->dim(), mbs[rI].nrDof()),
 	preC_(hlTask->dim())
 {}
@@ -83,6 +90,13 @@ void SetPointTaskCommon::dimWeight(const Eigen::VectorXd& dim)
 }
 
 
+void SetPointTaskCommon::registerCache(const std::vector<rbd::MultiBody>& mbs,
+	SolverData& data)
+{
+	hlTask_->registerCache(mbs, data);
+}
+
+
 void SetPointTaskCommon::updateNrVars(const std::vector<rbd::MultiBody>& /* mbs */,
 	const SolverData& data)
 {
@@ -92,30 +106,98 @@ void SetPointTaskCommon::updateNrVars(const std::vector<rbd::MultiBody>& /* mbs
 
 void SetPointTaskCommon::computeQC(Eigen::VectorXd& error)
 {
-	const Eigen::MatrixXd& J = hlTask_->jac();
-	const Eigen::VectorXd& normalAcc = hlTask_->normalAcc();
+	switch(error.rows())
+	{
+	case 3:
+		computeQC<3>(error);
+		break;
+	case 6:
+		computeQC<6>(error);
+		break;
+	default:
+		computeQC<Eigen::Dynamic>(error);
+	}
+}
 
-	error.noalias() -= normalAcc;
-	preC_.noalias() = dimWeight_.asDiagonal()*error;
-	C_.noalias() = -J.transpose()*preC_;
 
-	preQ_.noalias() = dimWeight_.asDiagonal()*J;
-	Q_.noalias() = J.transpose()*preQ_;
+template<int Rows>
+void SetPointTaskCommon::computeQC(Eigen::VectorXd& errorVec)
+{
+	typedef Eigen::Matrix<double, Rows, 1> Vector;
+	typedef Eigen::Matrix<double, Rows, Eigen::Dynamic> Matrix;
+
+	const Eigen::MatrixXd& JMat = hlTask_->jac();
+	const int rows = static_cast<int>(errorVec.rows());
+	const int cols = static_cast<int>(JMat.cols());
+
+	Eigen::Map<const Matrix> J(JMat.data(), rows, cols);
+	Eigen::Map<const Vector> normalAcc(hlTask_->normalAcc().data(), rows);
+	Eigen::Map<const Vector> dimWeight(dimWeight_.data(), rows);
+	Eigen::Map<Vector> error(errorVec.data(), rows);
+
+	error -= normalAcc;
+	if(leastSquares_)
+	{
+		Eigen::Map<Matrix>(ALS_.data(), rows, cols).noalias() =
+			dimWeight.cwiseSqrt().asDiagonal()*J;
+		Eigen::Map<Vector>(bLS_.data(), rows).noalias() =
+			dimWeight.cwiseSqrt().asDiagonal()*error;
+		return;
+	}
+
+	Eigen::Map<Vector> preC(preC_.data(), rows);
+	Eigen::Map<Matrix> preQ(preQ_.data(), rows, cols);
+
+	preC.noalias() = dimWeight.asDiagonal()*error;
+	preQ.noalias() = dimWeight.asDiagonal()*J;
+	if(Rows == Eigen::Dynamic)
+	{
+		C_.noalias() = -J.transpose()*preC;
+		// Q is symmetric, only the upper triangular part is computed
+		Q_.triangularView<Eigen::Upper>() = J.transpose()*preQ;
+	}
+	else
+	{
+		// the inner dimension is fixed, a coefficient based product
+		// is unrolled and avoid the blocking overhead of the matrix product
+		C_.noalias() = -J.transpose().lazyProduct(preC);
+		Q_.triangularView<Eigen::Upper>() = J.transpose().lazyProduct(preQ);
+	}
 }
 
 
 const Eigen::MatrixXd& SetPointTaskCommon::Q() const
 {
+	if(leastSquares_)
+	{
+		throw std::domain_error("Q is not computed in least squares mode, use ALS");
+	}
 	return Q_;
 }
 
 
 const Eigen::VectorXd& SetPointTaskCommon::C() const
 {
+	if(leastSquares_)
+	{
+		throw std::domain_error("C is not computed in least squares mode, use bLS");
+	}
 	return C_;
 }
 
 
+const Eigen::MatrixXd& SetPointTaskCommon::ALS() const
+{
+	return ALS_;
+}
+
+
+const Eigen::VectorXd& SetPointTaskCommon::bLS() const
+{
+	return bLS_;
+}
+
+
 /**
 	*														SetPointTask
 	*/
@@ -414,7 +496,7 @@ TargetObjectiveTask::TargetObjectiveTask(const std::vector<rbd::MultiBody>& mbs,
 	alphaDBegin_(0),
 	phi_(hlTask->dim()),
 	psi_(hlTask->dim()),
-	Q_(mbs[rI].nrDof(), mbs[rI].nrDof()),
+	Q_(Eigen::MatrixXd::Zero(mbs[rI].nrDof(), mbs[rI].nrDof())),
 	C_(mbs[rI].nrDof()),
 	preQ_(hlTask->dim(), mbs[rI].nrDof()),
 	CVecSum_(hlTask->dim()),
@@ -437,7 +519,7 @@ TargetObjectiveTask::TargetObjectiveTask(const std::vector<rbd::MultiBody>& mbs,
 	alphaDBegin_(0),
 	phi_(hlTask->dim()),
 	psi_(hlTask->dim()),
-	Q_(mbs[rI].nrDof(), mbs[rI].nrDof()),
+	Q_(Eigen::MatrixXd::Zero(mbs[rI].nrDof(), mbs[rI].nrDof())),
 	C_(mbs[rI].nrDof()),
 	preQ_(hlTask->dim(), mbs[rI].nrDof()),
 	CVecSum_(hlTask->dim()),
@@ -460,6 +542,13 @@ void TargetObjectiveTask::duration(double d)
 }
 
 
+void TargetObjectiveTask::registerCache(const std::vector<rbd::MultiBody>& mbs,
+	SolverData& data)
+{
+	hlTask_->registerCache(mbs, data);
+}
+
+
 void TargetObjectiveTask::updateNrVars(const std::vector<rbd::MultiBody>& /* mbs */,
 	const SolverData& data)
 {
@@ -523,7 +612,7 @@ void TargetObjectiveTask::update(const std::vector<rbd::MultiBody>& mbs,
 	}
 
 	preQ_.noalias() = dimWeight_.asDiagonal()*J;
-	Q_.noalias() = J.transpose()*preQ_;
+	Q_.triangularView<Upper>() = J.transpose()*preQ_;
 
 	CVecSum_.noalias() = phi_ - normalAcc;
 	preC_.noalias() = dimWeight_.asDiagonal()*CVecSum_;
@@ -608,6 +697,13 @@ int JointsSelector::dim()
 }
 
 
+void JointsSelector::registerCache(const std::vector<rbd::MultiBody>& mbs,
+	SolverData& data)
+{
+	hl_->registerCache(mbs, data);
+}
+
+
 void JointsSelector::update(const std::vector<rbd::MultiBody>& mbs,
 	const std::vector<rbd::MultiBodyConfig>& mbcs,
 	const SolverData& data)
@@ -655,7 +751,9 @@ TorqueTask::TorqueTask(const std::vector<rbd::MultiBody>& mbs, int robotIndex,
   motionConstr(mbs, robotIndex, tb),
   jointSelector_(mbs[robotIndex].nrDof()),
   Q_(mbs[robotIndex].nrDof(), mbs[robotIndex].nrDof()),
-  C_(mbs[robotIndex].nrDof())
+  C_(mbs[robotIndex].nrDof()),
+  preQ_(),
+  preC_(mbs[robotIndex].nrDof())
 {
   jointSelector_.setOnes();
 }
@@ -670,7 +768,9 @@ TorqueTask::TorqueTask(const std::vector<rbd::MultiBody>& mbs, int robotIndex,
   motionConstr(mbs, robotIndex, tb),
   jointSelector_(jointSelect),
   Q_(mbs[robotIndex].nrDof(), mbs[robotIndex].nrDof()),
-  C_(mbs[robotIndex].nrDof())
+  C_(mbs[robotIndex].nrDof()),
+  preQ_(),
+  preC_(mbs[robotIndex].nrDof())
 {
 }
 
@@ -684,7 +784,9 @@ TorqueTask::TorqueTask(const std::vector<rbd::MultiBody>& mbs, int robotIndex,
   motionConstr(mbs, robotIndex, tb),
   jointSelector_(mbs[robotIndex].nrDof()),
   Q_(mbs[robotIndex].nrDof(), mbs[robotIndex].nrDof()),
-  C_(mbs[robotIndex].nrDof())
+  C_(mbs[robotIndex].nrDof()),
+  preQ_(),
+  preC_(mbs[robotIndex].nrDof())
 {
   rbd::Jacobian jac(mbs[robotIndex], efName);
   jointSelector_.setZero();
@@ -699,14 +801,21 @@ TorqueTask::TorqueTask(const std::vector<rbd::MultiBody>& mbs, int robotIndex,
   }
 }
 
+void TorqueTask::registerCache(const std::vector<rbd::MultiBody>& mbs,
+                              SolverData& data)
+{
+  motionConstr.registerCache(mbs, data);
+}
+
 void TorqueTask::updateNrVars(const std::vector<rbd::MultiBody>& mbs,
                               const SolverData& data)
 {
   motionConstr.updateNrVars(mbs, data);
   alphaDBegin_ = data.alphaDBegin(robotIndex_);
   lambdaBegin_ = data.lambdaBegin();
-  Q_.resize(data.nrVars(), data.nrVars());
+  Q_.setZero(data.nrVars(), data.nrVars());
   C_.resize(data.nrVars());
+  preQ_.resize(mbs[robotIndex_].nrDof(), data.nrVars());
 }
 
 void TorqueTask::update(const std::vector<rbd::MultiBody>& mbs,
@@ -714,8 +823,11 @@ void TorqueTask::update(const std::vector<rbd::MultiBody>& mbs,
                         const SolverData& data)
 {
   motionConstr.update(mbs, mbcs, data);
-  Q_.noalias() = motionConstr.matrix().transpose()*jointSelector_.asDiagonal()*motionConstr.matrix();
-  C_.noalias() = motionConstr.fd().C().transpose()*jointSelector_.asDiagonal()*motionConstr.matrix();
+  const Eigen::MatrixXd& A = motionConstr.matrix();
+  preQ_.noalias() = jointSelector_.asDiagonal()*A;
+  Q_.triangularView<Eigen::Upper>() = A.transpose()*preQ_;
+  preC_.noalias() = jointSelector_.cwiseProduct(motionConstr.fd().C());
+  C_.noalias() = A.transpose()*preC_;
   //C_.setZero();
 }
 
@@ -735,9 +847,10 @@ PostureTask::PostureTask(const std::vector<rbd::MultiBody>& mbs,
 	robotIndex_(rI),
 	alphaDBegin_(0),
 	jointDatas_(),
-	Q_(mbs[rI].nrDof(), mbs[rI].nrDof()),
+	Q_(pt_.jac()),
 	C_(mbs[rI].nrDof()),
-	alphaVec_(mbs[rI].nrDof())
+	alphaVec_(mbs[rI].nrDof()),
+	QRevision_(newRevision())
 {}
 
 
@@ -807,7 +920,6 @@ void PostureTask::update(const std::vector<rbd::MultiBody>& mbs,
 	pt_.update(mb, mbc);
 	rbd::paramToVector(mbc.alpha, alphaVec_);
 
-	Q_ = pt_.jac();
 	C_.setZero();
 
 	int deb = mb.jointPosInDof(1);
@@ -849,7 +961,10 @@ PositionTask::PositionTask(const std::vector<rbd::MultiBody>& mbs, int rI,
 	const std::string& bodyName, const Eigen::Vector3d& pos,
 	const Eigen::Vector3d& bodyPoint):
 	pt_(mbs[rI], bodyName, pos, bodyPoint),
-	robotIndex_(rI)
+	bodyName_(bodyName),
+	robotIndex_(rI),
+	bodyIndex_(mbs[rI].bodyIndexByName(bodyName)),
+	jacIndex_(-1)
 {
 }
 
@@ -860,11 +975,26 @@ int PositionTask::dim()
 }
 
 
+void PositionTask::registerCache(const std::vector<rbd::MultiBody>& mbs,
+	SolverData& data)
+{
+	jacIndex_ = data.addBodyJacobian(mbs[robotIndex_], robotIndex_, bodyName_);
+}
+
+
 void PositionTask::update(const std::vector<rbd::MultiBody>& mbs,
 	const std::vector<rbd::MultiBodyConfig>& mbcs,
 	const SolverData& data)
 {
-	pt_.update(mbs[robotIndex_], mbcs[robotIndex_], data.normalAccB(robotIndex_));
+	if(data.bodyJacobianComputed(jacIndex_, robotIndex_, bodyIndex_))
+	{
+		pt_.update(mbs[robotIndex_], mbcs[robotIndex_], data.normalAccB(robotIndex_),
+			data.bodyJacobian(jacIndex_));
+	}
+	else
+	{
+		pt_.update(mbs[robotIndex_], mbcs[robotIndex_], data.normalAccB(robotIndex_));
+	}
 }
 
 
@@ -901,7 +1031,10 @@ OrientationTask::OrientationTask(const std::vector<rbd::MultiBody>& mbs,
 	int rI, const std::string& bodyName,
 	const Eigen::Quaterniond& ori):
 	ot_(mbs[rI], bodyName, ori),
-	robotIndex_(rI)
+	bodyName_(bodyName),
+	robotIndex_(rI),
+	bodyIndex_(mbs[rI].bodyIndexByName(bodyName)),
+	jacIndex_(-1)
 {}
 
 
@@ -909,7 +1042,10 @@ OrientationTask::OrientationTask(const std::vector<rbd::MultiBody>& mbs,
 	int rI, const std::string& bodyName,
 	const Eigen::Matrix3d& ori):
 	ot_(mbs[rI], bodyName, ori),
-	robotIndex_(rI)
+	bodyName_(bodyName),
+	robotIndex_(rI),
+	bodyIndex_(mbs[rI].bodyIndexByName(bodyName)),
+	jacIndex_(-1)
 {}
 
 
@@ -919,11 +1055,26 @@ int OrientationTask::dim()
 }
 
 
+void OrientationTask::registerCache(const std::vector<rbd::MultiBody>& mbs,
+	SolverData& data)
+{
+	jacIndex_ = data.addBodyJacobian(mbs[robotIndex_], robotIndex_, bodyName_);
+}
+
+
 void OrientationTask::update(const std::vector<rbd::MultiBody>& mbs,
 	const std::vector<rbd::MultiBodyConfig>& mbcs,
 	const SolverData& data)
 {
-	ot_.update(mbs[robotIndex_], mbcs[robotIndex_], data.normalAccB(robotIndex_));
+	if(data.bodyJacobianComputed(jacIndex_, robotIndex_, bodyIndex_))
+	{
+		ot_.update(mbs[robotIndex_], mbcs[robotIndex_], data.normalAccB(robotIndex_),
+			data.bodyJacobian(jacIndex_));
+	}
+	else
+	{
+		ot_.update(mbs[robotIndex_], mbcs[robotIndex_], data.normalAccB(robotIndex_));
+	}
 }
 
 
@@ -960,8 +1111,18 @@ SurfaceTransformTask::SurfaceTransformTask(const std::vector<rbd::MultiBody>& mb
 	int robotIndex,
 	const std::string& bodyName, const sva::PTransformd& X_0_t,
 	const sva::PTransformd& X_b_p):
-	TransformTaskCommon(mbs, robotIndex, bodyName, X_0_t, X_b_p)
+	TransformTaskCommon(mbs, robotIndex, bodyName, X_0_t, X_b_p),
+	bodyName_(bodyName),
+	bodyIndex_(mbs[robotIndex].bodyIndexByName(bodyName)),
+	jacIndex_(-1)
+{
+}
+
+
+void SurfaceTransformTask::registerCache(const std::vector<rbd::MultiBody>& mbs,
+	SolverData& data)
 {
+	jacIndex_ = data.addBodyJacobian(mbs[robotIndex_], robotIndex_, bodyName_);
 }
 
 
@@ -969,7 +1130,15 @@ void SurfaceTransformTask::update(const std::vector<rbd::MultiBody>& mbs,
 	const std::vector<rbd::MultiBodyConfig>& mbcs,
 	const SolverData& data)
 {
-	tt_.update(mbs[robotIndex_], mbcs[robotIndex_], data.normalAccB(robotIndex_));
+	if(data.bodyJacobianComputed(jacIndex_, robotIndex_, bodyIndex_))
+	{
+		tt_.update(mbs[robotIndex_], mbcs[robotIndex_], data.normalAccB(robotIndex_),
+			data.bodyJacobian(jacIndex_));
+	}
+	else
+	{
+		tt_.update(mbs[robotIndex_], mbcs[robotIndex_], data.normalAccB(robotIndex_));
+	}
 }
 
 
@@ -1261,7 +1430,8 @@ MultiCoMTask::MultiCoMTask(const std::vector<rbd::MultiBody>& mbs,
 	Q_(),
 	C_(),
 	CSum_(),
-	preQ_()
+	preQ_(),
+	preC_()
 {
 	init(mbs);
 }
@@ -1280,7 +1450,8 @@ MultiCoMTask::MultiCoMTask(const std::vector<rbd::MultiBody>& mbs,
 	Q_(),
 	C_(),
 	CSum_(),
-	preQ_()
+	preQ_(),
+	preC_()
 {
 	init(mbs);
 }
@@ -1334,6 +1505,7 @@ void MultiCoMTask::update(const std::vector<rbd::MultiBody>& mbs,
 	CSum_ = stiffness_*mct_.eval();
 	CSum_ -= stiffnessSqrt_*mct_.speed();
 	CSum_ -= mct_.normalAcc();
+	preC_ = dimWeight_.asDiagonal()*CSum_;
 	for(int i = 0; i < int(posInQ_.size()); ++i)
 	{
 		int r = mct_.robotIndexes()[i];
@@ -1343,9 +1515,9 @@ void MultiCoMTask::update(const std::vector<rbd::MultiBody>& mbs,
 		const Eigen::MatrixXd& J = mct_.jac(i);
 		preQ_.block(0, 0, 3, dof).noalias() = dimWeight_.asDiagonal()*J;
 
-		Q_.block(begin, begin, dof, dof).noalias() =
+		Q_.block(begin, begin, dof, dof).triangularView<Eigen::Upper>() =
 			J.transpose()*preQ_.block(0, 0, 3, dof);
-		C_.segment(begin, dof).noalias() = -J.transpose()*dimWeight_.asDiagonal()*CSum_;
+		C_.segment(begin, dof).noalias() = -J.transpose()*preC_;
 	}
 }
 
@@ -1506,9 +1678,9 @@ void MultiRobotTransformTask::update(const std::vector<rbd::MultiBody>& mbs,
 
 		// scince the two robot index could be the same
 		// we had to increment the Q and C matrix
-		Q_.block(begin, begin, dof, dof).noalias() +=
+		Q_.block(begin, begin, dof, dof).triangularView<Eigen::Upper>() +=
 			J.transpose()*preQ_.block(0, 0, 6, dof);
-		C_.segment(begin, dof).noalias() -= J.transpose()*dimWeight_.asDiagonal()*CSum_;
+		C_.segment(begin, dof).noalias() -= preQ_.block(0, 0, 6, dof).transpose()*CSum_;
 	}
 }
 
@@ -1642,6 +1814,7 @@ void ContactTask::updateNrVars(const std::vector<rbd::MultiBody>& /* mbs */,
 	Q_.resize(nrLambda, nrLambda);
 	Q_.noalias() = conesJac_.transpose()*conesJac_;
 	C_.setZero(nrLambda);
+	QRevision_ = newRevision();
 }
 
 
@@ -1723,6 +1896,7 @@ void GripperTorqueTask::updateNrVars(const std::vector<rbd::MultiBody>& /* mbs *
 		Q_.resize(0, 0);
 		C_.resize(0);
 	}
+	QRevision_ = newRevision();
 }
 
 
@@ -0,0 +1,669 @@
+// Copyright 2012-2016 CNRS-UM LIRMM, CNRS-AIST JRL
+//
+// This file is part of Tasks.
+//
+// Tasks is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Tasks is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with Tasks.  If not, see <http://www.gnu.org/licenses/>.
+
+// associated header
+#include "SparseQPSolver.h"
+
+// includes
+// std
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+// Tasks
+#include "GenQPUtils.h"
+#include "Tasks/QPSolver.h"
+
+
+namespace tasks
+{
+
+namespace qp
+{
+
+
+// regularization of the KKT matrix diagonal
+static const double KKT_REGULARIZATION = 1e-10;
+// stopping tolerance on the scaled residuals and the duality gap
+static const double IP_TOLERANCE = 1e-9;
+// fraction of the step to the boundary
+static const double IP_STEP_FACTOR = 0.99;
+
+
+namespace
+{
+
+// maximum step in [0, 1] that keep v + alpha*dv >= 0
+double maxStep(const Eigen::VectorXd& v, const Eigen::VectorXd& dv, int size)
+{
+	double alpha = 1.;
+	for(int i = 0; i < size; ++i)
+	{
+		if(dv(i) < 0.)
+		{
+			alpha = std::min(alpha, -v(i)/dv(i));
+		}
+	}
+	return alpha;
+}
+
+} // anonymous namespace
+
+
+SparseQPSolver::SparseQPSolver():
+	ldlt_(),
+	nrFullVars_(0), nrVars_(0), nrLS_(0),
+	maxEq_(0), maxInEq_(0),
+	nrEq_(0), nrInEq_(0),
+	colMap_(),
+	QTriplets_(), ATriplets_(), GTriplets_(), KTriplets_(),
+	Q_(), A_(), G_(),
+	C_(), b_(), h_(),
+	diag_(),
+	XLFull_(), XUFull_(), XL_(), XU_(),
+	K_(), KBase_(),
+	KOuter_(), KInner_(),
+	GTGStart_(), GTGIndex_(), GTGValue_(),
+	x_(), y_(), z_(), s_(),
+	rd_(), rp_(), ri_(), w_(), tmp_(),
+	rhs_(), sol_(),
+	dx_(), dy_(), dz_(), ds_(),
+	rc_(),
+	XFull_(),
+	maxIter_(100), nrIter_(0), nrAnalyze_(0),
+	analyzed_(false), success_(false)
+{
+}
+
+
+void SparseQPSolver::warmStart(bool /* w */)
+{
+	GenQPSolver::warmStart(false);
+}
+
+
+void SparseQPSolver::updateSize(int nrVars, int nrEq, int nrInEq, int nrGenInEq)
+{
+	nrFullVars_ = nrVars;
+	nrVars_ = nrVars - static_cast<int>(dependencies_.size());
+
+	colMap_.resize(nrVars);
+	if(dependencies_.size())
+	{
+		for(int i = 0; i < nrVars; ++i)
+		{
+			colMap_[i] = {fullToReduced_[i], 1.};
+		}
+		for(const auto& d: dependencies_)
+		{
+			colMap_[std::get<1>(d)] = {fullToReduced_[std::get<0>(d)], std::get<2>(d)};
+		}
+	}
+	else
+	{
+		for(int i = 0; i < nrVars; ++i)
+		{
+			colMap_[i] = {i, 1.};
+		}
+	}
+
+	// equal general inequality are moved in the equality rows
+	// and each variable bound can create two inequality rows
+	maxEq_ = nrEq + nrGenInEq + nrVars_;
+	maxInEq_ = nrInEq + nrGenInEq*2 + nrVars_*2;
+
+	diag_.resize(nrVars);
+	XLFull_.resize(nrVars);
+	XUFull_.resize(nrVars);
+	XL_.resize(nrVars_);
+	XU_.resize(nrVars_);
+	XFull_.resize(nrVars);
+
+	nrLS_ = 0;
+	resizeWorkspace();
+}
+
+
+void SparseQPSolver::resizeWorkspace()
+{
+	// each least squares row add one residual variable and one equality row
+	const int n = nrVars_ + nrLS_;
+	const int maxEq = maxEq_ + nrLS_;
+
+	C_.resize(n);
+	b_.resize(maxEq);
+	h_.resize(maxInEq_);
+
+	x_.setZero(n);
+	y_.resize(maxEq);
+	z_.resize(maxInEq_);
+	s_.resize(maxInEq_);
+
+	rd_.resize(n);
+	rp_.resize(maxEq);
+	ri_.resize(maxInEq_);
+	w_.resize(maxInEq_);
+	tmp_.resize(maxInEq_);
+	rc_.resize(maxInEq_);
+
+	rhs_.resize(n + maxEq);
+	sol_.resize(n + maxEq);
+	dx_.resize(n);
+	dy_.resize(maxEq);
+	dz_.resize(maxInEq_);
+	ds_.resize(maxInEq_);
+
+	analyzed_ = false;
+}
+
+
+void SparseQPSolver::addRow(const Eigen::MatrixXd& Ai,
+	const std::vector<ColBlock>& blocks, int line, double sign, int row,
+	std::vector<Triplet>& triplets) const
+{
+	auto addBlock = [&](int col, int size, int srcCol)
+	{
+		for(int c = 0; c < size; ++c)
+		{
+			const std::pair<int, double>& cm = colMap_[col + c];
+			triplets.emplace_back(row, cm.first, sign*cm.second*Ai(line, srcCol + c));
+		}
+	};
+
+	for(const ColBlock& cb: blocks)
+	{
+		addBlock(cb.col, cb.cols(nrFullVars_), cb.srcCol);
+	}
+}
+
+
+void SparseQPSolver::updateMatrix(
+	const std::vector<Task*>& tasks,
+	const std::vector<Equality*>& eqConstr,
+	const std::vector<Inequality*>& inEqConstr,
+	const std::vector<GenInequality*>& genInEqConstr,
+	const std::vector<Bound*>& boundConstr)
+{
+	const double inf = std::numeric_limits<double>::infinity();
+
+	int nrLS = 0;
+	for(const Task* t: tasks)
+	{
+		if(t->isLeastSquares())
+		{
+			nrLS += static_cast<int>(t->ALS().rows());
+		}
+	}
+	if(nrLS != nrLS_)
+	{
+		nrLS_ = nrLS;
+		resizeWorkspace();
+	}
+	const int n = nrVars_ + nrLS_;
+
+	// Q and C
+	QTriplets_.clear();
+	C_.setZero();
+	diag_.setZero();
+	for(const Task* t: tasks)
+	{
+		if(t->isLeastSquares())
+		{
+			continue;
+		}
+
+		const Eigen::MatrixXd& Qi = t->Q();
+		const Eigen::VectorXd& Ci = t->C();
+		std::pair<int, int> b = t->begin();
+		double weight = t->weight();
+
+		// only the upper triangular part of Qi is read
+		for(int c = 0; c < Qi.cols(); ++c)
+		{
+			const std::pair<int, double>& cm = colMap_[b.second + c];
+			for(int r = 0; r < c; ++r)
+			{
+				const std::pair<int, double>& rm = colMap_[b.first + r];
+				double value = weight*rm.second*cm.second*Qi(r, c);
+				QTriplets_.emplace_back(rm.first, cm.first, value);
+				QTriplets_.emplace_back(cm.first, rm.first, value);
+			}
+			const std::pair<int, double>& dm = colMap_[b.first + c];
+			QTriplets_.emplace_back(dm.first, cm.first,
+				weight*dm.second*cm.second*Qi(c, c));
+			diag_(b.first + c) += weight*Qi(c, c);
+		}
+
+		for(int r = 0; r < Ci.rows(); ++r)
+		{
+			const std::pair<int, double>& rm = colMap_[b.first + r];
+			C_(rm.first) += weight*rm.second*Ci(r);
+		}
+	}
+
+	// least squares tasks are added without forming A^T A:
+	// min 1/2 w ||r||^2 with the residual r = A x - b
+	ATriplets_.clear();
+	GTriplets_.clear();
+	nrEq_ = 0;
+	nrInEq_ = 0;
+	int residual = nrVars_;
+	for(const Task* t: tasks)
+	{
+		if(t->isLeastSquares())
+		{
+			const Eigen::MatrixXd& Ai = t->ALS();
+			const Eigen::VectorXd& bi = t->bLS();
+			int begin = t->begin().second;
+			for(int l = 0; l < Ai.rows(); ++l)
+			{
+				QTriplets_.emplace_back(residual, residual, t->weight());
+				for(int c = 0; c < Ai.cols(); ++c)
+				{
+					const std::pair<int, double>& cm = colMap_[begin + c];
+					ATriplets_.emplace_back(nrEq_, cm.first, cm.second*Ai(l, c));
+				}
+				ATriplets_.emplace_back(nrEq_, residual, -1.);
+				b_(nrEq_++) = bi(l);
+				++residual;
+			}
+			// diagonal of w A^T A
+			diag_.segment(begin, Ai.cols()) +=
+				t->weight()*Ai.colwise().squaredNorm().transpose();
+		}
+	}
+
+	// same diagonal regularization than fillQC
+	// all the diagonal is added to keep a constant sparsity pattern
+	for(int i = 0; i < nrFullVars_; ++i)
+	{
+		const std::pair<int, double>& cm = colMap_[i];
+		double value = std::abs(diag_(i)) < DIAG_CONSTANT ? DIAG_CONSTANT : 0.;
+		QTriplets_.emplace_back(cm.first, cm.first, cm.second*cm.second*value);
+	}
+
+	Q_.resize(n, n);
+	Q_.setFromTriplets(QTriplets_.begin(), QTriplets_.end());
+
+	// equality and inequality rows
+
+	for(Equality* e: eqConstr)
+	{
+		const Eigen::MatrixXd& Ai = e->AEq();
+		const Eigen::VectorXd& bi = e->bEq();
+		for(int l = 0; l < e->nrEq(); ++l)
+		{
+			addRow(Ai, e->AEqBlocks(), l, 1., nrEq_, ATriplets_);
+			b_(nrEq_++) = bi(l);
+		}
+	}
+
+	for(Inequality* ie: inEqConstr)
+	{
+		const Eigen::MatrixXd& Ai = ie->AInEq();
+		const Eigen::VectorXd& bi = ie->bInEq();
+		for(int l = 0; l < ie->nrInEq(); ++l)
+		{
+			if(bi(l) < inf)
+			{
+				addRow(Ai, ie->AInEqBlocks(), l, 1., nrInEq_, GTriplets_);
+				h_(nrInEq_++) = bi(l);
+			}
+		}
+	}
+
+	for(GenInequality* gie: genInEqConstr)
+	{
+		const Eigen::MatrixXd& Ai = gie->AGenInEq();
+		const std::vector<ColBlock>& blocks = gie->AGenInEqBlocks();
+		const Eigen::VectorXd& Li = gie->LowerGenInEq();
+		const Eigen::VectorXd& Ui = gie->UpperGenInEq();
+		for(int l = 0; l < gie->nrGenInEq(); ++l)
+		{
+			// same line classification than the dense backends
+			GenInEqKind kind = genInEqKind(Li(l), Ui(l));
+			if(kind == GenInEqKind::Equal)
+			{
+				addRow(Ai, blocks, l, 1., nrEq_, ATriplets_);
+				b_(nrEq_++) = Ui(l);
+			}
+			if(kind == GenInEqKind::Upper || kind == GenInEqKind::Both)
+			{
+				addRow(Ai, blocks, l, 1., nrInEq_, GTriplets_);
+				h_(nrInEq_++) = Ui(l);
+			}
+			if(kind == GenInEqKind::Lower || kind == GenInEqKind::Both)
+			{
+				addRow(Ai, blocks, l, -1., nrInEq_, GTriplets_);
+				h_(nrInEq_++) = -Li(l);
+			}
+		}
+	}
+
+	// bounds
+	XLFull_.fill(-inf);
+	XUFull_.fill(inf);
+	fillBound(boundConstr, XLFull_, XUFull_);
+	if(dependencies_.size())
+	{
+		XL_.fill(-inf);
+		XU_.fill(inf);
+		reduceBound(XLFull_, XL_, XUFull_, XU_, fullToReduced_, reducedToFull_,
+			dependencies_);
+	}
+	else
+	{
+		XL_ = XLFull_;
+		XU_ = XUFull_;
+	}
+
+	for(int i = 0; i < nrVars_; ++i)
+	{
+		if(XL_(i) == XU_(i))
+		{
+			ATriplets_.emplace_back(nrEq_, i, 1.);
+			b_(nrEq_++) = XU_(i);
+			continue;
+		}
+		if(XU_(i) < inf)
+		{
+			GTriplets_.emplace_back(nrInEq_, i, 1.);
+			h_(nrInEq_++) = XU_(i);
+		}
+		if(XL_(i) > -inf)
+		{
+			GTriplets_.emplace_back(nrInEq_, i, -1.);
+			h_(nrInEq_++) = -XL_(i);
+		}
+	}
+
+	A_.resize(nrEq_, n);
+	A_.setFromTriplets(ATriplets_.begin(), ATriplets_.end());
+	G_.resize(nrInEq_, n);
+	G_.setFromTriplets(GTriplets_.begin(), GTriplets_.end());
+
+	buildKKT();
+}
+
+
+void SparseQPSolver::buildKKT()
+{
+	const int n = nrVars_ + nrLS_;
+
+	// upper part of the KKT matrix
+	// the G^T G pattern is added with null values
+	KTriplets_.clear();
+	for(const Triplet& t: QTriplets_)
+	{
+		if(t.row() <= t.col())
+		{
+			KTriplets_.push_back(t);
+		}
+	}
+	for(int i = 0; i < n; ++i)
+	{
+		KTriplets_.emplace_back(i, i, KKT_REGULARIZATION);
+	}
+	for(int r = 0; r < A_.outerSize(); ++r)
+	{
+		for(SparseRowMatrix::InnerIterator it(A_, r); it; ++it)
+		{
+			KTriplets_.emplace_back(int(it.col()), n + r, it.value());
+		}
+		KTriplets_.emplace_back(n + r, n + r, -KKT_REGULARIZATION);
+	}
+	for(int r = 0; r < G_.outerSize(); ++r)
+	{
+		for(SparseRowMatrix::InnerIterator it1(G_, r); it1; ++it1)
+		{
+			for(SparseRowMatrix::InnerIterator it2(G_, r); it2; ++it2)
+			{
+				if(it1.col() <= it2.col())
+				{
+					KTriplets_.emplace_back(int(it1.col()), int(it2.col()), 0.);
+				}
+			}
+		}
+	}
+
+	K_.resize(n + nrEq_, n + nrEq_);
+	K_.setFromTriplets(KTriplets_.begin(), KTriplets_.end());
+	K_.makeCompressed();
+	KBase_ = Eigen::Map<const Eigen::VectorXd>(K_.valuePtr(), K_.nonZeros());
+
+	// index of each G^T G product in K_ values
+	auto valueIndex = [this](int row, int col)
+	{
+		const int* begin = K_.innerIndexPtr() + K_.outerIndexPtr()[col];
+		const int* end = K_.innerIndexPtr() + K_.outerIndexPtr()[col + 1];
+		return int(std::lower_bound(begin, end, row) - K_.innerIndexPtr());
+	};
+
+	GTGStart_.assign(1, 0);
+	GTGIndex_.clear();
+	GTGValue_.clear();
+	for(int r = 0; r < G_.outerSize(); ++r)
+	{
+		for(SparseRowMatrix::InnerIterator it1(G_, r); it1; ++it1)
+		{
+			for(SparseRowMatrix::InnerIterator it2(G_, r); it2; ++it2)
+			{
+				if(it1.col() <= it2.col())
+				{
+					GTGIndex_.push_back(valueIndex(int(it1.col()), int(it2.col())));
+					GTGValue_.push_back(it1.value()*it2.value());
+				}
+			}
+		}
+		GTGStart_.push_back(int(GTGIndex_.size()));
+	}
+
+	// only redo the symbolic analysis if the pattern has changed
+	bool samePattern = analyzed_ &&
+		KOuter_.size() == std::size_t(K_.outerSize() + 1) &&
+		KInner_.size() == std::size_t(K_.nonZeros()) &&
+		std::equal(KOuter_.begin(), KOuter_.end(), K_.outerIndexPtr()) &&
+		std::equal(KInner_.begin(), KInner_.end(), K_.innerIndexPtr());
+	if(!samePattern)
+	{
+		KOuter_.assign(K_.outerIndexPtr(), K_.outerIndexPtr() + K_.outerSize() + 1);
+		KInner_.assign(K_.innerIndexPtr(), K_.innerIndexPtr() + K_.nonZeros());
+		ldlt_.analyzePattern(K_);
+		analyzed_ = true;
+		++nrAnalyze_;
+	}
+}
+
+
+void SparseQPSolver::updateKKT()
+{
+	Eigen::Map<Eigen::VectorXd>(K_.valuePtr(), K_.nonZeros()) = KBase_;
+	for(int r = 0; r < nrInEq_; ++r)
+	{
+		for(int p = GTGStart_[r]; p < GTGStart_[r + 1]; ++p)
+		{
+			K_.valuePtr()[GTGIndex_[p]] += w_(r)*GTGValue_[p];
+		}
+	}
+	ldlt_.factorize(K_);
+}
+
+
+void SparseQPSolver::newtonStep(const Eigen::VectorXd& rc)
+{
+	const int n = nrVars_ + nrLS_;
+	const int m = nrInEq_;
+
+	// tmp = (Z ri - rc)/s
+	tmp_.head(m) = (z_.head(m).cwiseProduct(ri_.head(m)) - rc.head(m)).cwiseQuotient(
+		s_.head(m));
+
+	rhs_.head(n).noalias() = -rd_;
+	rhs_.head(n).noalias() -= G_.transpose()*tmp_.head(m);
+	rhs_.segment(n, nrEq_) = -rp_.head(nrEq_);
+
+	sol_.head(n + nrEq_) = ldlt_.solve(rhs_.head(n + nrEq_));
+	dx_ = sol_.head(n);
+	dy_.head(nrEq_) = sol_.segment(n, nrEq_);
+
+	ds_.head(m).noalias() = G_*dx_;
+	dz_.head(m) = w_.head(m).cwiseProduct(ds_.head(m)) + tmp_.head(m);
+	ds_.head(m) = -ri_.head(m) - ds_.head(m);
+}
+
+
+bool SparseQPSolver::solve()
+{
+	const int n = nrVars_ + nrLS_;
+	const int p = nrEq_;
+	const int m = nrInEq_;
+
+	// cold start, strictly positive slacks and multipliers
+	x_.setZero(n);
+	y_.head(p).setZero();
+	if(m > 0)
+	{
+		ri_.head(m).noalias() = G_*x_;
+		s_.head(m) = (h_.head(m) - ri_.head(m)).cwiseMax(1.);
+		z_.head(m).setOnes();
+	}
+
+	double cNorm = C_.lpNorm<Eigen::Infinity>();
+	double bNorm = p > 0 ? b_.head(p).lpNorm<Eigen::Infinity>() : 0.;
+	double hNorm = m > 0 ? h_.head(m).lpNorm<Eigen::Infinity>() : 0.;
+
+	success_ = false;
+	status_ = QPStatus::MaxIter;
+	for(nrIter_ = 0; nrIter_ < maxIter_; ++nrIter_)
+	{
+		if(Clock::now() >= deadline_)
+		{
+			status_ = QPStatus::Timeout;
+			break;
+		}
+
+		// residuals
+		rd_.noalias() = Q_*x_;
+		rd_ += C_;
+		rd_.noalias() += A_.transpose()*y_.head(p);
+		rd_.noalias() += G_.transpose()*z_.head(m);
+		rp_.head(p).noalias() = A_*x_;
+		rp_.head(p) -= b_.head(p);
+		ri_.head(m).noalias() = G_*x_;
+		ri_.head(m) += s_.head(m) - h_.head(m);
+		double mu = m > 0 ? s_.head(m).dot(z_.head(m))/m : 0.;
+
+		double rdNorm = rd_.lpNorm<Eigen::Infinity>();
+		double rpNorm = p > 0 ? rp_.head(p).lpNorm<Eigen::Infinity>() : 0.;
+		double riNorm = m > 0 ? ri_.head(m).lpNorm<Eigen::Infinity>() : 0.;
+		if(rdNorm <= IP_TOLERANCE*(1. + cNorm) &&
+			 rpNorm <= IP_TOLERANCE*(1. + bNorm) &&
+			 riNorm <= IP_TOLERANCE*(1. + hNorm) &&
+			 mu <= IP_TOLERANCE)
+		{
+			success_ = true;
+			status_ = QPStatus::Success;
+			break;
+		}
+
+		w_.head(m) = z_.head(m).cwiseQuotient(s_.head(m));
+		updateKKT();
+		if(ldlt_.info() != Eigen::Success)
+		{
+			status_ = QPStatus::Failure;
+			break;
+		}
+
+		// predictor
+		rc_.head(m) = s_.head(m).cwiseProduct(z_.head(m));
+		newtonStep(rc_);
+
+		if(m > 0)
+		{
+			double alphaAff = std::min(maxStep(s_, ds_, m), maxStep(z_, dz_, m));
+			double muAff = (s_.head(m) + alphaAff*ds_.head(m)).dot(
+				z_.head(m) + alphaAff*dz_.head(m))/m;
+			double sigma = std::pow(muAff/mu, 3);
+
+			// corrector
+			rc_.head(m) += ds_.head(m).cwiseProduct(dz_.head(m));
+			rc_.head(m).array() -= sigma*mu;
+			newtonStep(rc_);
+		}
+
+		double alpha = 1.;
+		if(m > 0)
+		{
+			alpha = std::min(1., IP_STEP_FACTOR*
+				std::min(maxStep(s_, ds_, m), maxStep(z_, dz_, m)));
+		}
+
+		x_ += alpha*dx_;
+		y_.head(p) += alpha*dy_.head(p);
+		z_.head(m) += alpha*dz_.head(m);
+		s_.head(m) += alpha*ds_.head(m);
+	}
+
+	if(dependencies_.size())
+	{
+		expandResult(x_, XFull_, reducedToFull_, dependencies_);
+	}
+	else
+	{
+		XFull_ = x_.head(nrVars_);
+	}
+
+	return success_;
+}
+
+
+const Eigen::VectorXd& SparseQPSolver::result() const
+{
+	return XFull_;
+}
+
+
+std::ostream& SparseQPSolver::errorMsg(
+	const std::vector<rbd::MultiBody>& /* mbs */,
+	const std::vector<Task*>& /* tasks */,
+	const std::vector<Equality*>& /* eqConstr */,
+	const std::vector<Inequality*>& /* inEqConstr */,
+	const std::vector<GenInequality*>& /* genInEqConstr */,
+	const std::vector<Bound*>& /* boundConstr */,
+	std::ostream& out) const
+{
+	out << "SparseQPSolver: ";
+	if(status_ == QPStatus::Timeout)
+	{
+		out << "deadline reached after " << nrIter_ << " iterations";
+	}
+	else if(ldlt_.info() != Eigen::Success)
+	{
+		out << "KKT factorization failed";
+	}
+	else
+	{
+		out << "no convergence after " << nrIter_ << " iterations" << std::endl;
+		out << "dual residual: " << rd_.lpNorm<Eigen::Infinity>();
+	}
+	return out;
+}
+
+
+} // namespace qp
+
+} // namespace tasks
@@ -0,0 +1,152 @@
+// Copyright 2012-2016 CNRS-UM LIRMM, CNRS-AIST JRL
+//
+// This file is part of Tasks.
+//
+// Tasks is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Tasks is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with Tasks.  If not, see <http://www.gnu.org/licenses/>.
+
+#pragma once
+
+// includes
+// std
+#include <vector>
+
+// Eigen
+#include <Eigen/Core>
+#include <Eigen/SparseCore>
+#include <Eigen/SparseCholesky>
+
+// Tasks
+#include "Tasks/GenQPSolver.h"
+
+
+namespace tasks
+{
+
+namespace qp
+{
+struct ColBlock;
+
+
+/**
+	* GenQPSolver interface implementation with a sparse primal-dual
+	* interior point method.
+	*
+	* The problem is assembled in sparse form from the task and constraint
+	* blocks (see ColBlock) and each Newton step solve the quasi-definite KKT system
+	* \f[
+	* \begin{bmatrix} Q + G^T W G + \delta I & A^T \\ A & -\delta I \end{bmatrix}
+	* \f]
+	* with a sparse \f$ LDL^T \f$ factorization.
+	* Least squares tasks (see Task::isLeastSquares) are not squared, a residual
+	* variable and an equality row are added for each of their rows.
+	* The symbolic analysis of the KKT matrix is only done again when its
+	* sparsity pattern change.
+	*/
+class TASKS_DLLAPI SparseQPSolver : public GenQPSolver
+{
+public:
+	SparseQPSolver();
+
+	virtual void updateSize(int nrVars, int nrEq, int nrInEq, int nrGenInEq) override;
+	virtual void updateMatrix(const std::vector<Task*>& tasks,
+		const std::vector<Equality*>& eqConstr,
+		const std::vector<Inequality*>& inEqConstr,
+		const std::vector<GenInequality*>& genInEqConstr,
+		const std::vector<Bound*>& boundConstr) override;
+	virtual bool solve() override;
+	virtual const Eigen::VectorXd& result() const override;
+	virtual std::ostream& errorMsg(const std::vector<rbd::MultiBody>& mbs,
+		const std::vector<Task*>& tasks,
+		const std::vector<Equality*>& eqConstr,
+		const std::vector<Inequality*>& inEqConstr,
+		const std::vector<GenInequality*>& genInEqConstr,
+		const std::vector<Bound*>& boundConstr,
+		std::ostream& out) const override;
+
+	/**
+		* The interior point iterates can't be seeded by the previous solution,
+		* each solve is a cold start and the warm start stays disabled.
+		*/
+	virtual void warmStart(bool w) override;
+	using GenQPSolver::warmStart;
+
+	/// @return Number of interior point iterations of the last solve.
+	virtual int iterations() const override
+	{
+		return nrIter_;
+	}
+
+	/// @return Number of symbolic analysis done since the solver creation.
+	int nrAnalyze() const
+	{
+		return nrAnalyze_;
+	}
+
+private:
+	typedef Eigen::SparseMatrix<double> SparseMatrix;
+	typedef Eigen::SparseMatrix<double, Eigen::RowMajor> SparseRowMatrix;
+	typedef Eigen::Triplet<double> Triplet;
+
+private:
+	void addRow(const Eigen::MatrixXd& Ai, const std::vector<ColBlock>& blocks,
+		int line, double sign, int row, std::vector<Triplet>& triplets) const;
+	void resizeWorkspace();
+	void buildKKT();
+	void updateKKT();
+	void newtonStep(const Eigen::VectorXd& rc);
+
+private:
+	Eigen::SimplicialLDLT<SparseMatrix, Eigen::Upper> ldlt_;
+
+	int nrFullVars_, nrVars_;
+	/// number of least squares residual variables
+	int nrLS_;
+	int maxEq_, maxInEq_;
+	int nrEq_, nrInEq_;
+
+	/// full variable to reduced variable and factor
+	std::vector<std::pair<int, double>> colMap_;
+
+	std::vector<Triplet> QTriplets_, ATriplets_, GTriplets_, KTriplets_;
+	SparseMatrix Q_;
+	SparseRowMatrix A_, G_;
+	Eigen::VectorXd C_, b_, h_;
+
+	Eigen::VectorXd diag_;
+	Eigen::VectorXd XLFull_, XUFull_, XL_, XU_;
+
+	// KKT matrix and its numerical update from the inequality weights
+	SparseMatrix K_;
+	Eigen::VectorXd KBase_;
+	std::vector<int> KOuter_, KInner_;
+	std::vector<int> GTGStart_, GTGIndex_;
+	std::vector<double> GTGValue_;
+
+	// interior point iterates and workspace
+	Eigen::VectorXd x_, y_, z_, s_;
+	Eigen::VectorXd rd_, rp_, ri_, w_, tmp_;
+	Eigen::VectorXd rhs_, sol_;
+	Eigen::VectorXd dx_, dy_, dz_, ds_;
+	Eigen::VectorXd rc_;
+
+	Eigen::VectorXd XFull_;
+
+	int maxIter_, nrIter_, nrAnalyze_;
+	bool analyzed_, success_;
+};
+
+
+} // namespace qp
+
+} // namespace tasks
@@ -46,6 +46,7 @@ PositionTask::PositionTask(const rbd::MultiBody& mb, const std::string& bodyName
 	eval_(3),
 	speed_(3),
 	normalAcc_(3),
+	shortJacMat_(3, jac_.dof()),
 	jacMat_(3, mb.nrDof()),
 	jacDotMat_(3, mb.nrDof())
 {
@@ -101,6 +102,23 @@ void PositionTask::update(const rbd::MultiBody& mb,
 }
 
 
+void PositionTask::update(const rbd::MultiBody& mb,
+	const rbd::MultiBodyConfig& mbc, const std::vector<sva::MotionVecd>& normalAccB,
+	const Eigen::MatrixXd& bodyJac)
+{
+	eval_ = pos_ - (point_*mbc.bodyPosW[bodyIndex_]).translation();
+	speed_ = jac_.velocity(mb, mbc).linear();
+	normalAcc_ = jac_.normalAcceleration(mb, mbc, normalAccB).linear();
+
+	// same frame as jac_.jacobian: the body point with the world orientation
+	const sva::PTransformd& X_0_b = mbc.bodyPosW[bodyIndex_];
+	sva::PTransformd X_0_p((sva::PTransformd(jac_.point())*X_0_b).translation());
+	shortJacMat_.noalias() =
+		(X_0_p*X_0_b.inv()).matrix().bottomRows<3>()*bodyJac;
+	jac_.fullJacobian(mb, shortJacMat_, jacMat_);
+}
+
+
 void PositionTask::updateDot(const rbd::MultiBody& mb, const rbd::MultiBodyConfig& mbc)
 {
 	const auto& shortJacMat =
@@ -151,6 +169,7 @@ OrientationTask::OrientationTask(const rbd::MultiBody& mb, const std::string& bo
 	eval_(3),
 	speed_(3),
 	normalAcc_(3),
+	shortJacMat_(3, jac_.dof()),
 	jacMat_(3, mb.nrDof()),
 	jacDotMat_(3, mb.nrDof())
 {
@@ -164,6 +183,7 @@ OrientationTask::OrientationTask(const rbd::MultiBody& mb, const std::string& bo
 	eval_(3),
 	speed_(3),
 	normalAcc_(3),
+	shortJacMat_(3, jac_.dof()),
 	jacMat_(3, mb.nrDof()),
 	jacDotMat_(3, mb.nrDof())
 {
@@ -211,6 +231,23 @@ void OrientationTask::update(const rbd::MultiBody& mb,
 }
 
 
+void OrientationTask::update(const rbd::MultiBody& mb,
+	const rbd::MultiBodyConfig& mbc, const std::vector<sva::MotionVecd>& normalAccB,
+	const Eigen::MatrixXd& bodyJac)
+{
+	eval_ = sva::rotationError(mbc.bodyPosW[bodyIndex_].rotation(), ori_, 1e-7);
+	speed_ = jac_.velocity(mb, mbc).angular();
+	normalAcc_ = jac_.normalAcceleration(mb, mbc, normalAccB).angular();
+
+	// same frame as jac_.jacobian: the body origin with the world orientation
+	const sva::PTransformd& X_0_b = mbc.bodyPosW[bodyIndex_];
+	sva::PTransformd X_0_p(X_0_b.translation());
+	shortJacMat_.noalias() =
+		(X_0_p*X_0_b.inv()).matrix().topRows<3>()*bodyJac;
+	jac_.fullJacobian(mb, shortJacMat_, jacMat_);
+}
+
+
 void OrientationTask::updateDot(const rbd::MultiBody& mb, const rbd::MultiBodyConfig& mbc)
 {
 	const auto& shortJacMat = jac_.jacobianDot(mb, mbc).block(0, 0, 3, jac_.dof());
@@ -330,6 +367,23 @@ SurfaceTransformTask::SurfaceTransformTask(const rbd::MultiBody& mb, const std::
 
 void SurfaceTransformTask::update(const rbd::MultiBody& mb,
 	const rbd::MultiBodyConfig& mbc, const std::vector<sva::MotionVecd>& normalAccB)
+{
+	jacMatTmp_ = jac_.jacobian(mb, mbc, X_b_p_*mbc.bodyPosW[bodyIndex_]);
+	updateFromJacobian(mb, mbc, normalAccB);
+}
+
+
+void SurfaceTransformTask::update(const rbd::MultiBody& mb,
+	const rbd::MultiBodyConfig& mbc, const std::vector<sva::MotionVecd>& normalAccB,
+	const Eigen::MatrixXd& bodyJac)
+{
+	jacMatTmp_.noalias() = X_b_p_.matrix()*bodyJac;
+	updateFromJacobian(mb, mbc, normalAccB);
+}
+
+
+void SurfaceTransformTask::updateFromJacobian(const rbd::MultiBody& mb,
+	const rbd::MultiBodyConfig& mbc, const std::vector<sva::MotionVecd>& normalAccB)
 {
 	sva::PTransformd X_0_p = X_b_p_*mbc.bodyPosW[bodyIndex_];
 	sva::PTransformd X_p_t = X_0_t_*X_0_p.inv();
@@ -346,8 +400,6 @@ void SurfaceTransformTask::update(const rbd::MultiBody& mb,
 	speed_ = -V_err_p.vector();
 	normalAcc_ = -(V_err_p.cross(w_0_p) + err_p.cross(wAN_0_p) - AN_0_p).vector();
 
-	jacMatTmp_ = jac_.jacobian(mb, mbc, X_0_p);
-
 	for(int i = 0; i < jac_.dof(); ++i)
 	{
 		jacMatTmp_.col(i).head<6>() -= err_p.cross(
@@ -718,7 +770,8 @@ GazeTask::GazeTask(const rbd::MultiBody &mb, const std::string& bodyName,
 	speed_(2),
 	normalAcc_(2),
 	jacMat_(2, mb.nrDof()),
-	jacDotMat_(2, mb.nrDof())
+	jacDotMat_(2, mb.nrDof()),
+	shortJacMat_(2, jac_.dof())
 {
 	*point2d_ << point3d[0]/point3d[2], point3d[1]/point3d[2];
 	depthEstimate_ = point3d[2];
@@ -737,7 +790,7 @@ GazeTask::GazeTask(const GazeTask& rhs):
 	L_img_dot_(new Eigen::Matrix<double, 2, 6>(*rhs.L_img_dot_)),
 	eval_(rhs.eval_), speed_(rhs.speed_),
 	normalAcc_(rhs.normalAcc_), jacMat_(rhs.jacMat_),
-	jacDotMat_(rhs.jacDotMat_)
+	jacDotMat_(rhs.jacDotMat_), shortJacMat_(rhs.shortJacMat_)
 {
 }
 
@@ -760,6 +813,7 @@ GazeTask& GazeTask::operator=(const GazeTask& rhs)
 		normalAcc_ = rhs.normalAcc_;
 		jacMat_ = rhs.jacMat_;
 		jacDotMat_ = rhs.jacDotMat_;
+		shortJacMat_ = rhs.shortJacMat_;
 	}
 	return *this;
 }
@@ -797,8 +851,8 @@ void GazeTask::update(const rbd::MultiBody& mb, const rbd::MultiBodyConfig& mbc,
 		sva::MotionVecd(Eigen::Vector6d::Zero()))).vector() + (*L_img_dot_)*(*surfaceVelocity_);
 
 	// compute the task Jacobian
-	Eigen::MatrixXd shortJacMat = (*L_img_)*jac_.jacobian(mb, mbc, X_b_gaze_*mbc.bodyPosW[bodyIndex_]).block(0, 0, 6, jac_.dof());
-	jac_.fullJacobian(mb, shortJacMat, jacMat_);
+	shortJacMat_.noalias() = (*L_img_)*jac_.jacobian(mb, mbc, X_b_gaze_*mbc.bodyPosW[bodyIndex_]).block(0, 0, 6, jac_.dof());
+	jac_.fullJacobian(mb, shortJacMat_, jacMat_);
 }
 
 
@@ -854,7 +908,8 @@ PositionBasedVisServoTask::PositionBasedVisServoTask(const rbd::MultiBody &mb,
 	speed_(6),
 	normalAcc_(6),
 	jacMat_(6, mb.nrDof()),
-	jacDotMat_(6, mb.nrDof())
+	jacDotMat_(6, mb.nrDof()),
+	shortJacMat_(6, jac_.dof())
 {
 }
 
@@ -870,7 +925,8 @@ PositionBasedVisServoTask::PositionBasedVisServoTask(const PositionBasedVisServo
 	omegaSkew_(rhs.omegaSkew_),
 	L_pbvs_dot_(new Eigen::Matrix<double, 6, 6>(*rhs.L_pbvs_dot_)),
 	eval_(rhs.eval_), speed_(rhs.speed_), normalAcc_(rhs.normalAcc_),
-	jacMat_(rhs.jacMat_), jacDotMat_(rhs.jacDotMat_)
+	jacMat_(rhs.jacMat_), jacDotMat_(rhs.jacDotMat_),
+	shortJacMat_(rhs.shortJacMat_)
 {
 }
 
@@ -893,6 +949,7 @@ PositionBasedVisServoTask& PositionBasedVisServoTask::operator=(const PositionBa
 		normalAcc_ = rhs.normalAcc_;
 		jacMat_ = rhs.jacMat_;
 		jacDotMat_ = rhs.jacDotMat_;
+		shortJacMat_ = rhs.shortJacMat_;
 	}
 	return *this;
 }
@@ -923,8 +980,8 @@ void PositionBasedVisServoTask::update(const rbd::MultiBody& mb, const rbd::Mult
 		sva::MotionVecd(Eigen::Vector6d::Zero()))).vector() + (*L_pbvs_dot_)*(*surfaceVelocity_);
 
 	// compute the task Jacobian
-	Eigen::MatrixXd shortJacMat = (*L_pbvs_)*jac_.jacobian(mb, mbc, X_b_s_*mbc.bodyPosW[bodyIndex_]).block(0, 0, 6, jac_.dof());
-	jac_.fullJacobian(mb, shortJacMat, jacMat_);
+	shortJacMat_.noalias() = (*L_pbvs_)*jac_.jacobian(mb, mbc, X_b_s_*mbc.bodyPosW[bodyIndex_]).block(0, 0, 6, jac_.dof());
+	jac_.fullJacobian(mb, shortJacMat_, jacMat_);
 }
 
 
@@ -1676,7 +1733,9 @@ RelativeDistTask::RelativeDistTask(const rbd::MultiBody& mb,
 	eval_(1),
 	speed_(1),
 	normalAcc_(1),
-	jacMat_(1, mb.nrDof())
+	jacMat_(1, mb.nrDof()),
+	fullJac_(3, mb.nrDof()),
+	alphaVec_(mb.nrDof())
 {
 	rbInfo_[0] = RelativeDistTask::RelativeBodiesInfo(mb, rbi1, u1);
 	rbInfo_[1] = RelativeDistTask::RelativeBodiesInfo(mb, rbi2, u2);
@@ -1735,6 +1794,7 @@ void RelativeDistTask::update(const rbd::MultiBody& mb, const rbd::MultiBodyConf
 	const std::vector<sva::MotionVecd>& normalAccB)
 {
 	double sign = 1;
+	rbd::paramToVector(mbc.alpha, alphaVec_);
 	jacMat_.setZero();
 	eval_.setZero();
 	speed_.setZero();
@@ -1762,18 +1822,17 @@ void RelativeDistTask::update(const rbd::MultiBody& mb, const rbd::MultiBodyConf
 		eval_[0] += sign*d;
 
 		//Compute the jacobian matrix
-		Eigen::MatrixXd shortMat;
-		Eigen::MatrixXd fullJac;
-		fullJac.resize(3, mb.nrDof());
-		shortMat = rbi.jac.jacobian(mb, mbc);
-		rbi.jac.fullJacobian(mb, shortMat.block(3, 0, 3, rbi.jac.dof()), fullJac);
-		jacMat_ += sign*n.transpose()*fullJac;
+		const Eigen::MatrixXd& shortMat = rbi.jac.jacobian(mb, mbc);
+		rbi.jac.fullJacobian(mb, shortMat.block(3, 0, 3, rbi.jac.dof()), fullJac_);
+		jacMat_.noalias() += (sign*n.transpose())*fullJac_;
 
 		//Compute the speed
 		speed_[0] += sign*rbi.jac.velocity(mb, mbc).linear().dot(n);
 
 		//Compute the normal acceleration (JDot alpha)
-		normalAcc_[0] += sign*(fullJac*rbd::dofToVector(mb, mbc.alpha)).dot(dn)
+		Eigen::Vector3d fullJacAlpha;
+		fullJacAlpha.noalias() = fullJac_*alphaVec_;
+		normalAcc_[0] += sign*fullJacAlpha.dot(dn)
 					+ sign*rbi.jac.normalAcceleration(mb, mbc, normalAccB).linear().dot(n);
 
 		//Update offn and sign
@@ -1821,7 +1880,8 @@ VectorOrientationTask::VectorOrientationTask(const rbd::MultiBody &mb,
 	eval_(3),
 	speed_(3),
 	normalAcc_(3),
-	jacMat_(3, mb.nrDof())
+	jacMat_(3, mb.nrDof()),
+	fullJac_(3, mb.nrDof())
 {
 }
 
@@ -1835,10 +1895,10 @@ void VectorOrientationTask::update(const rbd::MultiBody &mb,
 	eval_ = targetVector_ - actualVector_;
 
 	//Evaluation of speed and jacMat
-	Eigen::MatrixXd shortMat, fullJac(3, mb.nrDof());
-	shortMat = jac_.bodyJacobian(mb, mbc);
-	jac_.fullJacobian(mb, shortMat.block(0, 0, 3, jac_.dof()), fullJac);
-	jacMat_ = -E_0_b*skewMatrix(bodyVector_)*fullJac;
+	const Eigen::MatrixXd& shortMat = jac_.bodyJacobian(mb, mbc);
+	jac_.fullJacobian(mb, shortMat.block(0, 0, 3, jac_.dof()), fullJac_);
+	Eigen::Matrix3d E_skew = -E_0_b*skewMatrix(bodyVector_);
+	jacMat_.noalias() = E_skew*fullJac_;
 	Eigen::Vector3d w_b_b = jac_.bodyVelocity(mb, mbc).angular();
 	speed_ = E_0_b*(w_b_b.cross(bodyVector_));
 
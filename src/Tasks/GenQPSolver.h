@@ -19,6 +19,8 @@
 
 // includes
 // std
+#include <chrono>
+#include <string>
 #include <vector>
 
 // Eigen
@@ -50,10 +52,86 @@ class GenQPSolver;
 
 /**
 	* Factory to create GenQPSolver implementation.
-	* Two argument are supported QLD and LSSOL.
+	* Supported arguments are QLD, GI, ADMM, SPARSE and LSSOL (if available).
 	*/
 TASKS_DLLAPI GenQPSolver* createQPSolver(const std::string& name);
 
+/// @return Name of all the GenQPSolver implementation createQPSolver can build.
+TASKS_DLLAPI std::vector<std::string> qpSolverNames();
+
+
+/**
+	* Linear map \f$ x = P x_r \f$ from the reduced variables \f$ x_r \f$
+	* to the full variables \f$ x \f$ defined by the variable dependencies.
+	* P has one non zero by line: the independent variables are stored as runs
+	* of consecutive variables and the dependent ones one by one.
+	*/
+struct VariableReduction
+{
+	/// size consecutive independent variables
+	struct Run
+	{
+		int full, reduced, size;
+	};
+
+	/// dependent variable x(full) = factor*x_r(reduced)
+	struct Replica
+	{
+		int full, reduced;
+		double factor;
+	};
+
+	VariableReduction():
+		nrFull(0),
+		nrReduced(0),
+		runs(),
+		replicas()
+	{}
+
+	int nrFull, nrReduced;
+	/// sorted by full index
+	std::vector<Run> runs;
+	/// sorted by full index
+	std::vector<Replica> replicas;
+};
+
+
+/// Number of constraint lines removed by the presolve (see GenQPSolver::presolve).
+struct PresolveStats
+{
+	PresolveStats():
+		nrLines(0),
+		nrEmptyLines(0),
+		nrUnboundedLines(0),
+		nrBoundLines(0)
+	{}
+
+	/// constraint lines before the presolve
+	int nrLines;
+	/// removed lines without non zero
+	int nrEmptyLines;
+	/// removed lines with an infinite bound
+	int nrUnboundedLines;
+	/// lines on one variable moved to the variable bounds
+	int nrBoundLines;
+};
+
+
+/**
+	* Outcome of GenQPSolver::solve, from the best to the worst.
+	*/
+enum class QPStatus
+{
+	/// optimal solution found
+	Success = 0,
+	/// the maximum number of iterations has been reached
+	MaxIter = 1,
+	/// the deadline has been reached
+	Timeout = 2,
+	/// infeasible problem or numerical failure
+	Failure = 3
+};
+
 
 /**
 	* Generic QP solver abstract interface.
@@ -68,8 +146,10 @@ class TASKS_DLLAPI GenQPSolver
 public:
 	/// Default QP solver.
 	static const std::string default_qp_solver;
+	typedef std::chrono::steady_clock Clock;
 
 public:
+	GenQPSolver();
 	virtual ~GenQPSolver() {}
 
 	/**
@@ -88,6 +168,9 @@ public:
 	*/
 	virtual void setDependencies(int nrVars, std::vector<std::tuple<int, int, double>> dependencies);
 
+	/// @return Reduction operator computed by the last setDependencies.
+	const VariableReduction& reduction() const;
+
 	/**
 		* Construct the QP matrices.
 		* @param tasks Build \f$ Q \f$ and \f$ c \f$.
@@ -104,13 +187,100 @@ public:
 
 	/**
 		* Solve the quadratic program.
+		* The backend must set status_.
 		* @return true of success false on failure.
 		*/
 	virtual bool solve() = 0;
 
+	/// @return Status of the last solve.
+	QPStatus status() const;
+
+	/**
+		* @return true if the last solve has been interrupted (see GenQPSolver::status)
+		* and result() is its last iterate, feasible up to the solver tolerance.
+		*/
+	virtual bool feasibleIterate() const;
+
+	/**
+		* Set the wall-clock time after which the solves stop at their next
+		* iteration with the QPStatus::Timeout status.
+		* Backends that can't be interrupted ignore it.
+		* No deadline (Clock::time_point::max()) by default.
+		*/
+	virtual void deadline(const Clock::time_point& d);
+	const Clock::time_point& deadline() const;
+
 	/// @return Optimal \f$ x \f$ vector.
 	virtual const Eigen::VectorXd& result() const = 0;
 
+	/**
+		* Enable or disable the warm start.
+		* When enabled each solve is seeded with the active set
+		* of the previous one (or with the seed given to GenQPSolver::seed).
+		*/
+	virtual void warmStart(bool w);
+	/// @return true if the warm start is enabled.
+	bool warmStart() const;
+
+	/**
+		* Seed the active set of the next warm started solve.
+		* @param activeSet Active inequality lines in the backend
+		* line order (see GenQPSolver::activeSet).
+		*/
+	virtual void seed(const std::vector<int>& activeSet);
+
+	/**
+		* Forget the active set and the iterates of the previous solve,
+		* the next warm started solve is then a cold start.
+		*/
+	virtual void resetWarmStart();
+
+	/**
+		* @return Active inequality lines of the last solve in the backend line order
+		* before the presolve (empty if the backend don't compute it).
+		*/
+	const std::vector<int>& activeSet() const;
+
+	/// @return Number of iterations of the last solve (-1 if unknown).
+	virtual int iterations() const;
+
+	/**
+		* @return true if instances of this implementation can solve at the
+		* same time in different threads.
+		*/
+	virtual bool reentrant() const
+	{
+		return true;
+	}
+
+	/**
+		* Set the maximum number of iterations of a solve, this is the fixed
+		* number of iterations for the first order backends.
+		* A negative value restores the default limit of the backend.
+		* Backends without iteration limit ignore it.
+		*/
+	virtual void maxIter(int maxIter);
+	/// @return Maximum number of iterations of a solve (-1 if unknown).
+	virtual int maxIter() const;
+
+	/// @return Primal residual of the last solve (-1 if unknown).
+	virtual double primalResidual() const;
+	/// @return Dual residual of the last solve (-1 if unknown).
+	virtual double dualResidual() const;
+
+	/**
+		* Enable or disable (the default) the presolve.
+		* When enabled updateMatrix removes the empty constraint lines and
+		* the lines with an infinite bound, and moves the lines on only one variable
+		* to the variable bounds. The variables are unchanged by the presolve.
+		* Backends without presolve ignore it.
+		*/
+	virtual void presolve(bool p);
+	/// @return true if the presolve is enabled.
+	bool presolve() const;
+	/// @return Lines removed by the presolve of the last updateMatrix.
+	const PresolveStats& presolveStats() const;
+
 	/// @return Error message if GenQPSolver::solve has returned false.
 	virtual std::ostream& errorMsg(const std::vector<rbd::MultiBody>& mbs,
 		const std::vector<Task*>& tasks,
@@ -129,6 +299,23 @@ protected:
 	 * full variable, replica variable index in the full variable and the factor
 	 * in the dependency equation: replica = factor * primary */
 	std::vector<std::tuple<int, int, double>> dependencies_;
+	/** Reduction operator of the dependencies, computed by setDependencies */
+	VariableReduction reduction_;
+
+	/** true if the solve must be seeded by activeSet_ */
+	bool warmStart_;
+	/** Active set of the last solve, used to seed the next solve */
+	std::vector<int> activeSet_;
+
+	/** true if updateMatrix must presolve the problem */
+	bool presolve_;
+	/** Statistics of the last presolve */
+	PresolveStats presolveStats_;
+
+	/** Solves are interrupted after this time */
+	Clock::time_point deadline_;
+	/** Status of the last solve */
+	QPStatus status_;
 };
 
 
@@ -276,6 +276,9 @@ public:
 	void updateNrCollisions();
 
 	// Constraint
+	/// Register the bodies in collision.
+	virtual void registerCache(const std::vector<rbd::MultiBody>& mbs,
+		SolverData& data);
 	virtual void updateNrVars(const std::vector<rbd::MultiBody>& mbs,
 		const SolverData& data);
 
@@ -290,7 +293,9 @@ public:
 	virtual int nrInEq() const;
 	virtual int maxInEq() const;
 
+	/// AInEq is totalAlphaD wide, only robots involved in a collision are set
 	virtual const Eigen::MatrixXd& AInEq() const;
+	virtual const std::vector<ColBlock>& AInEqBlocks() const;
 	virtual const Eigen::VectorXd& bInEq() const;
 
 private:
@@ -304,6 +309,8 @@ private:
 		rbd::Jacobian jac;
 		sva::PTransformd X_op_o;
 		int rIndex, bIndex;
+		/// body index in the SolverData kinematics cache
+		int jacIndex;
 		std::string bodyName;
 	};
 
@@ -336,6 +343,8 @@ private:
 
 	Eigen::MatrixXd AInEq_;
 	Eigen::VectorXd bInEq_;
+	std::vector<ColBlock> robotBlocks_; ///< alphaD block of each robot
+	std::vector<ColBlock> AInEqBlocks_;
 
 	Eigen::MatrixXd fullJac_, distJac_;
 
@@ -493,7 +502,11 @@ public:
 	// In Inequality Constraint
 	virtual int maxInEq() const;
 
+	/// AInEq only store the lambda columns of the gripper contacts
 	virtual const Eigen::MatrixXd& AInEq() const;
+	virtual const std::vector<ColBlock>& AInEqBlocks() const;
+	/// AInEq is only computed in updateNrVars
+	virtual int AInEqRevision() const;
 	virtual const Eigen::VectorXd& bInEq() const;
 
 private:
@@ -513,6 +526,8 @@ private:
 
 	Eigen::MatrixXd AInEq_;
 	Eigen::VectorXd bInEq_;
+	std::vector<ColBlock> AInEqBlocks_;
+	int AInEqRevision_;
 };
 
 
@@ -594,6 +609,9 @@ public:
 	void updateBoundedSpeeds();
 
 	// Constraint
+	/// Register the constrained bodies.
+	virtual void registerCache(const std::vector<rbd::MultiBody>& mbs,
+		SolverData& data);
 	virtual void updateNrVars(const std::vector<rbd::MultiBody>& mbs,
 		const SolverData& data);
 
@@ -607,7 +625,9 @@ public:
 	// Inequality Constraint
 	virtual int maxGenInEq() const;
 
+	/// AGenInEq only store the robot alphaD columns
 	virtual const Eigen::MatrixXd& AGenInEq() const;
+	virtual const std::vector<ColBlock>& AGenInEqBlocks() const;
 	virtual const Eigen::VectorXd& LowerGenInEq() const;
 	virtual const Eigen::VectorXd& UpperGenInEq() const;
 
@@ -623,6 +643,7 @@ private:
 			lSpeed(ls),
 			uSpeed(us),
 			body(j.jointsPath().back()),
+			jacIndex(-1),
 			bodyName(bName)
 		{}
 
@@ -631,6 +652,8 @@ private:
 		Eigen::MatrixXd dof;
 		Eigen::VectorXd lSpeed, uSpeed;
 		int body;
+		/// body index in the SolverData kinematics cache
+		int jacIndex;
 		std::string bodyName;
 	};
 
@@ -641,10 +664,11 @@ private:
 	int robotIndex_, alphaDBegin_;
 	std::vector<BoundedSpeedData> cont_;
 
-	Eigen::MatrixXd fullJac_;
+	Eigen::MatrixXd jacMat_, fullJac_;
 
 	Eigen::MatrixXd A_;
 	Eigen::VectorXd lower_, upper_;
+	std::vector<ColBlock> AGenInEqBlocks_;
 
 	int nrVars_;
 	double timeStep_;
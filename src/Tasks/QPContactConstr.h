@@ -81,24 +81,17 @@ public:
 	void resetDofContacts();
 
 protected:
-	struct ContactCommon
-	{
-		ContactId cId;
-		sva::PTransformd X_b1_cf;
-		sva::PTransformd X_b1_b2;
-
-		bool operator==(const ContactCommon& cc) const;
-		bool operator<(const ContactCommon& cc) const;
-	};
-
-protected:
-	std::set<ContactCommon> contactCommonInContact(
-		const std::vector<rbd::MultiBody>& mbs,
-		const SolverData& data);
+	/**
+		* Fill contacts_ with the contacts of data that are not virtual,
+		* sorted by ContactId and without duplicate.
+		*/
+	void contactsInContact(const SolverData& data);
 
 protected:
 	std::set<ContactId> virtualContacts_;
 	std::map<ContactId, Eigen::MatrixXd> dofContacts_;
+	/// contacts of the last contactsInContact call
+	std::vector<const BilateralContact*> contacts_;
 };
 
 
@@ -120,6 +113,9 @@ public:
 	void updateDofContacts();
 
 	// Constraint
+	/// Register the bodies in contact.
+	virtual void registerCache(const std::vector<rbd::MultiBody>& mbs,
+		SolverData& data);
 	virtual void updateNrVars(const std::vector<rbd::MultiBody>& mbs,
 		const SolverData& data);
 
@@ -129,7 +125,9 @@ public:
 	virtual int nrEq() const;
 	virtual int maxEq() const;
 
+	/// AEq is totalAlphaD wide, only robots in contact are set
 	virtual const Eigen::MatrixXd& AEq() const;
+	virtual const std::vector<ColBlock>& AEqBlocks() const;
 	virtual const Eigen::VectorXd& bEq() const;
 
 protected:
@@ -138,10 +136,12 @@ protected:
 		ContactSideData(int rI, int aDB, double s, const rbd::Jacobian& j,
 			const sva::PTransformd& Xbp):
 			robotIndex(rI), alphaDBegin(aDB), bodyIndex(j.jointsPath().back()),
-			sign(s), jac(j), X_b_p(Xbp)
+			jacIndex(-1), sign(s), jac(j), X_b_p(Xbp)
 		{}
 
 		int robotIndex, alphaDBegin, bodyIndex;
+		/// body index in the SolverData kinematics cache
+		int jacIndex;
 		double sign;
 		rbd::Jacobian jac;
 		sva::PTransformd X_b_p;
@@ -171,14 +171,29 @@ protected:
 
 protected:
 	void updateNrEq();
+	/**
+		* Add sign*dof*J to the rows lines of A_ starting at line,
+		* J being the Jacobian of the csd side at its contact frame.
+		* J is derived from the body Jacobian of the kinematics cache of data
+		* when it has been computed.
+		*/
+	void addSideJacobian(int line, const ContactData& cd,
+		ContactSideData& csd, const rbd::MultiBody& mb,
+		const rbd::MultiBodyConfig& mbc, const SolverData& data);
 
 protected:
+	/**
+		* nrCont_ active contacts followed by the removed ones, kept
+		* (up to SolverData::contactCapacity) to reuse their Jacobians
+		*/
 	std::vector<ContactData> cont_;
+	int nrCont_;
 
 	Eigen::MatrixXd fullJac_, dofJac_;
 
 	Eigen::MatrixXd A_;
 	Eigen::VectorXd b_;
+	std::vector<ColBlock> AEqBlocks_;
 
 	int nrEq_, totalAlphaD_;
 	double timeStep_;
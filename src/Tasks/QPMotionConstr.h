@@ -20,6 +20,7 @@
 // includes
 // std
 #include <map>
+#include <memory>
 
 // Eigen
 #include <Eigen/Core>
@@ -73,7 +74,9 @@ private:
 	int lambdaBegin_;
 	Eigen::VectorXd XL_, XU_;
 
-	std::vector<ContactData> cont_; // only usefull for descBound
+	/// nrCont_ first elements are the current contacts, only usefull for descBound
+	std::vector<ContactData> cont_;
+	int nrCont_;
 };
 
 
@@ -89,11 +92,21 @@ public:
 		std::vector<rbd::MultiBodyConfig>& mbcs) const;
 
 	// Constraint
+	/// Register the robot dynamics and the contact bodies of the robot.
+	virtual void registerCache(const std::vector<rbd::MultiBody>& mbs,
+		SolverData& data);
 	virtual void updateNrVars(const std::vector<rbd::MultiBody>& mbs,
 		const SolverData& data);
 
 	void computeMatrix(const std::vector<rbd::MultiBody>& mb,
 		const std::vector<rbd::MultiBodyConfig>& mbcs);
+	/**
+		* Same as above but the contact body Jacobians are taken from
+		* the kinematics cache of data when it has been computed
+		* (see SolverData::addBodyJacobian).
+		*/
+	void computeMatrix(const std::vector<rbd::MultiBody>& mb,
+		const std::vector<rbd::MultiBodyConfig>& mbcs, const SolverData& data);
 
 	// Description
 	virtual std::string nameGenInEq() const;
@@ -103,6 +116,7 @@ public:
 	virtual int maxGenInEq() const;
 
 	virtual const Eigen::MatrixXd& AGenInEq() const;
+	virtual const std::vector<ColBlock>& AGenInEqBlocks() const;
 	virtual const Eigen::VectorXd& LowerGenInEq() const;
 	virtual const Eigen::VectorXd& UpperGenInEq() const;
 
@@ -110,31 +124,61 @@ protected:
 	struct ContactData
 	{
 		ContactData() {}
-		ContactData(const rbd::MultiBody& mb,
-			const std::string& bodyName, int lambdaBegin,
-			std::vector<Eigen::Vector3d> points,
+		ContactData(int bodyIndex, const ContactId& contactId,
+			int lambdaBegin, const std::vector<Eigen::Vector3d>& points,
+			const std::vector<FrictionCone>& cones);
+
+		/// set the lambda position, the points and the generators
+		void update(int lambdaBegin, const std::vector<Eigen::Vector3d>& points,
 			const std::vector<FrictionCone>& cones);
 
 
+		ContactId contactId;
 		int bodyIndex;
+		/// body index in the SolverData kinematics cache
+		int jacIndex;
 		int lambdaBegin;
-		rbd::Jacobian jac;
+		/// only built when the kinematics cache is not computed
+		rbd::Jacobian fallbackJac;
 		std::vector<Eigen::Vector3d> points;
 		// BEWARE generator are minus to avoid one multiplication by -1 in the
 		// update method
 		std::vector<Eigen::Matrix<double, 3, Eigen::Dynamic> > minusGenerators;
 	};
 
+protected:
+	void computeMatrix(const std::vector<rbd::MultiBody>& mb,
+		const std::vector<rbd::MultiBodyConfig>& mbcs, const SolverData* data);
+	/// @return Forward dynamics used by the last computeMatrix.
+	const rbd::ForwardDynamics& currentFd() const
+	{
+		return cacheFd_ ? *cacheFd_ : fd_;
+	}
+
 protected:
 	int robotIndex_, alphaDBegin_, nrDof_, lambdaBegin_;
 	rbd::ForwardDynamics fd_;
+	/// robot index in the SolverData dynamics cache
+	int fdIndex_;
+	/**
+		* forward dynamics of the SolverData used by the last computeMatrix,
+		* null when fd_ has been computed instead
+		*/
+	std::shared_ptr<const rbd::ForwardDynamics> cacheFd_;
 	Eigen::MatrixXd fullJacLambda_, jacTrans_, jacLambda_;
+	/**
+		* nrCont_ active contacts followed by the removed ones, kept
+		* (up to SolverData::contactCapacity) to reuse their generators
+		*/
 	std::vector<ContactData> cont_;
+	int nrCont_;
 
 	Eigen::VectorXd curTorque_;
 
 	Eigen::MatrixXd A_;
 	Eigen::VectorXd AL_, AU_;
+	/// robot alphaD and robot contacts lambda blocks of A_
+	std::vector<ColBlock> AGenInEqBlocks_;
 };
 
 
@@ -149,14 +193,16 @@ public:
 		const std::vector<rbd::MultiBodyConfig>& mbcs,
 		const SolverData& data);
         //Matrix
-        const Eigen::MatrixXd matrix() const
+        const Eigen::MatrixXd& matrix() const
         {
           return A_;
         }
 	//Contact torque
 	Eigen::MatrixXd contactMatrix() const;
-	//Access fd...
-	const rbd::ForwardDynamics fd() const;
+	/// Same as contactMatrix but without allocation if res has the right size.
+	void contactMatrix(Eigen::MatrixXd& res) const;
+	/// @return Forward dynamics used by the last update.
+	const rbd::ForwardDynamics& fd() const;
 
 protected:
 	Eigen::VectorXd torqueL_, torqueU_;
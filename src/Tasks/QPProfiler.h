@@ -0,0 +1,122 @@
+// Copyright 2012-2016 CNRS-UM LIRMM, CNRS-AIST JRL
+//
+// This file is part of Tasks.
+//
+// Tasks is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Tasks is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with Tasks.  If not, see <http://www.gnu.org/licenses/>.
+
+#pragma once
+
+// includes
+// std
+#include <chrono>
+#include <map>
+#include <string>
+#include <vector>
+
+#include <tasks/config.hh>
+
+
+namespace tasks
+{
+
+namespace qp
+{
+
+
+/**
+	* Rolling statistics of the duration of the QPSolver phases.
+	*
+	* Each phase keep the duration of its last window() samples in a ring buffer,
+	* the statistics are only computed when asked.
+	* When disabled (the default) the QPSolver does not read the clock and
+	* only pay one branch by phase.
+	*
+	* Phases are identified by their name, or by the index returned by phase.
+	* record can be called from different threads on different phases but
+	* phase must not be called while a record is running.
+	*/
+class TASKS_DLLAPI QPProfiler
+{
+public:
+	typedef std::chrono::steady_clock Clock;
+
+	/// Statistics in seconds of the samples in the window.
+	struct Stats
+	{
+		/// number of samples in the window
+		int count;
+		double last, mean, p50, p99, max;
+	};
+
+public:
+	/// @param window Number of samples kept by phase.
+	QPProfiler(int window=1000);
+
+	void enabled(bool e)
+	{
+		enabled_ = e;
+	}
+
+	bool enabled() const
+	{
+		return enabled_;
+	}
+
+	/// Set the number of samples kept by phase, this clear all the samples.
+	void window(int w);
+	int window() const
+	{
+		return window_;
+	}
+
+	/// Clear the samples of all phases.
+	void reset();
+
+	/// @return Index of the phase name, the phase is created if needed.
+	int phase(const std::string& name);
+	/// @return Name of all phases in creation order.
+	std::vector<std::string> phases() const;
+
+	/// Add a duration (in seconds) to a phase.
+	void record(int phase, double duration);
+	/// Add the duration between start and now to a phase.
+	void record(int phase, Clock::time_point start)
+	{
+		record(phase, std::chrono::duration<double>(Clock::now() - start).count());
+	}
+
+	Stats stats(int phase) const;
+	/// @throw std::domain_error if the phase does not exist.
+	Stats stats(const std::string& name) const;
+
+private:
+	struct Phase
+	{
+		std::string name;
+		std::vector<double> samples;
+		/// next sample to overwrite and number of samples
+		int next, count;
+	};
+
+private:
+	std::vector<Phase> phases_;
+	std::map<std::string, int> index_;
+	int window_;
+	bool enabled_;
+};
+
+
+} // namespace qp
+
+} // namespace tasks
@@ -0,0 +1,262 @@
+// Copyright 2012-2016 CNRS-UM LIRMM, CNRS-AIST JRL
+//
+// This file is part of Tasks.
+//
+// Tasks is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Tasks is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with Tasks.  If not, see <http://www.gnu.org/licenses/>.
+
+#pragma once
+
+// includes
+// std
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <tuple>
+#include <vector>
+
+// Eigen
+#include <Eigen/Core>
+
+// Tasks
+#include "GenQPSolver.h"
+
+#include <tasks/config.hh>
+
+
+namespace tasks
+{
+
+namespace qp
+{
+class AFillCache;
+class QFillCache;
+
+
+/**
+	* QP of one solve in the general form (see GenQPSolver)
+	* \f$ L \leq A x \leq U \f$, \f$ XL \leq x \leq XU \f$
+	* on the full variables.
+	* The equality lines have \f$ L = U \f$ and the inequality lines \f$ L = -\infty \f$.
+	*/
+struct TASKS_DLLAPI QPRecord
+{
+	QPRecord();
+
+	int nrVars;
+	/// {primary, replica, factor} (see GenQPSolver::setDependencies)
+	std::vector<std::tuple<int, int, double>> dependencies;
+	/// symmetric
+	Eigen::MatrixXd Q;
+	Eigen::VectorXd C;
+	Eigen::MatrixXd A;
+	Eigen::VectorXd AL, AU;
+	Eigen::VectorXd XL, XU;
+
+	/// solution of the recorded solve
+	Eigen::VectorXd result;
+	QPStatus status;
+	int iterations;
+	/// duration in seconds of the constraints and tasks update and of the solve
+	double updateTime, solveTime;
+
+	/**
+		* Index of the record decoded by QPRecordReader::read (-1 if none),
+		* the next record is decoded from this one.
+		*/
+	int index;
+};
+
+
+/**
+	* Append the QP of each solve of a QPSolver to a binary file
+	* (see QPSolver::recorder).
+	*
+	* The records are buffered and written to the file when the buffer is full,
+	* by flush and by close.
+	* Each array of a record only stores the entries that have changed since
+	* the previous record, or all its entries if that is smaller.
+	* A key record, stored relatively to zero arrays, is written at the
+	* first record, when the problem size changes and every keyInterval records.
+	*
+	* The file use the native byte order and all the numbers are 8 bytes aligned
+	* so the file can be memory mapped:
+	* - file header: 8 chars magic "TASKSQP", int32 version, int32 0
+	* - each record: int64 record size in bytes (header included),
+	*   int32 nrVars, nrLines, nrDependencies, status, iterations, key,
+	*   float64 updateTime, solveTime
+	*   then the dependencies as {int32 primary, int32 replica, float64 factor},
+	*   the arrays Q upper triangle by lines, C, A by lines, AL, AU, XL and XU
+	*   and the float64 result.
+	* - each array: int64 count, if count is -1 all the float64 entries
+	*   else count int32 indices (padded to 8 bytes) and count float64 values
+	*   replacing the ones of the previous record.
+	*/
+class TASKS_DLLAPI QPRecorder
+{
+public:
+	static const char magic[8];
+	static const std::int32_t version;
+
+public:
+	QPRecorder();
+	~QPRecorder();
+
+	/**
+		* Create the file and write its header.
+		* @throw std::runtime_error if the file can't be created.
+		*/
+	void open(const std::string& path);
+	/// Write the buffered records and close the file.
+	void close();
+	bool isOpen() const;
+	/// Write the buffered records to the file.
+	void flush();
+
+	/// Set the size in bytes above which the buffer is written (1 MiB by default).
+	void bufferSize(std::size_t size);
+	std::size_t bufferSize() const;
+
+	/// Set the maximum number of records between two key records (100 by default).
+	void keyInterval(int interval);
+	int keyInterval() const;
+
+	/// Append a record, do nothing if the recorder is not open.
+	void record(int nrVars,
+		const std::vector<std::tuple<int, int, double>>& dependencies,
+		const std::vector<Task*>& tasks,
+		const std::vector<Equality*>& eqConstr,
+		const std::vector<Inequality*>& inEqConstr,
+		const std::vector<GenInequality*>& genInEqConstr,
+		const std::vector<Bound*>& boundConstr,
+		const Eigen::VectorXd& result, QPStatus status, int iterations,
+		double updateTime, double solveTime);
+
+	/// @return Number of records written since open.
+	int nrRecords() const;
+
+private:
+	/// Append the entries of cur that differ from prev to buffer_ and update prev.
+	void writeArray(const double* cur, double* prev, std::size_t size);
+
+private:
+	std::ofstream file_;
+	int nrRecords_;
+	std::vector<char> buffer_;
+	std::size_t bufferSize_;
+	int keyInterval_, nrSinceKey_;
+
+	Eigen::MatrixXd Q_;
+	Eigen::VectorXd C_;
+	Eigen::MatrixXd A_;
+	Eigen::VectorXd AL_, AU_;
+	Eigen::VectorXd XL_, XU_;
+	std::unique_ptr<QFillCache> QCache_;
+	std::unique_ptr<AFillCache> ACache_;
+	/// packed Q upper triangle and A by lines
+	std::vector<double> QPacked_;
+	Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor> ALines_;
+	/// arrays of the previous record in the file order
+	std::vector<double> prev_;
+	std::vector<std::int32_t> indices_;
+};
+
+
+/**
+	* Read a file written by QPRecorder.
+	* The whole file is loaded by open.
+	*/
+class TASKS_DLLAPI QPRecordReader
+{
+public:
+	QPRecordReader();
+
+	/**
+		* Load a record file.
+		* @throw std::runtime_error if the file can't be read or is not a record file.
+		*/
+	void open(const std::string& path);
+
+	int nrRecords() const;
+	/**
+		* Decode the i-th record in rec.
+		* The records are decoded from the previous key record, or only the i-th
+		* one if rec holds the (i - 1)-th record (see QPRecord::index).
+		* There is no allocation if rec already has the right sizes.
+		*/
+	void read(int i, QPRecord& rec) const;
+
+private:
+	/// Decode the arrays of the i-th record on the ones of rec.
+	void decode(int i, QPRecord& rec) const;
+
+private:
+	std::vector<char> data_;
+	/// offset of each record in data_
+	std::vector<std::size_t> offsets_;
+	/// key record of each record
+	std::vector<int> keys_;
+};
+
+
+/**
+	* Solve recorded QPs with a GenQPSolver implementation.
+	* The backend is only resized when the size or
+	* the dependencies of the records change.
+	*/
+class TASKS_DLLAPI QPReplay
+{
+public:
+	/// @param solverName GenQPSolver implementation (see createQPSolver).
+	QPReplay(const std::string& solverName);
+	~QPReplay();
+
+	/**
+		* Build and solve a record.
+		* @return true on success (see GenQPSolver::solve).
+		*/
+	bool solve(const QPRecord& rec);
+
+	const Eigen::VectorXd& result() const;
+
+	/// @return Duration in seconds of the last updateMatrix and solve.
+	double updateTime() const;
+	double solveTime() const;
+
+	GenQPSolver& solver();
+
+private:
+	struct Problem;
+
+private:
+	std::unique_ptr<GenQPSolver> solver_;
+	std::unique_ptr<Problem> problem_;
+	double updateTime_, solveTime_;
+};
+
+
+/**
+	* Write a record in the QPS format (MPS with a QUADOBJ section).
+	* The dependencies are written as equality lines
+	* \f$ x_{replica} - factor \, x_{primary} = 0 \f$.
+	* @param name Problem name.
+	*/
+TASKS_DLLAPI std::ostream& writeQPS(const QPRecord& rec, const std::string& name,
+	std::ostream& out);
+
+
+} // namespace qp
+
+} // namespace tasks
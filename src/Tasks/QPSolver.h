@@ -19,7 +19,12 @@
 
 // includes
 // std
+#include <list>
+#include <functional>
+#include <map>
 #include <memory>
+#include <string>
+#include <tuple>
 #include <vector>
 
 // boost
@@ -31,6 +36,7 @@
 // Tasks
 #include "QPSolverData.h"
 #include "QPContacts.h"
+#include "QPProfiler.h"
 
 #include <tasks/config.hh>
 
@@ -55,6 +61,35 @@ class GenInequality;
 class Bound;
 class Task;
 class GenQPSolver;
+struct PresolveStats;
+enum class QPStatus;
+class QPRecorder;
+class DecomposedQPSolver;
+class WorkerPool;
+
+
+
+/**
+	* Sizes reserved by a QPSolver (see QPSolver::capacity).
+	*/
+struct QPCapacity
+{
+	QPCapacity():
+		nrContacts(0),
+		nrLambda(0),
+		nrEqLines(0),
+		nrInEqLines(0),
+		nrGenInEqLines(0)
+	{}
+
+	/// unilateral and bilateral contacts, also the number of removed contacts
+	/// which data are kept by the constraints
+	int nrContacts;
+	/// contact force variables
+	int nrLambda;
+	/// lines of the equality, inequality and general inequality constraints
+	int nrEqLines, nrInEqLines, nrGenInEqLines;
+};
 
 
 
@@ -65,6 +100,8 @@ public:
 	~QPSolver();
 
 	/** solve the problem
+		*  mbcs is also filled when the solve is interrupted by the iteration
+		*  or time budget (see solverStatus).
 		*  \param mbs current multibody
 		*  \param mbcs current state of the multibody and result of the solved problem
 		*/
@@ -85,19 +122,86 @@ public:
 		*/
 	void updateMbc(rbd::MultiBodyConfig& mbc, int robotIndex) const;
 
+	/**
+		* Resize the solver to the maximum number of lines of the constraints.
+		* This call is optional: before each solve the solver grow if
+		* the constraints have more lines than it can hold.
+		* The solver never shrink between two updateConstrSize calls.
+		*/
 	void updateConstrSize();
 
+	/**
+		* Set the robots and the contacts.
+		* The solver is only resized when the number of variables,
+		* the mimic joints or the problem decomposition change
+		* (see capacity).
+		*/
 	void nrVars(const std::vector<rbd::MultiBody>& mbs,
 		std::vector<UnilateralContact> uni,
 		std::vector<BilateralContact> bi);
 	int nrVars() const;
 
-	/// call updateNrVars on all tasks
-	void updateTasksNrVars(const std::vector<rbd::MultiBody>& mbs) const;
-	/// call updateNrVars on all constraints
-	void updateConstrsNrVars(const std::vector<rbd::MultiBody>& mbs) const;
-	/// call updateNrVars on all tasks and constraints
-	void updateNrVars(const std::vector<rbd::MultiBody>& mbs) const;
+	/**
+		* Reserve the variables and the constraint lines needed by the largest
+		* contact set, taken into account at the next nrVars call.
+		* While the contacts fit in c.nrLambda the number of variables stay
+		* totalAlphaD + c.nrLambda: the unused contact force variables are
+		* in no constraint and are zero. A contact change then only rewrite
+		* the contact indices and the active sizes, neither the solver buffers
+		* nor the size of the task and constraint matrices change.
+		* The constraints also keep the data of c.nrContacts removed contacts,
+		* so switching between contacts already seen don't allocate.
+		* The default capacity is zero (the exact sizes are used).
+		*/
+	void capacity(const QPCapacity& c);
+	const QPCapacity& capacity() const;
+
+	/**
+		* Add a contact to the current contacts.
+		* This is a full relayout like nrVars: every task and constraint
+		* is updated, the constraints only reuse the data of the contacts
+		* they already know (see capacity).
+		* @return false if there is already a contact with this id,
+		* the contacts are then unchanged.
+		*/
+	bool addContact(const std::vector<rbd::MultiBody>& mbs,
+		const UnilateralContact& contact);
+	bool addContact(const std::vector<rbd::MultiBody>& mbs,
+		const BilateralContact& contact);
+	/**
+		* Remove a contact from the current contacts.
+		* This is a full relayout like addContact.
+		* @return false if there is no contact with this id.
+		*/
+	bool removeContact(const std::vector<rbd::MultiBody>& mbs,
+		const ContactId& contactId);
+
+	/**
+		* Set the number of solver backends kept by nrVars, 0 (the default)
+		* disable the cache.
+		* A backend is cached with the contact set it is sized for, its
+		* workspace, variable reduction and the problem decomposition.
+		* When nrVars come back to one of the last contact sets the backend
+		* is swapped in instead of being created and sized again, and the
+		* following updateConstrSize don't resize it if the lines still fit.
+		* This is not a full layout cache: nrVars still compute the SolverData
+		* and call the updateNrVars of every task and constraint on a hit,
+		* so the swap cost grows with the number of tasks and constraints.
+		* The cache is cleared when the solver or the decomposition change.
+		*/
+	void backendCacheSize(int size);
+	int backendCacheSize() const;
+	/// @return Number of nrVars calls that have found their backend in the cache.
+	int backendCacheHits() const;
+	/// @return Number of nrVars calls that have created a new backend.
+	int backendCacheMisses() const;
+
+	/// call registerCache and updateNrVars on all tasks
+	void updateTasksNrVars(const std::vector<rbd::MultiBody>& mbs);
+	/// call registerCache and updateNrVars on all constraints
+	void updateConstrsNrVars(const std::vector<rbd::MultiBody>& mbs);
+	/// call registerCache and updateNrVars on all tasks and constraints
+	void updateNrVars(const std::vector<rbd::MultiBody>& mbs);
 
 	void addEqualityConstraint(Equality* co);
 	void removeEqualityConstraint(Equality* co);
@@ -126,7 +230,131 @@ public:
 	void resetTasks();
 	int nrTasks() const;
 
+	/**
+		* Set the number of threads used to update the constraints and the tasks
+		* before building the QP.
+		* The threads are created once and reused at each solve.
+		* Constraint::update and Task::update must then only write their own data.
+		* @param nrThreads Number of threads including the solving one,
+		* 1 (the default) disable the parallel update.
+		*/
+	void nrThreads(int nrThreads);
+	int nrThreads() const;
+
+	/**
+		* Tasks with the same update group are updated sequentially,
+		* in the order they were added, when the update is parallel.
+		* This must be used for tasks sharing the same HighLevelTask.
+		* @param task Task to put in the group.
+		* @param group Group identifier, -1 (the default) to put the task
+		* in its own group.
+		*/
+	void taskUpdateGroup(Task* task, int group);
+	int taskUpdateGroup(Task* task) const;
+
 	void solver(const std::string& name);
+	/// @return Name of the current QP solver.
+	const std::string& solver() const;
+	/// @return Current QP solver, the DecomposedQPSolver when decomposed.
+	const GenQPSolver& solverBackend() const;
+
+	/**
+		* Set the QP solver of the QPSolver constructed afterward
+		* (GenQPSolver::default_qp_solver by default).
+		* This is not thread safe.
+		*/
+	static void defaultSolver(const std::string& name);
+	/// @return Name of the QP solver of the QPSolver constructed afterward.
+	static const std::string& defaultSolver();
+
+	/**
+		* Enable or disable (the default is disabled) the decomposition of the problem.
+		* The robots that are not linked by a contact, a task or a constraint
+		* (see Equality::AEqBlocks, a dense constraint link all the robots)
+		* are put in different components.
+		* Each component is then assembled and solved as an independent QP,
+		* in parallel if nrThreads is greater than one.
+		* The components are computed at nrVars call, on the next solve after
+		* a task or a constraint is added or removed and when a constraint
+		* change its column blocks to couple two components.
+		*/
+	void decompose(bool d);
+	bool decompose() const;
+	/// @return Number of independent components of the problem.
+	int nrComponents() const;
+	/// @return true if the problem is solved as independent sub problems.
+	bool decomposed() const;
+
+	/**
+		* Enable or disable the warm start of the current solver
+		* (see GenQPSolver::warmStart).
+		*/
+	void warmStart(bool w);
+	bool warmStart() const;
+	/**
+		* Forget the active set of the previous solve, the next warm started
+		* solve is a cold start (see GenQPSolver::resetWarmStart).
+		*/
+	void resetWarmStart();
+	/// @return Number of iterations of the last solve (-1 if unknown).
+	int solverIterations() const;
+	/**
+		* @return true if the current backend can solve at the same time as
+		* other QPSolver in other threads (see GenQPSolver::reentrant).
+		*/
+	bool solverReentrant() const;
+
+	/**
+		* Enable or disable the presolve of the QP matrices, disabled by default.
+		* The setting is kept when the solver is changed
+		* (see GenQPSolver::presolve).
+		*/
+	void presolve(bool p);
+	bool presolve() const;
+	/// @return Lines removed by the presolve of the last solve.
+	const PresolveStats& presolveStats() const;
+
+	/**
+		* Set the maximum number of iterations of the solver
+		* (see GenQPSolver::maxIter).
+		* The setting is kept when the solver is changed,
+		* a negative value (-1 is the default) restores and keeps
+		* the default of each solver.
+		*/
+	void solverMaxIter(int maxIter);
+	int solverMaxIter() const;
+	/// @return Primal residual of the last solve (-1 if unknown).
+	double solverPrimalResidual() const;
+	/// @return Dual residual of the last solve (-1 if unknown).
+	double solverDualResidual() const;
+
+	/**
+		* Set the wall-clock budget of solveNoMbcUpdate in seconds,
+		* infinite (no budget) by default.
+		* The solver stop at its next iteration when the budget is spent
+		* (see GenQPSolver::deadline) and is not called if the update of
+		* the constraints and tasks has already spent it.
+		*/
+	void solverTimeBudget(double budget);
+	double solverTimeBudget() const;
+	/**
+		* @return Status of the last solve, QPStatus::Timeout if the solver
+		* has not been called because the time budget was spent.
+		*/
+	QPStatus solverStatus() const;
+	/**
+		* @return true if the last solve has failed without feasible iterate.
+		* The result is then the result of the previous successful solve
+		* projected on the bounds (zero if there is none).
+		*/
+	bool solverFallback() const;
+
+	/**
+		* Record the QP of each solve with r, nullptr (the default)
+		* stop the recording. r is not owned by the solver.
+		*/
+	void recorder(QPRecorder* r);
+	QPRecorder* recorder() const;
 
 	const SolverData& data() const;
 	SolverData& data();
@@ -138,11 +366,37 @@ public:
 	Eigen::VectorXd lambdaVec() const;
 	Eigen::VectorXd lambdaVec(int cIndex) const;
 
+	/**
+		* Same as alphaDVec and lambdaVec but the result is written in res.
+		* There is no allocation if res already has the right size.
+		*/
+	void alphaDVec(Eigen::VectorXd& res) const;
+	void alphaDVec(int rIndex, Eigen::VectorXd& res) const;
+	void lambdaVec(Eigen::VectorXd& res) const;
+	void lambdaVec(int cIndex, Eigen::VectorXd& res) const;
+
 	int contactLambdaPosition(const ContactId& cId) const;
 
 	boost::timer::cpu_times solveTime() const;
 	boost::timer::cpu_times solveAndBuildTime() const;
 
+	/**
+		* Per phase timing of the solve, disabled by default
+		* (use profiler().enabled(true)).
+		* The recorded phases are:
+		* - computeNormalAccB: normal accelerations, cached body Jacobians
+		*   and robot dynamics (see SolverData::addBodyJacobian
+		*   and SolverData::addDynamics)
+		* - update: update of all the constraints and tasks
+		* - constraint[i] Name and task[i] Name: update of the i-th constraint
+		*   or task of the solver, Name being its type
+		* - updateMatrix: fill of the QP matrices by the backend
+		* - solve: backend solve
+		* - total: solveNoMbcUpdate
+		*/
+	QPProfiler& profiler();
+	const QPProfiler& profiler() const;
+
 protected:
 	void preUpdate(const std::vector<rbd::MultiBody>& mbs,
 								const std::vector<rbd::MultiBodyConfig>& mbcs);
@@ -150,6 +404,42 @@ protected:
 									std::vector<rbd::MultiBodyConfig>& mbcs,
 		bool success);
 
+private:
+	/// what a solver layout depends on
+	struct LayoutKey
+	{
+		int nrVars;
+		std::vector<ContactId> contacts;
+		std::vector<int> alphaD, lambda;
+		std::vector<std::tuple<int, int, double>> dependencies;
+
+		bool operator==(const LayoutKey& k) const;
+	};
+
+	struct Layout
+	{
+		LayoutKey key;
+		std::unique_ptr<GenQPSolver> solver;
+		DecomposedQPSolver* decomposedSolver;
+		std::vector<int> varComponents;
+		int nrComponents;
+		int maxEqLines, maxInEqLines, maxGenInEqLines;
+	};
+
+private:
+	bool updateComponents();
+	/// Update the components and replace the solver if they have changed.
+	void resetComponents();
+	bool swapLayout();
+	void resetSolver();
+	void resetSolver(bool presolve);
+	void growConstrSize();
+	void computeFallback();
+	void updateJobs();
+	void updatePhases();
+	void runJob(int job, const std::vector<rbd::MultiBody>& mbs,
+		const std::vector<rbd::MultiBodyConfig>& mbcs, bool profile);
+
 private:
 	std::vector<Constraint*> constr_;
 	std::vector<Equality*> eqConstr_;
@@ -162,10 +452,126 @@ private:
 	SolverData data_;
 
 	int maxEqLines_, maxInEqLines_, maxGenInEqLines_;
+	QPCapacity capacity_;
 
 	std::unique_ptr<GenQPSolver> solver_;
+	std::string solverName_;
+	/// iteration limit given to the solvers, negative to keep their default
+	int solverMaxIter_;
+	QPRecorder* recorder_;
+	/// time budget of a solve in seconds
+	double solverTimeBudget_;
+	QPStatus solverStatus_;
+	/// last usable result and fallback result if solverFallback_ is true
+	bool solverFallback_;
+	Eigen::VectorXd lastResult_;
+	Eigen::VectorXd fallbackResult_;
+	std::vector<std::tuple<int, int, double>> dependencies_;
+	/// dependencies computed by nrVars
+	std::vector<std::tuple<int, int, double>> newDependencies_;
+
+	// problem decomposition, decomposedSolver_ is solver_ when decomposed
+	bool decompose_;
+	std::vector<int> varComponents_;
+	int nrComponents_;
+	/// a task or a constraint has been added or removed
+	bool componentsDirty_;
+	DecomposedQPSolver* decomposedSolver_;
+	/// updateComponents work vectors
+	std::vector<int> componentParent_, varRobot_, rootComponent_,
+		newVarComponents_;
+
+	// backends of the last contact sets, most recently used first
+	LayoutKey layoutKey_;
+	std::list<Layout> layouts_;
+	int backendCacheSize_;
+	int backendCacheHits_, backendCacheMisses_;
+	/// true if the backend comes from the cache and is not resized since
+	bool backendSwapped_;
+
+	// parallel update of the constraints and tasks
+	std::unique_ptr<WorkerPool> pool_;
+	std::map<const Task*, int> taskGroups_;
+	/**
+		* each job update the constraint constr (-1 if none) and
+		* the tasks in [begin, end) of jobTasks_, all are index in constr_ and tasks_
+		*/
+	struct UpdateJob
+	{
+		int constr;
+		int begin, end;
+	};
+	std::vector<UpdateJob> jobs_;
+	std::vector<int> jobTasks_;
+	bool jobsDirty_;
 
 	boost::timer::cpu_timer solverTimer_, solverAndBuildTimer_;
+
+	QPProfiler profiler_;
+	/// profiler phase of the solve steps and of each constraint and task
+	int normalAccBPhase_, updatePhase_, updateMatrixPhase_, solvePhase_,
+		totalPhase_;
+	std::vector<int> constrPhases_, taskPhases_;
+	bool phasesDirty_;
+};
+
+
+
+/**
+	* Solve batches of independent configurations in parallel.
+	*
+	* Tasks and constraints keep their state between update and solve and
+	* have no copy interface, so each thread has its own QPSolver built by
+	* the user given builder with its own tasks and constraints.
+	* The solvers and the worker threads are created once and reused
+	* by each solve.
+	*/
+class TASKS_DLLAPI QPBatchSolver
+{
+public:
+	/**
+		* Build a solver: add its tasks and constraints and call nrVars.
+		* The tasks and constraints must outlive the QPBatchSolver.
+		*/
+	typedef std::function<void(QPSolver&)> Builder;
+
+	/**
+		* @param nrThreads Number of threads, including the calling one.
+		* @param build Called once for each solver. If the first built solver
+		* backend is not reentrant (see QPSolver::solverReentrant) only one
+		* solver is built.
+		* @throw std::domain_error if nrThreads is lower than one or if the
+		* built solvers have different variables number.
+		*/
+	QPBatchSolver(int nrThreads, const Builder& build);
+	~QPBatchSolver();
+
+	QPBatchSolver(const QPBatchSolver&) = delete;
+	QPBatchSolver& operator=(const QPBatchSolver&) = delete;
+
+	/// @return Number of solvers, one per thread.
+	int nrSolvers() const;
+	/// @return Solver of the thread i, to change its settings.
+	QPSolver& solver(int i);
+
+	/**
+		* Solve each configuration of the batch.
+		* Each thread take the next unsolved configuration until the batch
+		* is done. Only one thread is used if a solver backend is not reentrant.
+		* @param mbs Multibodies shared by all the configurations.
+		* @param mbcsBatch Configurations to solve (not modified).
+		* @param results Result vector of each configuration
+		* (resized to nrVars x mbcsBatch.size() if needed).
+		* @param success Success of each configuration (resized if needed).
+		* @return Number of configurations successfully solved.
+		*/
+	int solve(const std::vector<rbd::MultiBody>& mbs,
+		const std::vector<std::vector<rbd::MultiBodyConfig>>& mbcsBatch,
+		Eigen::MatrixXd& results, Eigen::Array<bool, Eigen::Dynamic, 1>& success);
+
+private:
+	std::vector<std::unique_ptr<QPSolver>> solvers_;
+	std::unique_ptr<WorkerPool> pool_;
 };
 
 
@@ -174,6 +580,17 @@ class TASKS_DLLAPI Constraint
 {
 public:
 	virtual ~Constraint() {}
+
+	/**
+		* Register the bodies and robots read from the kinematics and dynamics
+		* caches of data (see SolverData::addBodyJacobian and
+		* SolverData::addDynamics).
+		* Called by QPSolver before updateNrVars, the default register nothing.
+		*/
+	virtual void registerCache(const std::vector<rbd::MultiBody>& /* mbs */,
+		SolverData& /* data */)
+	{}
+
 	virtual void updateNrVars(const std::vector<rbd::MultiBody>& msb,
 		const SolverData& data) = 0;
 
@@ -231,6 +648,71 @@ private:
 
 
 
+/**
+	* Dense column block of a constraint matrix.
+	* Columns [srcCol, srcCol + size) of the constraint matrix hold the
+	* coefficients of the variables [col, col + size).
+	* The full block (see full) hold all the variables, its size is
+	* only known by the solver.
+	*/
+struct TASKS_DLLAPI ColBlock
+{
+	ColBlock(int c, int s, int sc):
+		col(c),
+		size(s),
+		srcCol(sc)
+	{}
+
+	/// @return Block of a dense and nrVars columns wide matrix.
+	static ColBlock full()
+	{
+		return ColBlock(0, -1, 0);
+	}
+
+	/// @return true if the block is the full block.
+	bool isFull() const
+	{
+		return size == -1;
+	}
+
+	/// @return Number of columns of the block in a problem with nrVars variables.
+	int cols(int nrVars) const
+	{
+		return isFull() ? nrVars : size;
+	}
+
+	int col; ///< first variable of the block
+	int size; ///< number of columns, -1 for the full block
+	int srcCol; ///< first column of the block in the constraint matrix
+};
+
+
+/**
+	* @return true if blocks only hold the full block.
+	*/
+TASKS_DLLAPI bool isDenseColBlocks(const std::vector<ColBlock>& blocks);
+
+
+/**
+	* Expand a constraint matrix and its column blocks
+	* (see Equality::AEqBlocks) into a nrVars columns wide matrix.
+	* @param nrVars Number of variables, can be -1 if blocks is dense.
+	* @throw std::domain_error if nrVars is -1 and blocks is not dense or
+	* if A don't fit in nrVars columns.
+	*/
+TASKS_DLLAPI Eigen::MatrixXd expandColBlocks(const Eigen::MatrixXd& A,
+	const std::vector<ColBlock>& blocks, int nrVars);
+
+
+/**
+	* @return A revision number never returned before.
+	* Tasks and constraints with a matrix that rarely change tag it with
+	* a new revision each time it's modified (see Task::QRevision).
+	*/
+TASKS_DLLAPI int newRevision();
+
+
+
 class TASKS_DLLAPI Equality
 {
 public:
@@ -239,6 +721,18 @@ public:
 	virtual int nrEq() const { return maxEq(); }
 
 	virtual const Eigen::MatrixXd& AEq() const = 0;
+	/**
+		* Non zero column blocks of AEq.
+		* The full block alone (the default) means that AEq is dense and
+		* nrVars columns wide, otherwise all columns outside the blocks are zero
+		* and AEq can be narrower than nrVars.
+		* An empty list means that AEq has no non zero column.
+		*/
+	virtual const std::vector<ColBlock>& AEqBlocks() const;
+	/**
+		* Revision of AEq and AEqBlocks (see Task::QRevision).
+		*/
+	virtual int AEqRevision() const { return -1; }
 	virtual const Eigen::VectorXd& bEq() const = 0;
 
 	virtual std::string nameEq() const = 0;
@@ -266,6 +760,18 @@ public:
 	virtual int nrInEq() const { return maxInEq(); }
 
 	virtual const Eigen::MatrixXd& AInEq() const = 0;
+	/**
+		* Non zero column blocks of AInEq.
+		* The full block alone (the default) means that AInEq is dense and
+		* nrVars columns wide, otherwise all columns outside the blocks are zero
+		* and AInEq can be narrower than nrVars.
+		* An empty list means that AInEq has no non zero column.
+		*/
+	virtual const std::vector<ColBlock>& AInEqBlocks() const;
+	/**
+		* Revision of AInEq and AInEqBlocks (see Task::QRevision).
+		*/
+	virtual int AInEqRevision() const { return -1; }
 	virtual const Eigen::VectorXd& bInEq() const = 0;
 
 	virtual std::string nameInEq() const = 0;
@@ -293,6 +799,18 @@ public:
 	virtual int nrGenInEq() const { return maxGenInEq(); }
 
 	virtual const Eigen::MatrixXd& AGenInEq() const = 0;
+	/**
+		* Non zero column blocks of AGenInEq.
+		* The full block alone (the default) means that AGenInEq is dense and
+		* nrVars columns wide, otherwise all columns outside the blocks are zero
+		* and AGenInEq can be narrower than nrVars.
+		* An empty list means that AGenInEq has no non zero column.
+		*/
+	virtual const std::vector<ColBlock>& AGenInEqBlocks() const;
+	/**
+		* Revision of AGenInEq and AGenInEqBlocks (see Task::QRevision).
+		*/
+	virtual int AGenInEqRevision() const { return -1; }
 	virtual const Eigen::VectorXd& LowerGenInEq() const = 0;
 	virtual const Eigen::VectorXd& UpperGenInEq() const = 0;
 
@@ -358,15 +876,47 @@ public:
 
 	virtual std::pair<int, int> begin() const = 0;
 
+	/// Same as Constraint::registerCache.
+	virtual void registerCache(const std::vector<rbd::MultiBody>& /* mbs */,
+		SolverData& /* data */)
+	{}
+
 	virtual void updateNrVars(const std::vector<rbd::MultiBody>& mbs,
 		const SolverData& data) = 0;
 	virtual void update(const std::vector<rbd::MultiBody>& mbs,
 		const std::vector<rbd::MultiBodyConfig>& mbcs,
 		const SolverData& data) = 0;
 
+	/**
+		* Symmetric matrix of the task, added on the diagonal of the problem
+		* matrix at begin().
+		* Only its upper triangular part is read by the solvers.
+		*/
 	virtual const Eigen::MatrixXd& Q() const = 0;
 	virtual const Eigen::VectorXd& C() const = 0;
 
+	/**
+		* Revision of Q and begin.
+		* A solver only accumulate again the Q matrix of a task
+		* when its revision or its weight have changed since the last solve.
+		* -1 (the default) mean that Q change at each update.
+		*/
+	virtual int QRevision() const { return -1; }
+
+	/**
+		* @return true if the task objective is given in least squares form
+		* \f$ \frac{1}{2} \| A_{LS} x - b_{LS} \|^2 \f$ (see Task::ALS).
+		* Q and C are then not used by the solvers.
+		*/
+	virtual bool isLeastSquares() const { return false; }
+	/**
+		* Least squares matrix of the task, its columns start at begin().second.
+		* The task weight is applied by the solver.
+		*/
+	virtual const Eigen::MatrixXd& ALS() const;
+	/// Least squares vector of the task.
+	virtual const Eigen::VectorXd& bLS() const;
+
 private:
 	double weight_;
 };
@@ -380,6 +930,14 @@ public:
 
 	virtual int dim() = 0;
 
+	/**
+		* Same as Constraint::registerCache, called by the registerCache
+		* of the tasks using this HighLevelTask.
+		*/
+	virtual void registerCache(const std::vector<rbd::MultiBody>& /* mbs */,
+		SolverData& /* data */)
+	{}
+
 	virtual void update(const std::vector<rbd::MultiBody>& mbs,
 		const std::vector<rbd::MultiBodyConfig>& mbcs,
 		const SolverData& data) = 0;
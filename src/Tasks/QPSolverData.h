@@ -18,9 +18,21 @@
 #pragma once
 
 // includes
+// std
+#include <memory>
+#include <string>
+#include <vector>
+
+// Eigen
+#include <Eigen/Core>
+
 // SpaceVecAlg
 #include <SpaceVecAlg/SpaceVecAlg>
 
+// RBDyn
+#include <RBDyn/FD.h>
+#include <RBDyn/Jacobian.h>
+
 // Tasks
 #include "QPContacts.h"
 
@@ -115,6 +127,17 @@ public:
 		return static_cast<int>(uniCont_.size() + biCont_.size());
 	}
 
+	/**
+		* @return Number of contacts reserved by QPSolver::capacity,
+		* at least nrContacts.
+		* The constraints keep the data of this number of removed contacts
+		* to switch back to them without allocation.
+		*/
+	int contactCapacity() const
+	{
+		return contactCapacity_;
+	}
+
 	const std::vector<UnilateralContact>& unilateralContacts() const
 	{
 		return uniCont_;
@@ -143,6 +166,130 @@ public:
 		return normalAccB_[robotIndex];
 	}
 
+	/**
+		* Add a body to the kinematics cache and return its index.
+		* The body Jacobian of each cached body is computed once by cycle,
+		* before the update of the constraints and tasks (see bodyJacobian),
+		* the body velocity and normal acceleration being in
+		* MultiBodyConfig::bodyVelB and normalAccB.
+		* Called from Constraint::registerCache and Task::registerCache.
+		* The entries are kept by QPSolver::nrVars while the robots don't change
+		* but only the bodies registered again are computed.
+		* @return Index of the body in the cache.
+		*/
+	int addBodyJacobian(const rbd::MultiBody& mb, int robotIndex,
+		const std::string& bodyName);
+
+	/**
+		* @return Index of a body registered by addBodyJacobian
+		* since the last QPSolver::nrVars, -1 if the body is not in the cache.
+		*/
+	int bodyJacobianIndex(int robotIndex, int bodyIndex) const;
+
+	/**
+		* @return true if the entry index of the kinematics cache is the body
+		* bodyIndex of robotIndex and has been computed for the current cycle.
+		* The users fall back to their own Jacobian when false.
+		*/
+	bool bodyJacobianComputed(int index, int robotIndex, int bodyIndex) const
+	{
+		return cachesComputed_ && index >= 0 && index < int(bodyJac_.size()) &&
+			bodyJac_[index].used && bodyJac_[index].robotIndex == robotIndex &&
+			bodyJac_[index].bodyIndex == bodyIndex;
+	}
+
+	/**
+		* @return Body Jacobian of the current cycle
+		* (see rbd::Jacobian::bodyJacobian).
+		* The Jacobian at a frame p of the body is X_b_p.matrix()*bodyJacobian,
+		* like rbd::Jacobian::jacobian(mb, mbc, X_b_p*X_0_b).
+		* @param index Body index in the cache (see addBodyJacobian).
+		*/
+	const Eigen::MatrixXd& bodyJacobian(int index) const
+	{
+		return bodyJac_[index].mat;
+	}
+
+	/// @return Jacobian of the body in the cache (see addBodyJacobian).
+	const rbd::Jacobian& jacobian(int index) const
+	{
+		return bodyJac_[index].jac;
+	}
+
+	/// Compute the body Jacobian of each body in the cache.
+	void computeBodyJacobians(const std::vector<rbd::MultiBody>& mbs,
+		const std::vector<rbd::MultiBodyConfig>& mbcs);
+
+	/**
+		* Add a robot to the dynamics cache and return its index.
+		* The mass matrix and the bias forces of each cached robot are computed
+		* once by cycle, like the body Jacobians (see addBodyJacobian).
+		* @return Index of the robot in the cache.
+		*/
+	int addDynamics(const rbd::MultiBody& mb, int robotIndex);
+
+	/**
+		* @return Index of a robot registered by addDynamics
+		* since the last QPSolver::nrVars, -1 if the robot is not in the cache.
+		*/
+	int dynamicsIndex(int robotIndex) const;
+
+	/**
+		* @return true if the entry index of the dynamics cache is the robot
+		* robotIndex and has been computed for the current cycle.
+		*/
+	bool dynamicsComputed(int index, int robotIndex) const
+	{
+		return cachesComputed_ && index >= 0 && index < int(dynamics_.size()) &&
+			dynamics_[index].used && dynamics_[index].robotIndex == robotIndex;
+	}
+
+	/**
+		* @return Forward dynamics of the current cycle,
+		* H and C are computed (see rbd::ForwardDynamics::computeH and computeC).
+		* @param index Robot index in the cache (see addDynamics).
+		*/
+	const rbd::ForwardDynamics& forwardDynamics(int index) const
+	{
+		return *dynamics_[index].fd;
+	}
+
+	/**
+		* Same as forwardDynamics, the entry is kept alive by the returned pointer
+		* when it is removed from the cache or when the SolverData is destroyed.
+		*/
+	std::shared_ptr<const rbd::ForwardDynamics> sharedForwardDynamics(int index) const
+	{
+		return dynamics_[index].fd;
+	}
+
+	/// Compute H and C of each robot in the cache.
+	void computeDynamics(const std::vector<rbd::MultiBody>& mbs,
+		const std::vector<rbd::MultiBodyConfig>& mbcs);
+
+	/**
+		* @return true if the kinematics and dynamics caches have been computed
+		* for the current cycle, that is during the update of the constraints
+		* and tasks by QPSolver (see computeCaches).
+		*/
+	bool cachesComputed() const
+	{
+		return cachesComputed_;
+	}
+
+	/**
+		* Compute the body Jacobians and the dynamics of the caches and
+		* mark them computed until resetCaches.
+		*/
+	void computeCaches(const std::vector<rbd::MultiBody>& mbs,
+		const std::vector<rbd::MultiBodyConfig>& mbcs);
+
+	/// Mark the caches as not computed for the current cycle.
+	void resetCaches()
+	{
+		cachesComputed_ = false;
+	}
+
 private:
 	std::vector<int> alphaD_; //< each robot alphaD vector size
 	std::vector<int> alphaDBegin_; //< each robot alphaD vector begin in x
@@ -151,14 +298,41 @@ private:
 	int totalAlphaD_, totalLambda_;
 	int nrUniLambda_, nrBiLambda_;
 	int nrVars_; //< total number of var
+	int contactCapacity_; //< max(capacity, nrContacts)
 
 	std::vector<UnilateralContact> uniCont_;
 	std::vector<BilateralContact> biCont_;
 	std::vector<BilateralContact> allCont_;
+	/// removed contacts of allCont_, kept to reuse their memory
+	std::vector<BilateralContact> spareCont_;
 
 	std::vector<int> mobileRobotIndex_; //< robot index with dof > 0
 	/// normal acceleration of each body of each robot
 	std::vector<std::vector<sva::MotionVecd>> normalAccB_;
+
+	struct BodyJacobian
+	{
+		int robotIndex, bodyIndex;
+		rbd::Jacobian jac;
+		Eigen::MatrixXd mat;
+		/// registered since the last nrVars
+		bool used;
+	};
+	/// kinematics cache, filled by the registerCache of the constraints and tasks
+	std::vector<BodyJacobian> bodyJac_;
+
+	struct RobotDynamics
+	{
+		int robotIndex;
+		/// shared with the users of the cache (see sharedForwardDynamics)
+		std::shared_ptr<rbd::ForwardDynamics> fd;
+		/// registered since the last nrVars
+		bool used;
+	};
+	/// dynamics cache, filled by the registerCache of the constraints and tasks
+	std::vector<RobotDynamics> dynamics_;
+	/// true between computeCaches and resetCaches
+	bool cachesComputed_;
 };
 
 
@@ -62,15 +62,49 @@ public:
 		return dimWeight_;
 	}
 
+	/**
+		* Use the least squares form of the task
+		* \f$ \frac{1}{2} \| W^{1/2} (J \ddot{q} - e) \|^2 \f$
+		* instead of computing \f$ J^T W J \f$.
+		* dimWeight must be positive.
+		* In this mode only ALS and bLS are computed, Q and C throw
+		* std::domain_error.
+		*/
+	void leastSquares(bool ls)
+	{
+		leastSquares_ = ls;
+	}
+
+	/// Register the caches used by the HighLevelTask.
+	virtual void registerCache(const std::vector<rbd::MultiBody>& mbs,
+		SolverData& data);
 	virtual void updateNrVars(const std::vector<rbd::MultiBody>& mbs,
 		const SolverData& data);
 
+	/// @throw std::domain_error in least squares mode.
 	virtual const Eigen::MatrixXd& Q() const;
+	/// @throw std::domain_error in least squares mode.
 	virtual const Eigen::VectorXd& C() const;
 
+	virtual bool isLeastSquares() const
+	{
+		return leastSquares_;
+	}
+	virtual const Eigen::MatrixXd& ALS() const;
+	virtual const Eigen::VectorXd& bLS() const;
+
 protected:
 	void computeQC(Eigen::VectorXd& error);
 
+private:
+	/**
+		* computeQC kernel for a task of Rows dimensions.
+		* 3D and 6D tasks use a fixed row count so the products over the
+		* task dimension are unrolled.
+		*/
+	template<int Rows>
+	void computeQC(Eigen::VectorXd& error);
+
 protected:
 	HighLevelTask* hlTask_;
 	Eigen::VectorXd error_;
@@ -81,6 +115,9 @@ private:
 
 	Eigen::MatrixXd Q_;
 	Eigen::VectorXd C_;
+	bool leastSquares_;
+	Eigen::MatrixXd ALS_;
+	Eigen::VectorXd bLS_;
 	// cache
 	Eigen::MatrixXd preQ_;
 	Eigen::VectorXd preC_;
@@ -263,6 +300,9 @@ public:
 		return std::make_pair(alphaDBegin_, alphaDBegin_);
 	}
 
+	/// Register the caches used by the HighLevelTask.
+	virtual void registerCache(const std::vector<rbd::MultiBody>& mbs,
+		SolverData& data);
 	virtual void updateNrVars(const std::vector<rbd::MultiBody>& mbs,
 		const SolverData& data);
 	virtual void update(const std::vector<rbd::MultiBody>& mbs,
@@ -318,6 +358,8 @@ public:
 	}
 
 	virtual int dim();
+	virtual void registerCache(const std::vector<rbd::MultiBody>& mbs,
+		SolverData& data);
 	virtual void update(const std::vector<rbd::MultiBody>& mbs,
 		const std::vector<rbd::MultiBodyConfig>& mbcs,
 		const SolverData& data);
@@ -388,6 +430,8 @@ public:
                    const TorqueBound& tb, const std::string& efName,
                    double weight);
 
+	virtual void registerCache(const std::vector<rbd::MultiBody>& mbs,
+		SolverData& data);
 	virtual void updateNrVars(const std::vector<rbd::MultiBody>& mbs,
 		const SolverData& data);
 	virtual void update(const std::vector<rbd::MultiBody>& mbs,
@@ -421,6 +465,9 @@ private:
         Eigen::VectorXd jointSelector_;
         Eigen::MatrixXd Q_;
         Eigen::VectorXd C_;
+        // cache
+        Eigen::MatrixXd preQ_;
+        Eigen::VectorXd preC_;
 };
 
 class TASKS_DLLAPI PostureTask : public Task
@@ -478,6 +525,11 @@ public:
 
 	virtual const Eigen::MatrixXd& Q() const;
 	virtual const Eigen::VectorXd& C() const;
+	/// Q is the constant posture jacobian
+	virtual int QRevision() const
+	{
+		return QRevision_;
+	}
 
 	const Eigen::VectorXd& eval() const;
 
@@ -500,6 +552,7 @@ private:
 	Eigen::MatrixXd Q_;
 	Eigen::VectorXd C_;
 	Eigen::VectorXd alphaVec_;
+	int QRevision_;
 };
 
 
@@ -537,6 +590,9 @@ public:
 	}
 
 	virtual int dim();
+	/// Register the body in the kinematics cache.
+	virtual void registerCache(const std::vector<rbd::MultiBody>& mbs,
+		SolverData& data);
 	virtual void update(const std::vector<rbd::MultiBody>& mb,
 		const std::vector<rbd::MultiBodyConfig>& mbc,
 		const SolverData& data);
@@ -548,7 +604,10 @@ public:
 
 private:
 	tasks::PositionTask pt_;
-	int robotIndex_;
+	std::string bodyName_;
+	int robotIndex_, bodyIndex_;
+	/// body index in the SolverData kinematics cache
+	int jacIndex_;
 };
 
 
@@ -582,6 +641,9 @@ public:
 	}
 
 	virtual int dim();
+	/// Register the body in the kinematics cache.
+	virtual void registerCache(const std::vector<rbd::MultiBody>& mbs,
+		SolverData& data);
 	virtual void update(const std::vector<rbd::MultiBody>& mbs,
 		const std::vector<rbd::MultiBodyConfig>& mbcs,
 		const SolverData& data);
@@ -593,7 +655,10 @@ public:
 
 private:
 	tasks::OrientationTask ot_;
-	int robotIndex_;
+	std::string bodyName_;
+	int robotIndex_, bodyIndex_;
+	/// body index in the SolverData kinematics cache
+	int jacIndex_;
 };
 
 
@@ -675,9 +740,18 @@ public:
 		const std::string& bodyName, const sva::PTransformd& X_0_t,
 		const sva::PTransformd& X_b_p=sva::PTransformd::Identity());
 
+	/// Register the body in the kinematics cache.
+	virtual void registerCache(const std::vector<rbd::MultiBody>& mbs,
+		SolverData& data);
 	virtual void update(const std::vector<rbd::MultiBody>& mb,
 		const std::vector<rbd::MultiBodyConfig>& mbc,
 		const SolverData& data);
+
+private:
+	std::string bodyName_;
+	int bodyIndex_;
+	/// body index in the SolverData kinematics cache
+	int jacIndex_;
 };
 
 
@@ -939,6 +1013,7 @@ private:
 	Eigen::Vector3d CSum_;
 	// cache
 	Eigen::MatrixXd preQ_;
+	Eigen::Vector3d preC_;
 };
 
 
@@ -1057,7 +1132,8 @@ public:
 		error_(Eigen::Vector3d::Zero()),
 		errorD_(Eigen::Vector3d::Zero()),
 		Q_(),
-		C_()
+		C_(),
+		QRevision_(-1)
 	{}
 
 	virtual std::pair<int, int> begin() const
@@ -1076,6 +1152,11 @@ public:
 
 	virtual const Eigen::MatrixXd& Q() const;
 	virtual const Eigen::VectorXd& C() const;
+	/// Q is only computed in updateNrVars
+	virtual int QRevision() const
+	{
+		return QRevision_;
+	}
 
 private:
 	ContactId contactId_;
@@ -1087,6 +1168,7 @@ private:
 
 	Eigen::MatrixXd Q_;
 	Eigen::VectorXd C_;
+	int QRevision_;
 };
 
 
@@ -1102,7 +1184,8 @@ public:
 		axis_(axis),
 		begin_(0),
 		Q_(),
-		C_()
+		C_(),
+		QRevision_(-1)
 	{}
 
 	virtual std::pair<int, int> begin() const
@@ -1118,6 +1201,11 @@ public:
 
 	virtual const Eigen::MatrixXd& Q() const;
 	virtual const Eigen::VectorXd& C() const;
+	/// Q is only computed in updateNrVars
+	virtual int QRevision() const
+	{
+		return QRevision_;
+	}
 
 private:
 	ContactId contactId_;
@@ -1127,6 +1215,7 @@ private:
 
 	Eigen::MatrixXd Q_;
 	Eigen::VectorXd C_;
+	int QRevision_;
 };
 
 
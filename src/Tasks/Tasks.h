@@ -59,6 +59,14 @@ public:
 	void update(const rbd::MultiBody& mb, const rbd::MultiBodyConfig& mbc);
 	void update(const rbd::MultiBody& mb, const rbd::MultiBodyConfig& mbc,
 		const std::vector<sva::MotionVecd>& normalAccB);
+	/**
+		* Same as above but the Jacobian is derived from bodyJac,
+		* the body Jacobian of the body in the mbc configuration
+		* (see rbd::Jacobian::bodyJacobian).
+		*/
+	void update(const rbd::MultiBody& mb, const rbd::MultiBodyConfig& mbc,
+		const std::vector<sva::MotionVecd>& normalAccB,
+		const Eigen::MatrixXd& bodyJac);
 	void updateDot(const rbd::MultiBody& mb, const rbd::MultiBodyConfig& mbc);
 
 	const Eigen::VectorXd& eval() const;
@@ -77,6 +85,7 @@ private:
 	Eigen::VectorXd eval_;
 	Eigen::VectorXd speed_;
 	Eigen::VectorXd normalAcc_;
+	Eigen::MatrixXd shortJacMat_;
 	Eigen::MatrixXd jacMat_;
 	Eigen::MatrixXd jacDotMat_;
 };
@@ -98,6 +107,14 @@ public:
 	void update(const rbd::MultiBody& mb, const rbd::MultiBodyConfig& mbc);
 	void update(const rbd::MultiBody& mb, const rbd::MultiBodyConfig& mbc,
 		const std::vector<sva::MotionVecd>& normalAccB);
+	/**
+		* Same as above but the Jacobian is derived from bodyJac,
+		* the body Jacobian of the body in the mbc configuration
+		* (see rbd::Jacobian::bodyJacobian).
+		*/
+	void update(const rbd::MultiBody& mb, const rbd::MultiBodyConfig& mbc,
+		const std::vector<sva::MotionVecd>& normalAccB,
+		const Eigen::MatrixXd& bodyJac);
 	void updateDot(const rbd::MultiBody& mb, const rbd::MultiBodyConfig& mbc);
 
 	const Eigen::VectorXd& eval() const;
@@ -115,6 +132,7 @@ private:
 	Eigen::VectorXd eval_;
 	Eigen::VectorXd speed_;
 	Eigen::VectorXd normalAcc_;
+	Eigen::MatrixXd shortJacMat_;
 	Eigen::MatrixXd jacMat_;
 	Eigen::MatrixXd jacDotMat_;
 };
@@ -166,6 +184,20 @@ public:
 
 	void update(const rbd::MultiBody& mb, const rbd::MultiBodyConfig& mbc,
 		const std::vector<sva::MotionVecd>& normalAccB);
+	/**
+		* Same as above but the Jacobian is derived from bodyJac,
+		* the body Jacobian of the body in the mbc configuration
+		* (see rbd::Jacobian::bodyJacobian).
+		*/
+	void update(const rbd::MultiBody& mb, const rbd::MultiBodyConfig& mbc,
+		const std::vector<sva::MotionVecd>& normalAccB,
+		const Eigen::MatrixXd& bodyJac);
+
+protected:
+	/// compute the task from the Jacobian at the p frame in jacMatTmp_
+	void updateFromJacobian(const rbd::MultiBody& mb,
+		const rbd::MultiBodyConfig& mbc,
+		const std::vector<sva::MotionVecd>& normalAccB);
 
 protected:
 	Eigen::MatrixXd jacMatTmp_;
@@ -332,6 +364,8 @@ private:
 	Eigen::VectorXd normalAcc_;
 	Eigen::MatrixXd jacMat_;
 	Eigen::MatrixXd jacDotMat_;
+	/// jacobian in the image space before being expanded to all dof
+	Eigen::MatrixXd shortJacMat_;
 };
 
 
@@ -379,6 +413,8 @@ private:
 	Eigen::VectorXd normalAcc_;
 	Eigen::MatrixXd jacMat_;
 	Eigen::MatrixXd jacDotMat_;
+	/// jacobian in the image space before being expanded to all dof
+	Eigen::MatrixXd shortJacMat_;
 };
 
 
@@ -659,6 +695,8 @@ private:
 	Eigen::VectorXd speed_;
 	Eigen::VectorXd normalAcc_;
 	Eigen::MatrixXd jacMat_;
+	Eigen::MatrixXd fullJac_;
+	Eigen::VectorXd alphaVec_;
 
 	RelativeBodiesInfo rbInfo_[2];
 };
@@ -694,6 +732,7 @@ private:
 	Eigen::VectorXd speed_;
 	Eigen::VectorXd normalAcc_;
 	Eigen::MatrixXd jacMat_;
+	Eigen::MatrixXd fullJac_;
 };
 
 } // namespace tasks
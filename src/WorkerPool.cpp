@@ -0,0 +1,156 @@
+// Copyright 2012-2016 CNRS-UM LIRMM, CNRS-AIST JRL
+//
+// This file is part of Tasks.
+//
+// Tasks is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Tasks is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with Tasks.  If not, see <http://www.gnu.org/licenses/>.
+
+// associated header
+#include "WorkerPool.h"
+
+
+namespace tasks
+{
+
+namespace qp
+{
+
+
+WorkerPool::WorkerPool(int nrThreads):
+	workers_(),
+	mutex_(),
+	start_(),
+	done_(),
+	job_(nullptr),
+	nrJobs_(0),
+	nextJob_(0),
+	nrRunning_(0),
+	batch_(0),
+	stop_(false),
+	error_()
+{
+	for(int i = 1; i < nrThreads; ++i)
+	{
+		workers_.emplace_back(&WorkerPool::work, this);
+	}
+}
+
+
+WorkerPool::~WorkerPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		stop_ = true;
+	}
+	start_.notify_all();
+	for(std::thread& t: workers_)
+	{
+		t.join();
+	}
+}
+
+
+void WorkerPool::run(int nrJobs, const std::function<void(int)>& job)
+{
+	// not worth waking up the workers
+	if(workers_.empty() || nrJobs < 2)
+	{
+		for(int i = 0; i < nrJobs; ++i)
+		{
+			job(i);
+		}
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		job_ = &job;
+		nrJobs_ = nrJobs;
+		nextJob_.store(0, std::memory_order_relaxed);
+		nrRunning_ = static_cast<int>(workers_.size());
+		error_ = nullptr;
+		++batch_;
+	}
+	start_.notify_all();
+
+	execute();
+
+	std::exception_ptr error;
+	{
+		std::unique_lock<std::mutex> lock(mutex_);
+		done_.wait(lock, [this]{ return nrRunning_ == 0; });
+		job_ = nullptr;
+		std::swap(error, error_);
+	}
+
+	if(error)
+	{
+		std::rethrow_exception(error);
+	}
+}
+
+
+void WorkerPool::work()
+{
+	unsigned int batch = 0;
+	while(true)
+	{
+		{
+			std::unique_lock<std::mutex> lock(mutex_);
+			start_.wait(lock, [this, batch]{ return stop_ || batch_ != batch; });
+			if(stop_)
+			{
+				return;
+			}
+			batch = batch_;
+		}
+
+		execute();
+
+		bool last = false;
+		{
+			std::lock_guard<std::mutex> lock(mutex_);
+			last = --nrRunning_ == 0;
+		}
+		if(last)
+		{
+			done_.notify_one();
+		}
+	}
+}
+
+
+void WorkerPool::execute()
+{
+	int i = 0;
+	while((i = nextJob_.fetch_add(1, std::memory_order_relaxed)) < nrJobs_)
+	{
+		try
+		{
+			(*job_)(i);
+		}
+		catch(...)
+		{
+			std::lock_guard<std::mutex> lock(mutex_);
+			if(!error_)
+			{
+				error_ = std::current_exception();
+			}
+		}
+	}
+}
+
+
+} // namespace qp
+
+} // namespace tasks
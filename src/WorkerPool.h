@@ -0,0 +1,95 @@
+// Copyright 2012-2016 CNRS-UM LIRMM, CNRS-AIST JRL
+//
+// This file is part of Tasks.
+//
+// Tasks is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Tasks is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with Tasks.  If not, see <http://www.gnu.org/licenses/>.
+
+#pragma once
+
+// includes
+// std
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+
+namespace tasks
+{
+
+namespace qp
+{
+
+
+/**
+	* Persistent pool of worker threads used to run a batch of independent jobs.
+	*
+	* The threads are created once, sleep between two batches and
+	* pick the next job index with an atomic counter so a thread that
+	* finish early take the remaining jobs of the slower ones.
+	* The thread calling run also execute jobs.
+	*/
+class WorkerPool
+{
+public:
+	/**
+		* @param nrThreads Total number of threads used to run a batch,
+		* including the calling thread.
+		*/
+	WorkerPool(int nrThreads);
+	~WorkerPool();
+
+	WorkerPool(const WorkerPool&) = delete;
+	WorkerPool& operator=(const WorkerPool&) = delete;
+
+	int nrThreads() const
+	{
+		return static_cast<int>(workers_.size()) + 1;
+	}
+
+	/**
+		* Call job(i) for i in [0, nrJobs) and wait for all calls to end.
+		* The first exception thrown by a job is rethrown.
+		*/
+	void run(int nrJobs, const std::function<void(int)>& job);
+
+private:
+	void work();
+	void execute();
+
+private:
+	std::vector<std::thread> workers_;
+
+	std::mutex mutex_;
+	std::condition_variable start_, done_;
+
+	const std::function<void(int)>* job_;
+	int nrJobs_;
+	std::atomic<int> nextJob_;
+	/// number of workers that have not finished the current batch
+	int nrRunning_;
+	/// incremented at each batch to wake up the workers
+	unsigned int batch_;
+	bool stop_;
+
+	std::exception_ptr error_;
+};
+
+
+} // namespace qp
+
+} // namespace tasks
@@ -17,6 +17,11 @@
 
 #pragma once
 
+// includes
+// std
+#include <algorithm>
+#include <vector>
+
 namespace tasks
 {
 
@@ -42,6 +47,38 @@ inline bool compareDof(const rbd::MultiBody& mb1, const rbd::MultiBody& mb2)
 	return mb1.nrDof() < mb2.nrDof();
 }
 
+/**
+	* Move the first element of [v.begin() + pos, v.end()) matching pred
+	* at v[pos], the order of the other elements is kept.
+	* Used by the constraints keeping the data of the removed contacts
+	* after the active ones.
+	* @return false if no element match.
+	*/
+template<typename T, typename Pred>
+bool activateCached(std::vector<T>& v, std::size_t pos, Pred pred)
+{
+	auto it = std::find_if(v.begin() + pos, v.end(), pred);
+	if(it == v.end())
+	{
+		return false;
+	}
+	std::rotate(v.begin() + pos, it, it + 1);
+	return true;
+}
+
+/**
+	* Remove the elements of v after the nrActive first ones
+	* and the nrKept following ones.
+	*/
+template<typename T>
+void trimCached(std::vector<T>& v, std::size_t nrActive, std::size_t nrKept)
+{
+	if(v.size() > nrActive + nrKept)
+	{
+		v.erase(v.begin() + (nrActive + nrKept), v.end());
+	}
+}
+
 } // namespace qp
 
 } // namespace tasks
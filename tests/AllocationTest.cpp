@@ -15,14 +15,33 @@
 // You should have received a copy of the GNU Lesser General Public License
 // along with Tasks.  If not, see <http://www.gnu.org/licenses/>.
 
+// includes
+// std
+#include <atomic>
+#include <cstdlib>
+#include <string>
 
 // boost
 #define BOOST_TEST_MODULE AllocationTest
 #include <boost/test/unit_test.hpp>
 #include <boost/math/constants/constants.hpp>
 
+// RBDyn
+#include <RBDyn/EulerIntegration.h>
+#include <RBDyn/FK.h>
+#include <RBDyn/FV.h>
+
+// sch
+#include <sch/S_Object/S_Sphere.h>
+#include <sch/CD/CD_Pair.h>
+
 // Tasks
+#include "Tasks/Bounds.h"
+#include "Tasks/GenQPSolver.h"
 #include "Tasks/QPConstr.h"
+#include "Tasks/QPContactConstr.h"
+#include "Tasks/QPMotionConstr.h"
+#include "Tasks/QPSolver.h"
 #include "Tasks/QPTasks.h"
 
 // Arms
@@ -30,6 +49,55 @@
 
 #pragma GCC diagnostic ignored "-Wunused-variable"
 
+/*
+	* Count the heap allocations done while countAlloc is set.
+	* malloc, calloc and realloc are replaced by a counting version
+	* forwarding to the glibc implementation, operator new and Eigen
+	* dynamic matrices are both going through malloc.
+	*/
+static std::atomic<bool> countAlloc(false);
+static std::atomic<int> nrAlloc(0);
+
+#ifdef __GLIBC__
+#define TASKS_COUNT_ALLOC
+
+extern "C"
+{
+
+void* __libc_malloc(size_t size);
+void* __libc_calloc(size_t nmemb, size_t size);
+void* __libc_realloc(void* ptr, size_t size);
+
+void* malloc(size_t size)
+{
+	if(countAlloc.load(std::memory_order_relaxed))
+	{
+		++nrAlloc;
+	}
+	return __libc_malloc(size);
+}
+
+void* calloc(size_t nmemb, size_t size)
+{
+	if(countAlloc.load(std::memory_order_relaxed))
+	{
+		++nrAlloc;
+	}
+	return __libc_calloc(nmemb, size);
+}
+
+void* realloc(void* ptr, size_t size)
+{
+	if(countAlloc.load(std::memory_order_relaxed))
+	{
+		++nrAlloc;
+	}
+	return __libc_realloc(ptr, size);
+}
+
+} // extern "C"
+#endif
+
 std::string class_name(const std::string & fn_name)
 {
   auto eq_pos = fn_name.find_first_of('=') + 2;
@@ -93,3 +161,352 @@ BOOST_AUTO_TEST_CASE(AllocationTest)
 	test_shared_ptr_creation<tasks::qp::PositionBasedVisServoTask>(mbs, 0, "b3", pt, pt);
 	test_shared_ptr_creation<tasks::qp::MultiRobotTransformTask>(mbs, 0, 1, "b3", "b3", pt, pt, 1.0, 1.0);
 }
+
+
+
+#ifdef TASKS_COUNT_ALLOC
+/*
+	* Solve a scene using every task and constraint kind of QPSolverTest
+	* 1000 times with a backend and check that no cycle allocates.
+	*/
+void steadyStateSolveAllocation(const std::string& solverName, bool warmStart)
+{
+	using namespace Eigen;
+	using namespace sva;
+	using namespace rbd;
+	using namespace tasks;
+	namespace cst = boost::math::constants;
+
+	BOOST_TEST_MESSAGE("steady state solve with " << solverName <<
+		(warmStart ? " warm" : " cold") << " started");
+
+	// two fixed arms linked by a contact between their end effectors,
+	// the first one also have a self collision constraint
+	MultiBody mb1, mb2;
+	MultiBodyConfig mbc1Init, mbc2Init;
+
+	std::tie(mb1, mbc1Init) = makeZXZArm();
+	std::tie(mb2, mbc2Init) = makeZXZArm();
+
+	forwardKinematics(mb1, mbc1Init);
+	forwardVelocity(mb1, mbc1Init);
+	forwardKinematics(mb2, mbc2Init);
+	forwardVelocity(mb2, mbc2Init);
+
+	sva::PTransformd X_0_b1(mbc1Init.bodyPosW.back());
+	sva::PTransformd X_0_b2(mbc2Init.bodyPosW.back());
+	sva::PTransformd X_b1_b2(X_0_b2*X_0_b1.inv());
+
+	std::vector<rbd::MultiBody> mbs = {mb1, mb2};
+	std::vector<rbd::MultiBodyConfig> mbcs = {mbc1Init, mbc2Init};
+
+	std::vector<qp::UnilateralContact> contVec =
+		{qp::UnilateralContact(0, 1, "b3", "b3",
+			{Vector3d::Zero()}, RotX(cst::pi<double>()/2.), X_b1_b2,
+			3, std::tan(cst::pi<double>()/4.))};
+
+	qp::QPSolver solver;
+	solver.solver(solverName);
+	solver.warmStart(warmStart);
+
+	int bodyI = mb1.bodyIndexByName("b3");
+	const sva::PTransformd& X_0_b = mbc1Init.bodyPosW[bodyI];
+
+	double inf = std::numeric_limits<double>::infinity();
+	std::vector<std::vector<double> > lBound = {{}, {-cst::pi<double>()/2.}, {-inf}, {-inf}};
+	std::vector<std::vector<double> > uBound = {{}, {cst::pi<double>()/2.}, {inf}, {inf}};
+	std::vector<std::vector<double> > lVel = {{}, {-inf}, {-inf}, {-inf}};
+	std::vector<std::vector<double> > uVel = {{}, {inf}, {inf}, {inf}};
+	std::vector<std::vector<double> > lTBound = {{}, {-100.}, {-100.}, {-100.}};
+	std::vector<std::vector<double> > uTBound = {{}, {100.}, {100.}, {100.}};
+	VectorXd lPoly(1), uPoly(1), null;
+	lPoly << -100.;
+	uPoly << 100.;
+	std::vector<std::vector<VectorXd> > lPolyBound = {{null}, {lPoly}, {lPoly}, {lPoly}};
+	std::vector<std::vector<VectorXd> > uPolyBound = {{null}, {uPoly}, {uPoly}, {uPoly}};
+
+	// ContactSpeedConstr and ContactPosConstr are not used since they
+	// replace ContactAccConstr on the same contact
+	qp::JointLimitsConstr jointConstr(mbs, 0, {lBound, uBound}, 0.001);
+	qp::DamperJointLimitsConstr dampJointConstr(mbs, 1, {lBound, uBound},
+		{lVel, uVel}, 0.125, 0.025, 1., 0.001);
+	qp::MotionConstr motionConstr1(mbs, 0, {lTBound, uTBound});
+	qp::MotionPolyConstr motionPolyConstr2(mbs, 1, {lPolyBound, uPolyBound});
+	qp::PositiveLambda posLambdaConstr;
+	qp::ContactAccConstr contCstrAcc;
+	qp::GripperTorqueConstr gripConstr;
+	gripConstr.addGripper(contVec[0].contactId, 100.,
+		Vector3d::Zero(), Vector3d::UnitZ());
+
+	sch::S_Sphere b0(0.25), b3(0.25);
+	PTransformd I = PTransformd::Identity();
+	qp::CollisionConstr collConstr(mbs, 0.001);
+	collConstr.addCollision(mbs, 10,
+		0, "b0", &b0, I,
+		0, "b3", &b3, I,
+		0.01, 0.005, 1.);
+
+	qp::BoundedSpeedConstr speedConstr(mbs, 0, 0.001);
+	MatrixXd speedDof(1, 6);
+	VectorXd lSpeed(1), uSpeed(1);
+	speedDof << 0., 0., 0., 1., 0., 0.;
+	lSpeed << -1.;
+	uSpeed << 1.;
+	speedConstr.addBoundedSpeed(mbs, "b2", Vector3d::Zero(), speedDof,
+		lSpeed, uSpeed);
+
+	// the plane stay far from the CoM
+	qp::CoMIncPlaneConstr comPlaneConstr(mbs, 0, 0.001);
+	comPlaneConstr.addPlane(10, Vector3d::UnitZ(), 10., 0.1, 0.05, 0.);
+
+	qp::PostureTask postureTask(mbs, 0, mbc1Init.q, 1., 0.01);
+	qp::PostureTask postureTask2(mbs, 1, mbc2Init.q, 1., 0.01);
+	qp::PositionTask posTask(mbs, 0, "b3",
+		RotZ(cst::pi<double>()/4.)*X_0_b.translation());
+	qp::SetPointTask posTaskSp(mbs, 0, &posTask, 10., 1.);
+	qp::OrientationTask oriTask(mbs, 0, "b3", Matrix3d(RotZ(cst::pi<double>()/4.)));
+	qp::SetPointTask oriTaskSp(mbs, 0, &oriTask, 10., 0.1);
+	qp::CoMTask comTask(mbs, 0, Vector3d(0.1, 0.1, 0.));
+	qp::SetPointTask comTaskSp(mbs, 0, &comTask, 10., 0.1);
+	qp::GazeTask gazeTask(mbs, 0, "b3", Vector3d(0., 0., 1.), PTransformd::Identity());
+	qp::SetPointTask gazeTaskSp(mbs, 0, &gazeTask, 10., 0.01);
+	qp::PositionBasedVisServoTask pbvsTask(mbs, 0, "b3", PTransformd(Vector3d(0., 0., 0.1)));
+	qp::SetPointTask pbvsTaskSp(mbs, 0, &pbvsTask, 10., 0.01);
+	qp::TransformTask transTask(mbs, 1, "b3", X_0_b2);
+	qp::SetPointTask transTaskSp(mbs, 1, &transTask, 10., 0.01);
+	// also cover the least squares form of a task
+	transTaskSp.leastSquares(true);
+	qp::SurfaceTransformTask surfTransTask(mbs, 1, "b2", mbc2Init.bodyPosW[2]);
+	qp::SetPointTask surfTransTaskSp(mbs, 1, &surfTransTask, 10., 0.01);
+	qp::SurfaceOrientationTask surfOriTask(mbs, 0, "b2",
+		Matrix3d(mbc1Init.bodyPosW[2].rotation()), PTransformd::Identity());
+	qp::SetPointTask surfOriTaskSp(mbs, 0, &surfOriTask, 10., 0.01);
+	qp::MomentumTask momTask(mbs, 1, sva::ForceVecd(Vector6d::Zero()));
+	qp::SetPointTask momTaskSp(mbs, 1, &momTask, 10., 0.01);
+	qp::LinVelocityTask linVelTask(mbs, 1, "b2", Vector3d::Zero());
+	qp::SetPointTask linVelTaskSp(mbs, 1, &linVelTask, 10., 0.01);
+	qp::PositionTask selPosTask(mbs, 0, "b2", mbc1Init.bodyPosW[2].translation());
+	qp::JointsSelector selPosTaskJs(
+		qp::JointsSelector::ActiveJoints(mbs, 0, &selPosTask, {"j0", "j1"}));
+	qp::SetPointTask selPosTaskSp(mbs, 0, &selPosTaskJs, 10., 0.01);
+	qp::MultiCoMTask multiCoMTask(mbs, {0}, Vector3d(0.1, 0.1, 0.), 10., 0.1);
+	qp::MultiRobotTransformTask multiRobotTransTask(mbs, 0, 1, "b3", "b3",
+		PTransformd::Identity(), PTransformd::Identity(), 10., 0.01);
+	qp::TorqueTask torqueTask(mbs, 0, {lTBound, uTBound}, 0.001);
+
+	solver.addBoundConstraint(&jointConstr);
+	solver.addConstraint(&jointConstr);
+	dampJointConstr.addToSolver(solver);
+	motionConstr1.addToSolver(solver);
+	motionPolyConstr2.addToSolver(solver);
+	posLambdaConstr.addToSolver(solver);
+	contCstrAcc.addToSolver(solver);
+	gripConstr.addToSolver(solver);
+	solver.addInequalityConstraint(&collConstr);
+	solver.addConstraint(&collConstr);
+	speedConstr.addToSolver(solver);
+	comPlaneConstr.addToSolver(solver);
+
+	solver.addTask(&postureTask);
+	solver.addTask(&postureTask2);
+	solver.addTask(&posTaskSp);
+	solver.addTask(&oriTaskSp);
+	solver.addTask(&comTaskSp);
+	solver.addTask(&gazeTaskSp);
+	solver.addTask(&pbvsTaskSp);
+	solver.addTask(&transTaskSp);
+	solver.addTask(&surfTransTaskSp);
+	solver.addTask(&surfOriTaskSp);
+	solver.addTask(&momTaskSp);
+	solver.addTask(&linVelTaskSp);
+	solver.addTask(&selPosTaskSp);
+	solver.addTask(&multiCoMTask);
+	solver.addTask(&multiRobotTransTask);
+	solver.addTask(&torqueTask);
+
+	solver.nrVars(mbs, contVec, {});
+	solver.updateConstrSize();
+
+	// 3 dof + 3 dof + 3 lambda
+	BOOST_REQUIRE_EQUAL(solver.nrVars(), 3 + 3 + 3);
+
+	Eigen::VectorXd alphaD(solver.alphaDVec().size());
+
+	auto integrate = [&mbs, &mbcs]()
+	{
+		for(std::size_t r = 0; r < mbs.size(); ++r)
+		{
+			eulerIntegration(mbs[r], mbcs[r], 0.001);
+			forwardKinematics(mbs[r], mbcs[r]);
+			forwardVelocity(mbs[r], mbcs[r]);
+		}
+	};
+
+	// first cycles are allowed to allocate since some buffers are lazily sized,
+	// iterative backends can stop on their iteration limit
+	for(int i = 0; i < 10; ++i)
+	{
+		solver.solve(mbs, mbcs);
+		BOOST_REQUIRE(solver.solverStatus() != qp::QPStatus::Failure);
+		integrate();
+	}
+
+	int nrFail = 0;
+	nrAlloc = 0;
+	for(int i = 0; i < 1000; ++i)
+	{
+		countAlloc = true;
+		solver.solve(mbs, mbcs);
+		solver.alphaDVec(alphaD);
+		countAlloc = false;
+
+		if(solver.solverStatus() == qp::QPStatus::Failure)
+		{
+			++nrFail;
+		}
+		integrate();
+	}
+
+	BOOST_CHECK_EQUAL(nrFail, 0);
+	BOOST_CHECK_MESSAGE(nrAlloc.load() == 0, solverName <<
+		(warmStart ? " warm" : " cold") << " started: " <<
+		nrAlloc.load() << " allocations in 1000 solves");
+	BOOST_CHECK_SMALL((alphaD - solver.alphaDVec()).norm(), 1e-12);
+}
+#endif
+
+
+
+BOOST_AUTO_TEST_CASE(SteadyStateSolveAllocationTest)
+{
+#ifndef TASKS_COUNT_ALLOC
+	BOOST_TEST_MESSAGE("malloc can't be hooked on this platform, skipping");
+#else
+	// LSSOL manage its own fortran workspace and SPARSE is not checked:
+	// Eigen setFromTriplets and SimplicialLDLT::factorize allocate
+	// their temporaries at each solve
+	for(const std::string& name: tasks::qp::qpSolverNames())
+	{
+		if(name == "LSSOL" || name == "SPARSE")
+		{
+			continue;
+		}
+		for(bool warmStart: {false, true})
+		{
+			steadyStateSolveAllocation(name, warmStart);
+		}
+	}
+#endif
+}
+
+
+
+BOOST_AUTO_TEST_CASE(ContactSwitchAllocationTest)
+{
+#ifndef TASKS_COUNT_ALLOC
+	BOOST_TEST_MESSAGE("malloc can't be hooked on this platform, skipping");
+#else
+	using namespace Eigen;
+	using namespace sva;
+	using namespace rbd;
+	using namespace tasks;
+	namespace cst = boost::math::constants;
+
+	// free flyer arm switching between two contacts of its base
+	// and no contact, the solver capacity hold one contact
+	MultiBody mb, mbEnv;
+	MultiBodyConfig mbcInit, mbcEnv;
+
+	std::tie(mb, mbcInit) = makeZXZArm(false);
+	std::tie(mbEnv, mbcEnv) = makeEnv();
+
+	forwardKinematics(mb, mbcInit);
+	forwardVelocity(mb, mbcInit);
+	forwardKinematics(mbEnv, mbcEnv);
+	forwardVelocity(mbEnv, mbcEnv);
+
+	std::vector<MultiBody> mbs = {mb, mbEnv};
+	std::vector<MultiBodyConfig> mbcs = {mbcInit, mbcEnv};
+
+	double Inf = std::numeric_limits<double>::infinity();
+	std::vector<std::vector<double>> torqueMin = {{0., 0., 0., 0., 0., 0.},{-Inf},{-Inf},{-Inf}};
+	std::vector<std::vector<double>> torqueMax = {{0., 0., 0., 0., 0., 0.},{Inf},{Inf},{Inf}};
+
+	std::vector<Eigen::Vector3d> points =
+		{
+			Vector3d(0.1, 0.1, 0.),
+			Vector3d(-0.1, 0.1, 0.),
+			Vector3d(-0.1, -0.1, 0.),
+			Vector3d(0.1, -0.1, 0.)
+		};
+
+	std::vector<Eigen::Matrix3d> biFrames =
+		{
+			sva::RotY((0.*cst::pi<double>())/2.),
+			sva::RotY((1.*cst::pi<double>())/2.),
+			sva::RotY((2.*cst::pi<double>())/2.),
+			sva::RotY((3.*cst::pi<double>())/2.),
+		};
+
+	// the two contacts have a different id and lambda number
+	std::vector<std::vector<qp::UnilateralContact>> uniSets =
+		{{}, {}, {qp::UnilateralContact(0, 1, "b0", "b0", 1,
+			points, Matrix3d::Identity(), PTransformd::Identity(), 3, 0.7)}, {}};
+	std::vector<std::vector<qp::BilateralContact>> biSets =
+		{{qp::BilateralContact(0, 1, "b0", "b0",
+			points, biFrames, PTransformd::Identity(), 4, 0.7)}, {}, {}, {}};
+
+	qp::QPSolver solver;
+	solver.solver("QLD");
+	solver.warmStart(false);
+
+	qp::QPCapacity capacity;
+	capacity.nrContacts = 1;
+	capacity.nrLambda = 4*4;
+	solver.capacity(capacity);
+
+	qp::MotionConstr motionConstr(mbs, 0, {torqueMin, torqueMax});
+	qp::PositiveLambda posLambdaConstr;
+	qp::ContactAccConstr contCstrAcc;
+	qp::PostureTask postureTask(mbs, 0, mbcInit.q, 1., 0.01);
+
+	motionConstr.addToSolver(solver);
+	posLambdaConstr.addToSolver(solver);
+	contCstrAcc.addToSolver(solver);
+	solver.addTask(&postureTask);
+
+	auto switchContacts = [&](int i, bool count)
+	{
+		// the contact vectors are copied out of the counted section
+		std::vector<qp::UnilateralContact> uni(uniSets[i % 4]);
+		std::vector<qp::BilateralContact> bi(biSets[i % 4]);
+		mbcs[0] = mbcInit;
+
+		countAlloc = count;
+		solver.nrVars(mbs, std::move(uni), std::move(bi));
+		bool success = solver.solve(mbs, mbcs);
+		countAlloc = false;
+		return success;
+	};
+
+	// the first switches are allowed to allocate the data of each contact
+	for(int i = 0; i < 8; ++i)
+	{
+		BOOST_REQUIRE(switchContacts(i, false));
+	}
+
+	int nrFail = 0;
+	nrAlloc = 0;
+	for(int i = 0; i < 40; ++i)
+	{
+		if(!switchContacts(i, true))
+		{
+			++nrFail;
+		}
+		BOOST_CHECK_EQUAL(solver.nrVars(), 9 + 4*4);
+	}
+
+	BOOST_CHECK_EQUAL(nrFail, 0);
+	BOOST_CHECK_EQUAL(nrAlloc.load(), 0);
+#endif
+}
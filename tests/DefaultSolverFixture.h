@@ -0,0 +1,54 @@
+// Copyright 2012-2017 CNRS-UM LIRMM, CNRS-AIST JRL
+//
+// This file is part of Tasks.
+//
+// Tasks is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Tasks is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with Tasks.  If not, see <http://www.gnu.org/licenses/>.
+
+#pragma once
+
+// includes
+// std
+#include <algorithm>
+#include <string>
+#include <vector>
+
+// boost
+#include <boost/test/unit_test.hpp>
+
+// Tasks
+#include "Tasks/GenQPSolver.h"
+#include "Tasks/QPSolver.h"
+
+
+/**
+	* Set the default QP solver from the test arguments,
+	* "QPSolverTest -- GI" run the suite with the GI backend.
+	* Only a registered backend name is taken, so Boost.Test options
+	* like --log_level=all are left to the framework.
+	*/
+struct DefaultSolverFixture
+{
+	DefaultSolverFixture()
+	{
+		const auto& suite = boost::unit_test::framework::master_test_suite();
+		const std::vector<std::string> names = tasks::qp::qpSolverNames();
+		for(int i = 1; i < suite.argc; ++i)
+		{
+			if(std::find(names.begin(), names.end(), suite.argv[i]) != names.end())
+			{
+				tasks::qp::QPSolver::defaultSolver(suite.argv[i]);
+			}
+		}
+	}
+};
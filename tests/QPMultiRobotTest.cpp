@@ -35,6 +35,10 @@
 #include <RBDyn/MultiBodyConfig.h>
 #include <RBDyn/MultiBodyGraph.h>
 
+// sch
+#include <sch/S_Object/S_Sphere.h>
+#include <sch/CD/CD_Pair.h>
+
 // Tasks
 #include "Tasks/Bounds.h"
 #include "Tasks/QPConstr.h"
@@ -45,6 +49,10 @@
 
 // Arms
 #include "arms.h"
+#include "DefaultSolverFixture.h"
+
+
+BOOST_GLOBAL_FIXTURE(DefaultSolverFixture);
 
 
 // Test contact between two robot.
@@ -508,6 +516,145 @@ BOOST_AUTO_TEST_CASE(MultiRobotTransformTest)
 }
 
 
+// Test the decomposition of two arms without contact in two QP
+BOOST_AUTO_TEST_CASE(TwoArmDecompositionTest)
+{
+	using namespace Eigen;
+	using namespace sva;
+	using namespace rbd;
+	using namespace tasks;
+	namespace cst = boost::math::constants;
+
+	MultiBody mb1, mb2;
+	MultiBodyConfig mbc1Init, mbc2Init;
+
+	std::tie(mb1, mbc1Init) = makeZXZArm(true,
+		sva::PTransformd(sva::RotZ(-cst::pi<double>()/4.), Vector3d(-0.5, 0., 0.)));
+	forwardKinematics(mb1, mbc1Init);
+	forwardVelocity(mb1, mbc1Init);
+
+	std::tie(mb2, mbc2Init) = makeZXZArm(true,
+		 sva::PTransformd(sva::RotZ(cst::pi<double>()/2.), Vector3d(0.5, 0., 0.)));
+	forwardKinematics(mb2, mbc2Init);
+	forwardVelocity(mb2, mbc2Init);
+
+	std::vector<MultiBody> mbs = {mb1, mb2};
+	std::vector<MultiBodyConfig> mbcs = {mbc1Init, mbc2Init};
+
+	qp::PostureTask posture1Task(mbs, 0, mbc1Init.q, 0.1, 1.);
+	qp::PostureTask posture2Task(mbs, 1, mbc2Init.q, 0.1, 1.);
+	qp::PositionTask pos1Task(mbs, 0, "b3",
+		mbc1Init.bodyPosW[mb1.bodyIndexByName("b3")].translation() +
+		Vector3d(0.1, 0.1, 0.));
+	qp::PositionTask pos2Task(mbs, 1, "b3",
+		mbc2Init.bodyPosW[mb2.bodyIndexByName("b3")].translation() -
+		Vector3d(0.1, 0.1, 0.));
+	qp::SetPointTask pos1TaskSp(mbs, 0, &pos1Task, 10., 10.);
+	qp::SetPointTask pos2TaskSp(mbs, 1, &pos2Task, 10., 10.);
+
+	double inf = std::numeric_limits<double>::infinity();
+	std::vector<std::vector<double> > lBound = {{}, {-cst::pi<double>()/4.}, {-inf}, {-inf}};
+	std::vector<std::vector<double> > uBound = {{}, {cst::pi<double>()/4.}, {inf}, {inf}};
+	qp::JointLimitsConstr joint1Constr(mbs, 0, {lBound, uBound}, 0.005);
+	qp::JointLimitsConstr joint2Constr(mbs, 1, {lBound, uBound}, 0.005);
+
+	// same problem solved as one QP and as two QP
+	qp::QPSolver solver, solverDec;
+	solver.solver("QLD");
+	solverDec.solver("QLD");
+	solverDec.decompose(true);
+	solverDec.nrThreads(2);
+	BOOST_CHECK(!solver.decompose());
+	BOOST_CHECK(solverDec.decompose());
+
+	for(qp::QPSolver* s: {&solver, &solverDec})
+	{
+		joint1Constr.addToSolver(*s);
+		joint2Constr.addToSolver(*s);
+		s->addTask(&posture1Task);
+		s->addTask(&posture2Task);
+		s->addTask(&pos1TaskSp);
+		s->addTask(&pos2TaskSp);
+		s->nrVars(mbs, {}, {});
+		s->updateConstrSize();
+		BOOST_CHECK_EQUAL(s->nrComponents(), 2);
+	}
+	BOOST_CHECK(!solver.decomposed());
+	BOOST_CHECK(solverDec.decomposed());
+
+	// a collision between the arms is only added after 200 iterations
+	sch::S_Sphere b3Sphere(0.1);
+	sva::PTransformd I = sva::PTransformd::Identity();
+	qp::CollisionConstr collConstr(mbs, 0.005);
+
+	auto solveBoth = [&]()
+	{
+		BOOST_REQUIRE(solverDec.solveNoMbcUpdate(mbs, mbcs));
+		BOOST_REQUIRE(solver.solve(mbs, mbcs));
+		BOOST_CHECK_SMALL((solver.result() - solverDec.result()).norm(), 1e-6);
+		for(std::size_t r = 0; r < mbs.size(); ++r)
+		{
+			eulerIntegration(mbs[r], mbcs[r], 0.005);
+
+			forwardKinematics(mbs[r], mbcs[r]);
+			forwardVelocity(mbs[r], mbcs[r]);
+		}
+	};
+
+	for(int i = 0; i < 1000; ++i)
+	{
+		// the empty collision constraint has no column and keep the components
+		if(i == 100)
+		{
+			collConstr.addToSolver(mbs, solver);
+			collConstr.addToSolver(mbs, solverDec);
+			solver.updateConstrSize();
+			solverDec.updateConstrSize();
+		}
+		// the collision change the constraint blocks and couple the arms
+		if(i == 200)
+		{
+			collConstr.addCollision(mbs, 0, 0, "b3", &b3Sphere, I,
+				1, "b3", &b3Sphere, I, 0.05, 0.01, 1.);
+			for(qp::QPSolver* s: {&solver, &solverDec})
+			{
+				s->updateNrVars(mbs);
+				s->updateConstrSize();
+			}
+		}
+		// removing the constraint split the problem again
+		if(i == 300)
+		{
+			collConstr.removeFromSolver(solver);
+			collConstr.removeFromSolver(solverDec);
+			solver.updateConstrSize();
+			solverDec.updateConstrSize();
+		}
+
+		solveBoth();
+
+		bool coupled = i >= 200 && i < 300;
+		BOOST_CHECK_EQUAL(solverDec.nrComponents(), coupled ? 1 : 2);
+		BOOST_CHECK_EQUAL(solverDec.decomposed(), !coupled);
+	}
+
+	// a task on both arms link them without calling nrVars
+	qp::MultiRobotTransformTask mrtt(mbs, 0, 1, "b3", "b3",
+		sva::PTransformd::Identity(), sva::PTransformd::Identity(), 10., 1.);
+	solver.addTask(mbs, &mrtt);
+	solverDec.addTask(mbs, &mrtt);
+	solveBoth();
+	BOOST_CHECK_EQUAL(solverDec.nrComponents(), 1);
+	BOOST_CHECK(!solverDec.decomposed());
+
+	solver.removeTask(&mrtt);
+	solverDec.removeTask(&mrtt);
+	solveBoth();
+	BOOST_CHECK_EQUAL(solverDec.nrComponents(), 2);
+	BOOST_CHECK(solverDec.decomposed());
+}
+
+
 // Test the TorqueTask
 BOOST_AUTO_TEST_CASE(TorqueTaskTest)
 {
@@ -583,3 +730,113 @@ BOOST_AUTO_TEST_CASE(TorqueTaskTest)
 	solver.removeTask(&posture2Task);
 	solver.removeTask(&tt);
 }
+
+
+// Test the SPARSE solver against QLD
+// We use the unilateral contact setup of TwoArmDDynamicContactTest
+// and check that both solvers give the same result.
+BOOST_AUTO_TEST_CASE(SparseSolverTest)
+{
+	using namespace Eigen;
+	using namespace sva;
+	using namespace rbd;
+	using namespace tasks;
+	namespace cst = boost::math::constants;
+
+	MultiBody mb1, mb2;
+	MultiBodyConfig mbc1Init, mbc2Init;
+
+	std::tie(mb1, mbc1Init) = makeZXZArm();
+
+	forwardKinematics(mb1, mbc1Init);
+	forwardVelocity(mb1, mbc1Init);
+
+	std::tie(mb2, mbc2Init) = makeZXZArm(false);
+	Vector3d mb2InitPos = mbc1Init.bodyPosW.back().translation();
+	Quaterniond mb2InitOri(RotY(cst::pi<double>()/2.));
+	mbc2Init.q[0] = {mb2InitOri.w(), mb2InitOri.x(), mb2InitOri.y(), mb2InitOri.z(),
+		mb2InitPos.x(), mb2InitPos.y()+ 1, mb2InitPos.z()};
+	forwardKinematics(mb2, mbc2Init);
+	forwardVelocity(mb2, mbc2Init);
+
+	sva::PTransformd X_0_b1(mbc1Init.bodyPosW.back());
+	sva::PTransformd X_0_b2(mbc2Init.bodyPosW.front());
+	sva::PTransformd X_b1_b2(X_0_b2*X_0_b1.inv());
+
+	std::vector<MultiBody> mbs = {mb1, mb2};
+	std::vector<MultiBodyConfig> mbcs = {mbc1Init, mbc2Init};
+
+	std::vector<Eigen::Vector3d> points =
+	{
+		Vector3d(0.1, 0., 0.1),
+		Vector3d(0.1, 0., -0.1),
+		Vector3d(-0.1, 0., -0.1),
+		Vector3d(-0.1, 0., 0.1),
+	};
+
+	std::vector<qp::UnilateralContact> contVec =
+		{qp::UnilateralContact({0, 1, "b3", "b0"},
+			points, RotX(cst::pi<double>()/2.), X_b1_b2,
+			4, 0.7)};
+
+	qp::PostureTask posture1Task(mbs, 0, mbc1Init.q, 2., 1.);
+	qp::PostureTask posture2Task(mbs, 1, mbc2Init.q, 2., 1.);
+
+	qp::ContactSpeedConstr contCstrSpeed(0.001);
+
+	const double Inf = std::numeric_limits<double>::infinity();
+	std::vector<std::vector<double>> torqueMin1 = {{},{-Inf},{-Inf},{-Inf}};
+	std::vector<std::vector<double>> torqueMax1 = {{},{Inf},{Inf},{Inf}};
+	std::vector<std::vector<double>> torqueMin2 = {{0., 0., 0., 0., 0., 0.},
+																							{-Inf},{-Inf},{-Inf}};
+	std::vector<std::vector<double>> torqueMax2 = {{0., 0., 0., 0., 0., 0.},
+																							{Inf},{Inf},{Inf}};
+	qp::MotionConstr motion1(mbs, 0, {torqueMin1, torqueMax1});
+	qp::MotionConstr motion2(mbs, 1, {torqueMin2, torqueMax2});
+	qp::PositiveLambda plCstr;
+
+	qp::QPSolver qldSolver, sparseSolver, giSolver;
+	qldSolver.solver("QLD");
+	sparseSolver.solver("SPARSE");
+	giSolver.solver("GI");
+	// the interior point method is always cold started
+	sparseSolver.warmStart(true);
+	BOOST_CHECK(!sparseSolver.warmStart());
+	for(qp::QPSolver* solver: {&qldSolver, &sparseSolver, &giSolver})
+	{
+		motion1.addToSolver(*solver);
+		motion2.addToSolver(*solver);
+		plCstr.addToSolver(*solver);
+		contCstrSpeed.addToSolver(*solver);
+		solver->addTask(&posture1Task);
+		solver->addTask(&posture2Task);
+
+		solver->nrVars(mbs, contVec, {});
+		solver->updateConstrSize();
+	}
+
+	for(int i = 0; i < 1000; ++i)
+	{
+		BOOST_REQUIRE(qldSolver.solveNoMbcUpdate(mbs, mbcs));
+		BOOST_REQUIRE(giSolver.solveNoMbcUpdate(mbs, mbcs));
+		BOOST_REQUIRE(sparseSolver.solve(mbs, mbcs));
+		BOOST_CHECK_SMALL((qldSolver.alphaDVec() - sparseSolver.alphaDVec()).norm(),
+			1e-5);
+		BOOST_CHECK_SMALL((qldSolver.alphaDVec() - giSolver.alphaDVec()).norm(),
+			1e-6);
+
+		for(std::size_t r = 0; r < mbs.size(); ++r)
+		{
+			eulerIntegration(mbs[r], mbcs[r], 0.001);
+
+			forwardKinematics(mbs[r], mbcs[r]);
+			forwardVelocity(mbs[r], mbcs[r]);
+		}
+
+		// check that the link hold
+		sva::PTransformd X_0_b1_post(mbcs[0].bodyPosW.back());
+		sva::PTransformd X_0_b2_post(mbcs[1].bodyPosW.front());
+		sva::PTransformd X_b1_b2_post(X_0_b2_post*X_0_b1_post.inv());
+		BOOST_CHECK_SMALL((X_b1_b2.matrix() - X_b1_b2_post.matrix()).norm(), 1e-5);
+	}
+}
@@ -17,12 +17,18 @@
 
 // includes
 // std
+#include <algorithm>
 #include <fstream>
+#include <memory>
+#include <random>
+#include <sstream>
+#include <stdexcept>
 #include <tuple>
 
 // boost
 #define BOOST_TEST_MODULE QPSolverTest
 #include <boost/test/unit_test.hpp>
+#include <boost/filesystem.hpp>
 #include <boost/math/constants/constants.hpp>
 
 // Eigen
@@ -44,14 +50,111 @@
 
 // Tasks
 #include "Tasks/Bounds.h"
+#include "Tasks/GenQPSolver.h"
 #include "Tasks/QPConstr.h"
 #include "Tasks/QPContactConstr.h"
 #include "Tasks/QPMotionConstr.h"
+#include "Tasks/QPRecorder.h"
 #include "Tasks/QPSolver.h"
 #include "Tasks/QPTasks.h"
 
+// private
+#include "GenQPUtils.h"
+#include "GIQPSolver.h"
+#include "GoldfarbIdnani.h"
+
 // Arms
 #include "arms.h"
+#include "DefaultSolverFixture.h"
+
+
+BOOST_GLOBAL_FIXTURE(DefaultSolverFixture);
+
+
+
+namespace
+{
+
+/**
+	* ZXZ arm driven to its j1 joint limit by a position task,
+	* the problem shared by the backend tests.
+	*/
+struct ArmLimitProblem
+{
+	ArmLimitProblem():
+		ArmLimitProblem(makeZXZArm())
+	{}
+
+	/// Add the joint limits and the tasks to solver and set its variables.
+	void addTo(tasks::qp::QPSolver& solver, bool posture=true)
+	{
+		jointConstr.addToSolver(solver);
+		solver.nrVars(mbs, {}, {});
+		solver.updateConstrSize();
+		solver.addTask(&posTaskSp);
+		if(posture)
+		{
+			solver.addTask(&postureTask);
+		}
+	}
+
+	/// Integrate the arm state with the last result of solver.
+	void step(const tasks::qp::QPSolver& solver)
+	{
+		solver.updateMbc(mbcs[0], 0);
+		rbd::eulerIntegration(mbs[0], mbcs[0], dt);
+		rbd::forwardKinematics(mbs[0], mbcs[0]);
+		rbd::forwardVelocity(mbs[0], mbcs[0]);
+	}
+
+	/// @return true if j1 is in its limits.
+	bool inLimits() const
+	{
+		return mbcs[0].q[1][0] > -boost::math::constants::pi<double>()/4. - 0.01;
+	}
+
+	static constexpr double dt = 0.001;
+
+	std::vector<rbd::MultiBody> mbs;
+	std::vector<rbd::MultiBodyConfig> mbcs;
+	rbd::MultiBodyConfig mbcInit;
+	tasks::qp::PositionTask posTask;
+	tasks::qp::SetPointTask posTaskSp;
+	tasks::qp::PostureTask postureTask;
+	tasks::qp::JointLimitsConstr jointConstr;
+
+private:
+	ArmLimitProblem(std::tuple<rbd::MultiBody, rbd::MultiBodyConfig> arm):
+		mbs({std::get<0>(arm)}),
+		mbcs({initState(std::get<0>(arm), std::get<1>(arm))}),
+		mbcInit(mbcs[0]),
+		posTask(mbs, 0, "b3", sva::RotZ(boost::math::constants::pi<double>()/2.)*
+			mbcInit.bodyPosW[mbs[0].bodyIndexByName("b3")].translation()),
+		posTaskSp(mbs, 0, &posTask, 10., 1.),
+		postureTask(mbs, 0, mbcInit.q, 1., 0.01),
+		jointConstr(mbs, 0, limits(), dt)
+	{}
+
+	static rbd::MultiBodyConfig initState(const rbd::MultiBody& mb,
+		rbd::MultiBodyConfig mbc)
+	{
+		rbd::forwardKinematics(mb, mbc);
+		rbd::forwardVelocity(mb, mbc);
+		return mbc;
+	}
+
+	static tasks::QBound limits()
+	{
+		namespace cst = boost::math::constants;
+		double inf = std::numeric_limits<double>::infinity();
+		return {{{}, {-cst::pi<double>()/4.}, {-inf}, {-inf}},
+			{{}, {cst::pi<double>()/4.}, {inf}, {inf}}};
+	}
+};
+
+constexpr double ArmLimitProblem::dt;
+
+}
 
 
 BOOST_AUTO_TEST_CASE(FrictionConeTest)
@@ -554,186 +657,325 @@ BOOST_AUTO_TEST_CASE(QPJointLimitsTest)
 
 
 
-BOOST_AUTO_TEST_CASE(QPDamperJointLimitsTest)
+BOOST_AUTO_TEST_CASE(QPWarmStartTest)
 {
-	using namespace Eigen;
-	using namespace sva;
-	using namespace rbd;
 	using namespace tasks;
-	namespace cst = boost::math::constants;
-
-	MultiBody mb;
-	MultiBodyConfig mbcInit;
-
-	std::tie(mb, mbcInit) = makeZXZArm();
 
-	forwardKinematics(mb, mbcInit);
-	forwardVelocity(mb, mbcInit);
+	ArmLimitProblem arm;
 
-	std::vector<rbd::MultiBody> mbs = {mb};
-	std::vector<rbd::MultiBodyConfig> mbcs = {mbcInit};
+	// same problem solved by QLD, by the warm start seeded with the previous
+	// active set and by the warm start from an empty active set
+	qp::QPSolver coldSolver, warmSolver, resetSolver;
+	coldSolver.solver("QLD");
+	warmSolver.solver("QLD");
+	resetSolver.solver("QLD");
+	BOOST_CHECK(!warmSolver.warmStart());
+	warmSolver.warmStart(true);
+	BOOST_CHECK(warmSolver.warmStart());
+	resetSolver.warmStart(true);
 
-	qp::QPSolver solver;
+	for(qp::QPSolver* solver: {&coldSolver, &warmSolver, &resetSolver})
+	{
+		arm.addTo(*solver, false);
+	}
 
-	int bodyI = mb.bodyIndexByName("b3");
-	qp::PositionTask posTask(mbs, 0, "b3",
-		RotZ(cst::pi<double>()/2.)*mbcInit.bodyPosW[bodyI].translation());
-	qp::SetPointTask posTaskSp(mbs, 0, &posTask, 10., 1.);
+	int nrWarmSolved = 0;
+	int warmIter = 0, resetIter = 0;
+	for(int i = 0; i < 1000; ++i)
+	{
+		resetSolver.resetWarmStart();
+		BOOST_REQUIRE(coldSolver.solveNoMbcUpdate(arm.mbs, arm.mbcs));
+		BOOST_REQUIRE(resetSolver.solveNoMbcUpdate(arm.mbs, arm.mbcs));
+		BOOST_REQUIRE(warmSolver.solveNoMbcUpdate(arm.mbs, arm.mbcs));
+		BOOST_CHECK_SMALL((coldSolver.alphaDVec() - warmSolver.alphaDVec()).norm(),
+			1e-6);
+		BOOST_CHECK_SMALL((coldSolver.alphaDVec() - resetSolver.alphaDVec()).norm(),
+			1e-6);
+		// QLD don't report its iterations
+		BOOST_CHECK_EQUAL(coldSolver.solverIterations(), -1);
+
+		if(warmSolver.solverIterations() > 0 && resetSolver.solverIterations() > 0)
+		{
+			++nrWarmSolved;
+			warmIter += warmSolver.solverIterations();
+			resetIter += resetSolver.solverIterations();
+		}
+		arm.step(warmSolver);
+		BOOST_REQUIRE(arm.inLimits());
+	}
 
-	double inf = std::numeric_limits<double>::infinity();
-	std::vector<std::vector<double> > lBound = {{}, {-cst::pi<double>()/4.}, {-inf}, {-inf}};
-	std::vector<std::vector<double> > uBound = {{}, {cst::pi<double>()/4.}, {inf}, {inf}};
-	std::vector<std::vector<double> > lVel = {{}, {-inf}, {-inf}, {-inf}};
-	std::vector<std::vector<double> > uVel = {{}, {inf}, {inf}, {inf}};
+	// the warm start find the active joint limit
+	// with less iterations than a cold start
+	BOOST_CHECK_GT(nrWarmSolved, 900);
+	BOOST_CHECK_LT(warmIter, resetIter);
+}
 
-	qp::DamperJointLimitsConstr dampJointConstr(mbs, 0, {lBound, uBound},
-		{lVel, uVel}, 0.125, 0.025, 1., 0.001);
 
-	// Test add*Constraint
-	dampJointConstr.addToSolver(solver);
-	BOOST_CHECK_EQUAL(solver.nrBoundConstraints(), 1);
-	BOOST_CHECK_EQUAL(solver.nrConstraints(), 1);
 
-	solver.nrVars(mbs, {}, {});
-	solver.updateConstrSize();
+BOOST_AUTO_TEST_CASE(QPFillCacheTest)
+{
+	using namespace Eigen;
+	using namespace tasks;
 
-	solver.addTask(&posTaskSp);
-	BOOST_CHECK_EQUAL(solver.nrTasks(), 1);
+	ArmLimitProblem arm;
+	// second constant task, its Q block overlap the posture one
+	qp::PostureTask postureTask2(arm.mbs, 0, arm.mbcInit.q, 2., 0.1);
 
+	qp::QPSolver solver;
+	solver.solver("QLD");
+	arm.addTo(solver);
+	solver.addTask(&postureTask2);
+	std::vector<qp::Task*> tasks = {&arm.posTaskSp, &arm.postureTask,
+		&postureTask2};
 
-	// Test JointLimitsConstr
-	mbcs[0] = mbcInit;
-	for(int i = 0; i < 2000; ++i)
+	auto addTask = [&solver, &tasks](qp::Task* t)
 	{
-		BOOST_REQUIRE(solver.solve(mbs, mbcs));
-		eulerIntegration(mbs[0], mbcs[0], 0.001);
+		solver.addTask(t);
+		tasks.push_back(t);
+	};
+	auto removeTask = [&solver, &tasks](qp::Task* t)
+	{
+		solver.removeTask(t);
+		tasks.erase(std::find(tasks.begin(), tasks.end(), t));
+	};
 
-		forwardKinematics(mbs[0], mbcs[0]);
-		forwardVelocity(mbs[0], mbcs[0]);
-		BOOST_REQUIRE_GT(mbcs[0].q[1][0], -(cst::pi<double>()/4.)*(1. - 0.025) - 0.01);
-	}
+	// same tasks solved by a solver without cached matrices
+	auto refResult = [&arm, &tasks]()
+	{
+		qp::QPSolver ref;
+		ref.solver("QLD");
+		arm.jointConstr.addToSolver(ref);
+		ref.nrVars(arm.mbs, {}, {});
+		ref.updateConstrSize();
+		for(qp::Task* t: tasks)
+		{
+			ref.addTask(t);
+		}
+		BOOST_REQUIRE(ref.solveNoMbcUpdate(arm.mbs, arm.mbcs));
+		return ref.alphaDVec();
+	};
 
-	posTask.position(RotZ(-cst::pi<double>()/2.)*mbcInit.bodyPosW[bodyI].translation());
-	mbcs[0] = mbcInit;
-	for(int i = 0; i < 2000; ++i)
+	for(int i = 0; i < 100; ++i)
 	{
-		BOOST_REQUIRE(solver.solve(mbs, mbcs));
-		eulerIntegration(mbs[0], mbcs[0], 0.001);
+		switch(i)
+		{
+		case 10:
+			// weight of a constant task
+			arm.postureTask.weight(0.1);
+			break;
+		case 20:
+			// target of a constant task (only C change)
+			arm.postureTask.posture(arm.mbcs[0].q);
+			arm.postureTask.stiffness(2.);
+			break;
+		case 30:
+			// weight of the non constant task
+			arm.posTaskSp.weight(20.);
+			break;
+		case 40:
+			// target of the non constant task
+			arm.posTask.position(arm.posTask.position() + Vector3d(0., 0.1, 0.));
+			break;
+		case 50:
+			// removed and added again between two solves, at the end of the list
+			removeTask(&arm.postureTask);
+			addTask(&arm.postureTask);
+			break;
+		case 60:
+			// one solve without the task
+			removeTask(&postureTask2);
+			break;
+		case 61:
+			addTask(&postureTask2);
+			break;
+		case 70:
+			// only constant tasks
+			removeTask(&arm.posTaskSp);
+			break;
+		case 80:
+			addTask(&arm.posTaskSp);
+			break;
+		}
 
-		forwardKinematics(mbs[0], mbcs[0]);
-		forwardVelocity(mbs[0], mbcs[0]);
-		BOOST_REQUIRE_LT(mbcs[0].q[1][0], (cst::pi<double>()/4.)*(1. - 0.025) + 0.01);
+		BOOST_REQUIRE(solver.solveNoMbcUpdate(arm.mbs, arm.mbcs));
+		BOOST_CHECK_SMALL((solver.alphaDVec() - refResult()).norm(), 1e-8);
+		arm.step(solver);
 	}
+}
 
-	solver.removeTask(&posTaskSp);
-	BOOST_CHECK_EQUAL(solver.nrTasks(), 0);
 
-	// Test remove*Constraint
-	dampJointConstr.removeFromSolver(solver);
-	BOOST_CHECK_EQUAL(solver.nrBoundConstraints(), 0);
-	BOOST_CHECK_EQUAL(solver.nrConstraints(), 0);
-}
 
-BOOST_AUTO_TEST_CASE(QPMimicJointTest)
+BOOST_AUTO_TEST_CASE(QPGoldfarbIdnaniTest)
 {
 	using namespace Eigen;
-	using namespace sva;
-	using namespace rbd;
 	using namespace tasks;
-	namespace cst = boost::math::constants;
-
-	/* Make a very simple gripper */
-	MultiBodyGraph mbg;
-
-	double mass = 1.;
-	Matrix3d I = Matrix3d::Identity();
-	Vector3d h = Vector3d::Zero();
-
-	RBInertiad rbi(mass, h, I);
-
-	Body b0(rbi, "b0");
-	Body b1(rbi, "b1");
-	Body b2(rbi, "b2");
-	Body b3(rbi, "b3");
-
-	mbg.addBody(b0);
-	mbg.addBody(b1);
-	mbg.addBody(b2);
-	mbg.addBody(b3);
 
-	Joint j0(Joint::RevZ, true, "j0");
-	Joint j1(Joint::RevZ, true, "j1");
-	j1.makeMimic("j0", -1.0, 0.0);
-	Joint j2(Joint::RevZ, true, "j2");
-	j2.makeMimic("j0", 0.0, 0.5);
+	std::mt19937 gen(42);
+	std::normal_distribution<double> dist;
+	auto random = [&gen, &dist](int rows, int cols)
+	{
+		MatrixXd M(rows, cols);
+		for(int i = 0; i < rows; ++i)
+		{
+			for(int j = 0; j < cols; ++j)
+			{
+				M(i, j) = dist(gen);
+			}
+		}
+		return M;
+	};
+
+	const int n = 8, me = 2, mi = 6;
+	MatrixXd M = random(n, n);
+	MatrixXd Q = M*M.transpose() + MatrixXd::Identity(n, n);
+	MatrixXd Aeq = random(me, n);
+	VectorXd beq = random(me, 1);
+	MatrixXd Aineq = random(mi, n);
+	VectorXd bineq = random(mi, 1).cwiseAbs();
+	VectorXd XL = VectorXd::Constant(n, -0.5);
+	VectorXd XU = VectorXd::Constant(n, 0.5);
+
+	qp::GoldfarbIdnani gi;
+	gi.problem(n, me, mi);
+	for(int i = 0; i < 20; ++i)
+	{
+		// only c change, the factorization of Q is kept after the first solve
+		VectorXd c = 10.*random(n, 1);
+		BOOST_REQUIRE(gi.solve(Q, c, Aeq, beq, Aineq, bineq, XL, XU, i > 0));
+		BOOST_CHECK_EQUAL(gi.nrFactorizations(), 1);
+
+		// KKT conditions
+		const VectorXd& x = gi.result();
+		const VectorXd& mult = gi.multipliers();
+		VectorXd lambdaEq = mult.head(me);
+		VectorXd lambdaIneq = mult.segment(me, mi);
+		VectorXd lambdaL = mult.segment(me + mi, n);
+		VectorXd lambdaU = mult.segment(me + mi + n, n);
+
+		// stationarity
+		VectorXd grad = Q*x + c - Aeq.transpose()*lambdaEq +
+			Aineq.transpose()*lambdaIneq - lambdaL + lambdaU;
+		BOOST_CHECK_SMALL(grad.norm(), 1e-8);
+		// primal feasibility
+		BOOST_CHECK_SMALL((Aeq*x - beq).norm(), 1e-8);
+		BOOST_CHECK_LE((Aineq*x - bineq).maxCoeff(), 1e-8);
+		BOOST_CHECK_LE((XL - x).maxCoeff(), 1e-8);
+		BOOST_CHECK_LE((x - XU).maxCoeff(), 1e-8);
+		// dual feasibility and complementarity
+		BOOST_CHECK_GE(mult.tail(mi + 2*n).minCoeff(), 0.);
+		BOOST_CHECK_SMALL(lambdaIneq.dot(bineq - Aineq*x), 1e-8);
+		BOOST_CHECK_SMALL(lambdaL.dot(x - XL), 1e-8);
+		BOOST_CHECK_SMALL(lambdaU.dot(XU - x), 1e-8);
+	}
+}
 
-	mbg.addJoint(j0);
-	mbg.addJoint(j1);
-	mbg.addJoint(j2);
 
-	PTransformd from = sva::PTransformd::Identity();
 
-	mbg.linkBodies("b0", from, "b1", from, "j0");
-	mbg.linkBodies("b1", from, "b2", from, "j1");
-	mbg.linkBodies("b2", from, "b3", from, "j2");
+BOOST_AUTO_TEST_CASE(QPGISolverTest)
+{
+	ArmLimitProblem arm;
 
-	MultiBody mb = mbg.makeMultiBody("b0", true, from);
+	// same problem solved by QLD and GI
+	tasks::qp::QPSolver qldSolver, giSolver;
+	qldSolver.solver("QLD");
+	giSolver.solver("GI");
+	arm.addTo(qldSolver);
+	arm.addTo(giSolver);
 
-	MultiBodyConfig mbcInit(mb);
-	mbcInit.zero(mb);
-	BOOST_CHECK_EQUAL(mbcInit.q[3][0], 0.5);
+	const tasks::qp::GIQPSolver* gi =
+		dynamic_cast<const tasks::qp::GIQPSolver*>(&giSolver.solverBackend());
+	BOOST_REQUIRE(gi != nullptr);
 
-	forwardKinematics(mb, mbcInit);
-	forwardVelocity(mb, mbcInit);
+	int nrFacto = 0;
+	for(int i = 0; i < 1000; ++i)
+	{
+		// only the posture task is left at the end, Q is then constant
+		if(i == 500)
+		{
+			qldSolver.removeTask(&arm.posTaskSp);
+			giSolver.removeTask(&arm.posTaskSp);
+		}
 
-	std::vector<rbd::MultiBody> mbs = {mb};
-	std::vector<rbd::MultiBodyConfig> mbcs = {mbcInit};
+		BOOST_REQUIRE(qldSolver.solveNoMbcUpdate(arm.mbs, arm.mbcs));
+		BOOST_REQUIRE(giSolver.solve(arm.mbs, arm.mbcs));
+		BOOST_CHECK_SMALL((qldSolver.alphaDVec() - giSolver.alphaDVec()).norm(),
+			1e-6);
+		BOOST_CHECK_GE(giSolver.solverIterations(), 0);
 
-	qp::QPSolver solver;
+		// Q is factorized at each solve while the position task is there
+		// and only once after
+		if(i < 500)
+		{
+			BOOST_CHECK_GT(gi->nrFactorizations(), nrFacto);
+		}
+		else if(i > 500)
+		{
+			BOOST_CHECK_EQUAL(gi->nrFactorizations(), nrFacto);
+		}
+		nrFacto = gi->nrFactorizations();
 
-	tasks::qp::PostureTask pt(mbs, 0, mbcInit.q, 100.0, 10.0);
+		arm.step(giSolver);
+		BOOST_REQUIRE(arm.inLimits());
+	}
+}
 
-	solver.nrVars(mbs, {}, {});
-	solver.updateConstrSize();
 
-	solver.addTask(&pt);
-	BOOST_CHECK_EQUAL(solver.nrTasks(), 1);
 
+BOOST_AUTO_TEST_CASE(QPADMMSolverTest)
+{
+	ArmLimitProblem arm;
+
+	// same problem solved by QLD, GI and ADMM with its default iterations
+	tasks::qp::QPSolver qldSolver, giSolver, admmSolver;
+	qldSolver.solver("QLD");
+	giSolver.solver("GI");
+	admmSolver.solver("ADMM");
+	arm.addTo(qldSolver);
+	arm.addTo(giSolver);
+	arm.addTo(admmSolver);
+	BOOST_CHECK_EQUAL(admmSolver.solverMaxIter(), 200);
 
-	// Test mimic joint in mbc
-	mbcs[0] = mbcInit;
 	for(int i = 0; i < 1000; ++i)
 	{
-		BOOST_REQUIRE(solver.solve(mbs, mbcs));
-		eulerIntegration(mbs[0], mbcs[0], 0.001);
-
-		forwardKinematics(mbs[0], mbcs[0]);
-		forwardVelocity(mbs[0], mbcs[0]);
-		BOOST_REQUIRE(mbcs[0].q[1][0] == -mbcs[0].q[2][0]);
-		BOOST_REQUIRE(mbcs[0].q[3][0] == 0.5);
-	}
-	BOOST_CHECK_SMALL(mbcs[0].q[1][0], 1e-4);
-
-	mbcs[0] = mbcInit;
-	pt.posture({{}, {0.2}, {-0.2}, {0.5}});
-	for(int i = 0; i < 2000; ++i)
-	{
-		BOOST_REQUIRE(solver.solve(mbs, mbcs));
-		eulerIntegration(mbs[0], mbcs[0], 0.001);
-
-		forwardKinematics(mbs[0], mbcs[0]);
-		forwardVelocity(mbs[0], mbcs[0]);
-		BOOST_REQUIRE(mbcs[0].q[1][0] == -mbcs[0].q[2][0]);
-		BOOST_REQUIRE(mbcs[0].q[3][0] == 0.5);
+		BOOST_REQUIRE(qldSolver.solveNoMbcUpdate(arm.mbs, arm.mbcs));
+		BOOST_REQUIRE(giSolver.solveNoMbcUpdate(arm.mbs, arm.mbcs));
+		BOOST_REQUIRE(admmSolver.solve(arm.mbs, arm.mbcs));
+		// fixed number of iterations
+		BOOST_CHECK_EQUAL(admmSolver.solverIterations(), 200);
+		BOOST_CHECK_LE(admmSolver.solverPrimalResidual(), 1e-3);
+		BOOST_CHECK_LE(admmSolver.solverDualResidual(), 1e-3);
+		BOOST_CHECK_SMALL((qldSolver.alphaDVec() - admmSolver.alphaDVec()).norm(),
+			1e-5);
+		BOOST_CHECK_SMALL((giSolver.alphaDVec() - admmSolver.alphaDVec()).norm(),
+			1e-5);
+
+		arm.step(admmSolver);
+		BOOST_REQUIRE(arm.inLimits());
 	}
-	BOOST_CHECK_SMALL(mbcs[0].q[1][0] - 0.2, 1e-4);
 
-	solver.removeTask(&pt);
-	BOOST_CHECK_EQUAL(solver.nrTasks(), 0);
+	// QLD doesn't report residuals
+	BOOST_CHECK_EQUAL(qldSolver.solverPrimalResidual(), -1.);
+	BOOST_CHECK_EQUAL(qldSolver.solverMaxIter(), -1);
+
+	// the iteration number is kept when changing the backend
+	tasks::qp::QPSolver iterSolver;
+	iterSolver.solverMaxIter(300);
+	iterSolver.solver("ADMM");
+	BOOST_CHECK_EQUAL(iterSolver.solverMaxIter(), 300);
+
+	// a negative number restores the default of each backend
+	iterSolver.solverMaxIter(-1);
+	BOOST_CHECK_EQUAL(iterSolver.solverMaxIter(), 200);
+	iterSolver.solver("GI");
+	BOOST_CHECK_EQUAL(iterSolver.solverMaxIter(), std::numeric_limits<int>::max());
+	iterSolver.solverMaxIter(10);
+	iterSolver.solverMaxIter(-1);
+	BOOST_CHECK_EQUAL(iterSolver.solverMaxIter(), std::numeric_limits<int>::max());
 }
 
 
-BOOST_AUTO_TEST_CASE(QPTorqueLimitsTest)
+
+BOOST_AUTO_TEST_CASE(QPTimeBudgetTest)
 {
 	using namespace Eigen;
 	using namespace sva;
@@ -750,61 +992,1315 @@ BOOST_AUTO_TEST_CASE(QPTorqueLimitsTest)
 	forwardVelocity(mb, mbcInit);
 
 	std::vector<rbd::MultiBody> mbs = {mb};
-	std::vector<rbd::MultiBodyConfig> mbcs = {mbcInit};
-
-	qp::QPSolver solver;
 
 	int bodyI = mb.bodyIndexByName("b3");
 	qp::PositionTask posTask(mbs, 0, "b3",
 		RotZ(cst::pi<double>()/2.)*mbcInit.bodyPosW[bodyI].translation());
 	qp::SetPointTask posTaskSp(mbs, 0, &posTask, 10., 1.);
+	qp::PostureTask postureTask(mbs, 0, mbcInit.q, 1., 0.01);
 
-	std::vector<std::vector<double> > lBound = {{}, {-30.}, {-30.}, {-30.}};
-	std::vector<std::vector<double> > uBound = {{}, {30.}, {30.}, {30.}};
+	double inf = std::numeric_limits<double>::infinity();
+	std::vector<std::vector<double> > lBound = {{}, {-cst::pi<double>()/4.}, {-inf}, {-inf}};
+	std::vector<std::vector<double> > uBound = {{}, {cst::pi<double>()/4.}, {inf}, {inf}};
 
-	qp::MotionConstr motionCstr(mbs, 0, {lBound, uBound});
-	qp::PositiveLambda plCstr;
+	qp::JointLimitsConstr jointConstr(mbs, 0, {lBound, uBound}, 0.001);
 
-	// Test add*Constraint
+	for(const std::string& name: {"QLD", "GI", "ADMM"})
+	{
+		std::vector<rbd::MultiBodyConfig> mbcs = {mbcInit};
+		qp::QPSolver solver;
+		solver.solver(name);
+		solver.solverMaxIter(1000);
+		jointConstr.addToSolver(solver);
+		solver.nrVars(mbs, {}, {});
+		solver.updateConstrSize();
+		solver.addTask(&posTaskSp);
+		solver.addTask(&postureTask);
 
-	solver.addGenInequalityConstraint(&motionCstr);
-	BOOST_CHECK_EQUAL(solver.nrGenInequalityConstraints(), 1);
-	solver.addConstraint(&motionCstr);
-	BOOST_CHECK_EQUAL(solver.nrConstraints(), 1);
+		BOOST_REQUIRE(solver.solve(mbs, mbcs));
+		BOOST_CHECK(solver.solverStatus() == qp::QPStatus::Success);
+		BOOST_CHECK(!solver.solverFallback());
+		VectorXd alphaD = solver.alphaDVec();
+
+		// the budget is spent by the update, the solver is not called
+		// and the result is the previous one projected on the bounds
+		solver.solverTimeBudget(0.);
+		BOOST_CHECK(!solver.solve(mbs, mbcs));
+		BOOST_CHECK(solver.solverStatus() == qp::QPStatus::Timeout);
+		BOOST_CHECK(solver.solverFallback());
+		BOOST_CHECK_SMALL((solver.alphaDVec() - alphaD).norm(), 1e-3);
+		BOOST_CHECK_SMALL((rbd::dofToVector(mb, mbcs[0].alphaD) - alphaD).norm(), 1e-3);
+
+		solver.solverTimeBudget(inf);
+		BOOST_CHECK(solver.solve(mbs, mbcs));
+		BOOST_CHECK(solver.solverStatus() == qp::QPStatus::Success);
+		BOOST_CHECK(!solver.solverFallback());
+	}
+}
 
-	plCstr.addToSolver(solver);
-	BOOST_CHECK_EQUAL(solver.nrBoundConstraints(), 1);
-	BOOST_CHECK_EQUAL(solver.nrConstraints(), 2);
 
-	solver.addTask(&posTaskSp);
-	BOOST_CHECK_EQUAL(solver.nrTasks(), 1);
 
-	solver.nrVars(mbs, {}, {});
-	solver.updateConstrSize();
+BOOST_AUTO_TEST_CASE(QPBackendCacheTimeBudgetTest)
+{
+	using namespace Eigen;
+	using namespace sva;
+	using namespace rbd;
+	using namespace tasks;
+	namespace cst = boost::math::constants;
 
+	// two fixed arms with and without a contact between their end effectors
+	MultiBody mb1, mb2;
+	MultiBodyConfig mbc1Init, mbc2Init;
 
-	// Test MotionConstr torque limits
-	mbcs[0] = mbcInit;
-	for(int i = 0; i < 10000; ++i)
-	{
-		BOOST_REQUIRE(solver.solve(mbs, mbcs));
-		eulerIntegration(mbs[0], mbcs[0], 0.001);
+	std::tie(mb1, mbc1Init) = makeZXZArm();
+	std::tie(mb2, mbc2Init) = makeZXZArm();
 
-		forwardKinematics(mbs[0], mbcs[0]);
-		forwardVelocity(mbs[0], mbcs[0]);
-		motionCstr.computeTorque(solver.alphaDVec(), solver.lambdaVec());
-		motionCstr.torque(mbs, mbcs);
-		for(int i = 0; i < 3; ++i)
-		{
-			BOOST_REQUIRE_GT(mbcs[0].jointTorque[i+1][0], lBound[i+1][0] - 0.001);
-			BOOST_REQUIRE_LT(mbcs[0].jointTorque[i+1][0], uBound[i+1][0] + 0.001);
-		}
-	}
+	forwardKinematics(mb1, mbc1Init);
+	forwardVelocity(mb1, mbc1Init);
+	forwardKinematics(mb2, mbc2Init);
+	forwardVelocity(mb2, mbc2Init);
 
-	posTask.position(mbcInit.bodyPosW[bodyI].translation());
-	for(int i = 0; i < 10000; ++i)
-	{
-		BOOST_REQUIRE(solver.solve(mbs, mbcs));
+	sva::PTransformd X_b1_b2(mbc2Init.bodyPosW.back()*mbc1Init.bodyPosW.back().inv());
+
+	std::vector<rbd::MultiBody> mbs = {mb1, mb2};
+
+	std::vector<qp::UnilateralContact> noCont;
+	std::vector<qp::UnilateralContact> cont =
+		{qp::UnilateralContact(0, 1, "b3", "b3",
+			{Vector3d::Zero()}, RotX(cst::pi<double>()/2.), X_b1_b2,
+			3, std::tan(cst::pi<double>()/4.))};
+
+	double inf = std::numeric_limits<double>::infinity();
+	std::vector<std::vector<double> > lTBound = {{}, {-100.}, {-100.}, {-100.}};
+	std::vector<std::vector<double> > uTBound = {{}, {100.}, {100.}, {100.}};
+
+	qp::MotionConstr motionConstr1(mbs, 0, {lTBound, uTBound});
+	qp::MotionConstr motionConstr2(mbs, 1, {lTBound, uTBound});
+	qp::PositiveLambda posLambdaConstr;
+	qp::ContactAccConstr contCstrAcc;
+	qp::PostureTask postureTask1(mbs, 0, mbc1Init.q, 1., 0.01);
+	qp::PostureTask postureTask2(mbs, 1, mbc2Init.q, 1., 0.01);
+
+	for(const std::string& name: {"QLD", "GI", "ADMM", "SPARSE"})
+	{
+		std::vector<rbd::MultiBodyConfig> mbcs = {mbc1Init, mbc2Init};
+		qp::QPSolver solver;
+		solver.solver(name);
+		solver.solverMaxIter(1000);
+		solver.backendCacheSize(2);
+		motionConstr1.addToSolver(solver);
+		motionConstr2.addToSolver(solver);
+		posLambdaConstr.addToSolver(solver);
+		contCstrAcc.addToSolver(solver);
+		solver.addTask(&postureTask1);
+		solver.addTask(&postureTask2);
+
+		// both layouts are last solved with an already spent budget
+		solver.solverTimeBudget(0.);
+		for(const auto& c: {noCont, cont})
+		{
+			solver.nrVars(mbs, c, {});
+			solver.updateConstrSize();
+			BOOST_CHECK(!solver.solveNoMbcUpdate(mbs, mbcs));
+			BOOST_CHECK(solver.solverStatus() == qp::QPStatus::Timeout);
+		}
+
+		// the cached backend must not keep its old deadline
+		solver.solverTimeBudget(inf);
+		for(int i = 0; i < 4; ++i)
+		{
+			solver.nrVars(mbs, i % 2 == 0 ? noCont : cont, {});
+			solver.updateConstrSize();
+			BOOST_CHECK(solver.solveNoMbcUpdate(mbs, mbcs));
+			BOOST_CHECK(solver.solverStatus() == qp::QPStatus::Success);
+		}
+		BOOST_CHECK_EQUAL(solver.backendCacheHits(), 4);
+
+		contCstrAcc.removeFromSolver(solver);
+		posLambdaConstr.removeFromSolver(solver);
+		motionConstr2.removeFromSolver(solver);
+		motionConstr1.removeFromSolver(solver);
+	}
+}
+
+
+
+BOOST_AUTO_TEST_CASE(QPMidSolveTimeoutTest)
+{
+	using namespace Eigen;
+	using namespace tasks;
+
+	ArmLimitProblem arm;
+
+	// ADMM is interrupted after some iterations, its last iterate
+	// is feasible and used instead of the fallback
+	const int maxIter = 100000000;
+	qp::QPSolver qldSolver, admmSolver;
+	qldSolver.solver("QLD");
+	admmSolver.solver("ADMM");
+	admmSolver.solverMaxIter(maxIter);
+	arm.addTo(qldSolver);
+	arm.addTo(admmSolver);
+	admmSolver.solverTimeBudget(0.02);
+
+	for(int i = 0; i < 5; ++i)
+	{
+		BOOST_REQUIRE(qldSolver.solveNoMbcUpdate(arm.mbs, arm.mbcs));
+		BOOST_CHECK(!admmSolver.solve(arm.mbs, arm.mbcs));
+		BOOST_CHECK(admmSolver.solverStatus() == qp::QPStatus::Timeout);
+		BOOST_CHECK_GT(admmSolver.solverIterations(), 0);
+		BOOST_CHECK_LT(admmSolver.solverIterations(), maxIter);
+		BOOST_CHECK(admmSolver.solverBackend().feasibleIterate());
+		BOOST_CHECK(!admmSolver.solverFallback());
+		BOOST_CHECK_EQUAL((admmSolver.result() -
+			admmSolver.solverBackend().result()).norm(), 0.);
+		BOOST_CHECK_SMALL((admmSolver.alphaDVec() - qldSolver.alphaDVec()).norm(),
+			1e-5);
+		BOOST_CHECK_SMALL((rbd::dofToVector(arm.mbs[0], arm.mbcs[0].alphaD) -
+			admmSolver.alphaDVec()).norm(), 1e-8);
+		arm.step(admmSolver);
+	}
+
+	// a GI iterate is never primal feasible, the fallback is used
+	qp::QPSolver giSolver;
+	giSolver.solver("GI");
+	arm.addTo(giSolver);
+	BOOST_REQUIRE(giSolver.solve(arm.mbs, arm.mbcs));
+	VectorXd alphaD = giSolver.alphaDVec();
+	giSolver.solverTimeBudget(0.);
+	BOOST_CHECK(!giSolver.solve(arm.mbs, arm.mbcs));
+	BOOST_CHECK(giSolver.solverStatus() == qp::QPStatus::Timeout);
+	BOOST_CHECK(!giSolver.solverBackend().feasibleIterate());
+	BOOST_CHECK(giSolver.solverFallback());
+	BOOST_CHECK_SMALL((giSolver.alphaDVec() - alphaD).norm(), 1e-3);
+
+	// GoldfarbIdnani interrupted at its first iteration: the equality lines
+	// are satisfied but not the violated bounds
+	std::mt19937 gen(42);
+	std::normal_distribution<double> dist;
+	auto random = [&gen, &dist](int rows, int cols)
+	{
+		MatrixXd M(rows, cols);
+		for(int i = 0; i < rows; ++i)
+		{
+			for(int j = 0; j < cols; ++j)
+			{
+				M(i, j) = dist(gen);
+			}
+		}
+		return M;
+	};
+
+	const int n = 8, me = 2, mi = 6;
+	MatrixXd M = random(n, n);
+	MatrixXd Q = M*M.transpose() + MatrixXd::Identity(n, n);
+	VectorXd c = 100.*random(n, 1);
+	MatrixXd Aeq = random(me, n);
+	VectorXd beq = random(me, 1);
+	MatrixXd Aineq = random(mi, n);
+	VectorXd bineq = random(mi, 1).cwiseAbs();
+	VectorXd XL = VectorXd::Constant(n, -0.5);
+	VectorXd XU = VectorXd::Constant(n, 0.5);
+
+	qp::GoldfarbIdnani gi;
+	gi.problem(n, me, mi);
+	gi.deadline(std::chrono::steady_clock::now());
+	BOOST_CHECK(!gi.solve(Q, c, Aeq, beq, Aineq, bineq, XL, XU));
+	BOOST_CHECK_EQUAL(gi.status(), qp::GoldfarbIdnani::Timeout);
+	BOOST_CHECK_EQUAL(gi.iterations(), 1);
+	BOOST_CHECK_SMALL((Aeq*gi.result() - beq).norm(), 1e-8);
+	BOOST_CHECK_GT(gi.result().cwiseAbs().maxCoeff(), 0.5);
+
+	gi.deadline(std::chrono::steady_clock::time_point::max());
+	BOOST_CHECK(gi.solve(Q, c, Aeq, beq, Aineq, bineq, XL, XU, true));
+	BOOST_CHECK_LE(gi.result().cwiseAbs().maxCoeff(), 0.5 + 1e-8);
+}
+
+
+
+BOOST_AUTO_TEST_CASE(QPRecorderTest)
+{
+	using namespace Eigen;
+	using namespace tasks;
+	namespace fs = boost::filesystem;
+
+	// the same problem is recorded with a key record every 40 records
+	// and with only key records
+	ArmLimitProblem arm, armKey;
+	qp::QPSolver solver, solverKey;
+	solver.solver("QLD");
+	solverKey.solver("QLD");
+	arm.addTo(solver);
+	armKey.addTo(solverKey);
+
+	auto tempPath = []()
+	{
+		return (fs::temp_directory_path()/
+			fs::unique_path("QPRecorderTest-%%%%%%%%.bin")).string();
+	};
+	const std::string path = tempPath();
+	const std::string pathKey = tempPath();
+	qp::QPRecorder recorder, recorderKey;
+	recorder.keyInterval(40);
+	recorderKey.keyInterval(1);
+	recorder.open(path);
+	recorderKey.open(pathKey);
+	solver.recorder(&recorder);
+	solverKey.recorder(&recorderKey);
+
+	const int nrIter = 100;
+	std::vector<VectorXd> results;
+	for(int i = 0; i < nrIter; ++i)
+	{
+		// Q is then constant
+		if(i == nrIter/2)
+		{
+			solver.removeTask(&arm.posTaskSp);
+			solverKey.removeTask(&armKey.posTaskSp);
+		}
+		BOOST_REQUIRE(solver.solve(arm.mbs, arm.mbcs));
+		BOOST_REQUIRE(solverKey.solve(armKey.mbs, armKey.mbcs));
+		results.push_back(solver.result());
+		arm.step(solver);
+		armKey.step(solverKey);
+	}
+	solver.recorder(nullptr);
+	solverKey.recorder(nullptr);
+
+	// the records are still in the buffer
+	BOOST_CHECK_EQUAL(fs::file_size(path), 16);
+	recorder.close();
+	recorderKey.close();
+	BOOST_CHECK_EQUAL(recorder.nrRecords(), nrIter);
+	BOOST_CHECK_EQUAL(recorderKey.nrRecords(), nrIter);
+
+	// only the changed entries are stored out of the key records
+	BOOST_CHECK_LT(fs::file_size(path), fs::file_size(pathKey));
+	const int n = solver.nrVars();
+
+	qp::QPRecordReader reader;
+	reader.open(path);
+	BOOST_REQUIRE_EQUAL(reader.nrRecords(), nrIter);
+
+	// solve again the recorded problems with another backend
+	qp::QPReplay replay("GI");
+	qp::QPRecord rec;
+	for(int i = 0; i < nrIter; ++i)
+	{
+		reader.read(i, rec);
+		BOOST_CHECK_EQUAL(rec.index, i);
+		BOOST_CHECK_EQUAL(rec.nrVars, n);
+		BOOST_CHECK(rec.status == qp::QPStatus::Success);
+		BOOST_CHECK_SMALL((rec.result - results[i]).norm(), 1e-12);
+		BOOST_REQUIRE(replay.solve(rec));
+		BOOST_CHECK_SMALL((replay.result() - results[i]).norm(), 1e-6);
+	}
+
+	// random access from the previous key record give the same record
+	// than the sequential read
+	qp::QPRecord random;
+	for(int i: {5, 40, 79, nrIter - 1})
+	{
+		reader.read(i, random);
+		BOOST_CHECK_SMALL((random.result - results[i]).norm(), 1e-12);
+	}
+	BOOST_CHECK_EQUAL((random.Q - rec.Q).norm(), 0.);
+	BOOST_CHECK_EQUAL((random.C - rec.C).norm(), 0.);
+	BOOST_CHECK(random.XL == rec.XL);
+	BOOST_CHECK(random.XU == rec.XU);
+
+	std::ostringstream qps;
+	qp::writeQPS(rec, "QPRecorderTest", qps);
+	BOOST_CHECK(qps.str().find("QUADOBJ") != std::string::npos);
+	BOOST_CHECK(qps.str().find("ENDATA") != std::string::npos);
+
+	// the key records give the same problems
+	qp::QPRecordReader readerKey;
+	readerKey.open(pathKey);
+	BOOST_REQUIRE_EQUAL(readerKey.nrRecords(), nrIter);
+	qp::QPRecord recKey;
+	for(int i = 0; i < nrIter; ++i)
+	{
+		reader.read(i, rec);
+		readerKey.read(i, recKey);
+		BOOST_CHECK_SMALL((rec.Q - recKey.Q).norm(), 1e-12);
+		BOOST_CHECK_SMALL((rec.C - recKey.C).norm(), 1e-12);
+		BOOST_CHECK(rec.XL == recKey.XL);
+		BOOST_CHECK(rec.XU == recKey.XU);
+	}
+
+	BOOST_CHECK(fs::remove(path));
+	BOOST_CHECK(fs::remove(pathKey));
+}
+
+
+
+BOOST_AUTO_TEST_CASE(QPPresolveTest)
+{
+	using namespace Eigen;
+	using namespace sva;
+	using namespace rbd;
+	using namespace tasks;
+
+	MultiBody mb;
+	MultiBodyConfig mbcInit;
+
+	std::tie(mb, mbcInit) = makeZXZArm();
+
+	forwardKinematics(mb, mbcInit);
+	forwardVelocity(mb, mbcInit);
+
+	std::vector<MultiBody> mbs = {mb};
+	std::vector<MultiBodyConfig> mbcs = {mbcInit};
+
+	std::string bodyName("b3");
+	qp::BoundedSpeedConstr constSpeed(mbs, 0, 0.005);
+	qp::PostureTask postureTask(mbs, 0, {{}, {0.}, {0.}, {0.}}, 1., 0.01);
+	qp::PositionTask posTask(mbs, 0, bodyName, Vector3d(1., -1., 1.));
+	qp::SetPointTask posTaskSp(mbs, 0, &posTask, 20., 1.);
+
+	// the second dof line is empty
+	MatrixXd dof(2, 6);
+	dof << 0.,0.,0.,1.,0.,0.,  0.,0.,0.,0.,0.,0.;
+	VectorXd speed(2);
+	speed << 0., 0.;
+	constSpeed.addBoundedSpeed(mbs, bodyName, Vector3d::Zero(), dof, speed);
+
+	// same problem solved with and without presolve,
+	// warmSolver active set is remapped on the presolved lines
+	qp::QPSolver solver, preSolver, warmSolver;
+	solver.solver("QLD");
+	preSolver.solver("QLD");
+	warmSolver.solver("QLD");
+	BOOST_CHECK(!preSolver.presolve());
+	preSolver.presolve(true);
+	BOOST_CHECK(preSolver.presolve());
+	warmSolver.presolve(true);
+	warmSolver.warmStart(true);
+
+	for(qp::QPSolver* s: {&solver, &preSolver, &warmSolver})
+	{
+		constSpeed.addToSolver(*s);
+		s->addTask(&postureTask);
+		s->addTask(&posTaskSp);
+		s->nrVars(mbs, {}, {});
+		s->updateConstrSize();
+	}
+	// the presolve setting is kept when the solver is changed
+	preSolver.solver("QLD");
+	BOOST_CHECK(preSolver.presolve());
+
+	int nrWarmSolved = 0;
+	for(int i = 0; i < 100; ++i)
+	{
+		BOOST_REQUIRE(solver.solveNoMbcUpdate(mbs, mbcs));
+		BOOST_REQUIRE(warmSolver.solveNoMbcUpdate(mbs, mbcs));
+		BOOST_REQUIRE(preSolver.solve(mbs, mbcs));
+		BOOST_CHECK_SMALL((solver.alphaDVec() - preSolver.alphaDVec()).norm(), 1e-6);
+		BOOST_CHECK_SMALL((solver.alphaDVec() - warmSolver.alphaDVec()).norm(), 1e-6);
+		if(warmSolver.solverIterations() > 0)
+		{
+			++nrWarmSolved;
+		}
+
+		const qp::PresolveStats& stats = preSolver.presolveStats();
+		BOOST_CHECK_EQUAL(stats.nrLines, 2);
+		BOOST_CHECK_EQUAL(stats.nrEmptyLines, 1);
+		BOOST_CHECK_EQUAL(solver.presolveStats().nrLines, 0);
+
+		eulerIntegration(mbs[0], mbcs[0], 0.005);
+
+		forwardKinematics(mbs[0], mbcs[0]);
+		forwardVelocity(mbs[0], mbcs[0]);
+	}
+	// the presolved active set seeds the warm start
+	BOOST_CHECK_GT(nrWarmSolved, 90);
+}
+
+
+
+BOOST_AUTO_TEST_CASE(QPPresolveLinesTest)
+{
+	using namespace Eigen;
+	using namespace tasks;
+
+	const double inf = std::numeric_limits<double>::infinity();
+
+	// A x <= b
+	MatrixXd A(7, 4);
+	VectorXd b(7);
+	A << 0., 0., 0., 0.,  // empty
+		1., 1., 0., 0.,
+		0., 2., 0., 0.,  // unbounded
+		0., 2., 0., 0.,  // x1 <= 0.5
+		0., 0., -1., 0.,  // x2 >= -1
+		0., 0., 0., 1.,  // x3 <= -3, infeasible with x3 >= -2
+		1., 0., 0., 1.;
+	b << 1., 2., inf, 1., 1., -3., 0.;
+	VectorXd XL(VectorXd::Constant(4, -inf)), XU(VectorXd::Constant(4, inf));
+	XL(3) = -2.;
+
+	MatrixXd AP(7, 4);
+	VectorXd bP(7);
+	qp::PresolveStats stats;
+	qp::PresolveMap map;
+	map.resize(7);
+	int nrPLines = qp::presolveLines(A, b, 7, false, AP, bP, XL, XU, stats, &map);
+
+	BOOST_REQUIRE_EQUAL(nrPLines, 3);
+	BOOST_CHECK_EQUAL(stats.nrLines, 7);
+	BOOST_CHECK_EQUAL(stats.nrEmptyLines, 1);
+	BOOST_CHECK_EQUAL(stats.nrUnboundedLines, 1);
+	BOOST_CHECK_EQUAL(stats.nrBoundLines, 2);
+	BOOST_CHECK_EQUAL((AP.row(0) - A.row(1)).norm(), 0.);
+	BOOST_CHECK_EQUAL((AP.row(1) - A.row(5)).norm(), 0.);
+	BOOST_CHECK_EQUAL((AP.row(2) - A.row(6)).norm(), 0.);
+	BOOST_CHECK_EQUAL(bP(1), -3.);
+	BOOST_CHECK_EQUAL(XU(1), 0.5);
+	BOOST_CHECK_EQUAL(XL(2), -1.);
+	BOOST_CHECK_EQUAL(XL(0), -inf);
+	BOOST_CHECK_EQUAL(XL(1), -inf);
+	BOOST_CHECK_EQUAL(XL(3), -2.);
+	BOOST_CHECK_EQUAL(XU(3), inf);
+
+	// active lines before the presolve: Aineq lines then
+	// lower bounds (7 + col) then upper bounds (7 + 4 + col)
+	// the removed lines are dropped and the bound lines become bounds
+	std::vector<int> activeSet = {1, 3, 4, 6, 7, 14, 0, 2};
+	map.toPresolved(activeSet);
+	BOOST_CHECK(activeSet == std::vector<int>({0, 3 + 4 + 1, 3 + 2, 2, 3, 3 + 4 + 3}));
+	activeSet = {3, 7 + 4 + 1};
+	map.toPresolved(activeSet);
+	BOOST_CHECK(activeSet == std::vector<int>({3 + 4 + 1}));
+	activeSet = {0, 1, 2, 3, 3 + 4 + 1};
+	map.fromPresolved(activeSet);
+	BOOST_CHECK(activeSet == std::vector<int>({1, 5, 6, 7, 7 + 4 + 1}));
+
+	// A x = b, the line on one variable set both bounds
+	MatrixXd Aeq(3, 4);
+	VectorXd beq(3);
+	Aeq << 0., 0., 0., 0.,
+		0., 0., 3., 0.,
+		0., 0., 0., 0.;  // infeasible
+	beq << 0., 3., 1.;
+	XL.setConstant(-inf);
+	XU.setConstant(inf);
+	stats = qp::PresolveStats();
+	nrPLines = qp::presolveLines(Aeq, beq, 3, true, AP, bP, XL, XU, stats);
+	BOOST_REQUIRE_EQUAL(nrPLines, 1);
+	BOOST_CHECK_EQUAL(stats.nrEmptyLines, 1);
+	BOOST_CHECK_EQUAL(stats.nrBoundLines, 1);
+	BOOST_CHECK_EQUAL(bP(0), 1.);
+	BOOST_CHECK_EQUAL(XL(2), 1.);
+	BOOST_CHECK_EQUAL(XU(2), 1.);
+}
+
+
+
+BOOST_AUTO_TEST_CASE(QPLeastSquaresTaskTest)
+{
+	using namespace Eigen;
+	using namespace sva;
+	using namespace rbd;
+	using namespace tasks;
+	namespace cst = boost::math::constants;
+
+	MultiBody mb;
+	MultiBodyConfig mbcInit;
+
+	std::tie(mb, mbcInit) = makeZXZArm();
+
+	forwardKinematics(mb, mbcInit);
+	forwardVelocity(mb, mbcInit);
+
+	std::vector<rbd::MultiBody> mbs = {mb};
+	std::vector<rbd::MultiBodyConfig> mbcs = {mbcInit};
+
+	int bodyI = mb.bodyIndexByName("b3");
+	qp::PositionTask posTask(mbs, 0, "b3",
+		RotZ(cst::pi<double>()/2.)*mbcInit.bodyPosW[bodyI].translation());
+	qp::SetPointTask posTaskSp(mbs, 0, &posTask, 10., Vector3d(1., 2., 3.), 1.);
+	qp::SetPointTask posTaskSpLS(mbs, 0, &posTask, 10., Vector3d(1., 2., 3.), 1.);
+	qp::PostureTask postureTask(mbs, 0, mbcInit.q, 1., 0.01);
+
+	BOOST_CHECK(!posTaskSpLS.isLeastSquares());
+	posTaskSpLS.leastSquares(true);
+	BOOST_CHECK(posTaskSpLS.isLeastSquares());
+
+	double inf = std::numeric_limits<double>::infinity();
+	std::vector<std::vector<double> > lBound = {{}, {-cst::pi<double>()/4.}, {-inf}, {-inf}};
+	std::vector<std::vector<double> > uBound = {{}, {cst::pi<double>()/4.}, {inf}, {inf}};
+
+	qp::JointLimitsConstr jointConstr(mbs, 0, {lBound, uBound}, 0.001);
+
+	// the same problem with the Q/C and the least squares form
+	qp::QPSolver solver, solverLS, solverLSSparse;
+	solver.solver("QLD");
+	solverLS.solver("QLD");
+	solverLSSparse.solver("SPARSE");
+
+	for(qp::QPSolver* s: {&solver, &solverLS, &solverLSSparse})
+	{
+		jointConstr.addToSolver(*s);
+		s->nrVars(mbs, {}, {});
+		s->updateConstrSize();
+		s->addTask(&postureTask);
+	}
+	solver.addTask(&posTaskSp);
+	solverLS.addTask(&posTaskSpLS);
+	solverLSSparse.addTask(&posTaskSpLS);
+
+	for(int i = 0; i < 1000; ++i)
+	{
+		// go back and forth between the two modes on the same task
+		if(i == 400 || i == 600)
+		{
+			posTaskSpLS.leastSquares(i == 600);
+		}
+
+		BOOST_REQUIRE(solverLS.solveNoMbcUpdate(mbs, mbcs));
+		BOOST_REQUIRE(solverLSSparse.solveNoMbcUpdate(mbs, mbcs));
+		BOOST_REQUIRE(solver.solve(mbs, mbcs));
+		BOOST_CHECK_SMALL((solver.alphaDVec() - solverLS.alphaDVec()).norm(), 1e-6);
+		BOOST_CHECK_SMALL((solver.alphaDVec() - solverLSSparse.alphaDVec()).norm(),
+			1e-5);
+
+		if(posTaskSpLS.isLeastSquares())
+		{
+			// Q and C are not computed in least squares mode
+			BOOST_CHECK_THROW(posTaskSpLS.Q(), std::domain_error);
+			BOOST_CHECK_THROW(posTaskSpLS.C(), std::domain_error);
+			const MatrixXd& ALS = posTaskSpLS.ALS();
+			MatrixXd QLS = ALS.transpose()*ALS;
+			BOOST_CHECK_SMALL((posTaskSp.Q().triangularView<Upper>().toDenseMatrix() -
+				MatrixXd(QLS.triangularView<Upper>())).norm(), 1e-8);
+			BOOST_CHECK_SMALL((posTaskSp.C() + ALS.transpose()*posTaskSpLS.bLS()).norm(),
+				1e-8);
+		}
+		else
+		{
+			BOOST_CHECK_SMALL((posTaskSp.Q().triangularView<Upper>().toDenseMatrix() -
+				posTaskSpLS.Q().triangularView<Upper>().toDenseMatrix()).norm(), 1e-8);
+			BOOST_CHECK_SMALL((posTaskSp.C() - posTaskSpLS.C()).norm(), 1e-8);
+		}
+		eulerIntegration(mbs[0], mbcs[0], 0.001);
+
+		forwardKinematics(mbs[0], mbcs[0]);
+		forwardVelocity(mbs[0], mbcs[0]);
+	}
+}
+
+
+
+BOOST_AUTO_TEST_CASE(QPSetPointTaskKernelTest)
+{
+	using namespace Eigen;
+	using namespace sva;
+	using namespace rbd;
+	using namespace tasks;
+
+	MultiBody mb;
+	MultiBodyConfig mbcInit;
+
+	std::tie(mb, mbcInit) = makeZXZArm();
+	mbcInit.q = {{}, {0.4}, {-0.6}, {0.2}};
+	mbcInit.alpha = {{}, {0.1}, {0.3}, {-0.2}};
+
+	forwardKinematics(mb, mbcInit);
+	forwardVelocity(mb, mbcInit);
+
+	std::vector<rbd::MultiBody> mbs = {mb};
+	std::vector<rbd::MultiBodyConfig> mbcs = {mbcInit};
+
+	qp::QPSolver solver;
+	solver.nrVars(mbs, {}, {});
+	solver.updateConstrSize();
+	solver.data().computeNormalAccB(mbs, mbcs);
+
+	// 3D and 6D tasks use the fixed size kernel, GazeTask the dynamic one
+	qp::PositionTask posTask(mbs, 0, "b3", Vector3d(0.5, 0.5, 0.));
+	qp::PositionBasedVisServoTask pbvsTask(mbs, 0, "b3",
+		PTransformd(Vector3d(0.1, 0.2, 0.3)));
+	qp::GazeTask gazeTask(mbs, 0, "b3", Vector3d(0.1, 0.2, 1.),
+		PTransformd::Identity());
+
+	for(qp::HighLevelTask* hlTask: std::vector<qp::HighLevelTask*>{&posTask,
+		&pbvsTask, &gazeTask})
+	{
+		VectorXd dimWeight = VectorXd::LinSpaced(hlTask->dim(), 1., 2.);
+		qp::SetPointTask sp(mbs, 0, hlTask, 10., dimWeight, 1.);
+		qp::SetPointTask spLS(mbs, 0, hlTask, 10., dimWeight, 1.);
+		spLS.leastSquares(true);
+		sp.updateNrVars(mbs, solver.data());
+		spLS.updateNrVars(mbs, solver.data());
+		sp.update(mbs, mbcs, solver.data());
+		spLS.update(mbs, mbcs, solver.data());
+
+		MatrixXd J = hlTask->jac();
+		VectorXd error = 10.*hlTask->eval() - 2.*std::sqrt(10.)*hlTask->speed() -
+			hlTask->normalAcc();
+		MatrixXd Q = J.transpose()*dimWeight.asDiagonal()*J;
+		VectorXd C = -J.transpose()*dimWeight.asDiagonal()*error;
+
+		MatrixXd QUp = sp.Q().triangularView<Upper>();
+		MatrixXd QRefUp = Q.triangularView<Upper>();
+		BOOST_CHECK_SMALL((QUp - QRefUp).norm(), 1e-8);
+		BOOST_CHECK_SMALL((sp.C() - C).norm(), 1e-8);
+		BOOST_CHECK_SMALL((spLS.ALS() -
+			dimWeight.cwiseSqrt().asDiagonal()*J).norm(), 1e-8);
+		BOOST_CHECK_SMALL((spLS.bLS() -
+			dimWeight.cwiseSqrt().asDiagonal()*error).norm(), 1e-8);
+	}
+}
+
+
+BOOST_AUTO_TEST_CASE(QPParallelUpdateTest)
+{
+	using namespace Eigen;
+	using namespace sva;
+	using namespace rbd;
+	using namespace tasks;
+	namespace cst = boost::math::constants;
+
+	MultiBody mb;
+	MultiBodyConfig mbcInit;
+
+	std::tie(mb, mbcInit) = makeZXZArm();
+
+	forwardKinematics(mb, mbcInit);
+	forwardVelocity(mb, mbcInit);
+
+	std::vector<rbd::MultiBody> mbs = {mb};
+	std::vector<rbd::MultiBodyConfig> mbcs = {mbcInit};
+
+	int bodyI = mb.bodyIndexByName("b3");
+	qp::PositionTask posTask(mbs, 0, "b3",
+		RotZ(cst::pi<double>()/2.)*mbcInit.bodyPosW[bodyI].translation());
+	qp::OrientationTask oriTask(mbs, 0, "b3", RotZ(cst::pi<double>()/4.));
+	qp::PostureTask postureTask(mbs, 0, mbcInit.q, 1., 0.01);
+
+	double inf = std::numeric_limits<double>::infinity();
+	std::vector<std::vector<double> > lBound = {{}, {-cst::pi<double>()/4.}, {-inf}, {-inf}};
+	std::vector<std::vector<double> > uBound = {{}, {cst::pi<double>()/4.}, {inf}, {inf}};
+
+	qp::JointLimitsConstr jointConstr(mbs, 0, {lBound, uBound}, 0.001);
+
+	qp::QPSolver solver, solverPar;
+	BOOST_CHECK_EQUAL(solverPar.nrThreads(), 1);
+	solverPar.nrThreads(4);
+	BOOST_CHECK_EQUAL(solverPar.nrThreads(), 4);
+
+	// posTask is shared by two set point tasks so they must be updated
+	// sequentially
+	qp::SetPointTask posTaskSp(mbs, 0, &posTask, 10., 1.);
+	qp::SetPointTask posTaskSp2(mbs, 0, &posTask, 100., 0.1);
+	qp::SetPointTask oriTaskSp(mbs, 0, &oriTask, 10., 1.);
+
+	for(qp::QPSolver* s: {&solver, &solverPar})
+	{
+		jointConstr.addToSolver(*s);
+		s->nrVars(mbs, {}, {});
+		s->updateConstrSize();
+		s->addTask(&postureTask);
+		s->addTask(&posTaskSp);
+		s->addTask(&oriTaskSp);
+		s->addTask(&posTaskSp2);
+	}
+
+	solverPar.taskUpdateGroup(&posTaskSp, 0);
+	solverPar.taskUpdateGroup(&posTaskSp2, 0);
+	BOOST_CHECK_EQUAL(solverPar.taskUpdateGroup(&posTaskSp2), 0);
+	BOOST_CHECK_EQUAL(solverPar.taskUpdateGroup(&oriTaskSp), -1);
+
+	for(int i = 0; i < 1000; ++i)
+	{
+		BOOST_REQUIRE(solverPar.solveNoMbcUpdate(mbs, mbcs));
+		BOOST_REQUIRE(solver.solve(mbs, mbcs));
+		BOOST_CHECK_SMALL((solver.alphaDVec() - solverPar.alphaDVec()).norm(), 1e-8);
+		eulerIntegration(mbs[0], mbcs[0], 0.001);
+
+		forwardKinematics(mbs[0], mbcs[0]);
+		forwardVelocity(mbs[0], mbcs[0]);
+	}
+}
+
+
+
+BOOST_AUTO_TEST_CASE(QPSolveBatchTest)
+{
+	using namespace Eigen;
+	using namespace sva;
+	using namespace rbd;
+	using namespace tasks;
+
+	MultiBody mb;
+	MultiBodyConfig mbcInit;
+
+	std::tie(mb, mbcInit) = makeZXZArm();
+
+	forwardKinematics(mb, mbcInit);
+	forwardVelocity(mb, mbcInit);
+
+	std::vector<rbd::MultiBody> mbs = {mb};
+
+	// batch of configurations along a trajectory
+	std::vector<std::vector<rbd::MultiBodyConfig>> batch;
+	MultiBodyConfig mbc = mbcInit;
+	for(int i = 0; i < 50; ++i)
+	{
+		mbc.q[1][0] += 0.02;
+		mbc.alpha[2][0] = 0.1*i;
+		forwardKinematics(mb, mbc);
+		forwardVelocity(mb, mbc);
+		batch.push_back({mbc});
+	}
+
+	// each solver has its own tasks
+	const int nrSolvers = 3;
+	std::vector<std::unique_ptr<qp::PositionTask>> posTasks;
+	std::vector<std::unique_ptr<qp::SetPointTask>> posTasksSp;
+	auto build = [&](qp::QPSolver& s)
+	{
+		posTasks.emplace_back(new qp::PositionTask(mbs, 0, "b3",
+			Vector3d(0.5, 0.5, 0.)));
+		posTasksSp.emplace_back(new qp::SetPointTask(mbs, 0, posTasks.back().get(),
+			10., 1.));
+		s.solver("QLD");
+		s.addTask(posTasksSp.back().get());
+		s.nrVars(mbs, {}, {});
+		s.updateConstrSize();
+	};
+
+	qp::QPBatchSolver batchSolver(nrSolvers, build);
+	BOOST_REQUIRE_EQUAL(batchSolver.nrSolvers(), nrSolvers);
+	BOOST_CHECK(batchSolver.solver(0).solverReentrant());
+
+	// the last one is used as reference
+	qp::QPSolver solver;
+	build(solver);
+
+	// the solvers and the threads are reused by each solve
+	MatrixXd results;
+	Array<bool, Dynamic, 1> success;
+	for(int b = 0; b < 2; ++b)
+	{
+		BOOST_CHECK_EQUAL(batchSolver.solve(mbs, batch, results, success),
+			int(batch.size()));
+		BOOST_REQUIRE_EQUAL(results.cols(), int(batch.size()));
+		BOOST_REQUIRE_EQUAL(success.size(), int(batch.size()));
+
+		for(std::size_t i = 0; i < batch.size(); ++i)
+		{
+			BOOST_REQUIRE(solver.solveNoMbcUpdate(mbs, batch[i]));
+			BOOST_CHECK(success(i));
+			BOOST_CHECK_SMALL((solver.result() - results.col(i)).norm(), 1e-8);
+		}
+	}
+	BOOST_CHECK_EQUAL(int(posTasks.size()), nrSolvers + 1);
+
+	BOOST_CHECK_THROW(qp::QPBatchSolver(0, build), std::domain_error);
+
+	// the second solver has the variables of two robots
+	int nrBuilt = 0;
+	auto badBuild = [&](qp::QPSolver& s)
+	{
+		std::vector<rbd::MultiBody> buildMbs(nrBuilt++ == 0 ? 1 : 2, mb);
+		s.nrVars(buildMbs, {}, {});
+	};
+	BOOST_CHECK_THROW(qp::QPBatchSolver(2, badBuild), std::domain_error);
+}
+
+
+
+BOOST_AUTO_TEST_CASE(QPProfilerTest)
+{
+	using namespace Eigen;
+	using namespace sva;
+	using namespace rbd;
+	using namespace tasks;
+	namespace cst = boost::math::constants;
+
+	MultiBody mb;
+	MultiBodyConfig mbcInit;
+
+	std::tie(mb, mbcInit) = makeZXZArm();
+
+	forwardKinematics(mb, mbcInit);
+	forwardVelocity(mb, mbcInit);
+
+	std::vector<rbd::MultiBody> mbs = {mb};
+	std::vector<rbd::MultiBodyConfig> mbcs = {mbcInit};
+
+	qp::PositionTask posTask(mbs, 0, "b3", Vector3d(0.5, 0.5, 0.));
+	qp::SetPointTask posTaskSp(mbs, 0, &posTask, 10., 1.);
+	qp::PostureTask postureTask(mbs, 0, mbcInit.q, 1., 0.01);
+
+	double inf = std::numeric_limits<double>::infinity();
+	std::vector<std::vector<double> > lBound = {{}, {-cst::pi<double>()/4.}, {-inf}, {-inf}};
+	std::vector<std::vector<double> > uBound = {{}, {cst::pi<double>()/4.}, {inf}, {inf}};
+	qp::JointLimitsConstr jointConstr(mbs, 0, {lBound, uBound}, 0.001);
+
+	qp::QPSolver solver;
+	jointConstr.addToSolver(solver);
+	solver.nrVars(mbs, {}, {});
+	solver.updateConstrSize();
+	solver.addTask(&postureTask);
+	solver.addTask(&posTaskSp);
+
+	// nothing is recorded by default
+	BOOST_CHECK(!solver.profiler().enabled());
+	BOOST_REQUIRE(solver.solveNoMbcUpdate(mbs, mbcs));
+	BOOST_CHECK_EQUAL(solver.profiler().stats("solve").count, 0);
+
+	solver.profiler().enabled(true);
+	solver.profiler().window(50);
+	for(int nrThreads: {1, 2})
+	{
+		solver.nrThreads(nrThreads);
+		solver.profiler().reset();
+		for(int i = 0; i < 100; ++i)
+		{
+			BOOST_REQUIRE(solver.solveNoMbcUpdate(mbs, mbcs));
+		}
+
+		for(const char* phase: {"computeNormalAccB", "update",
+				"updateMatrix", "solve", "total",
+				"constraint[0] JointLimitsConstr", "task[0] PostureTask",
+				"task[1] SetPointTask"})
+		{
+			qp::QPProfiler::Stats s = solver.profiler().stats(phase);
+			BOOST_CHECK_EQUAL(s.count, 50);
+			BOOST_CHECK_GE(s.p50, 0.);
+			BOOST_CHECK_LE(s.p50, s.p99);
+			BOOST_CHECK_LE(s.p99, s.max);
+			BOOST_CHECK_LE(s.last, s.max);
+		}
+		BOOST_CHECK_LE(solver.profiler().stats("solve").max,
+			solver.profiler().stats("total").max);
+	}
+
+	BOOST_CHECK_THROW(solver.profiler().stats("unknown"), std::domain_error);
+}
+
+
+
+BOOST_AUTO_TEST_CASE(QPDamperJointLimitsTest)
+{
+	using namespace Eigen;
+	using namespace sva;
+	using namespace rbd;
+	using namespace tasks;
+	namespace cst = boost::math::constants;
+
+	MultiBody mb;
+	MultiBodyConfig mbcInit;
+
+	std::tie(mb, mbcInit) = makeZXZArm();
+
+	forwardKinematics(mb, mbcInit);
+	forwardVelocity(mb, mbcInit);
+
+	std::vector<rbd::MultiBody> mbs = {mb};
+	std::vector<rbd::MultiBodyConfig> mbcs = {mbcInit};
+
+	qp::QPSolver solver;
+
+	int bodyI = mb.bodyIndexByName("b3");
+	qp::PositionTask posTask(mbs, 0, "b3",
+		RotZ(cst::pi<double>()/2.)*mbcInit.bodyPosW[bodyI].translation());
+	qp::SetPointTask posTaskSp(mbs, 0, &posTask, 10., 1.);
+
+	double inf = std::numeric_limits<double>::infinity();
+	std::vector<std::vector<double> > lBound = {{}, {-cst::pi<double>()/4.}, {-inf}, {-inf}};
+	std::vector<std::vector<double> > uBound = {{}, {cst::pi<double>()/4.}, {inf}, {inf}};
+	std::vector<std::vector<double> > lVel = {{}, {-inf}, {-inf}, {-inf}};
+	std::vector<std::vector<double> > uVel = {{}, {inf}, {inf}, {inf}};
+
+	qp::DamperJointLimitsConstr dampJointConstr(mbs, 0, {lBound, uBound},
+		{lVel, uVel}, 0.125, 0.025, 1., 0.001);
+
+	// Test add*Constraint
+	dampJointConstr.addToSolver(solver);
+	BOOST_CHECK_EQUAL(solver.nrBoundConstraints(), 1);
+	BOOST_CHECK_EQUAL(solver.nrConstraints(), 1);
+
+	solver.nrVars(mbs, {}, {});
+	solver.updateConstrSize();
+
+	solver.addTask(&posTaskSp);
+	BOOST_CHECK_EQUAL(solver.nrTasks(), 1);
+
+
+	// Test JointLimitsConstr
+	mbcs[0] = mbcInit;
+	for(int i = 0; i < 2000; ++i)
+	{
+		BOOST_REQUIRE(solver.solve(mbs, mbcs));
+		eulerIntegration(mbs[0], mbcs[0], 0.001);
+
+		forwardKinematics(mbs[0], mbcs[0]);
+		forwardVelocity(mbs[0], mbcs[0]);
+		BOOST_REQUIRE_GT(mbcs[0].q[1][0], -(cst::pi<double>()/4.)*(1. - 0.025) - 0.01);
+	}
+
+	posTask.position(RotZ(-cst::pi<double>()/2.)*mbcInit.bodyPosW[bodyI].translation());
+	mbcs[0] = mbcInit;
+	for(int i = 0; i < 2000; ++i)
+	{
+		BOOST_REQUIRE(solver.solve(mbs, mbcs));
+		eulerIntegration(mbs[0], mbcs[0], 0.001);
+
+		forwardKinematics(mbs[0], mbcs[0]);
+		forwardVelocity(mbs[0], mbcs[0]);
+		BOOST_REQUIRE_LT(mbcs[0].q[1][0], (cst::pi<double>()/4.)*(1. - 0.025) + 0.01);
+	}
+
+	solver.removeTask(&posTaskSp);
+	BOOST_CHECK_EQUAL(solver.nrTasks(), 0);
+
+	// Test remove*Constraint
+	dampJointConstr.removeFromSolver(solver);
+	BOOST_CHECK_EQUAL(solver.nrBoundConstraints(), 0);
+	BOOST_CHECK_EQUAL(solver.nrConstraints(), 0);
+}
+
+BOOST_AUTO_TEST_CASE(QPVariableReductionTest)
+{
+	using namespace Eigen;
+	using namespace tasks;
+
+	const int nrVars = 12;
+	std::mt19937 gen(42);
+	std::uniform_real_distribution<double> factor(-2., 2.);
+	auto pick = [&gen](int lo, int hi)
+	{
+		return std::uniform_int_distribution<int>(lo, hi)(gen);
+	};
+
+	std::unique_ptr<qp::GenQPSolver> solver(
+		qp::createQPSolver(qp::QPSolver::defaultSolver()));
+	for(int t = 0; t < 100; ++t)
+	{
+		// the first nrDep shuffled variables are replicas of the other ones
+		std::vector<int> vars(nrVars);
+		for(int i = 0; i < nrVars; ++i)
+		{
+			vars[i] = i;
+		}
+		std::shuffle(vars.begin(), vars.end(), gen);
+		int nrDep = pick(1, nrVars/2);
+		std::vector<std::tuple<int, int, double>> deps;
+		for(int i = 0; i < nrDep; ++i)
+		{
+			deps.emplace_back(vars[pick(nrDep, nrVars - 1)], vars[i], factor(gen));
+		}
+
+		solver->setDependencies(nrVars, deps);
+		const qp::VariableReduction& red = solver->reduction();
+		BOOST_REQUIRE_EQUAL(red.nrFull, nrVars);
+		BOOST_REQUIRE_EQUAL(red.nrReduced, nrVars - nrDep);
+
+		// dense reduction operator x = P x_r
+		MatrixXd P(MatrixXd::Zero(nrVars, red.nrReduced));
+		for(const qp::VariableReduction::Run& r: red.runs)
+		{
+			P.block(r.full, r.reduced, r.size, r.size).setIdentity();
+		}
+		for(const qp::VariableReduction::Replica& r: red.replicas)
+		{
+			P(r.full, r.reduced) = r.factor;
+		}
+		BOOST_REQUIRE_EQUAL((P.array() != 0.).count(), nrVars);
+
+		// task on the full variables [begin, begin + size)
+		int begin = pick(0, nrVars - 1);
+		int size = pick(1, nrVars - begin);
+		MatrixXd J(MatrixXd::Random(size + 1, size));
+		MatrixXd Qi(J.transpose()*J);
+		VectorXd Ci(VectorXd::Random(size));
+		MatrixXd QFull(MatrixXd::Zero(nrVars, nrVars));
+		VectorXd CFull(VectorXd::Zero(nrVars));
+		QFull.block(begin, begin, size, size) = Qi;
+		CFull.segment(begin, size) = Ci;
+
+		MatrixXd Q(MatrixXd::Zero(red.nrReduced, red.nrReduced));
+		VectorXd C(VectorXd::Zero(red.nrReduced));
+		qp::addReducedQ(Qi, begin, 2., red, Q);
+		qp::addReducedC(Ci, begin, 2., red, C);
+		MatrixXd QRef(2.*P.transpose()*QFull*P);
+		BOOST_CHECK_SMALL((MatrixXd(Q.triangularView<Upper>()) -
+			MatrixXd(QRef.triangularView<Upper>())).norm(), 1e-10);
+		BOOST_CHECK_SMALL((C - 2.*P.transpose()*CFull).norm(), 1e-10);
+
+		// constraint on [begin, begin + size) split in two column blocks
+		// stored in reverse order in the constraint matrix
+		const int nrConstr = 3;
+		int s1 = pick(0, size);
+		int s2 = size - s1;
+		std::vector<qp::ColBlock> blocks = {qp::ColBlock(begin, s1, s2),
+			qp::ColBlock(begin + s1, s2, 0)};
+		MatrixXd Ai(MatrixXd::Random(nrConstr + 1, size));
+		MatrixXd AFull(MatrixXd::Zero(nrConstr, nrVars));
+		AFull.block(0, begin, nrConstr, s1) = Ai.block(1, s2, nrConstr, s1);
+		AFull.block(0, begin + s1, nrConstr, s2) = Ai.block(1, 0, nrConstr, s2);
+
+		MatrixXd A(MatrixXd::Zero(nrConstr + 2, red.nrReduced));
+		qp::fillReducedA(Ai, blocks, 1, nrConstr, 1, -1., red, A);
+		BOOST_CHECK_SMALL((A.middleRows(1, nrConstr) + AFull*P).norm(), 1e-10);
+		BOOST_CHECK_EQUAL(A.row(0).norm(), 0.);
+		BOOST_CHECK_EQUAL(A.row(nrConstr + 1).norm(), 0.);
+
+		// dense constraint
+		MatrixXd AiDense(MatrixXd::Random(nrConstr, nrVars));
+		A.setZero();
+		qp::fillReducedA(AiDense, {qp::ColBlock::full()}, 0, nrConstr, 2, 1., red, A);
+		BOOST_CHECK_SMALL((A.middleRows(2, nrConstr) - AiDense*P).norm(), 1e-10);
+		BOOST_CHECK_EQUAL(A.topRows(2).norm(), 0.);
+	}
+}
+
+
+BOOST_AUTO_TEST_CASE(QPMimicJointTest)
+{
+	using namespace Eigen;
+	using namespace sva;
+	using namespace rbd;
+	using namespace tasks;
+	namespace cst = boost::math::constants;
+
+	/* Make a very simple gripper */
+	MultiBodyGraph mbg;
+
+	double mass = 1.;
+	Matrix3d I = Matrix3d::Identity();
+	Vector3d h = Vector3d::Zero();
+
+	RBInertiad rbi(mass, h, I);
+
+	Body b0(rbi, "b0");
+	Body b1(rbi, "b1");
+	Body b2(rbi, "b2");
+	Body b3(rbi, "b3");
+
+	mbg.addBody(b0);
+	mbg.addBody(b1);
+	mbg.addBody(b2);
+	mbg.addBody(b3);
+
+	Joint j0(Joint::RevZ, true, "j0");
+	Joint j1(Joint::RevZ, true, "j1");
+	j1.makeMimic("j0", -1.0, 0.0);
+	Joint j2(Joint::RevZ, true, "j2");
+	j2.makeMimic("j0", 0.0, 0.5);
+
+	mbg.addJoint(j0);
+	mbg.addJoint(j1);
+	mbg.addJoint(j2);
+
+	PTransformd from = sva::PTransformd::Identity();
+
+	mbg.linkBodies("b0", from, "b1", from, "j0");
+	mbg.linkBodies("b1", from, "b2", from, "j1");
+	mbg.linkBodies("b2", from, "b3", from, "j2");
+
+	MultiBody mb = mbg.makeMultiBody("b0", true, from);
+
+	MultiBodyConfig mbcInit(mb);
+	mbcInit.zero(mb);
+	BOOST_CHECK_EQUAL(mbcInit.q[3][0], 0.5);
+
+	forwardKinematics(mb, mbcInit);
+	forwardVelocity(mb, mbcInit);
+
+	std::vector<rbd::MultiBody> mbs = {mb};
+	std::vector<rbd::MultiBodyConfig> mbcs = {mbcInit};
+
+	qp::QPSolver solver;
+
+	tasks::qp::PostureTask pt(mbs, 0, mbcInit.q, 100.0, 10.0);
+
+	solver.nrVars(mbs, {}, {});
+	solver.updateConstrSize();
+
+	solver.addTask(&pt);
+	BOOST_CHECK_EQUAL(solver.nrTasks(), 1);
+
+
+	// Test mimic joint in mbc
+	mbcs[0] = mbcInit;
+	for(int i = 0; i < 1000; ++i)
+	{
+		BOOST_REQUIRE(solver.solve(mbs, mbcs));
+		eulerIntegration(mbs[0], mbcs[0], 0.001);
+
+		forwardKinematics(mbs[0], mbcs[0]);
+		forwardVelocity(mbs[0], mbcs[0]);
+		BOOST_REQUIRE(mbcs[0].q[1][0] == -mbcs[0].q[2][0]);
+		BOOST_REQUIRE(mbcs[0].q[3][0] == 0.5);
+	}
+	BOOST_CHECK_SMALL(mbcs[0].q[1][0], 1e-4);
+
+	mbcs[0] = mbcInit;
+	pt.posture({{}, {0.2}, {-0.2}, {0.5}});
+	for(int i = 0; i < 2000; ++i)
+	{
+		BOOST_REQUIRE(solver.solve(mbs, mbcs));
+		eulerIntegration(mbs[0], mbcs[0], 0.001);
+
+		forwardKinematics(mbs[0], mbcs[0]);
+		forwardVelocity(mbs[0], mbcs[0]);
+		BOOST_REQUIRE(mbcs[0].q[1][0] == -mbcs[0].q[2][0]);
+		BOOST_REQUIRE(mbcs[0].q[3][0] == 0.5);
+	}
+	BOOST_CHECK_SMALL(mbcs[0].q[1][0] - 0.2, 1e-4);
+
+	// dense backends assemble the problem in the reduced variables
+	// check them against the sparse backend column mapping
+	qp::QPSolver sparseSolver;
+	sparseSolver.solver("SPARSE");
+	sparseSolver.nrVars(mbs, {}, {});
+	sparseSolver.updateConstrSize();
+	sparseSolver.addTask(&pt);
+
+	mbcs[0] = mbcInit;
+	pt.posture({{}, {-0.3}, {0.3}, {0.5}});
+	for(int i = 0; i < 100; ++i)
+	{
+		BOOST_REQUIRE(sparseSolver.solveNoMbcUpdate(mbs, mbcs));
+		BOOST_REQUIRE(solver.solve(mbs, mbcs));
+		BOOST_CHECK_SMALL((solver.alphaDVec() - sparseSolver.alphaDVec()).norm(),
+			1e-5);
+		eulerIntegration(mbs[0], mbcs[0], 0.001);
+
+		forwardKinematics(mbs[0], mbcs[0]);
+		forwardVelocity(mbs[0], mbcs[0]);
+	}
+
+	// same check with active joint and torque limits,
+	// the posture target is outside the j0 limits and the joint limits
+	// anticipate on 0.1s to be able to stop with the torque limits
+	std::vector<std::vector<double> > lQBound = {{}, {-0.25}, {-0.25}, {0.4}};
+	std::vector<std::vector<double> > uQBound = {{}, {0.25}, {0.25}, {0.6}};
+	std::vector<std::vector<double> > lTBound = {{}, {-10.}, {-10.}, {-10.}};
+	std::vector<std::vector<double> > uTBound = {{}, {10.}, {10.}, {10.}};
+	qp::JointLimitsConstr jointConstr(mbs, 0, {lQBound, uQBound}, 0.1);
+	qp::MotionConstr motionConstr(mbs, 0, {lTBound, uTBound});
+	for(qp::QPSolver* s: {&solver, &sparseSolver})
+	{
+		jointConstr.addToSolver(*s);
+		motionConstr.addToSolver(*s);
+		s->nrVars(mbs, {}, {});
+		s->updateConstrSize();
+	}
+
+	mbcs[0] = mbcInit;
+	pt.posture({{}, {0.4}, {-0.4}, {0.5}});
+	bool torqueLimited = false;
+	for(int i = 0; i < 1000; ++i)
+	{
+		BOOST_REQUIRE(sparseSolver.solveNoMbcUpdate(mbs, mbcs));
+		BOOST_REQUIRE(solver.solve(mbs, mbcs));
+		BOOST_CHECK_SMALL((solver.alphaDVec() - sparseSolver.alphaDVec()).norm(),
+			1e-4);
+
+		motionConstr.computeTorque(solver.alphaDVec(), solver.lambdaVec());
+		const VectorXd& torque = motionConstr.torque();
+		BOOST_REQUIRE_LT(torque.cwiseAbs().maxCoeff(), 10. + 1e-6);
+		torqueLimited = torqueLimited || torque.cwiseAbs().maxCoeff() > 10. - 1e-4;
+
+		eulerIntegration(mbs[0], mbcs[0], 0.001);
+
+		forwardKinematics(mbs[0], mbcs[0]);
+		forwardVelocity(mbs[0], mbcs[0]);
+		BOOST_REQUIRE(mbcs[0].q[1][0] == -mbcs[0].q[2][0]);
+		BOOST_REQUIRE_LT(mbcs[0].q[1][0], 0.25 + 1e-3);
+	}
+	BOOST_CHECK(torqueLimited);
+	BOOST_CHECK_SMALL(mbcs[0].q[1][0] - 0.25, 1e-2);
+
+	for(qp::QPSolver* s: {&solver, &sparseSolver})
+	{
+		jointConstr.removeFromSolver(*s);
+		motionConstr.removeFromSolver(*s);
+	}
+
+	solver.removeTask(&pt);
+	BOOST_CHECK_EQUAL(solver.nrTasks(), 0);
+}
+
+
+BOOST_AUTO_TEST_CASE(QPTorqueLimitsTest)
+{
+	using namespace Eigen;
+	using namespace sva;
+	using namespace rbd;
+	using namespace tasks;
+	namespace cst = boost::math::constants;
+
+	MultiBody mb;
+	MultiBodyConfig mbcInit;
+
+	std::tie(mb, mbcInit) = makeZXZArm();
+
+	forwardKinematics(mb, mbcInit);
+	forwardVelocity(mb, mbcInit);
+
+	std::vector<rbd::MultiBody> mbs = {mb};
+	std::vector<rbd::MultiBodyConfig> mbcs = {mbcInit};
+
+	qp::QPSolver solver;
+
+	int bodyI = mb.bodyIndexByName("b3");
+	qp::PositionTask posTask(mbs, 0, "b3",
+		RotZ(cst::pi<double>()/2.)*mbcInit.bodyPosW[bodyI].translation());
+	qp::SetPointTask posTaskSp(mbs, 0, &posTask, 10., 1.);
+
+	std::vector<std::vector<double> > lBound = {{}, {-30.}, {-30.}, {-30.}};
+	std::vector<std::vector<double> > uBound = {{}, {30.}, {30.}, {30.}};
+
+	qp::MotionConstr motionCstr(mbs, 0, {lBound, uBound});
+	qp::PositiveLambda plCstr;
+
+	// Test add*Constraint
+
+	solver.addGenInequalityConstraint(&motionCstr);
+	BOOST_CHECK_EQUAL(solver.nrGenInequalityConstraints(), 1);
+	solver.addConstraint(&motionCstr);
+	BOOST_CHECK_EQUAL(solver.nrConstraints(), 1);
+
+	plCstr.addToSolver(solver);
+	BOOST_CHECK_EQUAL(solver.nrBoundConstraints(), 1);
+	BOOST_CHECK_EQUAL(solver.nrConstraints(), 2);
+
+	solver.addTask(&posTaskSp);
+	BOOST_CHECK_EQUAL(solver.nrTasks(), 1);
+
+	solver.nrVars(mbs, {}, {});
+	solver.updateConstrSize();
+
+
+	// Test MotionConstr torque limits
+	mbcs[0] = mbcInit;
+	for(int i = 0; i < 10000; ++i)
+	{
+		BOOST_REQUIRE(solver.solve(mbs, mbcs));
+		eulerIntegration(mbs[0], mbcs[0], 0.001);
+
+		forwardKinematics(mbs[0], mbcs[0]);
+		forwardVelocity(mbs[0], mbcs[0]);
+		motionCstr.computeTorque(solver.alphaDVec(), solver.lambdaVec());
+		motionCstr.torque(mbs, mbcs);
+		for(int i = 0; i < 3; ++i)
+		{
+			BOOST_REQUIRE_GT(mbcs[0].jointTorque[i+1][0], lBound[i+1][0] - 0.001);
+			BOOST_REQUIRE_LT(mbcs[0].jointTorque[i+1][0], uBound[i+1][0] + 0.001);
+		}
+	}
+
+	posTask.position(mbcInit.bodyPosW[bodyI].translation());
+	for(int i = 0; i < 10000; ++i)
+	{
+		BOOST_REQUIRE(solver.solve(mbs, mbcs));
 		eulerIntegration(mbs[0], mbcs[0], 0.001);
 
 		forwardKinematics(mbs[0], mbcs[0]);
@@ -890,6 +2386,112 @@ BOOST_AUTO_TEST_CASE(QPTorqueLimitsTest)
 
 
 
+BOOST_AUTO_TEST_CASE(QPGenInEqKindTest)
+{
+	using namespace Eigen;
+	using namespace rbd;
+	using namespace tasks;
+
+	const double inf = std::numeric_limits<double>::infinity();
+	BOOST_CHECK(qp::genInEqKind(0., 0.) == qp::GenInEqKind::Equal);
+	BOOST_CHECK(qp::genInEqKind(-inf, inf) == qp::GenInEqKind::None);
+	BOOST_CHECK(qp::genInEqKind(inf, inf) == qp::GenInEqKind::None);
+	BOOST_CHECK(qp::genInEqKind(-inf, -inf) == qp::GenInEqKind::None);
+	BOOST_CHECK(qp::genInEqKind(-inf, 1.) == qp::GenInEqKind::Upper);
+	BOOST_CHECK(qp::genInEqKind(-1., inf) == qp::GenInEqKind::Lower);
+	BOOST_CHECK(qp::genInEqKind(-1., 1.) == qp::GenInEqKind::Both);
+
+	// free flying arm, the free joint torques are equal to zero,
+	// j0 bounds are both infinite and equal, j1 has a lower bound
+	// and j2 both bounds
+	MultiBody mb;
+	MultiBodyConfig mbcInit;
+	std::tie(mb, mbcInit) = makeZXZArm(false);
+	forwardKinematics(mb, mbcInit);
+	forwardVelocity(mb, mbcInit);
+
+	std::vector<MultiBody> mbs = {mb};
+	std::vector<MultiBodyConfig> mbcs = {mbcInit};
+
+	std::vector<std::vector<double>> lTBound =
+		{{0., 0., 0., 0., 0., 0.}, {inf}, {-100.}, {-100.}};
+	std::vector<std::vector<double>> uTBound =
+		{{0., 0., 0., 0., 0., 0.}, {inf}, {inf}, {100.}};
+	qp::MotionConstr motionConstr(mbs, 0, {lTBound, uTBound});
+	qp::PostureTask postureTask(mbs, 0, mbcInit.q, 10., 1.);
+
+	qp::QPSolver qldSolver;
+	qldSolver.solver("QLD");
+	std::vector<std::unique_ptr<qp::QPSolver>> solvers;
+	for(const std::string& name: qp::qpSolverNames())
+	{
+		// SPARSE build its rows without the dense form but must drop j0 too
+		if(name == "GI" || name == "LSSOL" || name == "SPARSE")
+		{
+			solvers.emplace_back(new qp::QPSolver);
+			solvers.back()->solver(name);
+		}
+	}
+
+	std::vector<qp::QPSolver*> allSolvers = {&qldSolver};
+	for(auto& s: solvers)
+	{
+		allSolvers.push_back(s.get());
+	}
+	for(qp::QPSolver* s: allSolvers)
+	{
+		motionConstr.addToSolver(*s);
+		s->addTask(&postureTask);
+		s->nrVars(mbs, {}, {});
+		s->updateConstrSize();
+	}
+
+	const int nrVars = qldSolver.nrVars();
+	const int nrGenInEq = motionConstr.maxGenInEq();
+	BOOST_REQUIRE_EQUAL(nrGenInEq, 9);
+
+	Eigen::MatrixXd Aeq(MatrixXd::Zero(nrGenInEq, nrVars));
+	Eigen::MatrixXd Aineq(MatrixXd::Zero(2*nrGenInEq, nrVars));
+	Eigen::VectorXd beq(nrGenInEq), bineq(2*nrGenInEq);
+	qp::AFillCache eqCache, ineqCache;
+	for(int i = 0; i < 100; ++i)
+	{
+		for(auto& s: solvers)
+		{
+			BOOST_REQUIRE(s->solveNoMbcUpdate(mbs, mbcs));
+		}
+		BOOST_REQUIRE(qldSolver.solve(mbs, mbcs));
+		for(auto& s: solvers)
+		{
+			BOOST_CHECK_SMALL((s->alphaDVec() - qldSolver.alphaDVec()).norm(), 1e-5);
+		}
+
+		// the QLD standard form has 6 equality lines (free joint)
+		// and 1 + 2 inequality lines (j1 and j2) instead of 2*9 inequality lines
+		int nrAeqLines = 0, nrAineqLines = 0;
+		eqCache.reset();
+		ineqCache.reset();
+		qp::fillGenInEq({&motionConstr}, nrVars, nrAeqLines, eqCache, Aeq, beq,
+			nrAineqLines, ineqCache, Aineq, bineq);
+		BOOST_REQUIRE_EQUAL(nrAeqLines, 6);
+		BOOST_REQUIRE_EQUAL(nrAineqLines, 3);
+		BOOST_CHECK_EQUAL(beq.head(6).norm(), 0.);
+		BOOST_CHECK_EQUAL(bineq(0), 100.);
+		BOOST_CHECK_EQUAL(bineq(1), 100.);
+		BOOST_CHECK_EQUAL(bineq(2), 100.);
+
+		// the QLD solution satisfies the reduced lines
+		const VectorXd& x = qldSolver.alphaDVec();
+		BOOST_CHECK_SMALL((Aeq.topRows(6)*x - beq.head(6)).norm(), 1e-6);
+		BOOST_CHECK_LT((Aineq.topRows(3)*x - bineq.head(3)).maxCoeff(), 1e-6);
+
+		eulerIntegration(mbs[0], mbcs[0], 0.001);
+		forwardKinematics(mbs[0], mbcs[0]);
+		forwardVelocity(mbs[0], mbcs[0]);
+	}
+}
+
+
 BOOST_AUTO_TEST_CASE(QPAutoCollTest)
 {
 	using namespace Eigen;
@@ -1231,6 +2833,451 @@ BOOST_AUTO_TEST_CASE(QPBilatContactTest)
 }
 
 
+namespace
+{
+
+/**
+	* Check the block fill of a constraint matrix against the fill
+	* of its nrVars columns wide expansion.
+	*/
+void checkColBlockFill(const Eigen::MatrixXd& Ai,
+	const std::vector<tasks::qp::ColBlock>& blocks, int nrVars)
+{
+	using namespace Eigen;
+	using namespace tasks::qp;
+
+	int nrLines = int(Ai.rows());
+	MatrixXd dense = expandColBlocks(Ai, blocks, nrVars);
+	BOOST_REQUIRE_EQUAL(dense.rows(), nrLines);
+	BOOST_REQUIRE_EQUAL(dense.cols(), nrVars);
+
+	// dense fill
+	MatrixXd ADense(MatrixXd::Random(nrLines + 2, nrVars));
+	fillA(dense, {ColBlock::full()}, 0, nrLines, nrVars, 1, -1., ADense);
+	BOOST_CHECK_SMALL((ADense.middleRows(1, nrLines) + dense).norm(), 1e-10);
+
+	// block fill in lines holding garbage, the lines around are left untouched
+	MatrixXd A(MatrixXd::Random(nrLines + 2, nrVars));
+	MatrixXd AInit = A;
+	AFillCache cache;
+	cache.start();
+	cache.fill(&Ai, -1, Ai, blocks, nrLines, nrVars, 1, -1., A);
+	BOOST_CHECK_SMALL((A.middleRows(1, nrLines) + dense).norm(), 1e-10);
+	BOOST_CHECK_EQUAL((A.row(0) - AInit.row(0)).norm(), 0.);
+	BOOST_CHECK_EQUAL((A.row(nrLines + 1) - AInit.row(nrLines + 1)).norm(), 0.);
+
+	// block fill in the reduced variables of an identity reduction
+	VariableReduction red;
+	red.nrFull = red.nrReduced = nrVars;
+	red.runs.push_back({0, 0, nrVars});
+	MatrixXd ARed(MatrixXd::Random(nrLines, nrVars));
+	AFillCache cacheRed;
+	cacheRed.reset(red);
+	cacheRed.start();
+	cacheRed.fill(&Ai, -1, Ai, blocks, nrLines, nrVars, 0, 1., ARed);
+	BOOST_CHECK_SMALL((ARed - dense).norm(), 1e-10);
+
+	VectorXd x(VectorXd::Random(nrVars));
+	for(int l = 0; l < nrLines; ++l)
+	{
+		BOOST_CHECK_SMALL(rowDot(Ai, blocks, l, x) - dense.row(l).dot(x), 1e-10);
+	}
+}
+
+}
+
+
+BOOST_AUTO_TEST_CASE(QPColBlockTest)
+{
+	using namespace Eigen;
+	using namespace sva;
+	using namespace rbd;
+	using namespace tasks;
+	namespace cst = boost::math::constants;
+
+	// full block and empty block list
+	MatrixXd A(MatrixXd::Random(2, 3));
+	BOOST_CHECK(qp::isDenseColBlocks({qp::ColBlock::full()}));
+	BOOST_CHECK(!qp::isDenseColBlocks({}));
+	BOOST_CHECK_EQUAL((qp::expandColBlocks(A, {qp::ColBlock::full()}, -1) - A).norm(), 0.);
+	BOOST_CHECK_EQUAL(qp::expandColBlocks(A, {}, 5).norm(), 0.);
+	BOOST_CHECK_THROW(qp::expandColBlocks(A, {qp::ColBlock(1, 2, 0)}, -1),
+		std::domain_error);
+	BOOST_CHECK_THROW(qp::expandColBlocks(A, {qp::ColBlock(4, 2, 0)}, 5),
+		std::domain_error);
+	checkColBlockFill(A, {qp::ColBlock(3, 2, 1)}, 5);
+	checkColBlockFill(A, {}, 5);
+
+	// the constraints are only on the second robot
+	MultiBody mb1, mb2, mbEnv;
+	MultiBodyConfig mbc1, mbc2, mbcEnv;
+
+	std::tie(mb1, mbc1) = makeZXZArm();
+	std::tie(mb2, mbc2) = makeZXZArm(false);
+	std::tie(mbEnv, mbcEnv) = makeEnv();
+
+	std::vector<MultiBody> mbs = {mb1, mb2, mbEnv};
+	std::vector<MultiBodyConfig> mbcs = {mbc1, mbc2, mbcEnv};
+	for(std::size_t r = 0; r < mbs.size(); ++r)
+	{
+		forwardKinematics(mbs[r], mbcs[r]);
+		forwardVelocity(mbs[r], mbcs[r]);
+	}
+
+	double Inf = std::numeric_limits<double>::infinity();
+	std::vector<std::vector<double>> torqueMin = {{0., 0., 0., 0., 0., 0.},{-Inf},{-Inf},{-Inf}};
+	std::vector<std::vector<double>> torqueMax = {{0., 0., 0., 0., 0., 0.},{Inf},{Inf},{Inf}};
+	qp::MotionConstr motionCstr(mbs, 1, {torqueMin, torqueMax});
+	qp::ContactAccConstr contCstrAcc;
+
+	sch::S_Sphere b3(0.25), b0(0.25);
+	PTransformd I = PTransformd::Identity();
+	qp::CollisionConstr collCstr(mbs, 0.001);
+	collCstr.addCollision(mbs, 10,
+		1, "b3", &b3, I,
+		2, "b0", &b0, I,
+		0.01, 0.005, 1.);
+	// without collision the matrix has no non zero column
+	qp::CollisionConstr emptyCollCstr(mbs, 0.001);
+
+	qp::ContactId cId(1, 2, "b3", "b0");
+	qp::GripperTorqueConstr gripCstr;
+	gripCstr.addGripper(cId, 1., Vector3d::Zero(), Vector3d::UnitZ());
+
+	qp::BoundedSpeedConstr speedCstr(mbs, 1, 0.005);
+	MatrixXd dof(1, 6);
+	VectorXd speed(1);
+	dof << 0., 0., 0., 1., 0., 0.;
+	speed << 0.;
+	speedCstr.addBoundedSpeed(mbs, "b3", Vector3d::Zero(), dof, speed);
+
+	qp::QPSolver solver;
+	motionCstr.addToSolver(solver);
+	solver.addEqualityConstraint(&contCstrAcc);
+	solver.addConstraint(&contCstrAcc);
+	collCstr.addToSolver(solver);
+	emptyCollCstr.addToSolver(solver);
+	gripCstr.addToSolver(solver);
+	speedCstr.addToSolver(solver);
+
+	std::vector<Eigen::Vector3d> points =
+		{
+			Vector3d(0.1, 0.1, 0.),
+			Vector3d(-0.1, 0.1, 0.),
+			Vector3d(-0.1, -0.1, 0.),
+			Vector3d(0.1, -0.1, 0.)
+		};
+	std::vector<Eigen::Matrix3d> biFrames =
+		{
+			sva::RotY((0.*cst::pi<double>())/2.),
+			sva::RotY((1.*cst::pi<double>())/2.),
+			sva::RotY((2.*cst::pi<double>())/2.),
+			sva::RotY((3.*cst::pi<double>())/2.),
+		};
+	std::vector<qp::BilateralContact> bi =
+		{qp::BilateralContact(cId, points, biFrames, I, 3, 0.7)};
+
+	solver.nrVars(mbs, {}, bi);
+	solver.updateConstrSize();
+	// only update the constraints matrices, the problem can be infeasible
+	solver.solve(mbs, mbcs);
+
+	int nrVars = solver.nrVars();
+	BOOST_CHECK(!qp::isDenseColBlocks(contCstrAcc.AEqBlocks()));
+	BOOST_CHECK_LT(contCstrAcc.AEq().cols(), nrVars);
+	checkColBlockFill(contCstrAcc.AEq(), contCstrAcc.AEqBlocks(), nrVars);
+
+	BOOST_CHECK(!qp::isDenseColBlocks(collCstr.AInEqBlocks()));
+	checkColBlockFill(collCstr.AInEq(), collCstr.AInEqBlocks(), nrVars);
+
+	BOOST_CHECK(emptyCollCstr.AInEqBlocks().empty());
+	checkColBlockFill(emptyCollCstr.AInEq(), emptyCollCstr.AInEqBlocks(), nrVars);
+
+	BOOST_CHECK(!qp::isDenseColBlocks(gripCstr.AInEqBlocks()));
+	BOOST_CHECK_LT(gripCstr.AInEq().cols(), nrVars);
+	checkColBlockFill(gripCstr.AInEq(), gripCstr.AInEqBlocks(), nrVars);
+
+	BOOST_CHECK(!qp::isDenseColBlocks(speedCstr.AGenInEqBlocks()));
+	BOOST_CHECK_LT(speedCstr.AGenInEq().cols(), nrVars);
+	checkColBlockFill(speedCstr.AGenInEq(), speedCstr.AGenInEqBlocks(), nrVars);
+
+	BOOST_CHECK(!qp::isDenseColBlocks(motionCstr.AGenInEqBlocks()));
+	checkColBlockFill(motionCstr.AGenInEq(), motionCstr.AGenInEqBlocks(), nrVars);
+
+	speedCstr.removeFromSolver(solver);
+	gripCstr.removeFromSolver(solver);
+	emptyCollCstr.removeFromSolver(solver);
+	collCstr.removeFromSolver(solver);
+	solver.removeEqualityConstraint(&contCstrAcc);
+	solver.removeConstraint(&contCstrAcc);
+	motionCstr.removeFromSolver(solver);
+}
+
+
+BOOST_AUTO_TEST_CASE(QPCapacityTest)
+{
+	using namespace Eigen;
+	using namespace sva;
+	using namespace rbd;
+	using namespace tasks;
+	namespace cst = boost::math::constants;
+
+	MultiBody mb, mbEnv;
+	MultiBodyConfig mbcInit, mbcEnv;
+
+	std::tie(mb, mbcInit) = makeZXZArm(false);
+	std::tie(mbEnv, mbcEnv) = makeEnv();
+
+	forwardKinematics(mb, mbcInit);
+	forwardVelocity(mb, mbcInit);
+	forwardKinematics(mbEnv, mbcEnv);
+	forwardVelocity(mbEnv, mbcEnv);
+
+	std::vector<MultiBody> mbs = {mb, mbEnv};
+	std::vector<MultiBodyConfig> mbcs = {mbcInit, mbcEnv};
+
+	double Inf = std::numeric_limits<double>::infinity();
+	std::vector<std::vector<double>> torqueMin = {{0., 0., 0., 0., 0., 0.},{-Inf},{-Inf},{-Inf}};
+	std::vector<std::vector<double>> torqueMax = {{0., 0., 0., 0., 0., 0.},{Inf},{Inf},{Inf}};
+
+	std::vector<Eigen::Vector3d> points =
+		{
+			Vector3d(0.1, 0.1, 0.),
+			Vector3d(-0.1, 0.1, 0.),
+			Vector3d(-0.1, -0.1, 0.),
+			Vector3d(0.1, -0.1, 0.)
+		};
+
+	std::vector<Eigen::Matrix3d> biFrames =
+		{
+			sva::RotY((0.*cst::pi<double>())/2.),
+			sva::RotY((1.*cst::pi<double>())/2.),
+			sva::RotY((2.*cst::pi<double>())/2.),
+			sva::RotY((3.*cst::pi<double>())/2.),
+		};
+
+	std::vector<qp::BilateralContact> bi =
+		{qp::BilateralContact(0, 1, "b0", "b0",
+			points, biFrames, sva::PTransformd::Identity(),
+			3, 0.7)};
+
+	// solver with a capacity for the bilateral contact and reference solver
+	qp::QPSolver solver, solverRef;
+	qp::MotionConstr motionCstr(mbs, 0, {torqueMin, torqueMax});
+	qp::MotionConstr motionCstrRef(mbs, 0, {torqueMin, torqueMax});
+	qp::PositiveLambda plCstr, plCstrRef;
+	qp::ContactAccConstr contCstrAcc, contCstrAccRef;
+
+	motionCstr.addToSolver(solver);
+	plCstr.addToSolver(solver);
+	solver.addEqualityConstraint(&contCstrAcc);
+	solver.addConstraint(&contCstrAcc);
+
+	motionCstrRef.addToSolver(solverRef);
+	plCstrRef.addToSolver(solverRef);
+	solverRef.addEqualityConstraint(&contCstrAccRef);
+	solverRef.addConstraint(&contCstrAccRef);
+
+	qp::QPCapacity capacity;
+	capacity.nrContacts = 1;
+	capacity.nrLambda = 4*3;
+	solver.capacity(capacity);
+
+	// switch the contact on and off, updateConstrSize is only called
+	// on the reference solver
+	for(int i = 0; i < 6; ++i)
+	{
+		std::vector<qp::BilateralContact> contacts =
+			i % 2 == 0 ? bi : std::vector<qp::BilateralContact>();
+		solver.nrVars(mbs, {}, contacts);
+		solverRef.nrVars(mbs, {}, contacts);
+		solverRef.updateConstrSize();
+
+		BOOST_CHECK_EQUAL(solver.nrVars(), 9 + 4*3);
+		BOOST_CHECK_EQUAL(solverRef.nrVars(), 9 + int(contacts.size())*4*3);
+		BOOST_CHECK_EQUAL(solver.data().totalLambda(), int(contacts.size())*4*3);
+
+		mbcs[0] = mbcInit;
+		BOOST_REQUIRE(solver.solveNoMbcUpdate(mbs, mbcs));
+		BOOST_REQUIRE(solverRef.solveNoMbcUpdate(mbs, mbcs));
+
+		BOOST_CHECK_SMALL((solver.alphaDVec() - solverRef.alphaDVec()).norm(), 1e-6);
+		BOOST_CHECK_SMALL((solver.lambdaVec() - solverRef.lambdaVec()).norm(), 1e-6);
+		// unused lambda variables
+		BOOST_CHECK_SMALL(solver.result().tail(solver.nrVars() -
+			solverRef.nrVars()).norm(), 1e-6);
+	}
+
+	solver.removeEqualityConstraint(&contCstrAcc);
+	solver.removeConstraint(&contCstrAcc);
+	plCstr.removeFromSolver(solver);
+	motionCstr.removeFromSolver(solver);
+
+	solverRef.removeEqualityConstraint(&contCstrAccRef);
+	solverRef.removeConstraint(&contCstrAccRef);
+	plCstrRef.removeFromSolver(solverRef);
+	motionCstrRef.removeFromSolver(solverRef);
+}
+
+
+BOOST_AUTO_TEST_CASE(QPAddContactTest)
+{
+	using namespace Eigen;
+	using namespace sva;
+	using namespace rbd;
+	using namespace tasks;
+	namespace cst = boost::math::constants;
+
+	MultiBody mb, mbEnv;
+	MultiBodyConfig mbcInit, mbcEnv;
+
+	std::tie(mb, mbcInit) = makeZXZArm(false);
+	std::tie(mbEnv, mbcEnv) = makeEnv();
+
+	forwardKinematics(mb, mbcInit);
+	forwardVelocity(mb, mbcInit);
+	forwardKinematics(mbEnv, mbcEnv);
+	forwardVelocity(mbEnv, mbcEnv);
+
+	std::vector<MultiBody> mbs = {mb, mbEnv};
+	std::vector<MultiBodyConfig> mbcs = {mbcInit, mbcEnv};
+
+	double Inf = std::numeric_limits<double>::infinity();
+	std::vector<std::vector<double>> torqueMin = {{0., 0., 0., 0., 0., 0.},{-Inf},{-Inf},{-Inf}};
+	std::vector<std::vector<double>> torqueMax = {{0., 0., 0., 0., 0., 0.},{Inf},{Inf},{Inf}};
+
+	std::vector<Eigen::Vector3d> points =
+		{
+			Vector3d(0.1, 0.1, 0.),
+			Vector3d(-0.1, 0.1, 0.),
+			Vector3d(-0.1, -0.1, 0.),
+			Vector3d(0.1, -0.1, 0.)
+		};
+
+	std::vector<Eigen::Matrix3d> biFrames =
+		{
+			sva::RotY((0.*cst::pi<double>())/2.),
+			sva::RotY((1.*cst::pi<double>())/2.),
+			sva::RotY((2.*cst::pi<double>())/2.),
+			sva::RotY((3.*cst::pi<double>())/2.),
+		};
+
+	qp::BilateralContact biB0(0, 1, "b0", "b0",
+		points, biFrames, sva::PTransformd::Identity(), 3, 0.7);
+	qp::BilateralContact biB3(0, 1, "b3", "b0",
+		points, biFrames, mbcInit.bodyPosW[3]*mbcEnv.bodyPosW[0].inv(), 3, 0.7);
+
+	// solver built incrementally and reference solver built with nrVars
+	qp::QPSolver solver, solverRef;
+	qp::MotionConstr motionCstr(mbs, 0, {torqueMin, torqueMax});
+	qp::MotionConstr motionCstrRef(mbs, 0, {torqueMin, torqueMax});
+	qp::PositiveLambda plCstr, plCstrRef;
+	qp::ContactAccConstr contCstrAcc, contCstrAccRef;
+
+	motionCstr.addToSolver(solver);
+	plCstr.addToSolver(solver);
+	contCstrAcc.addToSolver(solver);
+
+	motionCstrRef.addToSolver(solverRef);
+	plCstrRef.addToSolver(solverRef);
+	contCstrAccRef.addToSolver(solverRef);
+
+	auto check = [&](int nrContacts)
+	{
+		solverRef.nrVars(mbs, {}, solver.data().bilateralContacts());
+		solverRef.updateConstrSize();
+
+		BOOST_CHECK_EQUAL(solver.data().nrContacts(), nrContacts);
+		BOOST_CHECK_EQUAL(solver.nrVars(), solverRef.nrVars());
+		BOOST_CHECK_EQUAL(solver.nrVars(), 9 + nrContacts*4*3);
+
+		mbcs[0] = mbcInit;
+		BOOST_REQUIRE(solver.solveNoMbcUpdate(mbs, mbcs));
+		BOOST_REQUIRE(solverRef.solveNoMbcUpdate(mbs, mbcs));
+		BOOST_CHECK_SMALL((solver.result() - solverRef.result()).norm(), 1e-6);
+	};
+
+	solver.nrVars(mbs, {}, {});
+	BOOST_CHECK(solver.addContact(mbs, biB0));
+	check(1);
+	// a contact id can only be added once
+	BOOST_CHECK(!solver.addContact(mbs, biB0));
+	BOOST_CHECK(!solver.addContact(mbs, qp::UnilateralContact(biB0.contactId,
+		points, Matrix3d::Identity(), sva::PTransformd::Identity(), 3, 0.7)));
+	check(1);
+	// biB0 data are reused by the constraints
+	BOOST_CHECK(solver.addContact(mbs, biB3));
+	check(2);
+	BOOST_CHECK(solver.removeContact(mbs, biB3.contactId));
+	check(1);
+	BOOST_CHECK(!solver.removeContact(mbs, biB3.contactId));
+	BOOST_CHECK(solver.removeContact(mbs, biB0.contactId));
+	check(0);
+
+	// alternate between two contact sets, the layouts are reused
+	solver.backendCacheSize(2);
+	for(int i = 0; i < 4; ++i)
+	{
+		std::vector<qp::BilateralContact> bi = {biB0};
+		if(i % 2 == 1)
+		{
+			bi.push_back(biB3);
+		}
+		solver.nrVars(mbs, {}, bi);
+		check(int(bi.size()));
+	}
+	BOOST_CHECK_EQUAL(solver.backendCacheMisses(), 2);
+	BOOST_CHECK_EQUAL(solver.backendCacheHits(), 2);
+
+	// the backend sized while the cache is disabled must not be filed
+	// under the contact set of the last cached layout
+	std::vector<qp::BilateralContact> biA = {biB0}, biB = {biB0, biB3};
+	solver.nrVars(mbs, {}, biA);
+	check(1);
+	solver.backendCacheSize(0);
+	solver.nrVars(mbs, {}, biB);
+	check(2);
+	solver.backendCacheSize(2);
+	solver.nrVars(mbs, {}, {});
+	check(0);
+	solver.nrVars(mbs, {}, biA);
+	check(1);
+	BOOST_CHECK_EQUAL(solver.backendCacheMisses(), 4);
+	BOOST_CHECK_EQUAL(solver.backendCacheHits(), 3);
+
+	// the contact body Jacobians of the last solve are in the kinematics cache
+	int jacIndex = solver.data().bodyJacobianIndex(0, mbs[0].bodyIndexByName("b3"));
+	BOOST_REQUIRE_GE(jacIndex, 0);
+	rbd::Jacobian jacB3(mbs[0], "b3");
+	BOOST_CHECK_SMALL((solver.data().bodyJacobian(jacIndex) -
+		jacB3.bodyJacobian(mbs[0], mbcs[0])).norm(), 1e-10);
+
+	// H and C of the robot come from the dynamics cache
+	const rbd::ForwardDynamics& fd = solver.data().forwardDynamics(
+		solver.data().dynamicsIndex(0));
+	BOOST_CHECK_EQUAL(&motionCstr.fd(), &fd);
+	rbd::ForwardDynamics fdRef(mbs[0]);
+	fdRef.computeH(mbs[0], mbcs[0]);
+	fdRef.computeC(mbs[0], mbcs[0]);
+	BOOST_CHECK_SMALL((fd.H() - fdRef.H()).norm(), 1e-10);
+	BOOST_CHECK_SMALL((fd.C() - fdRef.C()).norm(), 1e-10);
+
+	// outside of the solver cycle the constraint computes its own H and C
+	motionCstr.update(mbs, mbcs, solver.data());
+	BOOST_CHECK_NE(&motionCstr.fd(), &fd);
+	BOOST_CHECK_SMALL((motionCstr.fd().H() - fdRef.H()).norm(), 1e-10);
+	BOOST_CHECK_SMALL((motionCstr.fd().C() - fdRef.C()).norm(), 1e-10);
+
+	contCstrAcc.removeFromSolver(solver);
+	plCstr.removeFromSolver(solver);
+	motionCstr.removeFromSolver(solver);
+
+	contCstrAccRef.removeFromSolver(solverRef);
+	plCstrRef.removeFromSolver(solverRef);
+	motionCstrRef.removeFromSolver(solverRef);
+}
+
+
 Eigen::Vector6d compute6dError(const sva::PTransformd& b1, const sva::PTransformd& b2)
 {
 	Eigen::Vector6d error;